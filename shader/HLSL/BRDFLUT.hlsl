@@ -0,0 +1,45 @@
+#ifndef BRDF_LUT_HLSL
+#define BRDF_LUT_HLSL
+
+// Lookups into the tables of HWPT::BRDFLUT, u is cos(theta) and v the perceptual roughness at texel centers,
+// so a clamping linear sampler interpolates them directly. Textures are passed in so raster and compute
+// passes can bind them wherever they like
+
+static const float BRDFLUTPI = 3.14159265358979323846f;
+
+// Prefiltered environment lighting times this gives the split-sum specular
+float3 SplitSumSpecular(Texture2D<float2> SplitSum, SamplerState Sampler, float3 F0, float NdotV, float Roughness) {
+    float2 ScaleBias = SplitSum.SampleLevel(Sampler, float2(saturate(NdotV), saturate(Roughness)), 0);
+    return F0 * ScaleBias.x + ScaleBias.y;
+}
+
+// Hemispherical average of Schlick's Fresnel
+float3 AverageFresnel(float3 F0) {
+    return F0 * (20.f / 21.f) + 1.f / 21.f;
+}
+
+// Kulla and Conty 2017: the energy single scattering GGX loses, as an extra lobe to add to the BRDF
+// for a path tracer. Multiply by NdotL like the single scattering lobe
+float3 GGXMultiScatterLobe(Texture2D<float> Energy, Texture2D<float> EnergyAverage, SamplerState Sampler,
+                           float3 F0, float NdotV, float NdotL, float Roughness) {
+    float EV = Energy.SampleLevel(Sampler, float2(saturate(NdotV), saturate(Roughness)), 0);
+    float EL = Energy.SampleLevel(Sampler, float2(saturate(NdotL), saturate(Roughness)), 0);
+    float EAvg = EnergyAverage.SampleLevel(Sampler, float2(saturate(Roughness), .5f), 0);
+    float Lobe = (1.f - EV) * (1.f - EL) / (BRDFLUTPI * max(1.f - EAvg, 1e-4f));
+    float3 FAvg = AverageFresnel(F0);
+    float3 Tint = FAvg * FAvg * EAvg / max(1.f - FAvg * (1.f - EAvg), 1e-4f);
+    return Lobe * Tint;
+}
+
+// Cosine-weighted integral of GGXMultiScatterLobe over the hemisphere, the multiple scattering analogue of
+// SplitSumSpecular for image based lighting
+float3 GGXMultiScatterAlbedo(Texture2D<float> Energy, Texture2D<float> EnergyAverage, SamplerState Sampler,
+                             float3 F0, float NdotV, float Roughness) {
+    float EV = Energy.SampleLevel(Sampler, float2(saturate(NdotV), saturate(Roughness)), 0);
+    float EAvg = EnergyAverage.SampleLevel(Sampler, float2(saturate(Roughness), .5f), 0);
+    float3 FAvg = AverageFresnel(F0);
+    // The hemispherical integral of (1 - E(mu)) mu is pi (1 - EAvg), which cancels the lobe's denominator
+    return (1.f - EV) * FAvg * FAvg * EAvg / max(1.f - FAvg * (1.f - EAvg), 1e-4f);
+}
+
+#endif
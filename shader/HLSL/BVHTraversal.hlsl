@@ -0,0 +1,89 @@
+#ifndef BVH_TRAVERSAL_HLSL
+#define BVH_TRAVERSAL_HLSL
+
+// Traversal of the BVH built by GPUBVHBuild.hlsl, plain compute so it runs on devices without ray
+// tracing pipelines. The BVH takes bindings 0-3 of set 0, kernels including this start at binding 4
+
+#include "GPUBVHCommon.hlsl"
+
+// One entry per level below the root, HWPT::GPUBVH::Build rejects trees deeper than this
+#define TRAVERSAL_STACK_SIZE 64
+// Header slot of GPUBVHBuild.hlsl counting rays that ran out of stack
+#define BVH_HEADER_TRAVERSAL_OVERFLOWS 4
+
+StructuredBuffer<GPUBVHNode> BVHNodes : register(t0);
+StructuredBuffer<float4> BVHPositions : register(t1);
+StructuredBuffer<uint> BVHIndices : register(t2);
+RWStructuredBuffer<uint> BVHHeader : register(u3);  // BVHHeader[0] is the root
+
+// Nearer child first with a short stack, AnyHit stops at the first triangle closer than Hit.T. A ray
+// that would overflow the stack is counted and reported as a miss rather than skipping a subtree
+bool TraceBVH(GPURay Ray, bool AnyHit, inout GPURayHit Hit) {
+    float3 InvDirection = 1.f / Ray.Direction;
+    bool Found = false;
+
+    uint Stack[TRAVERSAL_STACK_SIZE];
+    uint StackSize = 0;
+    uint NodeIndex = BVHHeader[0];
+    GPUBVHNode Root = BVHNodes[NodeIndex];
+    if (IntersectAABB(Root.Min, Root.Max, Ray.Origin, InvDirection, Ray.TMin, Hit.T) < 0.f) {
+        return false;
+    }
+
+    while (true) {
+        GPUBVHNode Node = BVHNodes[NodeIndex];
+        if (IsLeaf(Node)) {
+            uint Triangle = Node.Left;
+            float T;
+            float2 Barycentrics;
+            if (IntersectTriangle(BVHPositions[BVHIndices[3 * Triangle + 0]].xyz,
+                                  BVHPositions[BVHIndices[3 * Triangle + 1]].xyz,
+                                  BVHPositions[BVHIndices[3 * Triangle + 2]].xyz, Ray, Hit.T, T, Barycentrics)) {
+                Hit.T = T;
+                Hit.PrimitiveID = Triangle;
+                Hit.Barycentrics = Barycentrics;
+                Found = true;
+                if (AnyHit) {
+                    return true;
+                }
+            }
+        }
+        else {
+            GPUBVHNode Left = BVHNodes[Node.Left];
+            GPUBVHNode Right = BVHNodes[Node.Right];
+            float TLeft = IntersectAABB(Left.Min, Left.Max, Ray.Origin, InvDirection, Ray.TMin, Hit.T);
+            float TRight = IntersectAABB(Right.Min, Right.Max, Ray.Origin, InvDirection, Ray.TMin, Hit.T);
+            if (TLeft >= 0.f && TRight >= 0.f) {
+                uint Near = TLeft <= TRight ? Node.Left : Node.Right;
+                uint Far = TLeft <= TRight ? Node.Right : Node.Left;
+                if (StackSize == TRAVERSAL_STACK_SIZE) {
+                    InterlockedAdd(BVHHeader[BVH_HEADER_TRAVERSAL_OVERFLOWS], 1);
+                    Hit.PrimitiveID = GPU_BVH_LEAF;
+                    return false;
+                }
+                Stack[StackSize++] = Far;
+                NodeIndex = Near;
+                continue;
+            }
+            if (TLeft >= 0.f || TRight >= 0.f) {
+                NodeIndex = TLeft >= 0.f ? Node.Left : Node.Right;
+                continue;
+            }
+        }
+        if (StackSize == 0) {
+            break;
+        }
+        NodeIndex = Stack[--StackSize];
+    }
+    return Found;
+}
+
+bool IsOccluded(GPURay Ray) {
+    GPURayHit Hit;
+    Hit.T = Ray.TMax;
+    Hit.PrimitiveID = GPU_BVH_LEAF;
+    Hit.Barycentrics = float2(0.f, 0.f);
+    return TraceBVH(Ray, true, Hit);
+}
+
+#endif
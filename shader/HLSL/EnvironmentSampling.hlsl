@@ -0,0 +1,104 @@
+#ifndef ENVIRONMENT_SAMPLING_HLSL
+#define ENVIRONMENT_SAMPLING_HLSL
+
+// GPU side of HWPT::EnvironmentMap, indexing matches the CPU tables exactly
+
+// Kernels that bind the environment next to their own resources define the space before the include. Set 1
+// is the bindless heap and set 2 belongs to Sampling.hlsl
+#ifndef ENVIRONMENT_SPACE
+#define ENVIRONMENT_SPACE space3
+#endif
+
+struct AliasEntry {
+    float Probability;
+    uint Alias;
+};
+
+cbuffer EnvironmentInfo : register(b0, ENVIRONMENT_SPACE) {
+    uint EnvWidth;
+    uint EnvHeight;
+    float EnvInvWeightSum;
+    float EnvPadding;
+};
+
+// [EnvHeight marginal entries][EnvHeight * EnvWidth conditional entries]
+StructuredBuffer<AliasEntry> EnvAliasTable : register(t1, ENVIRONMENT_SPACE);
+Texture2D<float4> EnvRadiance : register(t2, ENVIRONMENT_SPACE);
+
+static const float EnvPI = 3.14159265358979323846f;
+
+float EnvLuminance(float3 Color) {
+    return dot(Color, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
+uint SampleAliasTable(uint Offset, uint Count, float U, out float Remapped) {
+    float Scaled = U * Count;
+    uint Index = min(uint(Scaled), Count - 1);
+    float Fraction = min(Scaled - Index, 0.99999994f);
+    AliasEntry Entry = EnvAliasTable[Offset + Index];
+    if (Fraction < Entry.Probability) {
+        Remapped = Fraction / Entry.Probability;
+        return Index;
+    }
+    Remapped = (Fraction - Entry.Probability) / (1.f - Entry.Probability);
+    return Entry.Alias;
+}
+
+float3 EnvSphericalToDirection(float Theta, float Phi) {
+    float SinTheta = sin(Theta);
+    return float3(SinTheta * cos(Phi), cos(Theta), SinTheta * sin(Phi));
+}
+
+uint2 EnvDirectionToPixel(float3 Direction) {
+    float Theta = acos(clamp(Direction.y, -1.f, 1.f));
+    float Phi = atan2(Direction.z, Direction.x);
+    Phi = Phi < 0.f ? Phi + 2.f * EnvPI : Phi;
+    return uint2(min(uint(Phi / (2.f * EnvPI) * EnvWidth), EnvWidth - 1),
+                 min(uint(Theta / EnvPI * EnvHeight), EnvHeight - 1));
+}
+
+// Pixel pdf is Luminance * sin(ThetaCenter) / WeightSum, mapped to solid angle
+float EnvPixelPdfToSolidAngle(uint2 Pixel, float SinTheta) {
+    float SinThetaCenter = sin(EnvPI * (Pixel.y + .5f) / EnvHeight);
+    float PixelPdf = max(EnvLuminance(EnvRadiance.Load(int3(Pixel, 0)).xyz), 0.f) *
+                     SinThetaCenter * EnvInvWeightSum;
+    return PixelPdf * EnvWidth * EnvHeight / (2.f * EnvPI * EnvPI * SinTheta);
+}
+
+float EnvironmentPdf(float3 Direction) {
+    float SinTheta = sqrt(max(0.f, 1.f - Direction.y * Direction.y));
+    if (SinTheta <= 0.f || EnvInvWeightSum <= 0.f) {
+        return 0.f;
+    }
+    return EnvPixelPdfToSolidAngle(EnvDirectionToPixel(Direction), SinTheta);
+}
+
+float3 EnvironmentLookup(float3 Direction) {
+    return EnvRadiance.Load(int3(EnvDirectionToPixel(Direction), 0)).xyz;
+}
+
+// O(1): one marginal and one conditional alias lookup
+float3 SampleEnvironment(float2 U, out float3 Direction, out float Pdf) {
+    Direction = float3(0.f, 1.f, 0.f);
+    Pdf = 0.f;
+    if (EnvInvWeightSum <= 0.f) {
+        return float3(0.f, 0.f, 0.f);
+    }
+
+    float V, UU;
+    uint Row = SampleAliasTable(0, EnvHeight, U.y, V);
+    uint Column = SampleAliasTable(EnvHeight + Row * EnvWidth, EnvWidth, U.x, UU);
+
+    float Theta = EnvPI * (Row + V) / EnvHeight;
+    float Phi = 2.f * EnvPI * (Column + UU) / EnvWidth;
+    float SinTheta = sin(Theta);
+    if (SinTheta <= 0.f) {
+        return float3(0.f, 0.f, 0.f);
+    }
+
+    Direction = EnvSphericalToDirection(Theta, Phi);
+    Pdf = EnvPixelPdfToSolidAngle(uint2(Column, Row), SinTheta);
+    return EnvRadiance.Load(int3(Column, Row, 0)).xyz;
+}
+
+#endif
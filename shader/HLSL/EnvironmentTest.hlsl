@@ -0,0 +1,31 @@
+#pragma Compute EnvironmentSampleTest
+
+// Draws environment samples for HWPT::EnvironmentMap::CompareGPUSampling, the resources of
+// EnvironmentSampling.hlsl live in set 0 next to the test buffers
+
+#define ENVIRONMENT_SPACE space0
+#include "EnvironmentSampling.hlsl"
+
+#define ENVIRONMENT_TEST_GROUP_SIZE 64
+
+struct EnvironmentTestConstants {
+    uint NumSamples;
+    uint3 Padding;
+};
+
+[[vk::push_constant]] EnvironmentTestConstants Constants;
+
+StructuredBuffer<float2> TestRandoms : register(t3);
+RWStructuredBuffer<float4> TestResults : register(u4);  // Direction and pdf, then radiance per sample
+
+[numthreads(ENVIRONMENT_TEST_GROUP_SIZE, 1, 1)]
+void EnvironmentSampleTest(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.NumSamples) {
+        return;
+    }
+    float3 Direction;
+    float Pdf;
+    float3 Radiance = SampleEnvironment(TestRandoms[GlobalID.x], Direction, Pdf);
+    TestResults[GlobalID.x * 2] = float4(Direction, Pdf);
+    TestResults[GlobalID.x * 2 + 1] = float4(Radiance, 0.f);
+}
@@ -0,0 +1,320 @@
+#pragma Compute LBVHMorton LBVHLeaves LBVHHierarchy LBVHRefit PLOCNearest PLOCMerge PLOCCount PLOCScan PLOCScatter PLOCFinalize
+
+// GPU BVH builder driven by HWPT::GPUBVH. Nodes [0, NumLeaves) are leaves in Morton order, internal nodes
+// are appended after them. LBVH (Karras 2012) builds the hierarchy in one pass and refits bottom up,
+// PLOC (Meister and Bittner 2018) instead merges mutual nearest neighbours among the Morton ordered
+// clusters until one is left
+
+#include "GPUBVHCommon.hlsl"
+
+#define BUILD_GROUP_SIZE 256
+#define INVALID_INDEX 0xffffffffu
+
+// Header slots
+#define HEADER_ROOT 0
+#define HEADER_CLUSTER_COUNT 1   // Two slots, ping-ponged with Parity
+#define HEADER_NEXT_NODE 3
+#define HEADER_TRAVERSAL_OVERFLOWS 4  // Incremented by BVHTraversal.hlsl
+
+struct BuildConstants {
+    float3 SceneMin;
+    uint NumLeaves;
+    float3 SceneInvExtent;
+    uint Parity;
+    uint SearchRadius;
+    uint3 Padding;
+};
+
+[[vk::push_constant]] BuildConstants Constants;
+
+StructuredBuffer<float4> Positions : register(t0);
+StructuredBuffer<uint> Indices : register(t1);
+RWStructuredBuffer<uint> MortonKeys : register(u2);
+RWStructuredBuffer<uint> MortonValues : register(u3);
+globallycoherent RWStructuredBuffer<GPUBVHNode> Nodes : register(u4);
+RWStructuredBuffer<uint> Parents : register(u5);
+RWStructuredBuffer<uint> Flags : register(u6);
+globallycoherent RWStructuredBuffer<uint> Header : register(u7);
+RWStructuredBuffer<uint> ClustersIn : register(u8);
+RWStructuredBuffer<uint> ClustersOut : register(u9);
+RWStructuredBuffer<uint> Nearest : register(u10);
+RWStructuredBuffer<uint> Valid : register(u11);
+RWStructuredBuffer<uint> BlockSums : register(u12);
+
+groupshared uint LocalScan[BUILD_GROUP_SIZE];
+groupshared uint ScanCarry;
+
+void GroupInclusiveScan(uint LocalID) {
+    for (uint Offset = 1; Offset < BUILD_GROUP_SIZE; Offset <<= 1u) {
+        uint Value = LocalID >= Offset ? LocalScan[LocalID - Offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        LocalScan[LocalID] += Value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+uint ExpandBits(uint Value) {
+    Value &= 0x3ffu;
+    Value = (Value | (Value << 16u)) & 0x030000ffu;
+    Value = (Value | (Value << 8u)) & 0x0300f00fu;
+    Value = (Value | (Value << 4u)) & 0x030c30c3u;
+    Value = (Value | (Value << 2u)) & 0x09249249u;
+    return Value;
+}
+
+float SurfaceArea(float3 Min, float3 Max) {
+    float3 Extent = max(Max - Min, 0.f);
+    return 2.f * (Extent.x * Extent.y + Extent.y * Extent.z + Extent.z * Extent.x);
+}
+
+uint ClusterCountIn() {
+    return Header[HEADER_CLUSTER_COUNT + Constants.Parity];
+}
+
+// ---------------------------------------------------------------------------------------------------- LBVH
+
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void LBVHMorton(uint3 GlobalID : SV_DispatchThreadID) {
+    uint Triangle = GlobalID.x;
+    if (Triangle >= Constants.NumLeaves) {
+        return;
+    }
+    float3 Centroid = (Positions[Indices[3 * Triangle + 0]].xyz + Positions[Indices[3 * Triangle + 1]].xyz +
+                       Positions[Indices[3 * Triangle + 2]].xyz) / 3.f;
+    uint3 Cell = uint3(clamp((Centroid - Constants.SceneMin) * Constants.SceneInvExtent * 1024.f, 0.f, 1023.f));
+    MortonKeys[Triangle] = (ExpandBits(Cell.x) << 2u) | (ExpandBits(Cell.y) << 1u) | ExpandBits(Cell.z);
+    MortonValues[Triangle] = Triangle;
+}
+
+// Leaf i holds the i-th triangle in Morton order, also resets the per-build state
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void LBVHLeaves(uint3 GlobalID : SV_DispatchThreadID) {
+    uint Leaf = GlobalID.x;
+    if (Leaf == 0) {
+        Header[HEADER_ROOT] = Constants.NumLeaves > 1 ? Constants.NumLeaves : 0;
+        Header[HEADER_CLUSTER_COUNT] = Constants.NumLeaves;
+        Header[HEADER_CLUSTER_COUNT + 1] = Constants.NumLeaves;
+        Header[HEADER_NEXT_NODE] = Constants.NumLeaves;
+        Header[HEADER_TRAVERSAL_OVERFLOWS] = 0;
+    }
+    if (Leaf >= Constants.NumLeaves) {
+        return;
+    }
+    uint Triangle = MortonValues[Leaf];
+    float3 P0 = Positions[Indices[3 * Triangle + 0]].xyz;
+    float3 P1 = Positions[Indices[3 * Triangle + 1]].xyz;
+    float3 P2 = Positions[Indices[3 * Triangle + 2]].xyz;
+
+    GPUBVHNode Node;
+    Node.Min = min(P0, min(P1, P2));
+    Node.Max = max(P0, max(P1, P2));
+    Node.Left = Triangle;
+    Node.Right = GPU_BVH_LEAF;
+    Nodes[Leaf] = Node;
+    Parents[Leaf] = INVALID_INDEX;
+    Flags[Leaf] = 0;
+    ClustersIn[Leaf] = Leaf;
+}
+
+// Length of the common prefix of keys i and j, duplicates fall back to the indices
+int Delta(int i, int j) {
+    if (j < 0 || j >= int(Constants.NumLeaves)) {
+        return -1;
+    }
+    uint KeyI = MortonKeys[i], KeyJ = MortonKeys[j];
+    if (KeyI == KeyJ) {
+        return 32 + 31 - int(firstbithigh(uint(i) ^ uint(j)));
+    }
+    return 31 - int(firstbithigh(KeyI ^ KeyJ));
+}
+
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void LBVHHierarchy(uint3 GlobalID : SV_DispatchThreadID) {
+    int i = int(GlobalID.x);
+    if (i >= int(Constants.NumLeaves) - 1) {
+        return;
+    }
+
+    // Direction and extent of the key range covered by internal node i
+    int Direction = Delta(i, i + 1) - Delta(i, i - 1) >= 0 ? 1 : -1;
+    int MinDelta = Delta(i, i - Direction);
+    int MaxLength = 2;
+    while (Delta(i, i + MaxLength * Direction) > MinDelta) {
+        MaxLength *= 2;
+    }
+    int Length = 0;
+    for (int Step = MaxLength / 2; Step >= 1; Step /= 2) {
+        if (Delta(i, i + (Length + Step) * Direction) > MinDelta) {
+            Length += Step;
+        }
+    }
+    int j = i + Length * Direction;
+
+    // Split position, the highest differing bit inside the range
+    int NodeDelta = Delta(i, j);
+    int Split = 0;
+    int Step = Length;
+    do {
+        Step = (Step + 1) / 2;
+        if (Delta(i, i + (Split + Step) * Direction) > NodeDelta) {
+            Split += Step;
+        }
+    } while (Step > 1);
+    int Gamma = i + Split * Direction + min(Direction, 0);
+
+    uint NodeIndex = Constants.NumLeaves + uint(i);
+    uint Left = min(i, j) == Gamma ? uint(Gamma) : Constants.NumLeaves + uint(Gamma);
+    uint Right = max(i, j) == Gamma + 1 ? uint(Gamma + 1) : Constants.NumLeaves + uint(Gamma + 1);
+    Nodes[NodeIndex].Left = Left;
+    Nodes[NodeIndex].Right = Right;
+    Parents[Left] = NodeIndex;
+    Parents[Right] = NodeIndex;
+    Flags[NodeIndex] = 0;
+    if (i == 0) {
+        Parents[NodeIndex] = INVALID_INDEX;
+    }
+}
+
+// One thread per leaf walks up, the second thread to reach a node has both children ready
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void LBVHRefit(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.NumLeaves) {
+        return;
+    }
+    uint NodeIndex = Parents[GlobalID.x];
+    while (NodeIndex != INVALID_INDEX) {
+        DeviceMemoryBarrier();
+        uint Arrived;
+        InterlockedAdd(Flags[NodeIndex], 1, Arrived);
+        if (Arrived == 0) {
+            return;
+        }
+        GPUBVHNode Left = Nodes[Nodes[NodeIndex].Left];
+        GPUBVHNode Right = Nodes[Nodes[NodeIndex].Right];
+        Nodes[NodeIndex].Min = min(Left.Min, Right.Min);
+        Nodes[NodeIndex].Max = max(Left.Max, Right.Max);
+        NodeIndex = Parents[NodeIndex];
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------- PLOC
+
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void PLOCNearest(uint3 GlobalID : SV_DispatchThreadID) {
+    int Count = int(ClusterCountIn());
+    int i = int(GlobalID.x);
+    if (i >= Count) {
+        return;
+    }
+    GPUBVHNode Cluster = Nodes[ClustersIn[i]];
+    float BestArea = 3.402823466e+38f;
+    uint Best = uint(i);
+    int Radius = int(Constants.SearchRadius);
+    for (int j = max(i - Radius, 0); j <= min(i + Radius, Count - 1); j++) {
+        if (j == i) {
+            continue;
+        }
+        GPUBVHNode Other = Nodes[ClustersIn[j]];
+        float Area = SurfaceArea(min(Cluster.Min, Other.Min), max(Cluster.Max, Other.Max));
+        if (Area < BestArea) {
+            BestArea = Area;
+            Best = uint(j);
+        }
+    }
+    Nearest[i] = Best;
+}
+
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void PLOCMerge(uint3 GlobalID : SV_DispatchThreadID) {
+    uint Count = ClusterCountIn();
+    uint i = GlobalID.x;
+    if (i >= Count) {
+        return;
+    }
+    uint Neighbour = Nearest[i];
+    bool Mutual = Neighbour != i && Nearest[Neighbour] == i;
+    if (!Mutual) {
+        Valid[i] = 1;
+        return;
+    }
+    // The lower index of a mutual pair creates the parent, the other one drops out
+    if (i > Neighbour) {
+        Valid[i] = 0;
+        return;
+    }
+    GPUBVHNode Left = Nodes[ClustersIn[i]];
+    GPUBVHNode Right = Nodes[ClustersIn[Neighbour]];
+    uint NodeIndex;
+    InterlockedAdd(Header[HEADER_NEXT_NODE], 1, NodeIndex);
+
+    GPUBVHNode Parent;
+    Parent.Min = min(Left.Min, Right.Min);
+    Parent.Max = max(Left.Max, Right.Max);
+    Parent.Left = ClustersIn[i];
+    Parent.Right = ClustersIn[Neighbour];
+    Nodes[NodeIndex] = Parent;
+    ClustersIn[i] = NodeIndex;
+    Valid[i] = 1;
+}
+
+// Order preserving compaction of the surviving clusters: count per block, scan, scatter
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void PLOCCount(uint3 GlobalID : SV_DispatchThreadID, uint3 LocalID : SV_GroupThreadID, uint3 GroupID : SV_GroupID) {
+    uint Count = ClusterCountIn();
+    if (GroupID.x * BUILD_GROUP_SIZE >= Count) {
+        return;
+    }
+    LocalScan[LocalID.x] = GlobalID.x < Count ? Valid[GlobalID.x] : 0;
+    GroupMemoryBarrierWithGroupSync();
+    GroupInclusiveScan(LocalID.x);
+    if (LocalID.x == BUILD_GROUP_SIZE - 1) {
+        BlockSums[GroupID.x] = LocalScan[LocalID.x];
+    }
+}
+
+// Single group, exclusive scan of the block sums, the total becomes the next cluster count
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void PLOCScan(uint3 LocalID : SV_GroupThreadID) {
+    uint NumBlocks = (ClusterCountIn() + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE;
+    if (LocalID.x == 0) {
+        ScanCarry = 0;
+    }
+    for (uint Base = 0; Base < NumBlocks; Base += BUILD_GROUP_SIZE) {
+        uint Index = Base + LocalID.x;
+        uint Value = Index < NumBlocks ? BlockSums[Index] : 0;
+        LocalScan[LocalID.x] = Value;
+        GroupMemoryBarrierWithGroupSync();
+        GroupInclusiveScan(LocalID.x);
+        if (Index < NumBlocks) {
+            BlockSums[Index] = ScanCarry + LocalScan[LocalID.x] - Value;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        if (LocalID.x == BUILD_GROUP_SIZE - 1) {
+            ScanCarry += LocalScan[LocalID.x];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    if (LocalID.x == 0) {
+        Header[HEADER_CLUSTER_COUNT + 1 - Constants.Parity] = ScanCarry;
+    }
+}
+
+[numthreads(BUILD_GROUP_SIZE, 1, 1)]
+void PLOCScatter(uint3 GlobalID : SV_DispatchThreadID, uint3 LocalID : SV_GroupThreadID, uint3 GroupID : SV_GroupID) {
+    uint Count = ClusterCountIn();
+    if (GroupID.x * BUILD_GROUP_SIZE >= Count) {
+        return;
+    }
+    uint IsValid = GlobalID.x < Count ? Valid[GlobalID.x] : 0;
+    LocalScan[LocalID.x] = IsValid;
+    GroupMemoryBarrierWithGroupSync();
+    GroupInclusiveScan(LocalID.x);
+    if (IsValid) {
+        ClustersOut[BlockSums[GroupID.x] + LocalScan[LocalID.x] - 1] = ClustersIn[GlobalID.x];
+    }
+}
+
+[numthreads(1, 1, 1)]
+void PLOCFinalize() {
+    Header[HEADER_ROOT] = ClustersIn[0];
+}
@@ -0,0 +1,72 @@
+#ifndef GPU_BVH_COMMON_HLSL
+#define GPU_BVH_COMMON_HLSL
+
+// Node layout shared by GPUBVHBuild.hlsl, BVHTraversal.hlsl and HWPT::GPUBVHNode. Leaves store the
+// triangle in Left and GPU_BVH_LEAF in Right, internal nodes store both child node indices
+
+#define GPU_BVH_LEAF 0xffffffffu
+
+struct GPUBVHNode {
+    float3 Min;
+    uint Left;
+    float3 Max;
+    uint Right;
+};
+
+struct GPURay {
+    float3 Origin;
+    float TMin;
+    float3 Direction;
+    float TMax;
+};
+
+struct GPURayHit {
+    float T;
+    uint PrimitiveID;
+    float2 Barycentrics;
+};
+
+bool IsLeaf(GPUBVHNode Node) {
+    return Node.Right == GPU_BVH_LEAF;
+}
+
+// Entry distance of the ray into the box, or a negative value on a miss
+float IntersectAABB(float3 Min, float3 Max, float3 Origin, float3 InvDirection, float TMin, float TMax) {
+    float3 T0 = (Min - Origin) * InvDirection;
+    float3 T1 = (Max - Origin) * InvDirection;
+    float3 TNear = min(T0, T1), TFar = max(T0, T1);
+    float Enter = max(max(TNear.x, TNear.y), max(TNear.z, TMin));
+    float Exit = min(min(TFar.x, TFar.y), min(TFar.z, TMax));
+    return Enter <= Exit ? Enter : -1.f;
+}
+
+// Moller-Trumbore, same tests as HWPT::BVH::IntersectTriangle
+bool IntersectTriangle(float3 V0, float3 V1, float3 V2, GPURay Ray, float TMax, out float T, out float2 Barycentrics) {
+    T = 0.f;
+    Barycentrics = float2(0.f, 0.f);
+    float3 Edge1 = V1 - V0, Edge2 = V2 - V0;
+    float3 P = cross(Ray.Direction, Edge2);
+    float Determinant = dot(Edge1, P);
+    if (abs(Determinant) < 1e-12f) {
+        return false;
+    }
+    float InvDeterminant = 1.f / Determinant;
+    float3 S = Ray.Origin - V0;
+    float U = dot(S, P) * InvDeterminant;
+    if (U < 0.f || U > 1.f) {
+        return false;
+    }
+    float3 Q = cross(S, Edge1);
+    float V = dot(Ray.Direction, Q) * InvDeterminant;
+    if (V < 0.f || U + V > 1.f) {
+        return false;
+    }
+    T = dot(Edge2, Q) * InvDeterminant;
+    if (T <= Ray.TMin || T >= TMax) {
+        return false;
+    }
+    Barycentrics = float2(U, V);
+    return true;
+}
+
+#endif
@@ -2,6 +2,7 @@
 #pragma Fragment PSMain
 
 #include "ViewUniformBuffer.hlsl"
+#include "BRDFLUT.hlsl"
 
 struct VSInput {
     float3 Position : POSITION;
@@ -13,15 +14,25 @@ struct VSOutput {
     float4 ClipPosition : SV_POSITION;
     float3 Color : COLOR;
     float2 TexCoord : TEXCOORD0;
+    float3 ViewPosition : TEXCOORD1;
 };
 
 Texture2D TexSampler : register(t1);
 SamplerState SamplerState : register(s1);
+// HWPT::BRDFLUT::GetSplitSumTexture with the LUT's clamping sampler
+Texture2D<float2> BRDFSplitSum : register(t2);
+SamplerState BRDFLUTSampler : register(s2);
+
+// Rough dielectric under a uniform sky, which stands in for prefiltered environment lighting
+static const float MeshRoughness = .6f;
+static const float3 MeshF0 = float3(.04f, .04f, .04f);
+static const float3 MeshSkyRadiance = float3(.25f, .25f, .25f);
 
 VSOutput VSMain(VSInput Input) {
     VSOutput Output;
     float4 ViewPosition = mul(ViewTrans, mul(ModelTrans, float4(Input.Position, 1.f)));
     Output.ClipPosition = mul(ProjTrans, ViewPosition);
+    Output.ViewPosition = ViewPosition.xyz;
     Output.Color = Input.Color;
     Output.TexCoord = Input.TexCoord;
     return Output;
@@ -29,5 +40,11 @@ VSOutput VSMain(VSInput Input) {
 
 float4 PSMain(VSOutput Input) : SV_TARGET {
     float3 TexColor = TexSampler.Sample(SamplerState, Input.TexCoord).xyz;
-    return float4(TexColor, 1.f);
+
+    // The vertices carry no normals, use the facet normal turned towards the eye
+    float3 Normal = normalize(cross(ddx(Input.ViewPosition), ddy(Input.ViewPosition)));
+    float3 ToEye = normalize(-Input.ViewPosition);
+    Normal = dot(Normal, ToEye) < 0.f ? -Normal : Normal;
+    float3 Specular = SplitSumSpecular(BRDFSplitSum, BRDFLUTSampler, MeshF0, dot(Normal, ToEye), MeshRoughness);
+    return float4(TexColor + Specular * MeshSkyRadiance, 1.f);
 }
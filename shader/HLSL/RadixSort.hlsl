@@ -0,0 +1,134 @@
+#pragma Compute RadixCount RadixScan RadixScatter
+
+// Stable LSD radix sort of uint key/value pairs with 4 bit digits, driven by HWPT::GPURadixSort.
+// Per pass: RadixCount builds one digit histogram per group, RadixScan turns all of them into global
+// offsets, RadixScatter sorts every group locally by the digit and writes the keys to their offsets
+
+#define RADIX_GROUP_SIZE 256
+#define RADIX_BITS 4
+#define RADIX_SIZE 16
+
+struct RadixSortConstants {
+    uint NumKeys;
+    uint Shift;
+    uint NumGroups;
+    uint Padding;
+};
+
+[[vk::push_constant]] RadixSortConstants Constants;
+
+StructuredBuffer<uint> KeysIn : register(t0);
+StructuredBuffer<uint> ValuesIn : register(t1);
+RWStructuredBuffer<uint> KeysOut : register(u2);
+RWStructuredBuffer<uint> ValuesOut : register(u3);
+// Digit major: Histograms[Digit * NumGroups + Group]
+RWStructuredBuffer<uint> Histograms : register(u4);
+
+groupshared uint LocalHistogram[RADIX_SIZE];
+groupshared uint LocalScan[RADIX_GROUP_SIZE];
+groupshared uint LocalKeys[RADIX_GROUP_SIZE];
+groupshared uint LocalValues[RADIX_GROUP_SIZE];
+groupshared uint LocalDigitStart[RADIX_SIZE];
+groupshared uint ScanCarry;
+
+// Inclusive Hillis-Steele scan of LocalScan
+void GroupInclusiveScan(uint LocalID) {
+    for (uint Offset = 1; Offset < RADIX_GROUP_SIZE; Offset <<= 1u) {
+        uint Value = LocalID >= Offset ? LocalScan[LocalID - Offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        LocalScan[LocalID] += Value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+uint GetDigit(uint Key) {
+    return (Key >> Constants.Shift) & (RADIX_SIZE - 1);
+}
+
+[numthreads(RADIX_GROUP_SIZE, 1, 1)]
+void RadixCount(uint3 GlobalID : SV_DispatchThreadID, uint3 LocalID : SV_GroupThreadID,
+                uint3 GroupID : SV_GroupID) {
+    if (LocalID.x < RADIX_SIZE) {
+        LocalHistogram[LocalID.x] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GlobalID.x < Constants.NumKeys) {
+        InterlockedAdd(LocalHistogram[GetDigit(KeysIn[GlobalID.x])], 1);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (LocalID.x < RADIX_SIZE) {
+        Histograms[LocalID.x * Constants.NumGroups + GroupID.x] = LocalHistogram[LocalID.x];
+    }
+}
+
+// Dispatched with a single group, exclusive scan over all RADIX_SIZE * NumGroups counters
+[numthreads(RADIX_GROUP_SIZE, 1, 1)]
+void RadixScan(uint3 LocalID : SV_GroupThreadID) {
+    if (LocalID.x == 0) {
+        ScanCarry = 0;
+    }
+    uint Count = RADIX_SIZE * Constants.NumGroups;
+    for (uint Base = 0; Base < Count; Base += RADIX_GROUP_SIZE) {
+        uint Index = Base + LocalID.x;
+        uint Value = Index < Count ? Histograms[Index] : 0;
+        LocalScan[LocalID.x] = Value;
+        GroupMemoryBarrierWithGroupSync();
+        GroupInclusiveScan(LocalID.x);
+
+        if (Index < Count) {
+            Histograms[Index] = ScanCarry + LocalScan[LocalID.x] - Value;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        if (LocalID.x == RADIX_GROUP_SIZE - 1) {
+            ScanCarry += LocalScan[LocalID.x];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+[numthreads(RADIX_GROUP_SIZE, 1, 1)]
+void RadixScatter(uint3 GlobalID : SV_DispatchThreadID, uint3 LocalID : SV_GroupThreadID,
+                  uint3 GroupID : SV_GroupID) {
+    uint NumValid = min(RADIX_GROUP_SIZE, Constants.NumKeys - GroupID.x * RADIX_GROUP_SIZE);
+    bool Valid = LocalID.x < NumValid;
+    // Out of range threads sit at the end of the last group and carry the largest digit, the stable
+    // local sort keeps them behind every real key
+    uint Key = Valid ? KeysIn[GlobalID.x] : (RADIX_SIZE - 1) << Constants.Shift;
+    uint Value = Valid ? ValuesIn[GlobalID.x] : 0;
+
+    // Local stable sort by the digit, one split per bit
+    for (uint Bit = 0; Bit < RADIX_BITS; Bit++) {
+        uint IsOne = (GetDigit(Key) >> Bit) & 1u;
+        LocalScan[LocalID.x] = 1u - IsOne;
+        GroupMemoryBarrierWithGroupSync();
+        GroupInclusiveScan(LocalID.x);
+
+        uint TotalZeros = LocalScan[RADIX_GROUP_SIZE - 1];
+        uint ZerosBefore = LocalScan[LocalID.x] - (1u - IsOne);
+        uint NewIndex = IsOne ? TotalZeros + LocalID.x - ZerosBefore : ZerosBefore;
+        LocalKeys[NewIndex] = Key;
+        LocalValues[NewIndex] = Value;
+        GroupMemoryBarrierWithGroupSync();
+
+        Key = LocalKeys[LocalID.x];
+        Value = LocalValues[LocalID.x];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint Digit = GetDigit(Key);
+    LocalKeys[LocalID.x] = Digit;
+    GroupMemoryBarrierWithGroupSync();
+    if (LocalID.x == 0 || LocalKeys[LocalID.x - 1] != Digit) {
+        LocalDigitStart[Digit] = LocalID.x;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (LocalID.x < NumValid) {
+        uint Destination = Histograms[Digit * Constants.NumGroups + GroupID.x] +
+                           LocalID.x - LocalDigitStart[Digit];
+        KeysOut[Destination] = Key;
+        ValuesOut[Destination] = Value;
+    }
+}
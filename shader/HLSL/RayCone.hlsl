@@ -0,0 +1,56 @@
+#ifndef RAY_CONE_HLSL
+#define RAY_CONE_HLSL
+
+// GPU side of HWPT::RayCone, texture LOD of path traced fetches from the cone footprint at each hit.
+// Resource free, the including tracer supplies the hit triangle's HWPT::Model::GetTriangleLODConstant
+
+struct RayCone {
+    float Width;
+    float SpreadAngle;
+};
+
+RayCone RayConeFromCamera(float VerticalFov, uint ImageHeight) {
+    RayCone Cone;
+    Cone.Width = 0.f;
+    Cone.SpreadAngle = atan(2.f * tan(VerticalFov * .5f) / float(ImageHeight));
+    return Cone;
+}
+
+RayCone PropagateRayCone(RayCone Cone, float T) {
+    Cone.Width += Cone.SpreadAngle * T;
+    return Cone;
+}
+
+RayCone BounceRayCone(RayCone Cone, float SurfaceSpreadAngle) {
+    Cone.SpreadAngle += SurfaceSpreadAngle;
+    return Cone;
+}
+
+float RoughnessSpreadAngle(float Roughness) {
+    return 2.f * atan(Roughness * Roughness);
+}
+
+float CurvatureSpreadAngle(RayCone Cone, float Curvature) {
+    return 2.f * Curvature * Cone.Width;
+}
+
+// The constants are in object space, InstanceScale is the uniform scale of the hit instance's object to world
+// transform (HWPT::RayCone::GetInstanceScale) and 1 for geometry that is not instanced
+float ComputeTextureLOD(RayCone Cone, float TriangleLODConstant, float3 RayDirection, float3 Normal,
+                        float InstanceScale) {
+    float CosTheta = max(abs(dot(RayDirection, Normal)), 1e-4f);
+    return TriangleLODConstant - log2(InstanceScale) + log2(max(abs(Cone.Width), 1e-8f)) -
+           log2(CosTheta);
+}
+
+// Fetch with the cone LOD instead of the always mip 0 a plain Load / SampleLevel(0) would give
+float4 SampleTextureRayCone(Texture2D<float4> Texture, SamplerState Sampler, float2 UV, RayCone Cone,
+                            float TriangleLODConstant, float3 RayDirection, float3 Normal, float InstanceScale) {
+    uint Width, Height, NumMips;
+    Texture.GetDimensions(0, Width, Height, NumMips);
+    float LOD = clamp(ComputeTextureLOD(Cone, TriangleLODConstant, RayDirection, Normal, InstanceScale), 0.f,
+                      float(NumMips - 1));
+    return Texture.SampleLevel(Sampler, UV, LOD);
+}
+
+#endif
@@ -0,0 +1,279 @@
+#pragma Compute ReSTIRInitial ReSTIRTemporal ReSTIRSpatial ReSTIRShade
+
+// Spatiotemporal reservoir resampling of point lights (Bitterli et al. 2020), driven by HWPT::ReSTIRDI.
+// ReSTIRInitial streams light candidates through RIS and tests visibility of the survivor, ReSTIRTemporal
+// merges with last frame's reservoir at the reprojected pixel, ReSTIRSpatial merges random neighbours
+// and ReSTIRShade traces one shadow ray per pixel. Reuse uses the biased 1/M weights with depth and
+// normal rejection, the same as RunInitialPass to RunShadePass on the CPU in src/core/pathtracer/ReSTIRDI.cpp
+
+#include "BVHTraversal.hlsl"
+#include "Sampling.hlsl"
+
+#define RESTIR_GROUP_SIZE 8
+#define RESTIR_TEMPORAL (1u << 0)
+#define RESTIR_SPATIAL (1u << 1)
+
+static const float ReSTIRPI = 3.14159265358979323846f;
+
+struct ReSTIRConstants {
+    uint Width;
+    uint Height;
+    uint NumLights;
+    uint FrameIndex;
+    uint NumCandidates;
+    uint MaxHistory;
+    uint NumSpatialSamples;
+    uint Flags;
+    float SpatialRadius;
+    float DepthThreshold;
+    float NormalThreshold;
+    float LightWeightSum;
+};
+
+struct PointLight {
+    float3 Position;
+    float Power;
+    float3 Intensity;
+    float Padding;
+};
+
+struct LightAliasEntry {
+    float Probability;
+    uint Alias;
+};
+
+// ViewDepth <= 0 marks background pixels
+struct GBufferTexel {
+    float3 Position;
+    float ViewDepth;
+    float3 Normal;
+    uint Albedo;
+};
+
+// W is the unbiased contribution weight WeightSum / (M * TargetPdf(LightIndex))
+struct PackedReservoir {
+    uint LightIndex;
+    float W;
+    uint M;
+};
+
+struct Reservoir {
+    uint LightIndex;
+    float WeightSum;
+    uint M;
+    float TargetPdf;
+};
+
+[[vk::push_constant]] ReSTIRConstants Constants;
+
+StructuredBuffer<PointLight> Lights : register(t4);
+StructuredBuffer<LightAliasEntry> LightAliasTable : register(t5);
+StructuredBuffer<GBufferTexel> GBuffer : register(t6);
+StructuredBuffer<GBufferTexel> PrevGBuffer : register(t7);
+StructuredBuffer<float2> MotionVectors : register(t8);  // Previous pixel minus current pixel
+RWStructuredBuffer<PackedReservoir> CandidateReservoirs : register(u9);
+RWStructuredBuffer<PackedReservoir> TemporalReservoirs : register(u10);
+RWStructuredBuffer<PackedReservoir> PrevReservoirs : register(u11);
+RWStructuredBuffer<PackedReservoir> CurrReservoirs : register(u12);
+RWStructuredBuffer<float4> Output : register(u13);
+
+float NextRandom(inout uint State) {
+    State = SamplerHash(State);
+    return float(State >> 8u) * 5.9604644775390625e-8f;
+}
+
+uint InitRandom(uint PixelIndex, uint Pass) {
+    return SamplerHashCombine(SamplerHash(PixelIndex), Constants.FrameIndex * 4u + Pass);
+}
+
+float3 UnpackAlbedo(uint Packed) {
+    return float3(Packed & 0xffu, (Packed >> 8u) & 0xffu, (Packed >> 16u) & 0xffu) / 255.f;
+}
+
+float ReSTIRLuminance(float3 Color) {
+    return dot(Color, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// Lambertian BRDF times the unshadowed light contribution
+float3 EvaluateLight(GBufferTexel Texel, uint LightIndex) {
+    PointLight Light = Lights[LightIndex];
+    float3 ToLight = Light.Position - Texel.Position;
+    float DistanceSquared = max(dot(ToLight, ToLight), 1e-8f);
+    float CosTheta = dot(Texel.Normal, ToLight) * rsqrt(DistanceSquared);
+    return UnpackAlbedo(Texel.Albedo) / ReSTIRPI * Light.Intensity * max(CosTheta, 0.f) / DistanceSquared;
+}
+
+float TargetPdf(GBufferTexel Texel, uint LightIndex) {
+    return ReSTIRLuminance(EvaluateLight(Texel, LightIndex));
+}
+
+bool IsLightVisible(GBufferTexel Texel, uint LightIndex) {
+    GPURay Ray;
+    Ray.Origin = Texel.Position + Texel.Normal * 1e-3f;
+    Ray.Direction = Lights[LightIndex].Position - Ray.Origin;
+    Ray.TMin = 0.f;
+    Ray.TMax = 0.999f;
+    return !IsOccluded(Ray);
+}
+
+uint SampleLight(float U, out float Pdf) {
+    float Scaled = U * Constants.NumLights;
+    uint Index = min(uint(Scaled), Constants.NumLights - 1);
+    LightAliasEntry Entry = LightAliasTable[Index];
+    if (Scaled - Index >= Entry.Probability) {
+        Index = Entry.Alias;
+    }
+    Pdf = Lights[Index].Power / Constants.LightWeightSum;
+    return Index;
+}
+
+Reservoir EmptyReservoir() {
+    Reservoir Result;
+    Result.LightIndex = 0xffffffffu;
+    Result.WeightSum = 0.f;
+    Result.M = 0;
+    Result.TargetPdf = 0.f;
+    return Result;
+}
+
+bool UpdateReservoir(inout Reservoir Result, uint LightIndex, float Weight, float Pdf, uint M, float U) {
+    Result.WeightSum += Weight;
+    Result.M += M;
+    if (Weight > 0.f && U * Result.WeightSum < Weight) {
+        Result.LightIndex = LightIndex;
+        Result.TargetPdf = Pdf;
+        return true;
+    }
+    return false;
+}
+
+// Reservoirs of another pixel are resampled with this pixel's target function
+void MergeReservoir(inout Reservoir Result, PackedReservoir Other, GBufferTexel Texel, float U) {
+    if (Other.M == 0) {
+        return;
+    }
+    float Pdf = Other.LightIndex < Constants.NumLights ? TargetPdf(Texel, Other.LightIndex) : 0.f;
+    UpdateReservoir(Result, Other.LightIndex, Pdf * Other.W * Other.M, Pdf, Other.M, U);
+}
+
+PackedReservoir PackReservoir(Reservoir Result) {
+    PackedReservoir Packed;
+    Packed.LightIndex = Result.LightIndex;
+    Packed.M = Result.M;
+    Packed.W = Result.TargetPdf > 0.f ? Result.WeightSum / (Result.M * Result.TargetPdf) : 0.f;
+    return Packed;
+}
+
+bool IsSimilar(GBufferTexel Texel, GBufferTexel Other) {
+    return Other.ViewDepth > 0.f &&
+           abs(Other.ViewDepth - Texel.ViewDepth) <= Constants.DepthThreshold * Texel.ViewDepth &&
+           dot(Other.Normal, Texel.Normal) >= Constants.NormalThreshold;
+}
+
+PackedReservoir EmptyPackedReservoir() {
+    return PackReservoir(EmptyReservoir());
+}
+
+[numthreads(RESTIR_GROUP_SIZE, RESTIR_GROUP_SIZE, 1)]
+void ReSTIRInitial(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.Width || GlobalID.y >= Constants.Height) {
+        return;
+    }
+    uint PixelIndex = GlobalID.y * Constants.Width + GlobalID.x;
+    GBufferTexel Texel = GBuffer[PixelIndex];
+    if (Texel.ViewDepth <= 0.f) {
+        CandidateReservoirs[PixelIndex] = EmptyPackedReservoir();
+        return;
+    }
+    uint RandomState = InitRandom(PixelIndex, 0);
+    Reservoir Result = EmptyReservoir();
+    for (uint i = 0; i < Constants.NumCandidates; i++) {
+        float SourcePdf;
+        uint LightIndex = SampleLight(NextRandom(RandomState), SourcePdf);
+        float Pdf = TargetPdf(Texel, LightIndex);
+        UpdateReservoir(Result, LightIndex, Pdf / SourcePdf, Pdf, 1, NextRandom(RandomState));
+    }
+    PackedReservoir Packed = PackReservoir(Result);
+    // Visibility reuse, an occluded survivor keeps its M but contributes nothing
+    if (Packed.W > 0.f && !IsLightVisible(Texel, Packed.LightIndex)) {
+        Packed.W = 0.f;
+    }
+    CandidateReservoirs[PixelIndex] = Packed;
+}
+
+[numthreads(RESTIR_GROUP_SIZE, RESTIR_GROUP_SIZE, 1)]
+void ReSTIRTemporal(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.Width || GlobalID.y >= Constants.Height) {
+        return;
+    }
+    uint PixelIndex = GlobalID.y * Constants.Width + GlobalID.x;
+    PackedReservoir Current = CandidateReservoirs[PixelIndex];
+    GBufferTexel Texel = GBuffer[PixelIndex];
+    if (!(Constants.Flags & RESTIR_TEMPORAL) || Texel.ViewDepth <= 0.f) {
+        TemporalReservoirs[PixelIndex] = Current;
+        return;
+    }
+
+    uint RandomState = InitRandom(PixelIndex, 1);
+    Reservoir Result = EmptyReservoir();
+    MergeReservoir(Result, Current, Texel, NextRandom(RandomState));
+
+    int2 PrevPixel = int2(floor(float2(GlobalID.xy) + .5f + MotionVectors[PixelIndex]));
+    if (all(PrevPixel >= 0) && PrevPixel.x < int(Constants.Width) && PrevPixel.y < int(Constants.Height)) {
+        uint PrevIndex = uint(PrevPixel.y) * Constants.Width + uint(PrevPixel.x);
+        if (IsSimilar(Texel, PrevGBuffer[PrevIndex])) {
+            PackedReservoir Previous = PrevReservoirs[PrevIndex];
+            // Bounded history, stale samples would otherwise dominate after lighting changes
+            Previous.M = min(Previous.M, Constants.MaxHistory * max(Current.M, 1u));
+            MergeReservoir(Result, Previous, Texel, NextRandom(RandomState));
+        }
+    }
+    TemporalReservoirs[PixelIndex] = PackReservoir(Result);
+}
+
+[numthreads(RESTIR_GROUP_SIZE, RESTIR_GROUP_SIZE, 1)]
+void ReSTIRSpatial(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.Width || GlobalID.y >= Constants.Height) {
+        return;
+    }
+    uint PixelIndex = GlobalID.y * Constants.Width + GlobalID.x;
+    PackedReservoir Center = TemporalReservoirs[PixelIndex];
+    GBufferTexel Texel = GBuffer[PixelIndex];
+    if (!(Constants.Flags & RESTIR_SPATIAL) || Texel.ViewDepth <= 0.f) {
+        CurrReservoirs[PixelIndex] = Center;
+        return;
+    }
+
+    uint RandomState = InitRandom(PixelIndex, 2);
+    Reservoir Result = EmptyReservoir();
+    MergeReservoir(Result, Center, Texel, NextRandom(RandomState));
+    for (uint i = 0; i < Constants.NumSpatialSamples; i++) {
+        float Radius = Constants.SpatialRadius * sqrt(NextRandom(RandomState));
+        float Angle = 2.f * ReSTIRPI * NextRandom(RandomState);
+        int2 Neighbour = int2(GlobalID.xy) + int2(round(Radius * float2(cos(Angle), sin(Angle))));
+        if (any(Neighbour < 0) || Neighbour.x >= int(Constants.Width) || Neighbour.y >= int(Constants.Height)) {
+            continue;
+        }
+        uint NeighbourIndex = uint(Neighbour.y) * Constants.Width + uint(Neighbour.x);
+        if (NeighbourIndex != PixelIndex && IsSimilar(Texel, GBuffer[NeighbourIndex])) {
+            MergeReservoir(Result, TemporalReservoirs[NeighbourIndex], Texel, NextRandom(RandomState));
+        }
+    }
+    CurrReservoirs[PixelIndex] = PackReservoir(Result);
+}
+
+[numthreads(RESTIR_GROUP_SIZE, RESTIR_GROUP_SIZE, 1)]
+void ReSTIRShade(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.Width || GlobalID.y >= Constants.Height) {
+        return;
+    }
+    uint PixelIndex = GlobalID.y * Constants.Width + GlobalID.x;
+    PackedReservoir Final = CurrReservoirs[PixelIndex];
+    GBufferTexel Texel = GBuffer[PixelIndex];
+    float3 Radiance = 0.f;
+    if (Texel.ViewDepth > 0.f && Final.W > 0.f && Final.LightIndex < Constants.NumLights &&
+        IsLightVisible(Texel, Final.LightIndex)) {
+        Radiance = EvaluateLight(Texel, Final.LightIndex) * Final.W;
+    }
+    Output[PixelIndex] = float4(Radiance, 1.f);
+}
@@ -0,0 +1,69 @@
+#ifndef SAMPLING_HLSL
+#define SAMPLING_HLSL
+
+// GPU side of HWPT::SobolSequence and HWPT::BlueNoise, every function matches its CPU counterpart bit for bit
+
+#define SOBOL_NUM_DIMENSIONS 16
+#define SOBOL_NUM_BITS 32
+#define BLUE_NOISE_TILE_SIZE 64
+#define BLUE_NOISE_GOLDEN_RATIO_FIXED_POINT 10368890u  // Golden ratio conjugate * 2^24
+
+// Kernels that bind the samplers next to their own resources define the space before the include
+#ifndef SAMPLING_SPACE
+#define SAMPLING_SPACE space2
+#endif
+
+// uint[SOBOL_NUM_DIMENSIONS][SOBOL_NUM_BITS]
+StructuredBuffer<uint> SobolDirections : register(t0, SAMPLING_SPACE);
+Texture2D<float4> BlueNoiseTile : register(t1, SAMPLING_SPACE);
+
+uint SamplerHash(uint Value) {
+    uint State = Value * 747796405u + 2891336453u;
+    uint Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+    return (Word >> 22u) ^ Word;
+}
+
+uint SamplerHashCombine(uint Seed, uint Value) {
+    return Seed ^ (SamplerHash(Value) + 0x9e3779b9u + (Seed << 6u) + (Seed >> 2u));
+}
+
+uint NestedUniformScramble(uint Value, uint Seed) {
+    Value = reversebits(Value);
+    Value += Seed;
+    Value ^= Value * 0x6c50b47cu;
+    Value ^= Value * 0xb82f1e52u;
+    Value ^= Value * 0xc7afe638u;
+    Value ^= Value * 0x8d22f6e6u;
+    return reversebits(Value);
+}
+
+uint SobolSampleRaw(uint Index, uint Dimension) {
+    uint Result = 0;
+    for (uint Bit = 0; Index != 0; Index >>= 1u, Bit++) {
+        if (Index & 1u) {
+            Result ^= SobolDirections[Dimension * SOBOL_NUM_BITS + Bit];
+        }
+    }
+    return Result;
+}
+
+float SobolSample(uint Index, uint Dimension, uint Seed) {
+    uint BlockSeed = SamplerHashCombine(Seed, Dimension / SOBOL_NUM_DIMENSIONS);
+    uint ShuffledIndex = NestedUniformScramble(Index, BlockSeed);
+    uint Value = SobolSampleRaw(ShuffledIndex, Dimension % SOBOL_NUM_DIMENSIONS);
+    Value = NestedUniformScramble(Value, SamplerHashCombine(BlockSeed, Dimension));
+    return min(float(Value) * 2.3283064365386963e-10f, 0.99999994f);
+}
+
+float SobolSamplePixel(uint2 Pixel, uint SampleIndex, uint Dimension) {
+    return SobolSample(SampleIndex, Dimension, SamplerHash(Pixel.x ^ SamplerHash(Pixel.y)));
+}
+
+// Rotation in 1/2^24 fixed point, exact for any frame index
+float4 SampleBlueNoise(uint2 Pixel, uint FrameIndex) {
+    uint4 Value = uint4(BlueNoiseTile.Load(int3(Pixel % BLUE_NOISE_TILE_SIZE, 0)) * 16777216.f) +
+                  FrameIndex * BLUE_NOISE_GOLDEN_RATIO_FIXED_POINT;
+    return float4(Value & 0xffffffu) * 5.9604644775390625e-8f;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma Compute SamplerTest
+
+// Draws Sobol and blue noise samples for HWPT::SobolSequence::CompareGPU, the tables of Sampling.hlsl
+// live in set 0 next to the result buffer. Thread z is frame FirstFrame + z * FrameStride
+
+#define SAMPLING_SPACE space0
+#include "Sampling.hlsl"
+
+#define SAMPLER_TEST_GROUP_SIZE 8
+
+struct SamplerTestConstants {
+    uint Width;
+    uint Height;
+    uint FirstFrame;
+    uint FrameStride;
+};
+
+[[vk::push_constant]] SamplerTestConstants Constants;
+
+// Sobol dimensions 0-3, then the blue noise, per pixel and frame
+RWStructuredBuffer<float4> TestResults : register(u2);
+
+[numthreads(SAMPLER_TEST_GROUP_SIZE, SAMPLER_TEST_GROUP_SIZE, 1)]
+void SamplerTest(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.Width || GlobalID.y >= Constants.Height) {
+        return;
+    }
+    uint FrameIndex = Constants.FirstFrame + GlobalID.z * Constants.FrameStride;
+    uint ResultIndex = (GlobalID.z * Constants.Height + GlobalID.y) * Constants.Width + GlobalID.x;
+    float4 Sobol;
+    for (uint Dimension = 0; Dimension < 4; Dimension++) {
+        Sobol[Dimension] = SobolSamplePixel(GlobalID.xy, FrameIndex, Dimension);
+    }
+    TestResults[ResultIndex * 2] = Sobol;
+    TestResults[ResultIndex * 2 + 1] = SampleBlueNoise(GlobalID.xy, FrameIndex);
+}
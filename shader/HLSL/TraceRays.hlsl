@@ -0,0 +1,31 @@
+#pragma Compute TraceClosestHit
+
+// Closest hits of a ray buffer, used by HWPT::GPUBVH::Trace
+
+#include "BVHTraversal.hlsl"
+
+#define TRAVERSAL_GROUP_SIZE 64
+
+struct TraversalConstants {
+    uint NumRays;
+    uint3 Padding;
+};
+
+[[vk::push_constant]] TraversalConstants Constants;
+
+StructuredBuffer<GPURay> Rays : register(t4);
+RWStructuredBuffer<GPURayHit> Hits : register(u5);
+
+[numthreads(TRAVERSAL_GROUP_SIZE, 1, 1)]
+void TraceClosestHit(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.NumRays) {
+        return;
+    }
+    GPURay Ray = Rays[GlobalID.x];
+    GPURayHit Hit;
+    Hit.T = Ray.TMax;
+    Hit.PrimitiveID = GPU_BVH_LEAF;
+    Hit.Barycentrics = float2(0.f, 0.f);
+    TraceBVH(Ray, false, Hit);
+    Hits[GlobalID.x] = Hit;
+}
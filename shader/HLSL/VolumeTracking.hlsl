@@ -0,0 +1,245 @@
+#pragma Compute VolumeRatioTracking VolumeDeltaTracking
+
+// GPU side of HWPT::VolumeTracker: brick-sparse density grid, majorant grid DDA and delta / ratio tracking,
+// driven by HWPT::GPUVolume. Each thread averages SamplesPerRay estimates for one ray
+
+#include "GPUBVHCommon.hlsl"
+
+#define VOLUME_GROUP_SIZE 64
+#define VOLUME_BRICK_SIZE 8
+#define VOLUME_EMPTY_BRICK 0xffffffffu
+#define VOLUME_LOCAL_MAJORANTS (1u << 0)
+
+struct VolumeConstants {
+    uint3 Dims;
+    uint NumRays;
+    uint3 BrickDims;
+    uint SamplesPerRay;
+    uint3 MajorantDims;
+    uint CellSize;
+    float3 BoundsMin;
+    float SigmaTScale;
+    float3 WorldToGrid;
+    float MaxDensity;
+    uint Flags;
+    uint Seed;
+    uint2 Padding;
+};
+
+struct VolumeResult {
+    float Transmittance;  // Ratio tracking estimate, or the fraction of escaped delta tracking samples
+    float CollisionT;  // Mean distance of the delta tracking collisions, -1 if all samples escaped
+    uint DensityLookups;
+    uint MajorantSegments;
+};
+
+[[vk::push_constant]] VolumeConstants Constants;
+
+StructuredBuffer<uint> BrickTable : register(t0);
+StructuredBuffer<float> BrickData : register(t1);
+StructuredBuffer<float> Majorants : register(t2);
+StructuredBuffer<GPURay> Rays : register(t3);
+RWStructuredBuffer<VolumeResult> Results : register(u4);
+
+uint VolumeHash(uint Value) {
+    uint State = Value * 747796405u + 2891336453u;
+    uint Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+    return (Word >> 22u) ^ Word;
+}
+
+float NextRandom(inout uint State) {
+    State = VolumeHash(State);
+    return float(State >> 8u) * 5.9604644775390625e-8f;
+}
+
+float GetVoxel(int3 Voxel) {
+    if (any(Voxel < 0) || any(Voxel >= int3(Constants.Dims))) {
+        return 0.f;
+    }
+    uint3 Brick = uint3(Voxel) / VOLUME_BRICK_SIZE;
+    uint BrickIndex = BrickTable[(Brick.z * Constants.BrickDims.y + Brick.y) * Constants.BrickDims.x + Brick.x];
+    if (BrickIndex == VOLUME_EMPTY_BRICK) {
+        return 0.f;
+    }
+    uint3 Local = uint3(Voxel) % VOLUME_BRICK_SIZE;
+    return BrickData[BrickIndex * VOLUME_BRICK_SIZE * VOLUME_BRICK_SIZE * VOLUME_BRICK_SIZE +
+                     (Local.z * VOLUME_BRICK_SIZE + Local.y) * VOLUME_BRICK_SIZE + Local.x];
+}
+
+// Trilinear between voxel centers, zero outside of the grid, the same as DensityGrid::Sample
+float SampleDensity(float3 GridPosition) {
+    if (any(GridPosition < 0.f) || any(GridPosition >= float3(Constants.Dims))) {
+        return 0.f;
+    }
+    float3 P = GridPosition - .5f;
+    float3 Floor = floor(P);
+    float3 Fraction = P - Floor;
+    int3 V = int3(Floor);
+    float D00 = lerp(GetVoxel(V), GetVoxel(V + int3(1, 0, 0)), Fraction.x);
+    float D10 = lerp(GetVoxel(V + int3(0, 1, 0)), GetVoxel(V + int3(1, 1, 0)), Fraction.x);
+    float D01 = lerp(GetVoxel(V + int3(0, 0, 1)), GetVoxel(V + int3(1, 0, 1)), Fraction.x);
+    float D11 = lerp(GetVoxel(V + int3(0, 1, 1)), GetVoxel(V + int3(1, 1, 1)), Fraction.x);
+    return lerp(lerp(D00, D10, Fraction.y), lerp(D01, D11, Fraction.y), Fraction.z);
+}
+
+float GetSigmaT(GPURay Ray, float T) {
+    float3 Position = Ray.Origin + Ray.Direction * T;
+    return Constants.SigmaTScale * SampleDensity((Position - Constants.BoundsMin) * Constants.WorldToGrid);
+}
+
+// Majorant grid walk in cell units, the ray parameter stays the one of the world space ray
+struct MajorantIterator {
+    float T;
+    float TExit;
+    int3 Cell;
+    int3 Step;
+    float3 TNext;
+    float3 TDelta;
+    bool Done;
+};
+
+MajorantIterator BeginMajorants(GPURay Ray) {
+    MajorantIterator Iterator;
+    float CellSize = float(Constants.CellSize);
+    float3 Origin = (Ray.Origin - Constants.BoundsMin) * Constants.WorldToGrid / CellSize;
+    float3 Direction = Ray.Direction * Constants.WorldToGrid / CellSize;
+    float3 GridMax = float3(Constants.Dims) / CellSize;
+
+    float TEnter = Ray.TMin, TExit = Ray.TMax;
+    bool Outside = false;
+    [unroll]
+    for (int Axis = 0; Axis < 3; Axis++) {
+        if (Direction[Axis] == 0.f) {
+            Outside = Outside || Origin[Axis] < 0.f || Origin[Axis] >= GridMax[Axis];
+            Iterator.Step[Axis] = 0;
+            Iterator.TDelta[Axis] = 1e30f;
+            continue;
+        }
+        float T0 = -Origin[Axis] / Direction[Axis];
+        float T1 = (GridMax[Axis] - Origin[Axis]) / Direction[Axis];
+        TEnter = max(TEnter, min(T0, T1));
+        TExit = min(TExit, max(T0, T1));
+        Iterator.Step[Axis] = Direction[Axis] > 0.f ? 1 : -1;
+        Iterator.TDelta[Axis] = abs(1.f / Direction[Axis]);
+    }
+    Iterator.T = TEnter;
+    Iterator.TExit = TExit;
+    Iterator.Done = Outside || !(TEnter < TExit);
+    Iterator.Cell = clamp(int3(floor(Origin + Direction * TEnter)), int3(0, 0, 0), int3(Constants.MajorantDims) - 1);
+    [unroll]
+    for (int Axis = 0; Axis < 3; Axis++) {
+        Iterator.TNext[Axis] = Iterator.Step[Axis] == 0 ? 1e30f :
+                               (float(Iterator.Cell[Axis] + (Iterator.Step[Axis] > 0 ? 1 : 0)) - Origin[Axis]) /
+                               Direction[Axis];
+    }
+    return Iterator;
+}
+
+// Returns the next segment [T0, T1) and its sigma_t majorant, false once the ray left the grid
+bool NextMajorantSegment(inout MajorantIterator Iterator, out float T0, out float T1, out float Majorant) {
+    T0 = Iterator.T;
+    T1 = Iterator.TExit;
+    Majorant = 0.f;
+    if (Iterator.Done) {
+        return false;
+    }
+    if ((Constants.Flags & VOLUME_LOCAL_MAJORANTS) == 0) {
+        Majorant = Constants.SigmaTScale * Constants.MaxDensity;
+        Iterator.Done = true;
+        return true;
+    }
+    int Axis = Iterator.TNext.x < Iterator.TNext.y ? (Iterator.TNext.x < Iterator.TNext.z ? 0 : 2) :
+                                                     (Iterator.TNext.y < Iterator.TNext.z ? 1 : 2);
+    T1 = min(Iterator.TNext[Axis], Iterator.TExit);
+    uint3 Cell = uint3(Iterator.Cell);
+    Majorant = Constants.SigmaTScale *
+               Majorants[(Cell.z * Constants.MajorantDims.y + Cell.y) * Constants.MajorantDims.x + Cell.x];
+
+    Iterator.T = T1;
+    Iterator.Cell[Axis] += Iterator.Step[Axis];
+    Iterator.TNext[Axis] += Iterator.TDelta[Axis];
+    Iterator.Done = T1 >= Iterator.TExit || Iterator.Cell[Axis] < 0 ||
+                    Iterator.Cell[Axis] >= int(Constants.MajorantDims[Axis]);
+    return true;
+}
+
+[numthreads(VOLUME_GROUP_SIZE, 1, 1)]
+void VolumeRatioTracking(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.NumRays) {
+        return;
+    }
+    GPURay Ray = Rays[GlobalID.x];
+    uint State = VolumeHash(GlobalID.x ^ VolumeHash(Constants.Seed));
+    VolumeResult Result = (VolumeResult) 0;
+    Result.CollisionT = -1.f;
+
+    for (uint Sample = 0; Sample < Constants.SamplesPerRay; Sample++) {
+        float Transmittance = 1.f;
+        MajorantIterator Iterator = BeginMajorants(Ray);
+        float T0, T1, Majorant;
+        while (Transmittance > 0.f && NextMajorantSegment(Iterator, T0, T1, Majorant)) {
+            Result.MajorantSegments++;
+            if (Majorant <= 0.f) {
+                continue;
+            }
+            float T = T0;
+            while (true) {
+                T -= log(1.f - NextRandom(State)) / Majorant;
+                if (T >= T1) {
+                    break;
+                }
+                Result.DensityLookups++;
+                Transmittance *= 1.f - GetSigmaT(Ray, T) / Majorant;
+                if (Transmittance <= 0.f) {
+                    Transmittance = 0.f;
+                    break;
+                }
+            }
+        }
+        Result.Transmittance += Transmittance;
+    }
+    Result.Transmittance /= float(Constants.SamplesPerRay);
+    Results[GlobalID.x] = Result;
+}
+
+[numthreads(VOLUME_GROUP_SIZE, 1, 1)]
+void VolumeDeltaTracking(uint3 GlobalID : SV_DispatchThreadID) {
+    if (GlobalID.x >= Constants.NumRays) {
+        return;
+    }
+    GPURay Ray = Rays[GlobalID.x];
+    uint State = VolumeHash(GlobalID.x ^ VolumeHash(Constants.Seed));
+    VolumeResult Result = (VolumeResult) 0;
+    uint NumCollisions = 0;
+    float CollisionSum = 0.f;
+
+    for (uint Sample = 0; Sample < Constants.SamplesPerRay; Sample++) {
+        bool Collided = false;
+        MajorantIterator Iterator = BeginMajorants(Ray);
+        float T0, T1, Majorant;
+        while (!Collided && NextMajorantSegment(Iterator, T0, T1, Majorant)) {
+            Result.MajorantSegments++;
+            if (Majorant <= 0.f) {
+                continue;
+            }
+            // Exponential steps are memoryless, so leaving the segment just restarts at the next one
+            float T = T0;
+            while (true) {
+                T -= log(1.f - NextRandom(State)) / Majorant;
+                if (T >= T1) {
+                    break;
+                }
+                Result.DensityLookups++;
+                if (NextRandom(State) * Majorant < GetSigmaT(Ray, T)) {
+                    Collided = true;
+                    CollisionSum += T;
+                    break;
+                }
+            }
+        }
+        NumCollisions += Collided ? 1 : 0;
+    }
+    Result.Transmittance = 1.f - float(NumCollisions) / float(Constants.SamplesPerRay);
+    Result.CollisionT = NumCollisions > 0 ? CollisionSum / float(NumCollisions) : -1.f;
+    Results[GlobalID.x] = Result;
+}
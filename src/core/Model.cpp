@@ -15,6 +15,7 @@ namespace HWPT {
             : m_generateMips(GenerateMips) {
         LoadModel(ModelPath);
         m_texture = new Texture2D(TexturePath, 1, m_generateMips);
+        ComputeTriangleLODConstants();
     }
 
     void Model::LoadModel(const std::filesystem::path &ModelPath) {
@@ -63,6 +64,29 @@ namespace HWPT {
                                           {VertexAttributeDataType::Float2, "TexCoord"}
                                   });
         m_indexBuffer = new IndexBuffer(Indices.size(), Indices.data());
+
+        m_vertices = std::move(Vertices);
+        m_indices = std::move(Indices);
+    }
+
+    void Model::ComputeTriangleLODConstants() {
+        const float TextureArea = static_cast<float>(m_texture->GetWidth()) *
+                                  static_cast<float>(m_texture->GetHeight());
+        const uint NumTriangles = GetTriangleCount();
+        m_triangleLODConstants.resize(NumTriangles);
+        for (uint Triangle = 0; Triangle < NumTriangles; Triangle++) {
+            const Vertex &V0 = m_vertices[m_indices[3 * Triangle + 0]];
+            const Vertex &V1 = m_vertices[m_indices[3 * Triangle + 1]];
+            const Vertex &V2 = m_vertices[m_indices[3 * Triangle + 2]];
+
+            glm::vec2 UV1 = V1.TexCoord - V0.TexCoord, UV2 = V2.TexCoord - V0.TexCoord;
+            float TexelArea = TextureArea * std::abs(UV1.x * UV2.y - UV1.y * UV2.x);
+            float WorldArea = glm::length(glm::cross(V1.Pos - V0.Pos, V2.Pos - V0.Pos));
+
+            // Degenerate triangles are never hit, any finite value works for them
+            m_triangleLODConstants[Triangle] = TexelArea > 0.f && WorldArea > 0.f ?
+                                               .5f * std::log2(TexelArea / WorldArea) : 0.f;
+        }
     }
 
     Model::~Model() {
@@ -76,8 +100,8 @@ namespace HWPT {
         m_indexBuffer->Bind(CommandBuffer);
     }
 
-    void Model::DrawIndexed(VkCommandBuffer CommandBuffer) {
+    void Model::DrawIndexed(VkCommandBuffer CommandBuffer, uint InstanceCount) {
         this->Bind(CommandBuffer);
-        vkCmdDrawIndexed(CommandBuffer, GetIndexCount(), 1, 0, 0, 0);
+        vkCmdDrawIndexed(CommandBuffer, GetIndexCount(), InstanceCount, 0, 0, 0);
     }
 }  // namespace HWPT
@@ -40,13 +40,38 @@ namespace HWPT {
             return m_vertexBuffer->GetLayout();
         }
 
-        void DrawIndexed(VkCommandBuffer CommandBuffer);
+        void DrawIndexed(VkCommandBuffer CommandBuffer, uint InstanceCount = 1);
+
+        // CPU copy of the geometry for acceleration structure builds and CPU tracing
+        [[nodiscard]] auto GetVertices() const -> const std::vector<Vertex>& {
+            return m_vertices;
+        }
+
+        [[nodiscard]] auto GetIndices() const -> const std::vector<uint>& {
+            return m_indices;
+        }
+
+        [[nodiscard]] auto GetTriangleCount() const -> uint {
+            return static_cast<uint>(m_indices.size() / 3);
+        }
+
+        // Ray cone texture LOD base of a triangle, 0.5 * log2(TexelArea / Area) with the object space area.
+        // Scaled instances correct it at lookup, see RayCone::ComputeTextureLOD
+        [[nodiscard]] auto GetTriangleLODConstant(uint Triangle) const -> float {
+            return m_triangleLODConstants[Triangle];
+        }
 
     private:
+        void ComputeTriangleLODConstants();
+
         Texture2D* m_texture = nullptr;
         IndexBuffer* m_indexBuffer = nullptr;
         VertexBuffer* m_vertexBuffer = nullptr;
         bool m_generateMips = false;
+
+        std::vector<Vertex> m_vertices;
+        std::vector<uint> m_indices;
+        std::vector<float> m_triangleLODConstants;
     };
 
 }  // namespace HWPT
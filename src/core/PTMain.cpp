@@ -1,10 +1,21 @@
 #include <iostream>
+#include <sstream>
 #include "core/application/VulkanBackendApp.h"
 
-auto main() -> int {
+auto main(int Argc, char** Argv) -> int {
     auto* App = new HWPT::VulkanBackendApp();
     App->Init();
-    App->Run();
+    // HardwarePathTracer --benchmark Name[,Name...] prints the named reports instead of opening the viewer
+    if (Argc == 3 && std::string(Argv[1]) == "--benchmark") {
+        std::vector<std::string> Names;
+        std::stringstream NameList(Argv[2]);
+        for (std::string Name; std::getline(NameList, Name, ',');) {
+            Names.push_back(Name);
+        }
+        App->RunBenchmarks(Names);
+    } else {
+        App->Run();
+    }
 
     delete App;
     return 0;
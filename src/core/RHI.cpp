@@ -4,27 +4,17 @@
 
 #include "RHI.h"
 #include "core/application/VulkanBackendApp.h"
+#include <array>
 
 
 namespace HWPT::RHI {
 
     auto FindMemoryType(uint TypeFilter, VkMemoryPropertyFlags Properties) -> uint {
-        VkPhysicalDeviceMemoryProperties memoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(GetVKPhysicalDevice(), &memoryProperties);
-
-        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-            if (TypeFilter & (1 << i) &&
-                (memoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties) {
-                return i;
-            }
-        }
-
-        Check(false);
-        return 0u;
+        return VulkanBackendApp::GetApplication()->GetMemoryAllocator()->FindMemoryType(TypeFilter, Properties);
     }
 
     void CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags Properties,
-                      VkBuffer &Buffer, VkDeviceMemory &BufferMemory) {
+                      VkBuffer &Buffer, MemoryAllocation* &BufferMemory) {
         VkBufferCreateInfo BufferInfo{};
         BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         BufferInfo.size = Size;
@@ -34,18 +24,40 @@ namespace HWPT::RHI {
         VkDevice GlobalDevice = GetVKDevice();
         VK_CHECK(vkCreateBuffer(GlobalDevice, &BufferInfo, nullptr, &Buffer));
 
-        VkMemoryRequirements memoryRequirements;
-        vkGetBufferMemoryRequirements(GlobalDevice, Buffer, &memoryRequirements);
-
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits,
-                                                      Properties);
+        VkBufferMemoryRequirementsInfo2 RequirementsInfo{};
+        RequirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+        RequirementsInfo.buffer = Buffer;
+        VkMemoryDedicatedRequirements DedicatedRequirements{};
+        DedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 MemoryRequirements{};
+        MemoryRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        MemoryRequirements.pNext = &DedicatedRequirements;
+        vkGetBufferMemoryRequirements2(GlobalDevice, &RequirementsInfo, &MemoryRequirements);
+        MemoryDedication Dedication;
+        Dedication.Buffer = Buffer;
+        Dedication.Prefers = DedicatedRequirements.prefersDedicatedAllocation == VK_TRUE;
+        Dedication.Requires = DedicatedRequirements.requiresDedicatedAllocation == VK_TRUE;
+
+        // Host visible copy sources are staging memory, everything else counts as a buffer
+        const VkBufferUsageFlags ResourceUsage =
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        MemoryCategory Category = (Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+                                  (Usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) && !(Usage & ResourceUsage) ?
+                                  MemoryCategory::Staging : MemoryCategory::Buffer;
+        BufferMemory = VulkanBackendApp::GetApplication()->GetMemoryAllocator()->Allocate(
+                MemoryRequirements.memoryRequirements, Properties, MemoryResourceKind::Linear, Category, Dedication);
+
+        VK_CHECK(vkBindBufferMemory(GlobalDevice, Buffer, BufferMemory->Memory, BufferMemory->Offset));
+    }
 
-        VK_CHECK(vkAllocateMemory(GlobalDevice, &allocateInfo, nullptr, &BufferMemory));
+    void DestroyBuffer(VkBuffer Buffer, MemoryAllocation *BufferMemory) {
+        vkDestroyBuffer(GetVKDevice(), Buffer, nullptr);
+        FreeMemory(BufferMemory);
+    }
 
-        vkBindBufferMemory(GlobalDevice, Buffer, BufferMemory, 0);
+    void FreeMemory(MemoryAllocation *Memory) {
+        VulkanBackendApp::GetApplication()->GetMemoryAllocator()->Free(Memory);
     }
 
     void CopyBuffer(VkBuffer Src, VkBuffer Dst, VkDeviceSize Size) {
@@ -61,11 +73,11 @@ namespace HWPT::RHI {
         App->EndIntermediateCommand(CommandBuffer);
     }
 
-    auto CreateStagingBuffer(VkDeviceSize Size) -> std::tuple<VkBuffer, VkDeviceMemory> {
+    auto CreateStagingBuffer(VkDeviceSize Size) -> std::tuple<VkBuffer, MemoryAllocation*> {
         VkBuffer StagingBuffer;
-        VkDeviceMemory StagingBufferMemory;
+        MemoryAllocation* StagingBufferMemory;
 
-        CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        CreateBuffer(Size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                      StagingBuffer, StagingBufferMemory);
 
@@ -74,7 +86,7 @@ namespace HWPT::RHI {
 
     void CreateTexture2D(uint Width, uint Height, uint NumMips, VkSampleCountFlagBits SampleCount,
                          VkFormat Format, VkImageUsageFlags Usage, VkImageTiling Tiling,
-                         VkImage &Texture, VkDeviceMemory &TextureMemory) {
+                         VkImage &Texture, MemoryAllocation* &TextureMemory) {
         VkImageCreateInfo CreateInfo{};
         CreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         CreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -95,71 +107,64 @@ namespace HWPT::RHI {
 
         VK_CHECK(vkCreateImage(GetVKDevice(), &CreateInfo, nullptr, &Texture));
 
-        VkMemoryRequirements MemRequirements;
-        vkGetImageMemoryRequirements(GetVKDevice(), Texture, &MemRequirements);
-        VkMemoryAllocateInfo AllocateInfo{};
-        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        AllocateInfo.allocationSize = MemRequirements.size;
-        AllocateInfo.memoryTypeIndex = FindMemoryType(MemRequirements.memoryTypeBits,
-                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        vkAllocateMemory(GetVKDevice(), &AllocateInfo, nullptr, &TextureMemory);
-        vkBindImageMemory(GetVKDevice(), Texture, TextureMemory, 0);
+        VkImageMemoryRequirementsInfo2 RequirementsInfo{};
+        RequirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+        RequirementsInfo.image = Texture;
+        VkMemoryDedicatedRequirements DedicatedRequirements{};
+        DedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+        VkMemoryRequirements2 MemRequirements{};
+        MemRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+        MemRequirements.pNext = &DedicatedRequirements;
+        vkGetImageMemoryRequirements2(GetVKDevice(), &RequirementsInfo, &MemRequirements);
+        MemoryDedication Dedication;
+        Dedication.Image = Texture;
+        Dedication.Prefers = DedicatedRequirements.prefersDedicatedAllocation == VK_TRUE;
+        Dedication.Requires = DedicatedRequirements.requiresDedicatedAllocation == VK_TRUE;
+        MemoryCategory Category =
+                Usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ?
+                MemoryCategory::RenderTarget : MemoryCategory::Texture;
+        TextureMemory = VulkanBackendApp::GetApplication()->GetMemoryAllocator()->Allocate(
+                MemRequirements.memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                Tiling == VK_IMAGE_TILING_OPTIMAL ? MemoryResourceKind::Optimal : MemoryResourceKind::Linear, Category,
+                Dedication);
+        VK_CHECK(vkBindImageMemory(GetVKDevice(), Texture, TextureMemory->Memory, TextureMemory->Offset));
     }
 
-    void TransitionTextureLayout(VkImage Image, uint NumMips, VkImageLayout OldLayout,
-                                 VkImageLayout NewLayout) {
-        VkCommandBuffer CommandBuffer = VulkanBackendApp::GetApplication()->BeginIntermediateCommand();
-
-        VkImageMemoryBarrier Barrier{};
-        Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        Barrier.oldLayout = OldLayout;
-        Barrier.newLayout = NewLayout;
-        Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        Barrier.image = Image;
-        Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        Barrier.subresourceRange.baseMipLevel = 0;
-        Barrier.subresourceRange.levelCount = NumMips;
-        Barrier.subresourceRange.baseArrayLayer = 0;
-        Barrier.subresourceRange.layerCount = 1;
-
-        VkPipelineStageFlags SourceStage, DestinationStage;
-        if (OldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-            NewLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            Barrier.srcAccessMask = 0;
-            Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            SourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            DestinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (OldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-                   NewLayout == VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL) {
-            Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            SourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            DestinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else if (OldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL &&
-                   NewLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            Barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-            Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            SourceStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            DestinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else if (OldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL &&
-                   NewLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-            Barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            Barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-            SourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-            DestinationStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        } else {
-            throw std::runtime_error("Unsupported layout transition!");
+    auto GetLayoutSyncScope(VkImageLayout Layout) -> std::pair<VkPipelineStageFlags2, VkAccessFlags2> {
+        switch (Layout) {
+            case VK_IMAGE_LAYOUT_UNDEFINED:
+            case VK_IMAGE_LAYOUT_PREINITIALIZED:
+            case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+            case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+            case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+            case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            case VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+                return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT |
+                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+            default:  // GENERAL and anything without a narrower use
+                return {VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
         }
+    }
 
-        vkCmdPipelineBarrier(CommandBuffer, SourceStage, DestinationStage,
-                             0, 0, nullptr, 0, nullptr, 1, &Barrier);
-
-        VulkanBackendApp::GetApplication()->EndIntermediateCommand(CommandBuffer);
+    void TransitionTextureLayout(ImageLayoutState &State, VkImageLayout NewLayout, VkPipelineStageFlags2 Stage,
+                                 VkAccessFlags2 Access) {
+        VulkanBackendApp::GetApplication()->GetBarrierBatcher()->Transition(State, NewLayout, Stage, Access);
     }
 
     void CreateImageView(VkImage Image, VkFormat Format, VkImageView &ImageView) {
@@ -181,9 +186,14 @@ namespace HWPT::RHI {
 
     void CopyBufferToTexture(VkImage Image, VkBuffer Buffer, uint Width, uint Height) {
         VkCommandBuffer CommandBuffer = VulkanBackendApp::GetApplication()->BeginIntermediateCommand();
+        CopyBufferToTexture(CommandBuffer, Image, Buffer, 0, Width, Height);
+        VulkanBackendApp::GetApplication()->EndIntermediateCommand(CommandBuffer);
+    }
 
+    void CopyBufferToTexture(VkCommandBuffer CommandBuffer, VkImage Image, VkBuffer Buffer,
+                             VkDeviceSize BufferOffset, uint Width, uint Height) {
         VkBufferImageCopy Region{};
-        Region.bufferOffset = 0;
+        Region.bufferOffset = BufferOffset;
         Region.bufferRowLength = 0;
         Region.bufferImageHeight = 0;
 
@@ -201,35 +211,24 @@ namespace HWPT::RHI {
 
         vkCmdCopyBufferToImage(CommandBuffer, Buffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                1, &Region);
-
-        VulkanBackendApp::GetApplication()->EndIntermediateCommand(CommandBuffer);
     }
 
-    void GenerateMips(VkImage Image, uint Width, uint Height, uint NumMips) {
-        auto CommandBuffer = VulkanBackendApp::GetApplication()->BeginIntermediateCommand();
-
-        VkImageMemoryBarrier Barrier{};
-        Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        Barrier.image = Image;
-        Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        Barrier.subresourceRange.levelCount = 1;
-        Barrier.subresourceRange.baseArrayLayer = 0;
-        Barrier.subresourceRange.layerCount = 1;
+    void GenerateMips(ImageLayoutState &State, uint Width, uint Height) {
+        auto* App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        GenerateMips(CommandBuffer, *App->GetBarrierBatcher(), State, Width, Height);
+        App->EndIntermediateCommand(CommandBuffer);
+    }
 
+    void GenerateMips(VkCommandBuffer CommandBuffer, BarrierBatcher &Barriers, ImageLayoutState &State,
+                      uint Width, uint Height) {
+        const VkImage Image = State.GetImage();
+        const uint NumMips = State.GetNumMips();
         int SrcMipWidth = static_cast<int>(Width), SrcMipHeight = static_cast<int>(Height);
-        for (int i = 1; i < NumMips; i++) {
-            // Transition Src to TRANSFER_SRC_OPTIMAL
-            Barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            Barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            Barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            Barrier.subresourceRange.baseMipLevel = i - 1;
-            vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
-                                 1, &Barrier);
+        for (uint i = 1; i < NumMips; i++) {
+            Barriers.Transition(State, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_NONE,
+                                VK_ACCESS_2_NONE, i - 1, 1);
+            Barriers.Flush(CommandBuffer);
 
             VkImageBlit Blit{};
             Blit.srcOffsets[0] = {0, 0, 0};
@@ -254,29 +253,11 @@ namespace HWPT::RHI {
 
             SrcMipWidth = DstMipWidth;
             SrcMipHeight = DstMipHeight;
-
-            // Transition Src to SHADER_READ_ONLY_OPTIMAL
-            Barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            Barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            Barrier.subresourceRange.baseMipLevel = i - 1;
-            vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
-                                 1, &Barrier);
         }
 
-        // Transition Last Level to SHADER_READ_ONLY_OPTIMAL
-        Barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        Barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        Barrier.subresourceRange.baseMipLevel = NumMips - 1;
-        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
-                             1, &Barrier);
-
-        VulkanBackendApp::GetApplication()->EndIntermediateCommand(CommandBuffer);
+        // Merges into one barrier for the source levels and one for the last level
+        Barriers.Transition(State, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+        Barriers.Flush(CommandBuffer);
     }
 
     void GenerateMips(VkImage Image, uint Width, uint Height, uint NumMips, VkFormat Format) {
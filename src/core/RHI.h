@@ -7,6 +7,8 @@
 
 #include "core/Core.h"
 #include "vulkan/vulkan.h"
+#include "core/memory/DeviceMemoryAllocator.h"
+#include "core/texture/BarrierBatcher.h"
 
 
 // NOTE: Only Support Vulkan, Actually is a Util Funcs Header Now
@@ -14,21 +16,44 @@ namespace HWPT::RHI {
     auto FindMemoryType(uint TypeFilter, VkMemoryPropertyFlags Properties) -> uint;
 
     void CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, VkMemoryPropertyFlags Properties,
-                      VkBuffer& Buffer, VkDeviceMemory& BufferMemory);
+                      VkBuffer& Buffer, MemoryAllocation*& BufferMemory);
+
+    // Destroys Buffer and returns its memory to the device allocator
+    void DestroyBuffer(VkBuffer Buffer, MemoryAllocation* BufferMemory);
+
+    void FreeMemory(MemoryAllocation* Memory);
 
     void CopyBuffer(VkBuffer Src, VkBuffer Dst, VkDeviceSize Size);
 
-    auto CreateStagingBuffer(VkDeviceSize Size) -> std::tuple<VkBuffer, VkDeviceMemory>;
+    auto CreateStagingBuffer(VkDeviceSize Size) -> std::tuple<VkBuffer, MemoryAllocation*>;
 
     void CreateTexture2D(uint Width, uint Height, uint NumMips, VkSampleCountFlagBits SampleCount,
                          VkFormat Format, VkImageUsageFlags Usage, VkImageTiling Tiling,
-                         VkImage& Texture, VkDeviceMemory& TextureMemory);
+                         VkImage& Texture, MemoryAllocation*& TextureMemory);
+
+    // Stage and access of the typical use of an image in Layout, e.g. fragment and compute sampling for
+    // SHADER_READ_ONLY_OPTIMAL
+    auto GetLayoutSyncScope(VkImageLayout Layout) -> std::pair<VkPipelineStageFlags2, VkAccessFlags2>;
 
-    void TransitionTextureLayout(VkImage Image, uint NumMips, VkImageLayout OldLayout, VkImageLayout NewLayout);
+    // Queued on the application's BarrierBatcher and recorded ahead of the next command buffer it begins,
+    // the old layout comes from State. Stage and Access are the next use, see BarrierBatcher::Transition
+    void TransitionTextureLayout(ImageLayoutState& State, VkImageLayout NewLayout,
+                                 VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE,
+                                 VkAccessFlags2 Access = VK_ACCESS_2_NONE);
 
     void CopyBufferToTexture(VkImage Image, VkBuffer Buffer, uint Width, uint Height);
 
-    void GenerateMips(VkImage Image, uint Width, uint Height, uint NumMips);
+    void GenerateMips(ImageLayoutState& State, uint Width, uint Height);
+
+    // Recording variants of the above for callers that batch work into their own command buffer,
+    // e.g. UploadManager. The overloads without a command buffer submit and wait on their own
+    void CopyBufferToTexture(VkCommandBuffer CommandBuffer, VkImage Image, VkBuffer Buffer,
+                             VkDeviceSize BufferOffset, uint Width, uint Height);
+
+    // Every level has to be in TRANSFER_DST_OPTIMAL with level 0 written, all of them end in READ_ONLY_OPTIMAL.
+    // The transitions go through Barriers and flush into CommandBuffer, so State tracks each level on the way
+    void GenerateMips(VkCommandBuffer CommandBuffer, BarrierBatcher& Barriers, ImageLayoutState& State,
+                      uint Width, uint Height);
 
     void GenerateMips(VkImage Image, uint Width, uint Height, uint NumMips, VkFormat Format);
 }  // namespace HWPT::RHI
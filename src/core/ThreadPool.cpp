@@ -0,0 +1,110 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <algorithm>
+
+
+namespace HWPT {
+
+    ThreadPool::ThreadPool(uint NumThreads) {
+        // The calling thread always takes part in ParallelFor, so spawn one worker less
+        uint NumWorkers = NumThreads > 1 ? NumThreads - 1 : 0;
+        m_workers.reserve(NumWorkers);
+        for (uint i = 0; i < NumWorkers; i++) {
+            m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto& Worker: m_workers) {
+            Worker.join();
+        }
+    }
+
+    auto ThreadPool::Get() -> ThreadPool& {
+        static ThreadPool GlobalPool;
+        return GlobalPool;
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> Task) {
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_tasks.push_back(std::move(Task));
+        }
+        m_condition.notify_one();
+    }
+
+    auto ThreadPool::TryRunPendingTask() -> bool {
+        std::function<void()> Task;
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            if (m_tasks.empty()) {
+                return false;
+            }
+            Task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        Task();
+        return true;
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> Task;
+            {
+                std::unique_lock<std::mutex> Lock(m_mutex);
+                m_condition.wait(Lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_stop && m_tasks.empty()) {
+                    return;
+                }
+                Task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            Task();
+        }
+    }
+
+    void ThreadPool::ParallelFor(uint Count, const std::function<void(uint, uint)>& Func,
+                                 uint GrainSize) {
+        if (Count == 0) {
+            return;
+        }
+        GrainSize = std::max(GrainSize, 1u);
+        // A few chunks per thread to balance uneven workloads
+        uint NumChunks = std::min((Count + GrainSize - 1) / GrainSize, GetNumThreads() * 4);
+        if (NumChunks <= 1 || m_workers.empty()) {
+            Func(0, Count);
+            return;
+        }
+
+        uint ChunkSize = (Count + NumChunks - 1) / NumChunks;
+        std::atomic<uint> RemainingChunks = (Count + ChunkSize - 1) / ChunkSize;
+        std::mutex DoneMutex;
+        std::condition_variable DoneCondition;
+
+        for (uint Begin = 0; Begin < Count; Begin += ChunkSize) {
+            uint End = std::min(Begin + ChunkSize, Count);
+            Enqueue([&, Begin, End]() {
+                Func(Begin, End);
+                // Decrement under the lock, the caller owns DoneMutex and may return right after
+                std::lock_guard<std::mutex> Lock(DoneMutex);
+                if (RemainingChunks.fetch_sub(1) == 1) {
+                    DoneCondition.notify_all();
+                }
+            });
+        }
+
+        // Help out instead of blocking, this also keeps nested ParallelFor calls from dead-locking
+        while (RemainingChunks.load() > 0 && TryRunPendingTask()) {}
+        std::unique_lock<std::mutex> Lock(DoneMutex);
+        DoneCondition.wait(Lock, [&]() { return RemainingChunks.load() == 0; });
+    }
+}  // namespace HWPT
@@ -0,0 +1,68 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#ifndef HARDWAREPATHTRACER_THREADPOOL_H
+#define HARDWAREPATHTRACER_THREADPOOL_H
+
+#include "core/Core.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+
+namespace HWPT {
+    class ThreadPool {
+    public:
+        explicit ThreadPool(uint NumThreads = std::thread::hardware_concurrency());
+
+        ~ThreadPool();
+
+        // Splits [0, Count) into chunks of at least GrainSize and runs Func(Begin, End) on the workers,
+        // the calling thread helps executing chunks and returns when all of them are done
+        void ParallelFor(uint Count, const std::function<void(uint Begin, uint End)>& Func,
+                         uint GrainSize = 1);
+
+        // Runs Func on a worker and returns a future of its result, exceptions are rethrown by the future.
+        // Without workers Func runs right away on the calling thread
+        template<typename F>
+        auto Submit(F&& Func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+            using ResultType = std::invoke_result_t<std::decay_t<F>>;
+            auto Task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(Func));
+            std::future<ResultType> Future = Task->get_future();
+            if (m_workers.empty()) {
+                (*Task)();
+            } else {
+                Enqueue([Task]() { (*Task)(); });
+            }
+            return Future;
+        }
+
+        [[nodiscard]] auto GetNumThreads() const -> uint {
+            return static_cast<uint>(m_workers.size()) + 1;  // Workers + Caller
+        }
+
+        static auto Get() -> ThreadPool&;
+
+    private:
+        void Enqueue(std::function<void()> Task);
+
+        auto TryRunPendingTask() -> bool;
+
+        void WorkerLoop();
+
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stop = false;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_THREADPOOL_H
@@ -0,0 +1,717 @@
+//
+// Created by HUSTLX on 2024/10/24.
+//
+
+#include "BVH.h"
+#include "core/Model.h"
+#include "core/ThreadPool.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+namespace HWPT {
+    static constexpr uint MaxBuildDepth = 64;
+    static constexpr uint TraversalStackSize = 64;
+
+    static auto Intersection(const AABB& A, const AABB& B) -> AABB {
+        AABB Result;
+        Result.Min = glm::max(A.Min, B.Min);
+        Result.Max = glm::min(A.Max, B.Max);
+        return Result;
+    }
+
+    // Entry distance of the ray into the box, infinity when it misses [TMin, TMax]
+    static auto IntersectNode(const BVHNode& Node, const glm::vec3& Origin, const glm::vec3& InvDirection,
+                              float TMin, float TMax) -> float {
+        glm::vec3 T0 = (Node.Min - Origin) * InvDirection;
+        glm::vec3 T1 = (Node.Max - Origin) * InvDirection;
+        glm::vec3 TNear = glm::min(T0, T1), TFar = glm::max(T0, T1);
+        float TEnter = std::max(std::max(TNear.x, TNear.y), std::max(TNear.z, TMin));
+        float TExit = std::min(std::min(TFar.x, TFar.y), std::min(TFar.z, TMax));
+        return TEnter <= TExit ? TEnter : std::numeric_limits<float>::infinity();
+    }
+
+    class BVH::Builder {
+    public:
+        Builder(BVH& Target, const std::vector<glm::vec3>& Positions, const std::vector<uint>& Indices,
+                const BVHBuildSettings& Settings)
+                : m_target(Target), m_positions(Positions), m_indices(Indices), m_settings(Settings) {}
+
+        void Run() {
+            const auto NumTriangles = static_cast<uint>(m_indices.size() / 3);
+            std::vector<Reference> References;
+            References.reserve(NumTriangles);
+            AABB RootBounds;
+            for (uint Triangle = 0; Triangle < NumTriangles; Triangle++) {
+                // Zero area triangles can never be hit, non-finite ones would poison the bounds
+                if (IsDegenerate(Triangle)) {
+                    m_numDegenerateTriangles++;
+                    continue;
+                }
+                Reference Ref;
+                for (uint k = 0; k < 3; k++) {
+                    Ref.Bounds.Extend(GetVertex(Triangle, k));
+                }
+                Ref.Triangle = Triangle;
+                RootBounds.Extend(Ref.Bounds);
+                References.push_back(Ref);
+            }
+
+            m_numReferences = static_cast<uint>(References.size());
+            m_maxReferences = static_cast<uint>(static_cast<float>(m_numReferences) *
+                                                std::max(m_settings.MaxReferenceFactor, 1.f));
+            m_rootArea = std::max(RootBounds.GetSurfaceArea(), 1e-12f);
+
+            m_target.m_nodes.clear();
+            m_target.m_triangleIndices.clear();
+            m_target.m_nodes.reserve(2 * References.size() + 1);
+            m_target.m_nodes.push_back({});
+            if (References.empty()) {
+                m_target.m_nodes[0] = {glm::vec3(0.f), 0, glm::vec3(0.f), 0};
+                return;
+            }
+            BuildNode(0, References, RootBounds, 0);
+        }
+
+        [[nodiscard]] auto GetNumSpatialSplits() const -> uint {
+            return m_numSpatialSplits;
+        }
+
+        [[nodiscard]] auto GetMaxDepth() const -> uint {
+            return m_maxDepth;
+        }
+
+        [[nodiscard]] auto GetNumDegenerateTriangles() const -> uint {
+            return m_numDegenerateTriangles;
+        }
+
+    private:
+        struct Bin {
+            AABB Bounds;
+            uint Count = 0;   // Object bins: references, spatial bins: references entering
+            uint Exits = 0;
+        };
+
+        struct SplitCandidate {
+            float Cost = std::numeric_limits<float>::infinity();
+            int Axis = -1;
+            uint Bin = 0;           // Left side holds bins [0, Bin]
+            float Position = 0.f;   // Spatial split plane
+            AABB Left, Right;
+            uint NumLeft = 0, NumRight = 0;
+        };
+
+        [[nodiscard]] auto GetVertex(uint Triangle, uint Corner) const -> const glm::vec3& {
+            return m_positions[m_indices[3 * Triangle + Corner]];
+        }
+
+        [[nodiscard]] auto IsDegenerate(uint Triangle) const -> bool {
+            const glm::vec3& V0 = GetVertex(Triangle, 0);
+            const glm::vec3& V1 = GetVertex(Triangle, 1);
+            const glm::vec3& V2 = GetVertex(Triangle, 2);
+            for (const glm::vec3& V: {V0, V1, V2}) {
+                if (!std::isfinite(V.x) || !std::isfinite(V.y) || !std::isfinite(V.z)) {
+                    return true;
+                }
+            }
+            // Collinear vertices included
+            return glm::length(glm::cross(V1 - V0, V2 - V0)) == 0.f;
+        }
+
+        [[nodiscard]] auto SplitCost(const AABB& Left, uint NumLeft, const AABB& Right, uint NumRight,
+                                     float NodeArea) const -> float {
+            return m_settings.TraversalCost + m_settings.IntersectionCost *
+                   (Left.GetSurfaceArea() * static_cast<float>(NumLeft) +
+                    Right.GetSurfaceArea() * static_cast<float>(NumRight)) / NodeArea;
+        }
+
+        // Clips the triangle of Ref against the plane, both halves are bounded by the original reference
+        void SplitReference(const Reference& Ref, int Axis, float Position, Reference& Left, Reference& Right) const {
+            Left = {AABB(), Ref.Triangle};
+            Right = {AABB(), Ref.Triangle};
+            for (uint k = 0; k < 3; k++) {
+                const glm::vec3& V0 = GetVertex(Ref.Triangle, k);
+                const glm::vec3& V1 = GetVertex(Ref.Triangle, (k + 1) % 3);
+                float P0 = V0[Axis], P1 = V1[Axis];
+                if (P0 <= Position) {
+                    Left.Bounds.Extend(V0);
+                }
+                if (P0 >= Position) {
+                    Right.Bounds.Extend(V0);
+                }
+                if ((P0 < Position && P1 > Position) || (P0 > Position && P1 < Position)) {
+                    float T = std::clamp((Position - P0) / (P1 - P0), 0.f, 1.f);
+                    glm::vec3 Point = V0 + (V1 - V0) * T;
+                    Point[Axis] = Position;
+                    Left.Bounds.Extend(Point);
+                    Right.Bounds.Extend(Point);
+                }
+            }
+            Left.Bounds.Max[Axis] = Position;
+            Right.Bounds.Min[Axis] = Position;
+            Left.Bounds = Intersection(Left.Bounds, Ref.Bounds);
+            Right.Bounds = Intersection(Right.Bounds, Ref.Bounds);
+        }
+
+        auto FindObjectSplit(const std::vector<Reference>& Refs, float NodeArea) const -> SplitCandidate {
+            SplitCandidate Best;
+            AABB CentroidBounds;
+            for (const auto& Ref: Refs) {
+                CentroidBounds.Extend(Ref.Bounds.GetCenter());
+            }
+
+            const uint NumBins = std::max(m_settings.NumBins, 2u);
+            std::vector<Bin> Bins(NumBins);
+            std::vector<AABB> RightBounds(NumBins);
+            for (int Axis = 0; Axis < 3; Axis++) {
+                float Extent = CentroidBounds.Max[Axis] - CentroidBounds.Min[Axis];
+                if (Extent <= 0.f) {
+                    continue;
+                }
+                float Scale = static_cast<float>(NumBins) / Extent;
+                std::fill(Bins.begin(), Bins.end(), Bin());
+                for (const auto& Ref: Refs) {
+                    uint Index = std::min(static_cast<uint>((Ref.Bounds.GetCenter()[Axis] -
+                                                             CentroidBounds.Min[Axis]) * Scale), NumBins - 1);
+                    Bins[Index].Bounds.Extend(Ref.Bounds);
+                    Bins[Index].Count++;
+                }
+
+                AABB Accumulated;
+                for (uint i = NumBins - 1; i > 0; i--) {
+                    Accumulated.Extend(Bins[i].Bounds);
+                    RightBounds[i] = Accumulated;
+                }
+                AABB Left;
+                uint NumLeft = 0, NumRight = static_cast<uint>(Refs.size());
+                for (uint i = 0; i < NumBins - 1; i++) {
+                    Left.Extend(Bins[i].Bounds);
+                    NumLeft += Bins[i].Count;
+                    NumRight -= Bins[i].Count;
+                    if (NumLeft == 0 || NumRight == 0) {
+                        continue;
+                    }
+                    float Cost = SplitCost(Left, NumLeft, RightBounds[i + 1], NumRight, NodeArea);
+                    if (Cost < Best.Cost) {
+                        Best.Cost = Cost;
+                        Best.Axis = Axis;
+                        Best.Bin = i;
+                        Best.Position = CentroidBounds.Min[Axis] + static_cast<float>(i + 1) / Scale;
+                        Best.Left = Left;
+                        Best.Right = RightBounds[i + 1];
+                        Best.NumLeft = NumLeft;
+                        Best.NumRight = NumRight;
+                    }
+                }
+            }
+            return Best;
+        }
+
+        auto FindSpatialSplit(const std::vector<Reference>& Refs, const AABB& NodeBounds,
+                              float NodeArea) const -> SplitCandidate {
+            SplitCandidate Best;
+            const uint NumBins = std::max(m_settings.NumBins, 2u);
+            std::vector<Bin> Bins(NumBins);
+            std::vector<AABB> RightBounds(NumBins);
+            for (int Axis = 0; Axis < 3; Axis++) {
+                float Origin = NodeBounds.Min[Axis];
+                float BinWidth = (NodeBounds.Max[Axis] - Origin) / static_cast<float>(NumBins);
+                if (BinWidth <= 0.f) {
+                    continue;
+                }
+                auto GetBin = [&](float Value) {
+                    return std::min(static_cast<uint>(std::max((Value - Origin) / BinWidth, 0.f)), NumBins - 1);
+                };
+
+                std::fill(Bins.begin(), Bins.end(), Bin());
+                for (const auto& Ref: Refs) {
+                    uint First = GetBin(Ref.Bounds.Min[Axis]), Last = GetBin(Ref.Bounds.Max[Axis]);
+                    Bins[First].Count++;
+                    Bins[Last].Exits++;
+                    // Chop the reference bin by bin, each bin only grows by the clipped piece
+                    Reference Current = Ref;
+                    for (uint i = First; i < Last; i++) {
+                        Reference Left, Right;
+                        SplitReference(Current, Axis, Origin + static_cast<float>(i + 1) * BinWidth, Left, Right);
+                        Bins[i].Bounds.Extend(Left.Bounds);
+                        Current = Right;
+                    }
+                    Bins[Last].Bounds.Extend(Current.Bounds);
+                }
+
+                AABB Accumulated;
+                for (uint i = NumBins - 1; i > 0; i--) {
+                    Accumulated.Extend(Bins[i].Bounds);
+                    RightBounds[i] = Accumulated;
+                }
+                AABB Left;
+                uint NumLeft = 0, NumRight = static_cast<uint>(Refs.size());
+                for (uint i = 0; i < NumBins - 1; i++) {
+                    Left.Extend(Bins[i].Bounds);
+                    NumLeft += Bins[i].Count;
+                    NumRight -= Bins[i].Exits;
+                    if (NumLeft == 0 || NumRight == 0 || !Left.IsValid() || !RightBounds[i + 1].IsValid()) {
+                        continue;
+                    }
+                    float Cost = SplitCost(Left, NumLeft, RightBounds[i + 1], NumRight, NodeArea);
+                    if (Cost < Best.Cost) {
+                        Best.Cost = Cost;
+                        Best.Axis = Axis;
+                        Best.Bin = i;
+                        Best.Position = Origin + static_cast<float>(i + 1) * BinWidth;
+                        Best.Left = Left;
+                        Best.Right = RightBounds[i + 1];
+                        Best.NumLeft = NumLeft;
+                        Best.NumRight = NumRight;
+                    }
+                }
+            }
+            return Best;
+        }
+
+        void PartitionObjectSplit(const std::vector<Reference>& Refs, const SplitCandidate& Split,
+                                  std::vector<Reference>& Left, std::vector<Reference>& Right) const {
+            for (const auto& Ref: Refs) {
+                (Ref.Bounds.GetCenter()[Split.Axis] < Split.Position ? Left : Right).push_back(Ref);
+            }
+            // Centroids exactly on the plane can upset the binned counts, never return an empty side
+            if (Left.empty() || Right.empty()) {
+                PartitionMedian(Refs, Left, Right);
+            }
+        }
+
+        void PartitionMedian(const std::vector<Reference>& Refs, std::vector<Reference>& Left,
+                             std::vector<Reference>& Right) const {
+            Left.assign(Refs.begin(), Refs.begin() + static_cast<std::ptrdiff_t>(Refs.size() / 2));
+            Right.assign(Refs.begin() + static_cast<std::ptrdiff_t>(Refs.size() / 2), Refs.end());
+        }
+
+        void PartitionSpatialSplit(const std::vector<Reference>& Refs, const SplitCandidate& Split,
+                                   std::vector<Reference>& Left, std::vector<Reference>& Right) {
+            const int Axis = Split.Axis;
+            AABB LeftBounds, RightBounds;
+            std::vector<const Reference*> Straddling;
+            for (const auto& Ref: Refs) {
+                if (Ref.Bounds.Max[Axis] <= Split.Position) {
+                    Left.push_back(Ref);
+                    LeftBounds.Extend(Ref.Bounds);
+                } else if (Ref.Bounds.Min[Axis] >= Split.Position) {
+                    Right.push_back(Ref);
+                    RightBounds.Extend(Ref.Bounds);
+                } else {
+                    Straddling.push_back(&Ref);
+                }
+            }
+
+            // Reference unsplitting, keep a straddling reference whole on one side when that is cheaper
+            auto NumLeft = static_cast<float>(Left.size() + Straddling.size());
+            auto NumRight = static_cast<float>(Right.size() + Straddling.size());
+            AABB SplitLeftBounds = Split.Left, SplitRightBounds = Split.Right;
+            for (const Reference* Ref: Straddling) {
+                Reference LeftPart, RightPart;
+                SplitReference(*Ref, Axis, Split.Position, LeftPart, RightPart);
+
+                AABB LeftWithWhole = SplitLeftBounds, RightWithWhole = SplitRightBounds;
+                LeftWithWhole.Extend(Ref->Bounds);
+                RightWithWhole.Extend(Ref->Bounds);
+                float CostSplit = SplitLeftBounds.GetSurfaceArea() * NumLeft +
+                                  SplitRightBounds.GetSurfaceArea() * NumRight;
+                float CostLeft = LeftWithWhole.GetSurfaceArea() * NumLeft +
+                                 SplitRightBounds.GetSurfaceArea() * (NumRight - 1.f);
+                float CostRight = SplitLeftBounds.GetSurfaceArea() * (NumLeft - 1.f) +
+                                  RightWithWhole.GetSurfaceArea() * NumRight;
+
+                if (CostLeft < CostSplit && CostLeft <= CostRight) {
+                    Left.push_back(*Ref);
+                    SplitLeftBounds = LeftWithWhole;
+                    NumRight -= 1.f;
+                } else if (CostRight < CostSplit) {
+                    Right.push_back(*Ref);
+                    SplitRightBounds = RightWithWhole;
+                    NumLeft -= 1.f;
+                } else if (LeftPart.Bounds.IsValid() && RightPart.Bounds.IsValid()) {
+                    Left.push_back(LeftPart);
+                    Right.push_back(RightPart);
+                    m_numReferences++;
+                } else {
+                    // Triangle only touches the plane, clipping leaves nothing on one side
+                    (LeftPart.Bounds.IsValid() ? Left : Right).push_back(*Ref);
+                }
+            }
+        }
+
+        void MakeLeaf(uint NodeIndex, const std::vector<Reference>& Refs, const AABB& Bounds) {
+            BVHNode& Node = m_target.m_nodes[NodeIndex];
+            Node.Min = Bounds.Min;
+            Node.Max = Bounds.Max;
+            Node.LeftOrFirst = static_cast<uint>(m_target.m_triangleIndices.size());
+            Node.Count = static_cast<uint>(Refs.size());
+            for (const auto& Ref: Refs) {
+                m_target.m_triangleIndices.push_back(Ref.Triangle);
+            }
+        }
+
+        void BuildNode(uint NodeIndex, std::vector<Reference>& Refs, const AABB& Bounds, uint Depth) {
+            m_maxDepth = std::max(m_maxDepth, Depth);
+            const auto NumRefs = static_cast<uint>(Refs.size());
+            const float NodeArea = std::max(Bounds.GetSurfaceArea(), 1e-12f);
+            const float LeafCost = m_settings.IntersectionCost * static_cast<float>(NumRefs);
+            if (NumRefs <= 1 || Depth >= MaxBuildDepth) {
+                MakeLeaf(NodeIndex, Refs, Bounds);
+                return;
+            }
+
+            SplitCandidate ObjectSplit = FindObjectSplit(Refs, NodeArea);
+            SplitCandidate SpatialSplit;
+            if (m_settings.Mode == BVHBuildMode::SpatialSplit && ObjectSplit.Axis >= 0) {
+                float OverlapArea = Intersection(ObjectSplit.Left, ObjectSplit.Right).GetSurfaceArea();
+                bool WithinBudget = m_numReferences + NumRefs <= m_maxReferences;
+                if (OverlapArea / m_rootArea > m_settings.SpatialSplitAlpha && WithinBudget) {
+                    SpatialSplit = FindSpatialSplit(Refs, Bounds, NodeArea);
+                }
+            }
+
+            float SplitCost = std::min(ObjectSplit.Cost, SpatialSplit.Cost);
+            if (NumRefs <= m_settings.MaxLeafSize && LeafCost <= SplitCost) {
+                MakeLeaf(NodeIndex, Refs, Bounds);
+                return;
+            }
+
+            std::vector<Reference> Left, Right;
+            if (SpatialSplit.Cost < ObjectSplit.Cost) {
+                PartitionSpatialSplit(Refs, SpatialSplit, Left, Right);
+                m_numSpatialSplits++;
+            } else if (ObjectSplit.Axis >= 0) {
+                PartitionObjectSplit(Refs, ObjectSplit, Left, Right);
+            } else {
+                // All centroids coincide, nothing to bin
+                PartitionMedian(Refs, Left, Right);
+            }
+            if (Left.empty() || Right.empty()) {
+                MakeLeaf(NodeIndex, Refs, Bounds);
+                return;
+            }
+            std::vector<Reference>().swap(Refs);
+
+            AABB LeftBounds, RightBounds;
+            for (const auto& Ref: Left) {
+                LeftBounds.Extend(Ref.Bounds);
+            }
+            for (const auto& Ref: Right) {
+                RightBounds.Extend(Ref.Bounds);
+            }
+
+            auto LeftIndex = static_cast<uint>(m_target.m_nodes.size());
+            m_target.m_nodes.push_back({});
+            m_target.m_nodes.push_back({});
+            BVHNode& Node = m_target.m_nodes[NodeIndex];
+            Node.Min = Bounds.Min;
+            Node.Max = Bounds.Max;
+            Node.LeftOrFirst = LeftIndex;
+            Node.Count = 0;
+
+            BuildNode(LeftIndex, Left, LeftBounds, Depth + 1);
+            BuildNode(LeftIndex + 1, Right, RightBounds, Depth + 1);
+        }
+
+        BVH& m_target;
+        const std::vector<glm::vec3>& m_positions;
+        const std::vector<uint>& m_indices;
+        BVHBuildSettings m_settings;
+
+        uint m_numReferences = 0;
+        uint m_maxReferences = 0;
+        uint m_numSpatialSplits = 0;
+        uint m_numDegenerateTriangles = 0;
+        uint m_maxDepth = 0;
+        float m_rootArea = 1.f;
+    };
+
+    void BVH::Build(const std::vector<glm::vec3> &Positions, const std::vector<uint> &Indices,
+                    const BVHBuildSettings &Settings) {
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        const auto NumTriangles = static_cast<uint>(Indices.size() / 3);
+        m_triangles.resize(NumTriangles);
+        for (uint Triangle = 0; Triangle < NumTriangles; Triangle++) {
+            const glm::vec3& V0 = Positions[Indices[3 * Triangle + 0]];
+            m_triangles[Triangle] = {V0, Positions[Indices[3 * Triangle + 1]] - V0,
+                                     Positions[Indices[3 * Triangle + 2]] - V0};
+        }
+
+        Builder TreeBuilder(*this, Positions, Indices, Settings);
+        TreeBuilder.Run();
+
+        m_stats = BVHStats();
+        m_stats.BuildTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+        m_stats.NumNodes = static_cast<uint>(m_nodes.size());
+        m_stats.NumReferences = static_cast<uint>(m_triangleIndices.size());
+        m_stats.NumSpatialSplits = TreeBuilder.GetNumSpatialSplits();
+        m_stats.NumDegenerateTriangles = TreeBuilder.GetNumDegenerateTriangles();
+        m_stats.MaxDepth = TreeBuilder.GetMaxDepth();
+        m_stats.MemoryBytes = m_nodes.size() * sizeof(BVHNode) + m_triangleIndices.size() * sizeof(uint) +
+                              m_triangles.size() * sizeof(Triangle);
+
+        AABB RootBounds = GetBounds();
+        float RootArea = std::max(RootBounds.GetSurfaceArea(), 1e-12f);
+        for (const auto& Node: m_nodes) {
+            AABB NodeBounds{Node.Min, Node.Max};
+            float Probability = NodeBounds.GetSurfaceArea() / RootArea;
+            if (Node.IsLeaf()) {
+                m_stats.NumLeaves++;
+                m_stats.SAHCost += Probability * Settings.IntersectionCost * static_cast<float>(Node.Count);
+            } else {
+                m_stats.SAHCost += Probability * Settings.TraversalCost;
+            }
+        }
+    }
+
+    void BVH::Build(const Model &InModel, const BVHBuildSettings &Settings) {
+        std::vector<glm::vec3> Positions;
+        Positions.reserve(InModel.GetVertices().size());
+        for (const auto& ModelVertex: InModel.GetVertices()) {
+            Positions.push_back(ModelVertex.Pos);
+        }
+        Build(Positions, InModel.GetIndices(), Settings);
+    }
+
+    auto BVH::GetBounds() const -> AABB {
+        if (m_nodes.empty()) {
+            return {};
+        }
+        return {m_nodes[0].Min, m_nodes[0].Max};
+    }
+
+    auto BVH::IntersectTriangle(uint TriangleIndex, const Ray &InRay, float TMax, float &T,
+                                glm::vec2 &Barycentrics) const -> bool {
+        // Moller-Trumbore
+        const Triangle& Tri = m_triangles[TriangleIndex];
+        glm::vec3 P = glm::cross(InRay.Direction, Tri.Edge2);
+        float Determinant = glm::dot(Tri.Edge1, P);
+        if (std::abs(Determinant) < 1e-12f) {
+            return false;
+        }
+        float InvDeterminant = 1.f / Determinant;
+        glm::vec3 S = InRay.Origin - Tri.V0;
+        float U = glm::dot(S, P) * InvDeterminant;
+        if (U < 0.f || U > 1.f) {
+            return false;
+        }
+        glm::vec3 Q = glm::cross(S, Tri.Edge1);
+        float V = glm::dot(InRay.Direction, Q) * InvDeterminant;
+        if (V < 0.f || U + V > 1.f) {
+            return false;
+        }
+        T = glm::dot(Tri.Edge2, Q) * InvDeterminant;
+        if (T <= InRay.TMin || T >= TMax) {
+            return false;
+        }
+        Barycentrics = glm::vec2(U, V);
+        return true;
+    }
+
+    auto BVH::Intersect(const Ray &InRay, RayHit &Hit, BVHTraversalStats* Stats) const -> bool {
+        if (m_nodes.empty() || m_triangleIndices.empty()) {
+            return false;
+        }
+        const glm::vec3 InvDirection = 1.f / InRay.Direction;
+        float ClosestT = std::min(InRay.TMax, Hit.T);
+        bool Found = false;
+
+        uint Stack[TraversalStackSize];
+        uint StackSize = 0;
+        uint NodeIndex = 0;
+        if (IntersectNode(m_nodes[0], InRay.Origin, InvDirection, InRay.TMin, ClosestT) ==
+            std::numeric_limits<float>::infinity()) {
+            return false;
+        }
+
+        while (true) {
+            const BVHNode& Node = m_nodes[NodeIndex];
+            if (Stats) {
+                Stats->NodeVisits++;
+            }
+            if (Node.IsLeaf()) {
+                for (uint i = 0; i < Node.Count; i++) {
+                    uint Triangle = m_triangleIndices[Node.LeftOrFirst + i];
+                    float T;
+                    glm::vec2 Barycentrics;
+                    if (Stats) {
+                        Stats->TriangleTests++;
+                    }
+                    if (IntersectTriangle(Triangle, InRay, ClosestT, T, Barycentrics)) {
+                        ClosestT = T;
+                        Hit.T = T;
+                        Hit.PrimitiveID = Triangle;
+                        Hit.Barycentrics = Barycentrics;
+                        Found = true;
+                    }
+                }
+            } else {
+                uint Near = Node.LeftOrFirst, Far = Node.LeftOrFirst + 1;
+                float TNear = IntersectNode(m_nodes[Near], InRay.Origin, InvDirection, InRay.TMin, ClosestT);
+                float TFar = IntersectNode(m_nodes[Far], InRay.Origin, InvDirection, InRay.TMin, ClosestT);
+                if (TFar < TNear) {
+                    std::swap(Near, Far);
+                    std::swap(TNear, TFar);
+                }
+                if (TNear != std::numeric_limits<float>::infinity()) {
+                    if (TFar != std::numeric_limits<float>::infinity()) {
+                        Check(StackSize < TraversalStackSize);
+                        Stack[StackSize++] = Far;
+                    }
+                    NodeIndex = Near;
+                    continue;
+                }
+            }
+            if (StackSize == 0) {
+                break;
+            }
+            NodeIndex = Stack[--StackSize];
+        }
+        return Found;
+    }
+
+    auto BVH::IsOccluded(const Ray &InRay, BVHTraversalStats* Stats) const -> bool {
+        if (m_nodes.empty() || m_triangleIndices.empty()) {
+            return false;
+        }
+        const glm::vec3 InvDirection = 1.f / InRay.Direction;
+        constexpr float Miss = std::numeric_limits<float>::infinity();
+
+        uint Stack[TraversalStackSize];
+        uint StackSize = 0;
+        uint NodeIndex = 0;
+        if (IntersectNode(m_nodes[0], InRay.Origin, InvDirection, InRay.TMin, InRay.TMax) == Miss) {
+            return false;
+        }
+
+        while (true) {
+            const BVHNode& Node = m_nodes[NodeIndex];
+            if (Stats) {
+                Stats->NodeVisits++;
+            }
+            if (Node.IsLeaf()) {
+                for (uint i = 0; i < Node.Count; i++) {
+                    float T;
+                    glm::vec2 Barycentrics;
+                    if (Stats) {
+                        Stats->TriangleTests++;
+                    }
+                    if (IntersectTriangle(m_triangleIndices[Node.LeftOrFirst + i], InRay, InRay.TMax, T,
+                                          Barycentrics)) {
+                        return true;
+                    }
+                }
+            } else {
+                // Any hit ends the search, so the order the children are visited in does not matter
+                uint Left = Node.LeftOrFirst, Right = Node.LeftOrFirst + 1;
+                bool HitsLeft = IntersectNode(m_nodes[Left], InRay.Origin, InvDirection, InRay.TMin,
+                                              InRay.TMax) != Miss;
+                bool HitsRight = IntersectNode(m_nodes[Right], InRay.Origin, InvDirection, InRay.TMin,
+                                               InRay.TMax) != Miss;
+                if (HitsLeft || HitsRight) {
+                    if (HitsLeft && HitsRight) {
+                        Check(StackSize < TraversalStackSize);
+                        Stack[StackSize++] = Right;
+                    }
+                    NodeIndex = HitsLeft ? Left : Right;
+                    continue;
+                }
+            }
+            if (StackSize == 0) {
+                break;
+            }
+            NodeIndex = Stack[--StackSize];
+        }
+        return false;
+    }
+
+    void BVH::CompareBuildModes(const std::vector<glm::vec3> &Positions, const std::vector<uint> &Indices,
+                                uint NumRays, const BVHBuildSettings &Settings) {
+        BVHBuildSettings SAHSettings = Settings, SBVHSettings = Settings;
+        SAHSettings.Mode = BVHBuildMode::SAH;
+        SBVHSettings.Mode = BVHBuildMode::SpatialSplit;
+
+        BVH SAHTree, SBVHTree;
+        SAHTree.Build(Positions, Indices, SAHSettings);
+        SBVHTree.Build(Positions, Indices, SBVHSettings);
+
+        // Random rays starting inside the scene bounds, close to what secondary bounces look like
+        AABB Bounds = SAHTree.GetBounds();
+        std::vector<Ray> Rays(NumRays);
+        PCGRandom Random(NumRays);
+        for (auto& TestRay: Rays) {
+            TestRay.Origin = Bounds.Min + glm::vec3(Random.NextFloat(), Random.NextFloat(), Random.NextFloat()) *
+                                          Bounds.GetExtent();
+            float Z = 1.f - 2.f * Random.NextFloat();
+            float Phi = 2.f * 3.14159265f * Random.NextFloat();
+            float R = std::sqrt(std::max(0.f, 1.f - Z * Z));
+            TestRay.Direction = glm::vec3(R * std::cos(Phi), R * std::sin(Phi), Z);
+        }
+
+        auto Measure = [&](const BVH& Tree, const char* Name) {
+            std::vector<BVHTraversalStats> PerRay(NumRays);
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            ThreadPool::Get().ParallelFor(NumRays, [&](uint Begin, uint End) {
+                for (uint i = Begin; i < End; i++) {
+                    RayHit Hit;
+                    Tree.Intersect(Rays[i], Hit, &PerRay[i]);
+                }
+            }, 256);
+            double TraceMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - StartTime).count();
+
+            BVHTraversalStats Total;
+            for (const auto& Stats: PerRay) {
+                Total.NodeVisits += Stats.NodeVisits;
+                Total.TriangleTests += Stats.TriangleTests;
+            }
+            const BVHStats& Stats = Tree.GetStats();
+            std::cout << Name << " | " << Stats.BuildTimeMs << " | " << Stats.NumNodes << " | "
+                      << Stats.NumReferences << " | " << Stats.NumSpatialSplits << " | "
+                      << Stats.NumDegenerateTriangles << " | "
+                      << Stats.MemoryBytes / 1024 << " | " << Stats.SAHCost << " | "
+                      << static_cast<double>(Total.NodeVisits) / NumRays << " | "
+                      << static_cast<double>(Total.TriangleTests) / NumRays << " | " << TraceMs << "\n";
+            return Total.NodeVisits * Settings.TraversalCost + Total.TriangleTests * Settings.IntersectionCost;
+        };
+
+        std::cout << "BVH " << Indices.size() / 3 << " triangles, " << NumRays << " random rays\n";
+        std::cout << "Mode | Build ms | Nodes | References | Spatial splits | Degenerate | KB | SAH cost | "
+                     "Nodes/ray | Triangles/ray | Trace ms\n";
+        double SAHWork = Measure(SAHTree, "SAH");
+        double SBVHWork = Measure(SBVHTree, "SBVH");
+        std::cout << "SBVH traversal cost improvement: SAH model "
+                  << SAHTree.GetStats().SAHCost / std::max(SBVHTree.GetStats().SAHCost, 1e-6f)
+                  << "x, measured " << SAHWork / std::max(SBVHWork, 1.) << "x\n";
+        std::cout.flush();
+    }
+
+    void BVH::BenchmarkSpatialSplits(uint NumTriangles) {
+        // Long thin diagonal slivers, the worst case for object splits
+        std::vector<glm::vec3> Positions;
+        std::vector<uint> Indices;
+        Positions.reserve(3 * NumTriangles);
+        Indices.reserve(3 * NumTriangles);
+        PCGRandom Random(42);
+        const float SceneSize = 100.f;
+        for (uint i = 0; i < NumTriangles; i++) {
+            glm::vec3 Start = glm::vec3(Random.NextFloat(), Random.NextFloat(), Random.NextFloat()) * SceneSize;
+            glm::vec3 Direction = glm::normalize(glm::vec3(Random.NextFloat(), Random.NextFloat(), Random.NextFloat()) -
+                                                 glm::vec3(.5f));
+            float Length = 10.f + 30.f * Random.NextFloat();
+            glm::vec3 Side = glm::normalize(glm::cross(Direction, glm::vec3(.3f, .5f, .8f))) * .05f;
+            auto Base = static_cast<uint>(Positions.size());
+            Positions.push_back(Start);
+            Positions.push_back(Start + Direction * Length);
+            Positions.push_back(Start + Side);
+            Indices.insert(Indices.end(), {Base, Base + 1, Base + 2});
+        }
+        CompareBuildModes(Positions, Indices);
+    }
+}  // namespace HWPT
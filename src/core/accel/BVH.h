@@ -0,0 +1,122 @@
+//
+// Created by HUSTLX on 2024/10/24.
+//
+
+#ifndef HARDWAREPATHTRACER_BVH_H
+#define HARDWAREPATHTRACER_BVH_H
+
+#include "core/Core.h"
+#include "core/pathtracer/Ray.h"
+#include <vector>
+
+
+namespace HWPT {
+    class Model;
+
+    enum class BVHBuildMode : uint8_t {
+        SAH,            // Binned object splits only
+        SpatialSplit    // SBVH (Stich et al. 2009), object and spatial splits with reference duplication
+    };
+
+    struct BVHBuildSettings {
+        BVHBuildMode Mode = BVHBuildMode::SAH;
+        uint NumBins = 16;
+        uint MaxLeafSize = 4;
+        float TraversalCost = 1.f;
+        float IntersectionCost = 1.f;
+        // Spatial splits are only tried when the children of the best object split overlap by more
+        // than this fraction of the root surface area, the alpha of the SBVH paper
+        float SpatialSplitAlpha = 1e-5f;
+        // Memory cap, spatial splits stop once the references reach this multiple of the triangle count
+        float MaxReferenceFactor = 2.f;
+    };
+
+    // 32 bytes, children of an interior node are stored next to each other
+    struct BVHNode {
+        glm::vec3 Min;
+        uint LeftOrFirst;   // Interior: index of the left child, leaf: first entry in the triangle index list
+        glm::vec3 Max;
+        uint Count;         // 0 for interior nodes
+
+        [[nodiscard]] auto IsLeaf() const -> bool {
+            return Count > 0;
+        }
+    };
+
+    struct BVHStats {
+        uint NumNodes = 0;
+        uint NumLeaves = 0;
+        uint NumReferences = 0;
+        uint NumSpatialSplits = 0;
+        uint NumDegenerateTriangles = 0;  // Zero area or non-finite, left out of the tree
+        uint MaxDepth = 0;
+        float SAHCost = 0.f;
+        double BuildTimeMs = 0.;
+        size_t MemoryBytes = 0;
+    };
+
+    struct BVHTraversalStats {
+        uint64_t NodeVisits = 0;
+        uint64_t TriangleTests = 0;
+    };
+
+    // Triangle BVH over Model geometry, the bottom level of the acceleration structures
+    class BVH {
+    public:
+        BVH() = default;
+
+        void Build(const std::vector<glm::vec3>& Positions, const std::vector<uint>& Indices,
+                   const BVHBuildSettings& Settings = {});
+
+        void Build(const Model& InModel, const BVHBuildSettings& Settings = {});
+
+        // Closest hit, Hit.PrimitiveID is the triangle index
+        auto Intersect(const Ray& InRay, RayHit& Hit, BVHTraversalStats* Stats = nullptr) const -> bool;
+
+        // Any hit in (TMin, TMax), returns on the first one found without ordering the children
+        [[nodiscard]] auto IsOccluded(const Ray& InRay, BVHTraversalStats* Stats = nullptr) const -> bool;
+
+        [[nodiscard]] auto GetBounds() const -> AABB;
+
+        [[nodiscard]] auto GetNodes() const -> const std::vector<BVHNode>& {
+            return m_nodes;
+        }
+
+        [[nodiscard]] auto GetTriangleIndices() const -> const std::vector<uint>& {
+            return m_triangleIndices;
+        }
+
+        [[nodiscard]] auto GetStats() const -> const BVHStats& {
+            return m_stats;
+        }
+
+        // Builds both modes over the same geometry and reports SAH cost, memory and the measured
+        // traversal work of random rays
+        static void CompareBuildModes(const std::vector<glm::vec3>& Positions, const std::vector<uint>& Indices,
+                                      uint NumRays = 1u << 16, const BVHBuildSettings& Settings = {});
+
+        // CompareBuildModes on a synthetic scene of long thin diagonal triangles
+        static void BenchmarkSpatialSplits(uint NumTriangles = 1u << 16);
+
+    private:
+        struct Reference {
+            AABB Bounds;
+            uint Triangle;
+        };
+
+        struct Triangle {
+            glm::vec3 V0, Edge1, Edge2;
+        };
+
+        class Builder;
+
+        auto IntersectTriangle(uint TriangleIndex, const Ray& InRay, float TMax, float& T, glm::vec2& Barycentrics) const -> bool;
+
+        std::vector<BVHNode> m_nodes;
+        std::vector<uint> m_triangleIndices;
+        std::vector<Triangle> m_triangles;
+        BVHStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_BVH_H
@@ -0,0 +1,343 @@
+//
+// Created by HUSTLX on 2024/10/25.
+//
+
+#include "TLAS.h"
+#include "core/ThreadPool.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+namespace HWPT {
+    static constexpr uint TopLevelStackSize = 64;
+    static constexpr uint MaxTopLevelDepth = 60;
+
+    auto AffineTransform::FromMatrix(const glm::mat4 &Matrix) -> AffineTransform {
+        // glm is column major, Matrix[Column][Row]
+        AffineTransform Result{};
+        for (int Row = 0; Row < 3; Row++) {
+            Result.Rows[Row] = glm::vec4(Matrix[0][Row], Matrix[1][Row], Matrix[2][Row], Matrix[3][Row]);
+        }
+        return Result;
+    }
+
+    static auto TransformBounds(const AABB& Bounds, const glm::mat4& Matrix) -> AABB {
+        AABB Result;
+        for (uint Corner = 0; Corner < 8; Corner++) {
+            glm::vec4 Point((Corner & 1u) ? Bounds.Max.x : Bounds.Min.x, (Corner & 2u) ? Bounds.Max.y : Bounds.Min.y,
+                            (Corner & 4u) ? Bounds.Max.z : Bounds.Min.z, 1.f);
+            Result.Extend(glm::vec3(Matrix * Point));
+        }
+        return Result;
+    }
+
+    auto TLAS::AddBLAS(const BVH *BLAS) -> uint {
+        Check(BLAS);
+        m_blases.push_back(BLAS);
+        return static_cast<uint>(m_blases.size() - 1);
+    }
+
+    auto TLAS::AddInstance(uint BLASIndex, const glm::mat4 &ObjectToWorld) -> uint {
+        Check(BLASIndex < m_blases.size());
+        m_instances.push_back({AffineTransform::FromMatrix(glm::inverse(ObjectToWorld)), BLASIndex});
+        return static_cast<uint>(m_instances.size() - 1);
+    }
+
+    void TLAS::Clear() {
+        m_blases.clear();
+        m_instances.clear();
+        m_nodes.clear();
+        m_instanceIndices.clear();
+    }
+
+    auto TLAS::GetObjectToWorld(uint Instance) const -> glm::mat4 {
+        const AffineTransform& WorldToObject = m_instances[Instance].WorldToObject;
+        glm::mat4 Matrix = glm::transpose(glm::mat4(WorldToObject.Rows[0], WorldToObject.Rows[1],
+                                                    WorldToObject.Rows[2], glm::vec4(0.f, 0.f, 0.f, 1.f)));
+        return glm::inverse(Matrix);
+    }
+
+    void TLAS::Build(uint MaxLeafSize, uint NumBins) {
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        const auto NumInstances = static_cast<uint>(m_instances.size());
+        std::vector<BuildPrimitive> Primitives(NumInstances);
+        ThreadPool::Get().ParallelFor(NumInstances, [&](uint Begin, uint End) {
+            for (uint i = Begin; i < End; i++) {
+                Primitives[i].Bounds = TransformBounds(m_blases[m_instances[i].BLASIndex]->GetBounds(),
+                                                       GetObjectToWorld(i));
+                Primitives[i].Center = Primitives[i].Bounds.GetCenter();
+            }
+        }, 1024);
+
+        m_nodes.clear();
+        m_nodes.reserve(2 * static_cast<size_t>(NumInstances));
+        m_instanceIndices.resize(NumInstances);
+        for (uint i = 0; i < NumInstances; i++) {
+            m_instanceIndices[i] = i;
+        }
+        m_nodes.push_back({glm::vec3(0.f), 0, glm::vec3(0.f), 0});
+        if (NumInstances > 0) {
+            BuildNode(0, 0, NumInstances, Primitives, std::max(MaxLeafSize, 1u), std::max(NumBins, 2u));
+        }
+
+        m_buildTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+    }
+
+    void TLAS::BuildNode(uint NodeIndex, uint Begin, uint End, std::vector<BuildPrimitive> &Primitives,
+                         uint MaxLeafSize, uint NumBins) {
+        struct Task {
+            uint NodeIndex, Begin, End, Depth;
+        };
+        // Explicit stack, a million instances can get deeper than comfortable for recursion
+        std::vector<Task> Tasks = {{NodeIndex, Begin, End, 0}};
+        struct Bin {
+            AABB Bounds;
+            uint Count = 0;
+        };
+        std::vector<Bin> Bins(NumBins);
+        std::vector<AABB> RightBounds(NumBins);
+
+        while (!Tasks.empty()) {
+            Task Current = Tasks.back();
+            Tasks.pop_back();
+
+            AABB Bounds, CentroidBounds;
+            for (uint i = Current.Begin; i < Current.End; i++) {
+                Bounds.Extend(Primitives[m_instanceIndices[i]].Bounds);
+                CentroidBounds.Extend(Primitives[m_instanceIndices[i]].Center);
+            }
+            m_nodes[Current.NodeIndex].Min = Bounds.Min;
+            m_nodes[Current.NodeIndex].Max = Bounds.Max;
+
+            const uint Count = Current.End - Current.Begin;
+            if (Count <= MaxLeafSize || Current.Depth >= MaxTopLevelDepth) {
+                m_nodes[Current.NodeIndex].LeftOrFirst = Current.Begin;
+                m_nodes[Current.NodeIndex].Count = Count;
+                continue;
+            }
+
+            // Binned SAH over the instance centroids
+            float BestCost = std::numeric_limits<float>::infinity();
+            int BestAxis = -1;
+            float BestPosition = 0.f;
+            for (int Axis = 0; Axis < 3; Axis++) {
+                float Extent = CentroidBounds.Max[Axis] - CentroidBounds.Min[Axis];
+                if (Extent <= 0.f) {
+                    continue;
+                }
+                float Scale = static_cast<float>(NumBins) / Extent;
+                std::fill(Bins.begin(), Bins.end(), Bin());
+                for (uint i = Current.Begin; i < Current.End; i++) {
+                    const BuildPrimitive& Primitive = Primitives[m_instanceIndices[i]];
+                    uint Index = std::min(static_cast<uint>((Primitive.Center[Axis] - CentroidBounds.Min[Axis]) *
+                                                            Scale), NumBins - 1);
+                    Bins[Index].Bounds.Extend(Primitive.Bounds);
+                    Bins[Index].Count++;
+                }
+                AABB Accumulated;
+                for (uint i = NumBins - 1; i > 0; i--) {
+                    Accumulated.Extend(Bins[i].Bounds);
+                    RightBounds[i] = Accumulated;
+                }
+                AABB Left;
+                uint NumLeft = 0;
+                for (uint i = 0; i < NumBins - 1; i++) {
+                    Left.Extend(Bins[i].Bounds);
+                    NumLeft += Bins[i].Count;
+                    uint NumRight = Count - NumLeft;
+                    if (NumLeft == 0 || NumRight == 0) {
+                        continue;
+                    }
+                    float Cost = Left.GetSurfaceArea() * static_cast<float>(NumLeft) +
+                                 RightBounds[i + 1].GetSurfaceArea() * static_cast<float>(NumRight);
+                    if (Cost < BestCost) {
+                        BestCost = Cost;
+                        BestAxis = Axis;
+                        BestPosition = CentroidBounds.Min[Axis] + static_cast<float>(i + 1) / Scale;
+                    }
+                }
+            }
+
+            uint Middle = Current.Begin;
+            if (BestAxis >= 0) {
+                auto First = m_instanceIndices.begin() + Current.Begin, Last = m_instanceIndices.begin() + Current.End;
+                Middle = static_cast<uint>(std::partition(First, Last, [&](uint Instance) {
+                    return Primitives[Instance].Center[BestAxis] < BestPosition;
+                }) - m_instanceIndices.begin());
+            }
+            if (Middle == Current.Begin || Middle == Current.End) {
+                // Coincident centroids, split the range in half
+                Middle = Current.Begin + Count / 2;
+            }
+
+            auto LeftIndex = static_cast<uint>(m_nodes.size());
+            m_nodes.push_back({});
+            m_nodes.push_back({});
+            m_nodes[Current.NodeIndex].LeftOrFirst = LeftIndex;
+            m_nodes[Current.NodeIndex].Count = 0;
+            Tasks.push_back({LeftIndex + 1, Middle, Current.End, Current.Depth + 1});
+            Tasks.push_back({LeftIndex, Current.Begin, Middle, Current.Depth + 1});
+        }
+    }
+
+    auto TLAS::Intersect(const Ray &InRay, RayHit &Hit, BVHTraversalStats* Stats) const -> bool {
+        if (m_instances.empty()) {
+            return false;
+        }
+        const glm::vec3 InvDirection = 1.f / InRay.Direction;
+        auto IntersectBounds = [&](const BVHNode& Node, float TMax) {
+            glm::vec3 T0 = (Node.Min - InRay.Origin) * InvDirection;
+            glm::vec3 T1 = (Node.Max - InRay.Origin) * InvDirection;
+            glm::vec3 TNear = glm::min(T0, T1), TFar = glm::max(T0, T1);
+            float TEnter = std::max(std::max(TNear.x, TNear.y), std::max(TNear.z, InRay.TMin));
+            float TExit = std::min(std::min(TFar.x, TFar.y), std::min(TFar.z, TMax));
+            return TEnter <= TExit ? TEnter : std::numeric_limits<float>::infinity();
+        };
+
+        bool Found = false;
+        uint Stack[TopLevelStackSize];
+        uint StackSize = 0;
+        uint NodeIndex = 0;
+        if (IntersectBounds(m_nodes[0], std::min(InRay.TMax, Hit.T)) == std::numeric_limits<float>::infinity()) {
+            return false;
+        }
+
+        while (true) {
+            const BVHNode& Node = m_nodes[NodeIndex];
+            if (Stats) {
+                Stats->NodeVisits++;
+            }
+            if (Node.IsLeaf()) {
+                for (uint i = 0; i < Node.Count; i++) {
+                    uint InstanceIndex = m_instanceIndices[Node.LeftOrFirst + i];
+                    const BVHInstance& Instance = m_instances[InstanceIndex];
+                    // Unnormalized object space direction keeps the hit distance in world units
+                    Ray ObjectRay;
+                    ObjectRay.Origin = Instance.WorldToObject.TransformPoint(InRay.Origin);
+                    ObjectRay.Direction = Instance.WorldToObject.TransformVector(InRay.Direction);
+                    ObjectRay.TMin = InRay.TMin;
+                    ObjectRay.TMax = std::min(InRay.TMax, Hit.T);
+                    if (m_blases[Instance.BLASIndex]->Intersect(ObjectRay, Hit, Stats)) {
+                        Hit.InstanceID = InstanceIndex;
+                        Found = true;
+                    }
+                }
+            } else {
+                float ClosestT = std::min(InRay.TMax, Hit.T);
+                uint Near = Node.LeftOrFirst, Far = Node.LeftOrFirst + 1;
+                float TNear = IntersectBounds(m_nodes[Near], ClosestT);
+                float TFar = IntersectBounds(m_nodes[Far], ClosestT);
+                if (TFar < TNear) {
+                    std::swap(Near, Far);
+                    std::swap(TNear, TFar);
+                }
+                if (TNear != std::numeric_limits<float>::infinity()) {
+                    if (TFar != std::numeric_limits<float>::infinity()) {
+                        Check(StackSize < TopLevelStackSize);
+                        Stack[StackSize++] = Far;
+                    }
+                    NodeIndex = Near;
+                    continue;
+                }
+            }
+            if (StackSize == 0) {
+                break;
+            }
+            NodeIndex = Stack[--StackSize];
+        }
+        return Found;
+    }
+
+    auto TLAS::GetMemoryBytes() const -> size_t {
+        return m_nodes.size() * sizeof(BVHNode) + m_instances.size() * sizeof(BVHInstance) +
+               m_instanceIndices.size() * sizeof(uint);
+    }
+
+    auto TLAS::GetBLASMemoryBytes() const -> size_t {
+        size_t Bytes = 0;
+        for (const BVH* BLAS: m_blases) {
+            Bytes += BLAS->GetStats().MemoryBytes;
+        }
+        return Bytes;
+    }
+
+    void TLAS::BenchmarkInstancing(uint NumInstances, uint NumRays) {
+        // A UV sphere stands in for a tree, instanced over a square forest floor
+        constexpr uint Rings = 24, Segments = 48;
+        constexpr float Pi = 3.14159265f;
+        std::vector<glm::vec3> Positions;
+        std::vector<uint> Indices;
+        for (uint Ring = 0; Ring <= Rings; Ring++) {
+            float Theta = Pi * static_cast<float>(Ring) / Rings;
+            for (uint Segment = 0; Segment <= Segments; Segment++) {
+                float Phi = 2.f * Pi * static_cast<float>(Segment) / Segments;
+                Positions.emplace_back(std::sin(Theta) * std::cos(Phi), std::cos(Theta) + 1.f,
+                                       std::sin(Theta) * std::sin(Phi));
+            }
+        }
+        for (uint Ring = 0; Ring < Rings; Ring++) {
+            for (uint Segment = 0; Segment < Segments; Segment++) {
+                uint I0 = Ring * (Segments + 1) + Segment, I1 = I0 + Segments + 1;
+                Indices.insert(Indices.end(), {I0, I1, I0 + 1, I0 + 1, I1, I1 + 1});
+            }
+        }
+
+        BVH Mesh;
+        Mesh.Build(Positions, Indices);
+
+        TLAS Scene;
+        uint MeshIndex = Scene.AddBLAS(&Mesh);
+        const auto Side = static_cast<uint>(std::ceil(std::sqrt(static_cast<float>(NumInstances))));
+        const float Spacing = 4.f;
+        PCGRandom Random(1);
+        for (uint i = 0; i < NumInstances; i++) {
+            glm::vec3 Position(static_cast<float>(i % Side) * Spacing + Random.NextFloat(), 0.f,
+                               static_cast<float>(i / Side) * Spacing + Random.NextFloat());
+            float Scale = .5f + Random.NextFloat();
+            glm::mat4 Transform = glm::translate(glm::mat4(1.f), Position);
+            Transform = glm::rotate(Transform, 2.f * Pi * Random.NextFloat(), glm::vec3(0.f, 1.f, 0.f));
+            Transform = glm::scale(Transform, glm::vec3(Scale, Scale * (1.f + Random.NextFloat()), Scale));
+            Scene.AddInstance(MeshIndex, Transform);
+        }
+        Scene.Build();
+
+        // Oblique rays from above the forest
+        const float Extent = static_cast<float>(Side) * Spacing;
+        std::vector<Ray> Rays(NumRays);
+        for (auto& TestRay: Rays) {
+            TestRay.Origin = glm::vec3(Random.NextFloat() * Extent, 20.f, Random.NextFloat() * Extent);
+            TestRay.Direction = glm::normalize(glm::vec3(Random.NextFloat() - .5f, -1.f, Random.NextFloat() - .5f));
+        }
+        std::vector<uint8_t> Hits(NumRays, 0);
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        ThreadPool::Get().ParallelFor(NumRays, [&](uint Begin, uint End) {
+            for (uint i = Begin; i < End; i++) {
+                RayHit Hit;
+                Hits[i] = Scene.Intersect(Rays[i], Hit) ? 1 : 0;
+            }
+        }, 256);
+        double TraceMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+        uint NumHits = 0;
+        for (uint8_t Hit: Hits) {
+            NumHits += Hit;
+        }
+
+        const size_t MeshBytes = Mesh.GetStats().MemoryBytes;
+        const size_t FlattenedBytes = static_cast<size_t>(NumInstances) *
+                                      (MeshBytes + Positions.size() * sizeof(glm::vec3) + Indices.size() * sizeof(uint));
+        std::cout << "TLAS " << NumInstances << " instances of " << Indices.size() / 3 << " triangles\n"
+                  << "  BLAS " << Scene.GetBLASMemoryBytes() / 1024 << " KB, TLAS "
+                  << Scene.GetMemoryBytes() / (1024 * 1024) << " MB (" << sizeof(BVHInstance)
+                  << " bytes per instance), flattened geometry would be " << FlattenedBytes / (1024 * 1024)
+                  << " MB\n"
+                  << "  Build " << Scene.GetBuildTimeMs() << " ms, " << NumRays << " rays in " << TraceMs
+                  << " ms, " << NumHits << " hits\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
@@ -0,0 +1,89 @@
+//
+// Created by HUSTLX on 2024/10/25.
+//
+
+#ifndef HARDWAREPATHTRACER_TLAS_H
+#define HARDWAREPATHTRACER_TLAS_H
+
+#include "core/Core.h"
+#include "core/accel/BVH.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Row major 3x4 affine transform, a quarter less memory than a mat4 per instance
+    struct AffineTransform {
+        glm::vec4 Rows[3];
+
+        static auto FromMatrix(const glm::mat4& Matrix) -> AffineTransform;
+
+        [[nodiscard]] auto TransformPoint(const glm::vec3& Point) const -> glm::vec3 {
+            glm::vec4 P(Point, 1.f);
+            return {glm::dot(Rows[0], P), glm::dot(Rows[1], P), glm::dot(Rows[2], P)};
+        }
+
+        [[nodiscard]] auto TransformVector(const glm::vec3& Vector) const -> glm::vec3 {
+            glm::vec4 V(Vector, 0.f);
+            return {glm::dot(Rows[0], V), glm::dot(Rows[1], V), glm::dot(Rows[2], V)};
+        }
+    };
+
+    // Only what traversal needs, the object to world matrix can be rebuilt from the inverse on a hit
+    struct BVHInstance {
+        AffineTransform WorldToObject;
+        uint BLASIndex;
+    };
+
+    // Two-level acceleration structure, a top-level BVH over instance bounds whose leaves transform the
+    // ray into object space and continue in a shared bottom-level BVH. BLASes are not owned
+    class TLAS {
+    public:
+        auto AddBLAS(const BVH* BLAS) -> uint;
+
+        auto AddInstance(uint BLASIndex, const glm::mat4& ObjectToWorld) -> uint;
+
+        void Clear();
+
+        void Build(uint MaxLeafSize = 2, uint NumBins = 16);
+
+        // Closest hit, Hit.InstanceID is the index returned by AddInstance and Hit.T is in world space
+        auto Intersect(const Ray& InRay, RayHit& Hit, BVHTraversalStats* Stats = nullptr) const -> bool;
+
+        [[nodiscard]] auto GetObjectToWorld(uint Instance) const -> glm::mat4;
+
+        [[nodiscard]] auto GetNumInstances() const -> uint {
+            return static_cast<uint>(m_instances.size());
+        }
+
+        [[nodiscard]] auto GetBuildTimeMs() const -> double {
+            return m_buildTimeMs;
+        }
+
+        // Top-level nodes, instances and instance indices, the BLAS memory is counted once per BLAS
+        [[nodiscard]] auto GetMemoryBytes() const -> size_t;
+
+        [[nodiscard]] auto GetBLASMemoryBytes() const -> size_t;
+
+        // Scatters NumInstances copies of one mesh, reports memory against flattened geometry and
+        // the trace throughput
+        static void BenchmarkInstancing(uint NumInstances = 1000000, uint NumRays = 1u << 16);
+
+    private:
+        struct BuildPrimitive {
+            AABB Bounds;
+            glm::vec3 Center;
+        };
+
+        void BuildNode(uint NodeIndex, uint Begin, uint End, std::vector<BuildPrimitive>& Primitives,
+                       uint MaxLeafSize, uint NumBins);
+
+        std::vector<const BVH*> m_blases;
+        std::vector<BVHInstance> m_instances;
+
+        std::vector<BVHNode> m_nodes;
+        std::vector<uint> m_instanceIndices;
+        double m_buildTimeMs = 0.;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_TLAS_H
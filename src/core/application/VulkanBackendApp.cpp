@@ -4,11 +4,25 @@
 
 #include "VulkanBackendApp.h"
 #include <unordered_set>
+#include <cstring>
 #include <algorithm>
 #include <core/shader/ShaderBase.h>
 #include <core/buffer/VertexBuffer.h>
 #include "core/RHI.h"
+#include "core/ThreadPool.h"
+#include "core/sampling/EnvironmentMap.h"
+#include "core/compute/GPUVolume.h"
+#include "core/pathtracer/VolumeTracking.h"
+#include "core/pathtracer/GuidedPathTracer.h"
+#include "core/pathtracer/ReSTIRDI.h"
+#include "core/compute/GPUBVH.h"
+#include "core/accel/TLAS.h"
+#include "core/accel/BVH.h"
+#include "core/compute/GPURadixSort.h"
+#include "core/pathtracer/RaySorter.h"
+#include "core/sampling/SobolSequence.h"
 #include <random>
+#include <limits>
 
 
 namespace HWPT {
@@ -27,11 +41,15 @@ namespace HWPT {
         while (!glfwWindowShouldClose(m_window)) {
             m_fpsCalculator->Tick();
 
+            // Latency of a frame is measured from here, where its input is polled
+            m_frameStartTime = std::chrono::high_resolution_clock::now();
             glfwPollEvents();
-            DrawFrame();
-
             BeginImGui();
             DrawImGuiFrame();
+            ImGui::Render();
+
+            // Records the ImGui draw data into the frame's command buffer
+            DrawFrame();
             EndImGui();
 
             Present();
@@ -41,6 +59,55 @@ namespace HWPT {
         CleanUp();
     }
 
+    void VulkanBackendApp::RunBenchmarks(const std::vector<std::string> &Names) {
+        Check(m_contextInited);
+
+        const std::vector<std::pair<std::string, std::function<void()>>> Benchmarks = {
+                {"EnvironmentMap", []() { EnvironmentMap::BenchmarkBuild(); }},
+                {"Sobol", []() { SobolSequence::BenchmarkConvergence(); }},
+                {"SamplerGPU", [this]() { SobolSequence::CompareGPU(*m_sobolSequence, *m_blueNoise); }},
+                {"RaySorter", []() { RaySorter::BenchmarkBounces(); }},
+                {"GPURadixSort", []() { GPURadixSort::Benchmark(); }},
+                {"BVH", []() { BVH::BenchmarkSpatialSplits(); }},
+                {"TLAS", []() { TLAS::BenchmarkInstancing(); }},
+                {"GPUBVH", [this]() {
+                    std::vector<glm::vec3> Positions;
+                    for (const auto& ModelVertex: m_vikingRoom->GetVertices()) {
+                        Positions.push_back(ModelVertex.Pos);
+                    }
+                    GPUBVH::Benchmark(Positions, m_vikingRoom->GetIndices());
+                }},
+                {"ReSTIRDI", []() { ReSTIRDI::CompareEqualTime(); }},
+                {"ReSTIRDIGPU", []() { ReSTIRDI::CompareGPU(); }},
+                {"PathGuiding", []() { GuidedPathTracer::ReportEqualTime(); }},
+                {"VolumeMajorants", []() { VolumeTracker::ReportMajorants(); }},
+                {"GPUVolume", []() { GPUVolume::Benchmark(); }},
+                {"BRDFLUT", []() { BRDFLUT::ReportStartup(); }},
+                {"DeviceMemoryAllocator", []() { DeviceMemoryAllocator::Benchmark(); }},
+                {"UploadManager", []() { UploadManager::Benchmark(); }},
+        };
+        for (const std::string& Name: Names) {
+            bool Found = false;
+            for (const auto& [BenchmarkName, Benchmark]: Benchmarks) {
+                if (Name == "all" || Name == BenchmarkName) {
+                    std::cout << "== " << BenchmarkName << "\n";
+                    Benchmark();
+                    Found = true;
+                }
+            }
+            if (!Found) {
+                std::cerr << "Unknown benchmark " << Name << ", expected one of:";
+                for (const auto& [BenchmarkName, Benchmark]: Benchmarks) {
+                    std::cerr << " " << BenchmarkName;
+                }
+                std::cerr << "\n";
+            }
+        }
+        vkDeviceWaitIdle(m_device);
+
+        CleanUp();
+    }
+
     void VulkanBackendApp::DrawImGuiFrame() {
         // TODO: Viewport
 //        {
@@ -56,21 +123,135 @@ namespace HWPT {
 //        }
         {
             ImGui::Begin("Settings");
-
+            ImGui::SliderInt("Frames in flight", &m_framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+            if (m_pacingSweepWindow < 0 && ImGui::Button("Measure frame pacing")) {
+                m_pacingSweepWindow = 0;
+                m_pacingSweepRestore = m_framesInFlight;
+                m_framesInFlight = 1;
+                m_pacingResults.clear();
+                m_pacingWindow = {};
+            }
+            if (ImGui::Button("Benchmark command recording")) {
+                m_runRecordingBenchmark = true;
+            }
             ImGui::End();
         }
         {
             ImGui::Begin("Statistics");
             ImGui::Text("FPS: %d", m_fpsCalculator->GetFPS());
+            const RenderGraphStats& GraphStats = m_renderGraph->GetStats();
+            ImGui::Text("Render graph: %u passes, %u culled", GraphStats.NumPasses, GraphStats.NumCulledPasses);
+            ImGui::Text("Barriers: %u image, %u buffer in %u batches", GraphStats.NumImageBarriers,
+                        GraphStats.NumBufferBarriers, GraphStats.NumBarrierBatches);
+            ImGui::Text("Transients: %u, %.1f MB aliased into %.1f MB", GraphStats.NumTransients,
+                        static_cast<float>(GraphStats.TransientBytes) / (1024.f * 1024.f),
+                        static_cast<float>(GraphStats.AllocatedBytes) / (1024.f * 1024.f));
+            const BarrierBatcherStats& BatcherStats = m_barrierBatcher->GetStats();
+            ImGui::Text("Layout transitions: %llu requested, %llu skipped, %llu barriers in %llu flushes",
+                        static_cast<unsigned long long>(BatcherStats.NumRequested),
+                        static_cast<unsigned long long>(BatcherStats.NumSkipped),
+                        static_cast<unsigned long long>(BatcherStats.NumBarriers),
+                        static_cast<unsigned long long>(BatcherStats.NumFlushes));
+            const FrameLinearAllocatorStats& FrameStats = m_frameAllocator->GetStats();
+            ImGui::Text("Frame constants: %u allocations, %.1f KB (peak %.1f KB)", FrameStats.NumAllocations,
+                        static_cast<float>(FrameStats.UsedBytes) / 1024.f,
+                        static_cast<float>(FrameStats.PeakBytes) / 1024.f);
+            BindlessHeapStats HeapStats = m_bindlessHeap->GetStats();
+            for (uint Type = 0; Type < static_cast<uint>(BindlessType::Count); Type++) {
+                ImGui::Text("Bindless %s: %u / %u (%u retired)", GetBindlessTypeName(static_cast<BindlessType>(Type)),
+                            HeapStats.Live[Type], HeapStats.Capacity[Type], HeapStats.Retired[Type]);
+            }
+            DescriptorCacheStats CacheStats = m_descriptorCache->GetStats();
+            ImGui::Text("Descriptor cache: %u layouts (%u hits), %u sets (%u hits), %u pools",
+                        CacheStats.NumLayouts, CacheStats.LayoutHits, CacheStats.NumSets, CacheStats.SetHits,
+                        m_descriptorCache->GetAllocatorStats().NumPools);
+            PipelineCacheStats PSOStats = m_pipelineCache->GetStats();
+            ImGui::Text("Startup: %.1f ms, %s pipeline cache (%.1f KB loaded in %.2f ms)", m_startupMilliseconds,
+                        PSOStats.WarmStart ? "warm" : "cold", static_cast<float>(PSOStats.LoadedBytes) / 1024.f,
+                        PSOStats.LoadMilliseconds);
+            ImGui::Text("BRDF LUT: %.2f ms, %s", m_brdfLUT->GetSetupMs(),
+                        m_brdfLUT->IsLoadedFromCache() ? "loaded from cache" : "integrated");
+            ImGui::Text("Blue noise tile: %.2f ms", m_blueNoise->GetBuildTimeMs());
+            ImGui::Text("Pipelines: %u compiled (%u queued to workers) in %.1f ms CPU, %u hits",
+                        PSOStats.NumPipelines, PSOStats.NumAsyncRequests, PSOStats.CompileMilliseconds, PSOStats.Hits);
+            const FrameCommandPoolStats& GraphicsPoolStats = m_commandPool.GraphicsPool->GetStats();
+            const FrameCommandPoolStats& IntermediatePoolStats = m_commandPool.IntermediatePool->GetStats();
+            ImGui::Text("Command buffers: %u graphics allocated (%u pool resets), %u intermediate allocated",
+                        GraphicsPoolStats.NumAllocated, GraphicsPoolStats.NumResets,
+                        IntermediatePoolStats.NumAllocated);
+            const ParallelRecordStats& RecordStats = m_commandRecorder->GetStats();
+            ImGui::Text("Forward recording: %u draws in %u secondary buffers, %.3f ms", RecordStats.NumItems,
+                        RecordStats.NumRanges, RecordStats.RecordMilliseconds);
+            for (const auto& [NumThreads, Milliseconds]: m_recordingBenchmark) {
+                ImGui::Text("  Benchmark, %u threads: %.3f ms", NumThreads, Milliseconds);
+            }
+            ImGui::Text("Frames in flight: %d, frame %.2f ms, latency %.2f ms, waited %.2f ms", m_framesInFlight,
+                        m_pacing.FrameMilliseconds, m_pacing.LatencyMilliseconds, m_pacing.WaitMilliseconds);
+            for (const FramePacingResult& Result: m_pacingResults) {
+                ImGui::Text("  %d in flight: frame %.2f ms, latency %.2f ms, waited %.2f ms", Result.FramesInFlight,
+                            Result.FrameMilliseconds, Result.LatencyMilliseconds, Result.WaitMilliseconds);
+            }
             ImGui::End();
         }
+        DrawMemoryPanel();
+    }
+
+    void VulkanBackendApp::DrawMemoryPanel() {
+        constexpr float MB = 1024.f * 1024.f;
+        ImGui::Begin("Memory");
+        ImGui::Text("Budget source: %s", m_memoryBudget->HasBudgetExtension() ? "VK_EXT_memory_budget" :
+                                         "heap size estimate");
+        const auto& Heaps = m_memoryBudget->GetHeaps();
+        for (uint Heap = 0; Heap < Heaps.size(); Heap++) {
+            const HeapBudget& Current = Heaps[Heap];
+            ImGui::Text("Heap %u (%s) %.0f MB, pressure %s", Heap,
+                        Current.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ? "device local" : "host",
+                        static_cast<float>(Current.Size) / MB, GetMemoryPressureName(Current.Pressure));
+            char Overlay[64];
+            snprintf(Overlay, sizeof(Overlay), "%.1f / %.1f MB", static_cast<float>(Current.Usage) / MB,
+                     static_cast<float>(Current.Budget) / MB);
+            float Fraction = Current.Budget > 0 ?
+                             static_cast<float>(Current.Usage) / static_cast<float>(Current.Budget) : 0.f;
+            ImGui::ProgressBar(std::min(Fraction, 1.f), ImVec2(-1.f, 0.f), Overlay);
+            ImGui::Text("Allocator: %.1f MB", static_cast<float>(Current.AllocatorBytes) / MB);
+        }
+        ImGui::Separator();
+        DeviceMemoryStats Stats = m_memoryAllocator->GetStats();
+        if (ImGui::BeginTable("Categories", 3)) {
+            ImGui::TableSetupColumn("Category");
+            ImGui::TableSetupColumn("Allocations");
+            ImGui::TableSetupColumn("MB");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(GetMemoryCategoryName(static_cast<MemoryCategory>(i)));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", Stats.CategoryAllocations[i]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", static_cast<float>(Stats.CategoryBytes[i]) / MB);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::Text("Blocks: %u (%.1f MB), dedicated: %u (%.1f MB)", Stats.NumBlocks,
+                    static_cast<float>(Stats.BlockBytes) / MB, Stats.NumDedicated,
+                    static_cast<float>(Stats.DedicatedBytes) / MB);
+        ImGui::End();
     }
 
     void VulkanBackendApp::Init() {
         Check(s_application == nullptr);
         s_application = this;
         InitWindow();
+        auto StartTime = std::chrono::high_resolution_clock::now();
         InitVulkan();
+        m_startupMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+        PipelineCacheStats CacheStats = m_pipelineCache->GetStats();
+        std::cout << "Vulkan init took " << m_startupMilliseconds << " ms with a "
+                  << (CacheStats.WarmStart ? "warm" : "cold") << " pipeline cache, " << CacheStats.NumPipelines
+                  << " pipelines compiled on " << ThreadPool::Get().GetNumThreads() << " threads in "
+                  << CacheStats.CompileMilliseconds << " ms CPU\n";
         InitImGui();
         m_contextInited = true;
 
@@ -94,18 +275,34 @@ namespace HWPT {
         CreateSurface();
         SelectPhysicalDevice();
         CreateLogicalDevice();
+        m_memoryAllocator = new DeviceMemoryAllocator(m_device, m_physicalDevice);
+        m_memoryBudget = new MemoryBudget(m_physicalDevice, m_memoryAllocator,
+                                          IsDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+        // Empty blocks the allocator keeps for reuse are the cheapest memory to give back
+        m_memoryBudget->AddPressureCallback([this](uint Heap, MemoryPressure Pressure, const HeapBudget&) {
+            if (Pressure == MemoryPressure::None) {
+                return;
+            }
+            VkDeviceSize Released = m_memoryAllocator->ReleaseEmptyBlocks(Heap);
+            std::cerr << GetMemoryPressureName(Pressure) << " memory pressure on heap " << Heap << ", released "
+                      << Released / (1024 * 1024) << " MB of empty blocks\n";
+        });
+        CreateUploadManager();
+        m_barrierBatcher = new BarrierBatcher();
+        m_bindlessHeap = new BindlessHeap(m_device, m_physicalDevice, MAX_FRAMES_IN_FLIGHT);
+        m_pipelineCache = new PipelineCache(m_device, m_physicalDevice, "PipelineCache.bin");
         CreateSwapChain();
 
         CreateRenderPass();
-        CreateMSAABuffers();
-        CreateFrameBuffers();
+        m_renderGraph = new RenderGraph(m_device);
 
         CreateCommandPool();
-        CreateCommandBuffers();
+        m_commandRecorder = new ParallelCommandRecorder(
+                m_device, FindQueueFamilies(m_physicalDevice).GraphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
 
-        CreateDescriptorPool();
+        CreateDescriptorCache();
 
-        CreateUniformBuffers();
+        CreateFrameAllocator();
         CreateModelAndSampler();
 
         CreateGraphicsDescriptorSetLayout();
@@ -117,10 +314,26 @@ namespace HWPT {
         CreateComputeDescriptorSetLayout();
         CreateComputePipeline();
         CreateComputeDescriptorSets();
+        WaitForPipelines();
 
         CreateSyncObjects();
     }
 
+    void VulkanBackendApp::CreateUploadManager() {
+        QueueFamilyIndices Indices = FindQueueFamilies(m_physicalDevice);
+        UploadQueues Queues;
+        Queues.ConsumerQueue = m_queue.GraphicsQueue;
+        Queues.ConsumerFamily = Indices.GraphicsFamily.value();
+        if (Indices.TransferFamily.has_value()) {
+            Queues.UploadQueue = m_queue.TransferQueue;
+            Queues.UploadFamily = Indices.TransferFamily.value();
+        } else {
+            Queues.UploadQueue = Queues.ConsumerQueue;
+            Queues.UploadFamily = Queues.ConsumerFamily;
+        }
+        m_uploadManager = new UploadManager(m_device, Queues);
+    }
+
     void VulkanBackendApp::FrameBufferResizeCallback(GLFWwindow *Window, int Width, int Height) {
         auto App =
                 reinterpret_cast<VulkanBackendApp *>(glfwGetWindowUserPointer(Window));
@@ -128,10 +341,13 @@ namespace HWPT {
     }
 
     void VulkanBackendApp::CleanUp() {
-        delete m_msaaBuffers;
+        delete m_renderGraph;
         delete m_vikingRoom;
+        delete m_brdfLUT;
+        delete m_sobolSequence;
+        delete m_blueNoise;
+        delete m_frameAllocator;
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            delete m_MVPUniformBuffers[i];
             delete m_particleStorageBuffers[i];
         }
         delete m_sampler;
@@ -142,23 +358,26 @@ namespace HWPT {
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
             vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
-            vkDestroyFence(m_device, m_graphicsInFlightFences[i], nullptr);
-            vkDestroyFence(m_device, m_computeInFlightFences[i], nullptr);
-            vkDestroySemaphore(m_device, m_computeFinishedSemaphores[i], nullptr);
         }
+        vkDestroySemaphore(m_device, m_frameTimeline, nullptr);
+        vkDestroySemaphore(m_device, m_computeTimeline, nullptr);
 
-        vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
-        vkDestroyDescriptorSetLayout(m_device, m_graphicsDescriptorSetLayout, nullptr);
+        delete m_descriptorCache;
         vkDestroyPipelineLayout(m_device, m_graphicsPipelineLayout, nullptr);
-        vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
-        vkDestroyPipeline(m_device, m_particleGraphicsPipeline, nullptr);
-        vkDestroyDescriptorSetLayout(m_device, m_computeDescriptorSetLayout, nullptr);
         vkDestroyPipelineLayout(m_device, m_computePipelineLayout, nullptr);
-        vkDestroyPipeline(m_device, m_computePipeline, nullptr);
-        vkDestroyCommandPool(m_device, m_commandPool.GraphicsPool, nullptr);
-        vkDestroyCommandPool(m_device, m_commandPool.ComputePool, nullptr);
+        delete m_commandRecorder;
+        delete m_commandPool.GraphicsPool;
+        delete m_commandPool.ComputePool;
+        delete m_commandPool.IntermediatePool;
         vkDestroyRenderPass(m_device, m_renderPass, nullptr);
         vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        m_pipelineCache->Save();
+        delete m_pipelineCache;
+        delete m_uploadManager;
+        delete m_barrierBatcher;
+        delete m_bindlessHeap;
+        delete m_memoryBudget;
+        delete m_memoryAllocator;
         vkDestroyDevice(m_device, nullptr);
         vkDestroyInstance(m_instance, nullptr);
 
@@ -167,36 +386,64 @@ namespace HWPT {
     }
 
     void VulkanBackendApp::DrawFrame() {
-        vkWaitForFences(m_device, 1, &m_computeInFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
-        vkResetFences(m_device, 1, &m_computeInFlightFences[m_currentFrame]);
+        // Uploads become visible on the graphics queue, a separate compute queue waits for them on the GPU
+        m_uploadManager->Flush();
+        m_memoryBudget->Update();
+
+        // Waits until the frame that last used this frame's resources is done
+        BeginFramePacing();
+        m_frameAllocator->BeginFrame(m_currentFrame);
+        m_bindlessHeap->BeginFrame();
+        m_commandPool.ComputePool->BeginFrame(m_currentFrame);
+        m_commandPool.GraphicsPool->BeginFrame(m_currentFrame);
+        m_commandRecorder->BeginFrame(m_currentFrame);
+        if (m_runRecordingBenchmark) {
+            RunRecordingBenchmark();
+            m_runRecordingBenchmark = false;
+        }
+        UpdateFrameConstants();
 
-        auto ComputeCommandBuffer = m_computeCommandBuffers[m_currentFrame];
-        vkResetCommandBuffer(ComputeCommandBuffer, 0);
+        VkCommandBuffer ComputeCommandBuffer = m_commandPool.ComputePool->Acquire();
 
         VkCommandBufferBeginInfo ComputeBeginInfo{};
         ComputeBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        ComputeBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         VK_CHECK(vkBeginCommandBuffer(ComputeCommandBuffer, &ComputeBeginInfo));
         vkCmdBindPipeline(ComputeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
         vkCmdBindDescriptorSets(ComputeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
                                 m_computePipelineLayout, 0, 1,
-                                &m_computeDescriptorSets[m_currentFrame], 0, nullptr);
+                                &m_computeDescriptorSets[m_currentFrame], 1, &m_frameConstantsOffset);
+        m_bindlessHeap->Bind(ComputeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout);
         vkCmdDispatch(ComputeCommandBuffer, (s_particleCount + 255) / 256, 1, 1);
+        // The dispatch reads the previous frame's particles and writes this frame's, which are drawn later
+        m_particleStorageBuffers[(m_currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT]->MarkFrameUse(
+                m_frameNumber);
+        m_particleStorageBuffers[m_currentFrame]->MarkFrameUse(m_frameNumber);
         VK_CHECK(vkEndCommandBuffer(ComputeCommandBuffer));
 
         VkSubmitInfo ComputeSubmitInfo{};
         ComputeSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         ComputeSubmitInfo.waitSemaphoreCount = 0;
+        VkSemaphore UploadTimeline = m_uploadManager->GetTimelineSemaphore();
+        VkPipelineStageFlags UploadWaitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        uint64_t UploadWaitValue = m_uploadManager->GetSubmittedValue();
+        VkTimelineSemaphoreSubmitInfo ComputeTimelineInfo{};
+        ComputeTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        ComputeTimelineInfo.signalSemaphoreValueCount = 1;
+        ComputeTimelineInfo.pSignalSemaphoreValues = &m_frameNumber;
+        ComputeSubmitInfo.pNext = &ComputeTimelineInfo;
+        if (m_queue.ComputeQueue != m_queue.GraphicsQueue && UploadWaitValue > 0) {
+            ComputeTimelineInfo.waitSemaphoreValueCount = 1;
+            ComputeTimelineInfo.pWaitSemaphoreValues = &UploadWaitValue;
+            ComputeSubmitInfo.waitSemaphoreCount = 1;
+            ComputeSubmitInfo.pWaitSemaphores = &UploadTimeline;
+            ComputeSubmitInfo.pWaitDstStageMask = &UploadWaitStage;
+        }
         ComputeSubmitInfo.commandBufferCount = 1;
         ComputeSubmitInfo.pCommandBuffers = &ComputeCommandBuffer;
         ComputeSubmitInfo.signalSemaphoreCount = 1;
-        ComputeSubmitInfo.pSignalSemaphores = &m_computeFinishedSemaphores[m_currentFrame];
-        VK_CHECK(vkQueueSubmit(m_queue.ComputeQueue, 1, &ComputeSubmitInfo,
-                               m_computeInFlightFences[m_currentFrame]));
-
-
-        vkWaitForFences(m_device, 1, &m_graphicsInFlightFences[m_currentFrame], VK_TRUE,
-                        UINT64_MAX);
-        vkResetFences(m_device, 1, &m_graphicsInFlightFences[m_currentFrame]);
+        ComputeSubmitInfo.pSignalSemaphores = &m_computeTimeline;
+        VK_CHECK(vkQueueSubmit(m_queue.ComputeQueue, 1, &ComputeSubmitInfo, VK_NULL_HANDLE));
 
         if (m_frameBufferResized) {
             OnWindowResize();
@@ -212,30 +459,130 @@ namespace HWPT {
             throw std::runtime_error("Failed to acquire swap chain images");
         }
 
-        auto GraphicsCommandBuffer = m_graphicsCommandBuffers[m_currentFrame];
-        vkResetCommandBuffer(GraphicsCommandBuffer, 0);
+        VkCommandBuffer GraphicsCommandBuffer = m_commandPool.GraphicsPool->Acquire();
 
         RecordCommandBuffer(GraphicsCommandBuffer, m_imageIndex);
 
         VkSubmitInfo GraphicsSubmitInfo{};
         GraphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        // The particles written by this frame's dispatch are read as vertices, the swap chain image is written
+        // at color attachment output. The binary semaphores of the swap chain carry no value
         std::array<VkSemaphore, 2> GraphicsWaitSemaphores = {
-                m_computeFinishedSemaphores[m_currentFrame],
+                m_computeTimeline,
                 m_imageAvailableSemaphores[m_currentFrame]
         };
-        GraphicsSubmitInfo.waitSemaphoreCount = GraphicsWaitSemaphores.size();
-        GraphicsSubmitInfo.pWaitSemaphores = GraphicsWaitSemaphores.data();
+        std::array<uint64_t, 2> GraphicsWaitValues = {m_frameNumber, 0};
         std::array<VkPipelineStageFlags, 2> WaitStages = {
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
         };
+        std::array<VkSemaphore, 2> GraphicsSignalSemaphores = {
+                m_renderFinishedSemaphores[m_currentFrame],
+                m_frameTimeline
+        };
+        std::array<uint64_t, 2> GraphicsSignalValues = {0, m_frameNumber};
+        VkTimelineSemaphoreSubmitInfo GraphicsTimelineInfo{};
+        GraphicsTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        GraphicsTimelineInfo.waitSemaphoreValueCount = GraphicsWaitValues.size();
+        GraphicsTimelineInfo.pWaitSemaphoreValues = GraphicsWaitValues.data();
+        GraphicsTimelineInfo.signalSemaphoreValueCount = GraphicsSignalValues.size();
+        GraphicsTimelineInfo.pSignalSemaphoreValues = GraphicsSignalValues.data();
+        GraphicsSubmitInfo.pNext = &GraphicsTimelineInfo;
+        GraphicsSubmitInfo.waitSemaphoreCount = GraphicsWaitSemaphores.size();
+        GraphicsSubmitInfo.pWaitSemaphores = GraphicsWaitSemaphores.data();
         GraphicsSubmitInfo.pWaitDstStageMask = WaitStages.data();
         GraphicsSubmitInfo.commandBufferCount = 1;
         GraphicsSubmitInfo.pCommandBuffers = &GraphicsCommandBuffer;
-        GraphicsSubmitInfo.signalSemaphoreCount = 1;
-        GraphicsSubmitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[m_currentFrame];
-        VK_CHECK(vkQueueSubmit(m_queue.GraphicsQueue, 1, &GraphicsSubmitInfo,
-                               m_graphicsInFlightFences[m_currentFrame]));
+        GraphicsSubmitInfo.signalSemaphoreCount = GraphicsSignalSemaphores.size();
+        GraphicsSubmitInfo.pSignalSemaphores = GraphicsSignalSemaphores.data();
+        VK_CHECK(vkQueueSubmit(m_queue.GraphicsQueue, 1, &GraphicsSubmitInfo, VK_NULL_HANDLE));
+        m_submittedFrameNumber = m_frameNumber;
+    }
+
+    void VulkanBackendApp::WaitForSubmittedFrames() {
+        WaitForFrame(m_submittedFrameNumber);
+    }
+
+    void VulkanBackendApp::WaitForFrame(uint64_t FrameNumber) {
+        FrameNumber = std::min(FrameNumber, m_submittedFrameNumber);
+        if (FrameNumber == 0) {
+            return;
+        }
+        // A frame's graphics work waits for its dispatch, so its frame timeline value covers both queues
+        VkSemaphoreWaitInfo WaitInfo{};
+        WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        WaitInfo.semaphoreCount = 1;
+        WaitInfo.pSemaphores = &m_frameTimeline;
+        WaitInfo.pValues = &FrameNumber;
+        VK_CHECK(vkWaitSemaphores(m_device, &WaitInfo, UINT64_MAX));
+    }
+
+    void VulkanBackendApp::BeginFramePacing() {
+        using Clock = std::chrono::high_resolution_clock;
+        m_frameNumber++;
+        m_currentFrame = static_cast<uint>(m_frameNumber % MAX_FRAMES_IN_FLIGHT);
+
+        // Frame N signals N on the frame timeline once its graphics work is done, and that follows its dispatch.
+        // Waiting for N - m_framesInFlight leaves at most that many frames queued, and since m_framesInFlight
+        // never exceeds MAX_FRAMES_IN_FLIGHT this also covers the frame that last used m_currentFrame's resources
+        auto WaitStart = Clock::now();
+        if (m_frameNumber > static_cast<uint64_t>(m_framesInFlight)) {
+            uint64_t WaitValue = m_frameNumber - m_framesInFlight;
+            VkSemaphoreWaitInfo WaitInfo{};
+            WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            WaitInfo.semaphoreCount = 1;
+            WaitInfo.pSemaphores = &m_frameTimeline;
+            WaitInfo.pValues = &WaitValue;
+            VK_CHECK(vkWaitSemaphores(m_device, &WaitInfo, UINT64_MAX));
+        }
+        auto Now = Clock::now();
+
+        // Completion is only observed here, frames that finished while the CPU was busy count as finishing now.
+        // Every frame still pending is less than MAX_FRAMES_IN_FLIGHT old, so its start time is still in the ring
+        uint64_t Completed = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_device, m_frameTimeline, &Completed));
+        while (m_lastCompletedFrame < Completed) {
+            m_lastCompletedFrame++;
+            m_pacingWindow.LatencyMilliseconds += std::chrono::duration<double, std::milli>(
+                    Now - m_frameStartTimes[m_lastCompletedFrame % MAX_FRAMES_IN_FLIGHT]).count();
+            m_pacingWindow.NumLatencySamples++;
+        }
+        m_frameStartTimes[m_currentFrame] = m_frameStartTime;
+        m_pacingWindow.WaitMilliseconds += std::chrono::duration<double, std::milli>(Now - WaitStart).count();
+        if (m_frameNumber > 1) {
+            m_pacingWindow.FrameMilliseconds += std::chrono::duration<double, std::milli>(
+                    m_frameStartTime - m_previousFrameStartTime).count();
+            m_pacingWindow.NumFrames++;
+        }
+        m_previousFrameStartTime = m_frameStartTime;
+
+        constexpr uint WindowFrames = 120;
+        if (m_pacingWindow.NumFrames < WindowFrames) {
+            return;
+        }
+        m_pacing.FramesInFlight = m_framesInFlight;
+        m_pacing.FrameMilliseconds = m_pacingWindow.FrameMilliseconds / m_pacingWindow.NumFrames;
+        m_pacing.WaitMilliseconds = m_pacingWindow.WaitMilliseconds / m_pacingWindow.NumFrames;
+        m_pacing.LatencyMilliseconds = m_pacingWindow.NumLatencySamples > 0 ?
+                                       m_pacingWindow.LatencyMilliseconds / m_pacingWindow.NumLatencySamples : 0.;
+        m_pacingWindow = {};
+        if (m_pacingSweepWindow < 0) {
+            return;
+        }
+
+        // Every setting of the sweep gets a window to settle in and a measured one
+        if (m_pacingSweepWindow % 2 == 1) {
+            m_pacingResults.push_back(m_pacing);
+            std::cout << m_framesInFlight << " frames in flight: " << m_pacing.FrameMilliseconds << " ms per frame, "
+                      << m_pacing.LatencyMilliseconds << " ms latency\n";
+            if (m_framesInFlight == MAX_FRAMES_IN_FLIGHT) {
+                m_framesInFlight = m_pacingSweepRestore;
+                m_pacingSweepWindow = -1;
+                return;
+            }
+            m_framesInFlight++;
+        }
+        m_pacingSweepWindow++;
     }
 
     void VulkanBackendApp::CreateVkInstance() {
@@ -245,7 +592,7 @@ namespace HWPT {
         AppInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         AppInfo.pEngineName = "No Engine";
         AppInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        AppInfo.apiVersion = VK_API_VERSION_1_0;
+        AppInfo.apiVersion = VulkanApiVersion;
 
         VkInstanceCreateInfo CreateInfo{};
         CreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -314,20 +661,23 @@ namespace HWPT {
         vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &QueueFamilyCount,
                                                  QueueFamilies.data());
 
+        // The first family offering a role keeps it, later families must not take it over
         int Index = 0;
         for (const auto &QueueFamily: QueueFamilies) {
-            if (QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            if ((QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !Indices.GraphicsFamily.has_value()) {
                 Indices.GraphicsFamily = Index;
             }
             // TODO: Use Dedicated Compute Queue, !(QueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-            if (QueueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            if ((QueueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !Indices.ComputeFamily.has_value()) {
                 Indices.ComputeFamily = Index;
             }
 
-            VkBool32 PresentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(PhysicalDevice, Index, m_surface, &PresentSupport);
-            if (PresentSupport) {
-                Indices.PresentFamily = Index;
+            if (!Indices.PresentFamily.has_value()) {
+                VkBool32 PresentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(PhysicalDevice, Index, m_surface, &PresentSupport);
+                if (PresentSupport) {
+                    Indices.PresentFamily = Index;
+                }
             }
             if (Indices.IsComplete()) {
                 break;
@@ -335,6 +685,20 @@ namespace HWPT {
             ++Index;
         }
 
+        // Uploads prefer a transfer only family (the copy engine), then any other family without graphics
+        for (uint i = 0; i < QueueFamilyCount && !Indices.TransferFamily.has_value(); i++) {
+            VkQueueFlags Flags = QueueFamilies[i].queueFlags;
+            if ((Flags & VK_QUEUE_TRANSFER_BIT) && !(Flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                Indices.TransferFamily = i;
+            }
+        }
+        for (uint i = 0; i < QueueFamilyCount && !Indices.TransferFamily.has_value(); i++) {
+            VkQueueFlags Flags = QueueFamilies[i].queueFlags;
+            if ((Flags & VK_QUEUE_TRANSFER_BIT) && !(Flags & VK_QUEUE_GRAPHICS_BIT)) {
+                Indices.TransferFamily = i;
+            }
+        }
+
         return Indices;
     }
 
@@ -354,6 +718,15 @@ namespace HWPT {
         return RequiredExtensionsCopy.empty();
     }
 
+    auto VulkanBackendApp::IsDeviceExtensionEnabled(const char *Extension) const -> bool {
+        for (const char* Enabled: m_enabledDeviceExtensions) {
+            if (strcmp(Enabled, Extension) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     auto
     VulkanBackendApp::QuerySwapChainSupport(
             VkPhysicalDevice PhysicalDevice) -> SwapChainSupportDetails {
@@ -390,7 +763,27 @@ namespace HWPT {
         bool IsSwapChainSupport =
                 !SwapChainSupport.Formats.empty() && !SwapChainSupport.PresentModes.empty();
 
-        return Indices.IsComplete() && IsExtensionSupport && IsSwapChainSupport;
+        // The features CreateLogicalDevice enables have to be there, UploadManager and the frame pacing are
+        // built on timeline semaphores and BindlessHeap on descriptor indexing. BindlessHeap clamps its arrays
+        // to the limits of the device picked here
+        VkPhysicalDeviceProperties Properties;
+        vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+        VkPhysicalDeviceVulkan12Features Vulkan12Features{};
+        Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 Features{};
+        Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        Features.pNext = &Vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(PhysicalDevice, &Features);
+        bool IsFeatureSupport = Properties.apiVersion >= VulkanApiVersion && Vulkan12Features.timelineSemaphore &&
+                                Vulkan12Features.descriptorIndexing && Vulkan12Features.runtimeDescriptorArray &&
+                                Vulkan12Features.descriptorBindingPartiallyBound &&
+                                Vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+                                Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+                                Vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+                                Vulkan12Features.shaderSampledImageArrayNonUniformIndexing &&
+                                Vulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+
+        return Indices.IsComplete() && IsExtensionSupport && IsSwapChainSupport && IsFeatureSupport;
     }
 
     void VulkanBackendApp::CreateLogicalDevice() {
@@ -401,6 +794,9 @@ namespace HWPT {
                 Indices.ComputeFamily.value(),
                 Indices.PresentFamily.value()
         };
+        if (Indices.TransferFamily.has_value()) {
+            UniqueQueueFamilies.insert(Indices.TransferFamily.value());
+        }
         std::vector<VkDeviceQueueCreateInfo> QueueCreateInfos;
         QueueCreateInfos.reserve(QueueCreateInfos.size());
 
@@ -416,14 +812,27 @@ namespace HWPT {
 
         VkDeviceCreateInfo CreateInfo{};
         CreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        CreateInfo.queueCreateInfoCount = 1;
+        CreateInfo.queueCreateInfoCount = QueueCreateInfos.size();
         CreateInfo.pQueueCreateInfos = QueueCreateInfos.data();
         VkPhysicalDeviceFeatures DeviceFeatures{};
         DeviceFeatures.sampleRateShading = VK_TRUE;
         DeviceFeatures.geometryShader = VK_TRUE;
         CreateInfo.pEnabledFeatures = &DeviceFeatures;
-        CreateInfo.enabledExtensionCount = DeviceExtensions.size();
-        CreateInfo.ppEnabledExtensionNames = DeviceExtensions.data();
+        m_enabledDeviceExtensions = DeviceExtensions;
+        uint ExtensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &ExtensionCount, nullptr);
+        std::vector<VkExtensionProperties> AvailableExtensions(ExtensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &ExtensionCount, AvailableExtensions.data());
+        for (const char* Extension: OptionalDeviceExtensions) {
+            for (const auto& SupportExtension: AvailableExtensions) {
+                if (strcmp(SupportExtension.extensionName, Extension) == 0) {
+                    m_enabledDeviceExtensions.push_back(Extension);
+                    break;
+                }
+            }
+        }
+        CreateInfo.enabledExtensionCount = m_enabledDeviceExtensions.size();
+        CreateInfo.ppEnabledExtensionNames = m_enabledDeviceExtensions.data();
 
         if (m_enableValidationLayers) {
             CreateInfo.enabledLayerCount = ValidationLayers.size();
@@ -436,10 +845,27 @@ namespace HWPT {
         Sync2Feature.synchronization2 = VK_TRUE;
         CreateInfo.pNext = &Sync2Feature;
 
+        // Timeline semaphores, used by UploadManager, and the descriptor indexing BindlessHeap is built on
+        VkPhysicalDeviceVulkan12Features Vulkan12Features = {};
+        Vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        Vulkan12Features.timelineSemaphore = VK_TRUE;
+        Vulkan12Features.descriptorIndexing = VK_TRUE;
+        Vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        Vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        Vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        Vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        Vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        Vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        Sync2Feature.pNext = &Vulkan12Features;
+
         VK_CHECK(vkCreateDevice(m_physicalDevice, &CreateInfo, nullptr, &m_device));
         vkGetDeviceQueue(m_device, Indices.GraphicsFamily.value(), 0, &m_queue.GraphicsQueue);
         vkGetDeviceQueue(m_device, Indices.ComputeFamily.value(), 0, &m_queue.ComputeQueue);
         vkGetDeviceQueue(m_device, Indices.PresentFamily.value(), 0, &m_queue.PresentQueue);
+        if (Indices.TransferFamily.has_value()) {
+            vkGetDeviceQueue(m_device, Indices.TransferFamily.value(), 0, &m_queue.TransferQueue);
+        }
     }
 
     void VulkanBackendApp::CreateSwapChain() {
@@ -524,6 +950,7 @@ namespace HWPT {
         for (auto &FrameBuffer: m_swapChainFrameBuffers) {
             vkDestroyFramebuffer(m_device, FrameBuffer, nullptr);
         }
+        m_swapChainFrameBuffers.clear();
         for (auto &ImageView: m_swapChain.SwapChainImageViews) {
             vkDestroyImageView(m_device, ImageView, nullptr);
         }
@@ -538,7 +965,8 @@ namespace HWPT {
         MSAAColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         MSAAColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         MSAAColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        MSAAColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // The render graph transitions every attachment before the pass
+        MSAAColorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         MSAAColorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;  // For resolve MSAA buffer
 
         VkAttachmentDescription DepthAttachment{};
@@ -548,7 +976,7 @@ namespace HWPT {
         DepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         DepthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         DepthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        DepthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         DepthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentDescription ResolvedColorAttachment{};
@@ -558,7 +986,7 @@ namespace HWPT {
         ResolvedColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         ResolvedColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         ResolvedColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        ResolvedColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        ResolvedColorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         ResolvedColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference MSAAColorAttachmentRef{};
@@ -606,13 +1034,13 @@ namespace HWPT {
         VK_CHECK(vkCreateRenderPass(m_device, &CreateInfo, nullptr, &m_renderPass));
     }
 
-    void VulkanBackendApp::CreateFrameBuffers() {
+    void VulkanBackendApp::CreateFrameBuffers(VkImageView MSAAColorView, VkImageView MSAADepthView) {
         m_swapChainFrameBuffers.resize(m_swapChain.SwapChainImages.size());
 
         for (size_t Index = 0; Index < m_swapChainFrameBuffers.size(); Index++) {
             std::array<VkImageView, 3> Attachments = {
-                    m_msaaBuffers->MSAAColorBuffer->CreateSRV(),
-                    m_msaaBuffers->MSAADepthBuffer->CreateSRV(),
+                    MSAAColorView,
+                    MSAADepthView,
                     m_swapChain.SwapChainImageViews[Index]
             };
 
@@ -633,58 +1061,28 @@ namespace HWPT {
     void VulkanBackendApp::CreateCommandPool() {
         QueueFamilyIndices Indices = FindQueueFamilies(m_physicalDevice);
 
-        VkCommandPoolCreateInfo GraphicsPoolCreateInfo{};
-        GraphicsPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        GraphicsPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        GraphicsPoolCreateInfo.queueFamilyIndex = Indices.GraphicsFamily.value();
-
-        VK_CHECK(vkCreateCommandPool(m_device, &GraphicsPoolCreateInfo,
-                                     nullptr, &m_commandPool.GraphicsPool));
-
-        VkCommandPoolCreateInfo ComputePoolCreateInfo{};
-        ComputePoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        ComputePoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        ComputePoolCreateInfo.queueFamilyIndex = Indices.ComputeFamily.value();
-        VK_CHECK(vkCreateCommandPool(m_device, &ComputePoolCreateInfo,
-                                     nullptr, &m_commandPool.ComputePool));
-    }
-
-    void VulkanBackendApp::CreateCommandBuffers() {
-        m_graphicsCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        m_computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkCommandBufferAllocateInfo GraphicsAllocateInfo{};
-        GraphicsAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        GraphicsAllocateInfo.commandPool = m_commandPool.GraphicsPool;
-        GraphicsAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        GraphicsAllocateInfo.commandBufferCount = m_graphicsCommandBuffers.size();
-        VK_CHECK(vkAllocateCommandBuffers(m_device, &GraphicsAllocateInfo,
-                                          m_graphicsCommandBuffers.data()));
-
-        VkCommandBufferAllocateInfo ComputeAllocateInfo{};
-        ComputeAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        ComputeAllocateInfo.commandPool = m_commandPool.ComputePool;
-        ComputeAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        ComputeAllocateInfo.commandBufferCount = m_computeCommandBuffers.size();
-
-        VK_CHECK(vkAllocateCommandBuffers(m_device, &ComputeAllocateInfo,
-                                          m_computeCommandBuffers.data()));
+        // The frame's command buffers are handed out again after its pool is reset in DrawFrame
+        m_commandPool.GraphicsPool = new FrameCommandPool(m_device, Indices.GraphicsFamily.value(),
+                                                          MAX_FRAMES_IN_FLIGHT);
+        m_commandPool.ComputePool = new FrameCommandPool(m_device, Indices.ComputeFamily.value(),
+                                                         MAX_FRAMES_IN_FLIGHT);
+        m_commandPool.IntermediatePool = new FrameCommandPool(m_device, Indices.GraphicsFamily.value(), 1);
     }
 
     auto VulkanBackendApp::BeginIntermediateCommand() -> VkCommandBuffer {
-        VkCommandBufferAllocateInfo AllocateInfo{};
-        AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        AllocateInfo.commandPool = m_commandPool.GraphicsPool;
-        AllocateInfo.commandBufferCount = 1;
+        // Keeps pending uploads ahead of the command in queue order
+        if (m_uploadManager) {
+            m_uploadManager->Flush();
+        }
 
-        VkCommandBuffer CommandBuffer;
-        VK_CHECK(vkAllocateCommandBuffers(m_device, &AllocateInfo, &CommandBuffer));
+        VkCommandBuffer CommandBuffer = m_commandPool.IntermediatePool->Acquire();
+        m_commandPool.NumPendingIntermediateCommands++;
 
         VkCommandBufferBeginInfo BeginInfo{};
         BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
+        m_barrierBatcher->Flush(CommandBuffer);
 
         return CommandBuffer;
     }
@@ -700,191 +1098,160 @@ namespace HWPT {
         vkQueueSubmit(m_queue.GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(m_queue.GraphicsQueue);
 
-        vkFreeCommandBuffers(m_device, m_commandPool.GraphicsPool, 1, &CommandBuffer);
+        // Commands may nest, the pool can only be reset once none of its buffers is still being recorded
+        if (--m_commandPool.NumPendingIntermediateCommands == 0) {
+            m_commandPool.IntermediatePool->BeginFrame(0);
+        }
     }
 
     void VulkanBackendApp::CreateGraphicsDescriptorSetLayout() {
-        VkDescriptorSetLayoutBinding UBOLayoutBinding{};
-        UBOLayoutBinding.binding = 0;
-        UBOLayoutBinding.descriptorCount = 1;
-        UBOLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        UBOLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        UBOLayoutBinding.pImmutableSamplers = nullptr;
-
-        VkDescriptorSetLayoutBinding SamplerLayoutBinding{};
-        SamplerLayoutBinding.binding = 1;
-        SamplerLayoutBinding.descriptorCount = 1;
-        SamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        SamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        std::array<VkDescriptorSetLayoutBinding, 2> Bindings = {
-                UBOLayoutBinding, SamplerLayoutBinding
-        };
-
-        VkDescriptorSetLayoutCreateInfo LayoutInfo{};
-        LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        LayoutInfo.bindingCount = Bindings.size();
-        LayoutInfo.pBindings = Bindings.data();
-
-        VK_CHECK(vkCreateDescriptorSetLayout(m_device, &LayoutInfo, nullptr,
-                                             &m_graphicsDescriptorSetLayout));
+        m_graphicsDescriptorSetLayout = m_descriptorCache->GetLayout({
+                {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
+                 VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT},
+                {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT},
+                {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT}
+        });
     }
 
     void VulkanBackendApp::CreateGraphicsPipeline() {
-        ShaderBase VertexShader(ShaderType::Vertex, "../../shader/HLSL/Vert.spv");
-        ShaderBase FragmentShader(ShaderType::Fragment, "../../shader/HLSL/Frag.spv");
-
-        VkPipelineShaderStageCreateInfo VertShaderStageInfo{};
-        VertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        VertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        VertShaderStageInfo.module = VertexShader.GetHandle();
-        VertShaderStageInfo.pName = "VSMain";
-        VkPipelineShaderStageCreateInfo FragShaderStageInfo{};
-        FragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        FragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        FragShaderStageInfo.module = FragmentShader.GetHandle();
-        FragShaderStageInfo.pName = "PSMain";
-
-        std::array<VkPipelineShaderStageCreateInfo, 2> ShaderStages = {
-                VertShaderStageInfo, FragShaderStageInfo
-        };
-
-        VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
-        VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        auto bindingDescription = m_vikingRoom->GetVertexBufferLayout()->GetBindingDescription();
-        auto attributeDescription = m_vikingRoom->GetVertexBufferLayout()->GetAttributeDescriptions();
-        VertexInputInfo.vertexBindingDescriptionCount = 1;
-        VertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        VertexInputInfo.vertexAttributeDescriptionCount = attributeDescription.size();
-        VertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
-
-        VkPipelineInputAssemblyStateCreateInfo InputAssemble{};
-        InputAssemble.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        InputAssemble.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        InputAssemble.primitiveRestartEnable = VK_FALSE;
-
-        std::vector<VkDynamicState> DynamicStates = {
-                VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
-                VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT
-        };
-        VkPipelineDynamicStateCreateInfo DynamicState{};
-        DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        DynamicState.dynamicStateCount = DynamicStates.size();
-        DynamicState.pDynamicStates = DynamicStates.data();
-
-        VkPipelineViewportStateCreateInfo ViewportState{};
-        ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        ViewportState.viewportCount = 0;
-
-        VkPipelineRasterizationStateCreateInfo Rasterizer{};
-        Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        Rasterizer.depthClampEnable = VK_FALSE;
-        Rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        Rasterizer.lineWidth = 1.f;
-        Rasterizer.cullMode = VK_CULL_MODE_NONE;
-        Rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        Rasterizer.depthBiasEnable = VK_FALSE;
-        Rasterizer.depthBiasConstantFactor = 0.f;
-        Rasterizer.depthBiasClamp = 0.f;
-        Rasterizer.depthBiasSlopeFactor = 0.f;
-
-        VkPipelineMultisampleStateCreateInfo Multisampling{};
-        Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        Multisampling.sampleShadingEnable = VK_FALSE;
-        Multisampling.rasterizationSamples = GetVKSampleCount(m_msaaSamples);
-        Multisampling.minSampleShading = 1.f;
-        Multisampling.pSampleMask = nullptr;
-        Multisampling.alphaToCoverageEnable = VK_FALSE;
-        Multisampling.alphaToOneEnable = VK_FALSE;
-        Multisampling.sampleShadingEnable = VK_TRUE;
-        Multisampling.minSampleShading = .2f;
-
-        VkPipelineColorBlendAttachmentState ColorBlendAttachment{};
-        ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                                              VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        ColorBlendAttachment.blendEnable = VK_FALSE;
-        ColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-        ColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-        ColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-        ColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        ColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        ColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-        VkPipelineColorBlendStateCreateInfo ColorBlending{};
-        ColorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        ColorBlending.logicOpEnable = VK_FALSE;
-        ColorBlending.logicOp = VK_LOGIC_OP_COPY;
-        ColorBlending.attachmentCount = 1;
-        ColorBlending.pAttachments = &ColorBlendAttachment;
-
+        // Set 0 holds the pass bindings, set 1 the bindless heap
+        std::array<VkDescriptorSetLayout, 2> SetLayouts = {m_graphicsDescriptorSetLayout, m_bindlessHeap->GetLayout()};
         VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
         PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        PipelineLayoutInfo.setLayoutCount = 1;
-        PipelineLayoutInfo.pSetLayouts = &m_graphicsDescriptorSetLayout;
+        PipelineLayoutInfo.setLayoutCount = SetLayouts.size();
+        PipelineLayoutInfo.pSetLayouts = SetLayouts.data();
         PipelineLayoutInfo.pushConstantRangeCount = 0;
         PipelineLayoutInfo.pPushConstantRanges = nullptr;
 
         VK_CHECK(vkCreatePipelineLayout(m_device, &PipelineLayoutInfo, nullptr,
                                         &m_graphicsPipelineLayout));
 
-        // Depth-Stencil Test
-        VkPipelineDepthStencilStateCreateInfo DepthStencil{};
-        DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        DepthStencil.depthTestEnable = VK_TRUE;
-        DepthStencil.depthWriteEnable = VK_TRUE;
-        DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-        DepthStencil.depthBoundsTestEnable = VK_FALSE;
-//        DepthStencil.minDepthBounds = 0.f;
-//        DepthStencil.maxDepthBounds = 1.f;
-        DepthStencil.stencilTestEnable = VK_FALSE;
-        DepthStencil.front = {};
-        DepthStencil.back = {};
-
-        VkGraphicsPipelineCreateInfo PipelineInfo{};
-        PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        PipelineInfo.stageCount = ShaderStages.size();
-        PipelineInfo.pStages = ShaderStages.data();
-        PipelineInfo.pVertexInputState = &VertexInputInfo;
-        PipelineInfo.pInputAssemblyState = &InputAssemble;
-        PipelineInfo.pViewportState = &ViewportState;
-        PipelineInfo.pRasterizationState = &Rasterizer;
-        PipelineInfo.pMultisampleState = &Multisampling;
-        PipelineInfo.pDepthStencilState = &DepthStencil;
-        PipelineInfo.pColorBlendState = &ColorBlending;
-        PipelineInfo.pDynamicState = &DynamicState;
-        PipelineInfo.layout = m_graphicsPipelineLayout;
-        PipelineInfo.renderPass = m_renderPass;
-        PipelineInfo.subpass = 0;
-        PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        PipelineInfo.basePipelineIndex = -1;
-
-        VK_CHECK(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &PipelineInfo, nullptr,
-                                           &m_graphicsPipeline));
+        m_graphicsPipelineRequest = m_pipelineCache->CompileAsync([this]() {
+            ShaderBase VertexShader(ShaderType::Vertex, "../../shader/HLSL/Vert.spv");
+            ShaderBase FragmentShader(ShaderType::Fragment, "../../shader/HLSL/Frag.spv");
+
+            VkPipelineShaderStageCreateInfo VertShaderStageInfo{};
+            VertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            VertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            VertShaderStageInfo.module = VertexShader.GetHandle();
+            VertShaderStageInfo.pName = "VSMain";
+            VkPipelineShaderStageCreateInfo FragShaderStageInfo{};
+            FragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            FragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            FragShaderStageInfo.module = FragmentShader.GetHandle();
+            FragShaderStageInfo.pName = "PSMain";
+
+            std::array<VkPipelineShaderStageCreateInfo, 2> ShaderStages = {
+                    VertShaderStageInfo, FragShaderStageInfo
+            };
+
+            VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
+            VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            auto bindingDescription = m_vikingRoom->GetVertexBufferLayout()->GetBindingDescription();
+            auto attributeDescription = m_vikingRoom->GetVertexBufferLayout()->GetAttributeDescriptions();
+            VertexInputInfo.vertexBindingDescriptionCount = 1;
+            VertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+            VertexInputInfo.vertexAttributeDescriptionCount = attributeDescription.size();
+            VertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
+
+            VkPipelineInputAssemblyStateCreateInfo InputAssemble{};
+            InputAssemble.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            InputAssemble.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            InputAssemble.primitiveRestartEnable = VK_FALSE;
+
+            std::vector<VkDynamicState> DynamicStates = {
+                    VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
+                    VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT
+            };
+            VkPipelineDynamicStateCreateInfo DynamicState{};
+            DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            DynamicState.dynamicStateCount = DynamicStates.size();
+            DynamicState.pDynamicStates = DynamicStates.data();
+
+            VkPipelineViewportStateCreateInfo ViewportState{};
+            ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            ViewportState.viewportCount = 0;
+
+            VkPipelineRasterizationStateCreateInfo Rasterizer{};
+            Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            Rasterizer.depthClampEnable = VK_FALSE;
+            Rasterizer.rasterizerDiscardEnable = VK_FALSE;
+            Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+            Rasterizer.lineWidth = 1.f;
+            Rasterizer.cullMode = VK_CULL_MODE_NONE;
+            Rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            Rasterizer.depthBiasEnable = VK_FALSE;
+            Rasterizer.depthBiasConstantFactor = 0.f;
+            Rasterizer.depthBiasClamp = 0.f;
+            Rasterizer.depthBiasSlopeFactor = 0.f;
+
+            VkPipelineMultisampleStateCreateInfo Multisampling{};
+            Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            Multisampling.sampleShadingEnable = VK_FALSE;
+            Multisampling.rasterizationSamples = GetVKSampleCount(m_msaaSamples);
+            Multisampling.minSampleShading = 1.f;
+            Multisampling.pSampleMask = nullptr;
+            Multisampling.alphaToCoverageEnable = VK_FALSE;
+            Multisampling.alphaToOneEnable = VK_FALSE;
+            Multisampling.sampleShadingEnable = VK_TRUE;
+            Multisampling.minSampleShading = .2f;
+
+            VkPipelineColorBlendAttachmentState ColorBlendAttachment{};
+            ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                                  VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            ColorBlendAttachment.blendEnable = VK_FALSE;
+            ColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            ColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            ColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+            ColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            ColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            ColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+            VkPipelineColorBlendStateCreateInfo ColorBlending{};
+            ColorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            ColorBlending.logicOpEnable = VK_FALSE;
+            ColorBlending.logicOp = VK_LOGIC_OP_COPY;
+            ColorBlending.attachmentCount = 1;
+            ColorBlending.pAttachments = &ColorBlendAttachment;
+
+            // Depth-Stencil Test
+            VkPipelineDepthStencilStateCreateInfo DepthStencil{};
+            DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            DepthStencil.depthTestEnable = VK_TRUE;
+            DepthStencil.depthWriteEnable = VK_TRUE;
+            DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+            DepthStencil.depthBoundsTestEnable = VK_FALSE;
+//            DepthStencil.minDepthBounds = 0.f;
+//            DepthStencil.maxDepthBounds = 1.f;
+            DepthStencil.stencilTestEnable = VK_FALSE;
+            DepthStencil.front = {};
+            DepthStencil.back = {};
+
+            VkGraphicsPipelineCreateInfo PipelineInfo{};
+            PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            PipelineInfo.stageCount = ShaderStages.size();
+            PipelineInfo.pStages = ShaderStages.data();
+            PipelineInfo.pVertexInputState = &VertexInputInfo;
+            PipelineInfo.pInputAssemblyState = &InputAssemble;
+            PipelineInfo.pViewportState = &ViewportState;
+            PipelineInfo.pRasterizationState = &Rasterizer;
+            PipelineInfo.pMultisampleState = &Multisampling;
+            PipelineInfo.pDepthStencilState = &DepthStencil;
+            PipelineInfo.pColorBlendState = &ColorBlending;
+            PipelineInfo.pDynamicState = &DynamicState;
+            PipelineInfo.layout = m_graphicsPipelineLayout;
+            PipelineInfo.renderPass = m_renderPass;
+            PipelineInfo.subpass = 0;
+            PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+            PipelineInfo.basePipelineIndex = -1;
+
+            return m_pipelineCache->GetGraphicsPipeline(PipelineInfo, {VertexShader.GetCodeHash(),
+                                                                       FragmentShader.GetCodeHash()});
+        });
     }
 
     void VulkanBackendApp::CreateParticleGraphicsPipeline() {
-        ShaderBase VertexShader(ShaderType::Vertex, "../../shader/HLSL/ParticleVert.spv");
-        ShaderBase FragmentShader(ShaderType::Fragment, "../../shader/HLSL/ParticleFrag.spv");
-
-        VkPipelineShaderStageCreateInfo VertShaderStageInfo{};
-        VertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        VertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        VertShaderStageInfo.module = VertexShader.GetHandle();
-        VertShaderStageInfo.pName = "VSMain";
-        VkPipelineShaderStageCreateInfo FragShaderStageInfo{};
-        FragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        FragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        FragShaderStageInfo.module = FragmentShader.GetHandle();
-        FragShaderStageInfo.pName = "PSMain";
-
-        std::array<VkPipelineShaderStageCreateInfo, 2> ShaderStages = {
-                VertShaderStageInfo, FragShaderStageInfo
-        };
-
         // TODO: Use Particle Vertex Layout and Set Layout in VertexBuffer(Create VertexBufferLayout Class)
-        VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
-        VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         m_particleVertexBufferLayout = std::make_shared<VertexBufferLayout>(
                 std::initializer_list<VertexAttribute>(
                         {
@@ -892,157 +1259,170 @@ namespace HWPT {
                                 VertexAttribute(VertexAttributeDataType::Float3, "PlaceHolder"),
                                 VertexAttribute(VertexAttributeDataType::Float3, "Color")
                         }));
-        auto bindingDescription = m_particleVertexBufferLayout->GetBindingDescription();
-        auto attributeDescription = m_particleVertexBufferLayout->GetAttributeDescriptions();
-        VertexInputInfo.vertexBindingDescriptionCount = 1;
-        VertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        VertexInputInfo.vertexAttributeDescriptionCount = attributeDescription.size();
-        VertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
-
-        VkPipelineInputAssemblyStateCreateInfo InputAssemble{};
-        InputAssemble.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        InputAssemble.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
-        InputAssemble.primitiveRestartEnable = VK_FALSE;
-
-        std::vector<VkDynamicState> DynamicStates = {
-                VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
-                VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT
-        };
-        VkPipelineDynamicStateCreateInfo DynamicState{};
-        DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        DynamicState.dynamicStateCount = DynamicStates.size();
-        DynamicState.pDynamicStates = DynamicStates.data();
-
-        VkPipelineViewportStateCreateInfo ViewportState{};
-        ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        ViewportState.viewportCount = 0;
-
-        VkPipelineRasterizationStateCreateInfo Rasterizer{};
-        Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        Rasterizer.depthClampEnable = VK_FALSE;
-        Rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        Rasterizer.lineWidth = 1.f;
-        Rasterizer.cullMode = VK_CULL_MODE_NONE;
-        Rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        Rasterizer.depthBiasEnable = VK_FALSE;
-        Rasterizer.depthBiasConstantFactor = 0.f;
-        Rasterizer.depthBiasClamp = 0.f;
-        Rasterizer.depthBiasSlopeFactor = 0.f;
-
-        VkPipelineMultisampleStateCreateInfo Multisampling{};
-        Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        Multisampling.sampleShadingEnable = VK_FALSE;
-        Multisampling.rasterizationSamples = GetVKSampleCount(m_msaaSamples);
-        Multisampling.minSampleShading = 1.f;
-        Multisampling.pSampleMask = nullptr;
-        Multisampling.alphaToCoverageEnable = VK_FALSE;
-        Multisampling.alphaToOneEnable = VK_FALSE;
-        Multisampling.sampleShadingEnable = VK_TRUE;
-        Multisampling.minSampleShading = .2f;
-
-        VkPipelineColorBlendAttachmentState ColorBlendAttachment{};
-        ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                                              VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        ColorBlendAttachment.blendEnable = VK_FALSE;
-        ColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-        ColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-        ColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-        ColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        ColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        ColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-        VkPipelineColorBlendStateCreateInfo ColorBlending{};
-        ColorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        ColorBlending.logicOpEnable = VK_FALSE;
-        ColorBlending.logicOp = VK_LOGIC_OP_COPY;
-        ColorBlending.attachmentCount = 1;
-        ColorBlending.pAttachments = &ColorBlendAttachment;
-
-        // Depth-Stencil Test
-        VkPipelineDepthStencilStateCreateInfo DepthStencil{};
-        DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        DepthStencil.depthTestEnable = VK_TRUE;
-        DepthStencil.depthWriteEnable = VK_TRUE;
-        DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-        DepthStencil.depthBoundsTestEnable = VK_FALSE;
-//        DepthStencil.minDepthBounds = 0.f;
-//        DepthStencil.maxDepthBounds = 1.f;
-        DepthStencil.stencilTestEnable = VK_FALSE;
-        DepthStencil.front = {};
-        DepthStencil.back = {};
-
-        VkGraphicsPipelineCreateInfo PipelineInfo{};
-        PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        PipelineInfo.stageCount = ShaderStages.size();
-        PipelineInfo.pStages = ShaderStages.data();
-        PipelineInfo.pVertexInputState = &VertexInputInfo;
-        PipelineInfo.pInputAssemblyState = &InputAssemble;
-        PipelineInfo.pViewportState = &ViewportState;
-        PipelineInfo.pRasterizationState = &Rasterizer;
-        PipelineInfo.pMultisampleState = &Multisampling;
-        PipelineInfo.pDepthStencilState = &DepthStencil;
-        PipelineInfo.pColorBlendState = &ColorBlending;
-        PipelineInfo.pDynamicState = &DynamicState;
-        PipelineInfo.layout = m_graphicsPipelineLayout;
-        PipelineInfo.renderPass = m_renderPass;
-        PipelineInfo.subpass = 0;
-        PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        PipelineInfo.basePipelineIndex = -1;
-
-        VK_CHECK(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &PipelineInfo, nullptr,
-                                           &m_particleGraphicsPipeline));
+
+        m_particleGraphicsPipelineRequest = m_pipelineCache->CompileAsync([this]() {
+            ShaderBase VertexShader(ShaderType::Vertex, "../../shader/HLSL/ParticleVert.spv");
+            ShaderBase FragmentShader(ShaderType::Fragment, "../../shader/HLSL/ParticleFrag.spv");
+
+            VkPipelineShaderStageCreateInfo VertShaderStageInfo{};
+            VertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            VertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            VertShaderStageInfo.module = VertexShader.GetHandle();
+            VertShaderStageInfo.pName = "VSMain";
+            VkPipelineShaderStageCreateInfo FragShaderStageInfo{};
+            FragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            FragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            FragShaderStageInfo.module = FragmentShader.GetHandle();
+            FragShaderStageInfo.pName = "PSMain";
+
+            std::array<VkPipelineShaderStageCreateInfo, 2> ShaderStages = {
+                    VertShaderStageInfo, FragShaderStageInfo
+            };
+
+            VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
+            VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            auto bindingDescription = m_particleVertexBufferLayout->GetBindingDescription();
+            auto attributeDescription = m_particleVertexBufferLayout->GetAttributeDescriptions();
+            VertexInputInfo.vertexBindingDescriptionCount = 1;
+            VertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+            VertexInputInfo.vertexAttributeDescriptionCount = attributeDescription.size();
+            VertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
+
+            VkPipelineInputAssemblyStateCreateInfo InputAssemble{};
+            InputAssemble.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            InputAssemble.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            InputAssemble.primitiveRestartEnable = VK_FALSE;
+
+            std::vector<VkDynamicState> DynamicStates = {
+                    VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
+                    VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT
+            };
+            VkPipelineDynamicStateCreateInfo DynamicState{};
+            DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            DynamicState.dynamicStateCount = DynamicStates.size();
+            DynamicState.pDynamicStates = DynamicStates.data();
+
+            VkPipelineViewportStateCreateInfo ViewportState{};
+            ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            ViewportState.viewportCount = 0;
+
+            VkPipelineRasterizationStateCreateInfo Rasterizer{};
+            Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            Rasterizer.depthClampEnable = VK_FALSE;
+            Rasterizer.rasterizerDiscardEnable = VK_FALSE;
+            Rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+            Rasterizer.lineWidth = 1.f;
+            Rasterizer.cullMode = VK_CULL_MODE_NONE;
+            Rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+            Rasterizer.depthBiasEnable = VK_FALSE;
+            Rasterizer.depthBiasConstantFactor = 0.f;
+            Rasterizer.depthBiasClamp = 0.f;
+            Rasterizer.depthBiasSlopeFactor = 0.f;
+
+            VkPipelineMultisampleStateCreateInfo Multisampling{};
+            Multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            Multisampling.sampleShadingEnable = VK_FALSE;
+            Multisampling.rasterizationSamples = GetVKSampleCount(m_msaaSamples);
+            Multisampling.minSampleShading = 1.f;
+            Multisampling.pSampleMask = nullptr;
+            Multisampling.alphaToCoverageEnable = VK_FALSE;
+            Multisampling.alphaToOneEnable = VK_FALSE;
+            Multisampling.sampleShadingEnable = VK_TRUE;
+            Multisampling.minSampleShading = .2f;
+
+            VkPipelineColorBlendAttachmentState ColorBlendAttachment{};
+            ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                                  VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+            ColorBlendAttachment.blendEnable = VK_FALSE;
+            ColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            ColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            ColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+            ColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            ColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            ColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+            VkPipelineColorBlendStateCreateInfo ColorBlending{};
+            ColorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            ColorBlending.logicOpEnable = VK_FALSE;
+            ColorBlending.logicOp = VK_LOGIC_OP_COPY;
+            ColorBlending.attachmentCount = 1;
+            ColorBlending.pAttachments = &ColorBlendAttachment;
+
+            // Depth-Stencil Test
+            VkPipelineDepthStencilStateCreateInfo DepthStencil{};
+            DepthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            DepthStencil.depthTestEnable = VK_TRUE;
+            DepthStencil.depthWriteEnable = VK_TRUE;
+            DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+            DepthStencil.depthBoundsTestEnable = VK_FALSE;
+//            DepthStencil.minDepthBounds = 0.f;
+//            DepthStencil.maxDepthBounds = 1.f;
+            DepthStencil.stencilTestEnable = VK_FALSE;
+            DepthStencil.front = {};
+            DepthStencil.back = {};
+
+            VkGraphicsPipelineCreateInfo PipelineInfo{};
+            PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            PipelineInfo.stageCount = ShaderStages.size();
+            PipelineInfo.pStages = ShaderStages.data();
+            PipelineInfo.pVertexInputState = &VertexInputInfo;
+            PipelineInfo.pInputAssemblyState = &InputAssemble;
+            PipelineInfo.pViewportState = &ViewportState;
+            PipelineInfo.pRasterizationState = &Rasterizer;
+            PipelineInfo.pMultisampleState = &Multisampling;
+            PipelineInfo.pDepthStencilState = &DepthStencil;
+            PipelineInfo.pColorBlendState = &ColorBlending;
+            PipelineInfo.pDynamicState = &DynamicState;
+            PipelineInfo.layout = m_graphicsPipelineLayout;
+            PipelineInfo.renderPass = m_renderPass;
+            PipelineInfo.subpass = 0;
+            PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+            PipelineInfo.basePipelineIndex = -1;
+
+            return m_pipelineCache->GetGraphicsPipeline(PipelineInfo, {VertexShader.GetCodeHash(),
+                                                                       FragmentShader.GetCodeHash()});
+        });
     }
 
     void VulkanBackendApp::CreateComputeDescriptorSetLayout() {
-        std::array<VkDescriptorSetLayoutBinding, 3> LayoutBindings{};
-        LayoutBindings[0].binding = 0;
-        LayoutBindings[0].descriptorCount = 1;
-        LayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        LayoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        LayoutBindings[1].binding = 1;
-        LayoutBindings[1].descriptorCount = 1;
-        LayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        LayoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        LayoutBindings[2].binding = 2;
-        LayoutBindings[2].descriptorCount = 1;
-        LayoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        LayoutBindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        VkDescriptorSetLayoutCreateInfo LayoutInfo{};
-        LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        LayoutInfo.bindingCount = LayoutBindings.size();
-        LayoutInfo.pBindings = LayoutBindings.data();
-
-        VK_CHECK(vkCreateDescriptorSetLayout(m_device, &LayoutInfo, nullptr,
-                                             &m_computeDescriptorSetLayout));
+        m_computeDescriptorSetLayout = m_descriptorCache->GetLayout({
+                {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT},
+                {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT},
+                {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT}
+        });
     }
 
     void VulkanBackendApp::CreateComputePipeline() {
+        std::array<VkDescriptorSetLayout, 2> SetLayouts = {m_computeDescriptorSetLayout, m_bindlessHeap->GetLayout()};
         VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
         PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        PipelineLayoutInfo.setLayoutCount = 1;
-        PipelineLayoutInfo.pSetLayouts = &m_computeDescriptorSetLayout;
+        PipelineLayoutInfo.setLayoutCount = SetLayouts.size();
+        PipelineLayoutInfo.pSetLayouts = SetLayouts.data();
         VK_CHECK(vkCreatePipelineLayout(m_device, &PipelineLayoutInfo, nullptr,
                                         &m_computePipelineLayout));
 
-        ShaderBase ComputeShader(ShaderType::Compute, "../../shader/HLSL/UpdateParticle.spv");
+        m_computePipelineRequest = m_pipelineCache->CompileAsync([this]() {
+            ShaderBase ComputeShader(ShaderType::Compute, "../../shader/HLSL/UpdateParticle.spv");
+
+            VkPipelineShaderStageCreateInfo ComputeShaderStageInfo{};
+            ComputeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            ComputeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            ComputeShaderStageInfo.module = ComputeShader.GetHandle();
+            ComputeShaderStageInfo.pName = "UpdateParticles";
 
-        VkPipelineShaderStageCreateInfo ComputeShaderStageInfo{};
-        ComputeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        ComputeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-        ComputeShaderStageInfo.module = ComputeShader.GetHandle();
-        ComputeShaderStageInfo.pName = "UpdateParticles";
+            VkComputePipelineCreateInfo PipelineInfo{};
+            PipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            PipelineInfo.stage = ComputeShaderStageInfo;
+            PipelineInfo.layout = m_computePipelineLayout;
 
-        VkComputePipelineCreateInfo PipelineInfo{};
-        PipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-        PipelineInfo.stage = ComputeShaderStageInfo;
-        PipelineInfo.layout = m_computePipelineLayout;
+            return m_pipelineCache->GetComputePipeline(PipelineInfo, ComputeShader.GetCodeHash());
+        });
+    }
 
-        VK_CHECK(vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &PipelineInfo, nullptr,
-                                          &m_computePipeline));
+    void VulkanBackendApp::WaitForPipelines() {
+        m_graphicsPipeline = m_graphicsPipelineRequest.get();
+        m_particleGraphicsPipeline = m_particleGraphicsPipelineRequest.get();
+        m_computePipeline = m_computePipelineRequest.get();
     }
 
     struct MVPData {
@@ -1053,7 +1433,11 @@ namespace HWPT {
         float DeltaTime;
     };
 
-    void VulkanBackendApp::CreateUniformBuffers() {
+    void VulkanBackendApp::CreateFrameAllocator() {
+        m_frameAllocator = new FrameLinearAllocator(1 << 20, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void VulkanBackendApp::UpdateFrameConstants() {
         MVPData MVP{};
         MVP.ModelTrans = glm::identity<glm::mat4>();
         glm::vec3 CameraPos = glm::vec3(0.f, 0.f, 2.f);
@@ -1069,97 +1453,52 @@ namespace HWPT {
                                          1e-3f, 1000.f);
         MVP.DebugColor = glm::vec3(.5f, .9f, .6f);
         MVP.DeltaTime = m_fpsCalculator ? static_cast<float>(m_fpsCalculator->GetDeltaTime()) : 0.f;
-
-        m_MVPUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            m_MVPUniformBuffers[i] = new UniformBuffer(sizeof(MVPData), &MVP);
-        }
+        m_frameConstantsOffset = m_frameAllocator->Push(MVP);
     }
 
-    void VulkanBackendApp::CreateDescriptorPool() {
-        std::array<VkDescriptorPoolSize, 3> PoolSizes{};
-        PoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        PoolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
-        PoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        PoolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
-        PoolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        PoolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT * 2;
-
-        VkDescriptorPoolCreateInfo PoolInfo{};
-        PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        PoolInfo.poolSizeCount = PoolSizes.size();
-        PoolInfo.pPoolSizes = PoolSizes.data();
-        PoolInfo.maxSets = 4;
-        VK_CHECK(vkCreateDescriptorPool(m_device, &PoolInfo, nullptr, &m_descriptorPool));
+    void VulkanBackendApp::CreateDescriptorCache() {
+        m_descriptorCache = new DescriptorCache(m_device);
     }
 
     void VulkanBackendApp::CreateGraphicsDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> Layouts(MAX_FRAMES_IN_FLIGHT,
-                                                   m_graphicsDescriptorSetLayout);
-        VkDescriptorSetAllocateInfo AllocateInfo{};
-        AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        AllocateInfo.descriptorPool = m_descriptorPool;
-        AllocateInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
-        AllocateInfo.pSetLayouts = Layouts.data();
-
+        // Nothing in the set changes between frames, the cache hands every frame the same one
         m_graphicsDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        VK_CHECK(
-                vkAllocateDescriptorSets(m_device, &AllocateInfo, m_graphicsDescriptorSets.data()));
-
-        std::array<VkWriteDescriptorSet, 2> DescriptorWrites{};
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo BufferInfo{};
-            BufferInfo.buffer = m_MVPUniformBuffers[i]->GetHandle();
-            BufferInfo.offset = 0;
-            BufferInfo.range = VK_WHOLE_SIZE;
-            DescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            DescriptorWrites[0].dstSet = m_graphicsDescriptorSets[i];
-            DescriptorWrites[0].dstBinding = 0;
-            DescriptorWrites[0].dstArrayElement = 0;
-            DescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            DescriptorWrites[0].descriptorCount = 1;
-            DescriptorWrites[0].pBufferInfo = &BufferInfo;
-
-            VkDescriptorImageInfo ImageInfo{};
-            ImageInfo.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
-            ImageInfo.imageView = m_vikingRoom->GetTexture()->CreateSRV();
-            ImageInfo.sampler = m_sampler->GetHandle();
-            DescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            DescriptorWrites[1].dstSet = m_graphicsDescriptorSets[i];
-            DescriptorWrites[1].dstBinding = 1;
-            DescriptorWrites[1].dstArrayElement = 0;
-            DescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            DescriptorWrites[1].descriptorCount = 1;
-            DescriptorWrites[1].pImageInfo = &ImageInfo;
-
-            vkUpdateDescriptorSets(m_device, 2, DescriptorWrites.data(), 0, nullptr);
+            m_graphicsDescriptorSets[i] = m_descriptorCache->GetSet(m_graphicsDescriptorSetLayout, {
+                    DescriptorWrite::BufferWrite(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                                 m_frameAllocator->GetHandle(), 0, sizeof(MVPData)),
+                    DescriptorWrite::ImageWrite(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                m_vikingRoom->GetTexture()->CreateSRV(), m_sampler->GetHandle()),
+                    DescriptorWrite::ImageWrite(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                m_brdfLUT->GetSplitSumTexture()->CreateSRV(),
+                                                m_brdfLUT->GetSampler()->GetHandle())
+            });
         }
     }
 
     void VulkanBackendApp::CreateSyncObjects() {
+        // The swap chain only takes binary semaphores, everything else is paced by the timelines
         m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_graphicsInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_computeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             VkSemaphoreCreateInfo SemaphoreInfo{};
             SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-            VkFenceCreateInfo FenceInfo{};
-            FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-            FenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
             VK_CHECK(vkCreateSemaphore(m_device, &SemaphoreInfo, nullptr,
                                        &m_imageAvailableSemaphores[i]));
             VK_CHECK(vkCreateSemaphore(m_device, &SemaphoreInfo, nullptr,
                                        &m_renderFinishedSemaphores[i]));
-            VK_CHECK(vkCreateFence(m_device, &FenceInfo, nullptr, &m_graphicsInFlightFences[i]));
-            VK_CHECK(vkCreateFence(m_device, &FenceInfo, nullptr, &m_computeInFlightFences[i]));
-            VK_CHECK(vkCreateSemaphore(m_device, &SemaphoreInfo, nullptr,
-                                       &m_computeFinishedSemaphores[i]));
         }
+
+        VkSemaphoreTypeCreateInfo TypeCreateInfo{};
+        TypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        TypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        TypeCreateInfo.initialValue = 0;
+        VkSemaphoreCreateInfo TimelineInfo{};
+        TimelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        TimelineInfo.pNext = &TypeCreateInfo;
+        VK_CHECK(vkCreateSemaphore(m_device, &TimelineInfo, nullptr, &m_frameTimeline));
+        VK_CHECK(vkCreateSemaphore(m_device, &TimelineInfo, nullptr, &m_computeTimeline));
     }
 
     void VulkanBackendApp::RecordCommandBuffer(VkCommandBuffer CommandBuffer, uint ImageIndex) {
@@ -1167,7 +1506,62 @@ namespace HWPT {
         BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
         VK_CHECK(vkBeginCommandBuffer(CommandBuffer, &BeginInfo));
+        m_barrierBatcher->Flush(CommandBuffer);
+
+        m_renderGraph->Reset();
+        // Last used by the previous present, the acquire semaphore is waited at color attachment output
+        RGAccess BackBufferInitial{VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE,
+                                   VK_IMAGE_LAYOUT_UNDEFINED};
+        RGHandle BackBuffer = m_renderGraph->ImportTexture("BackBuffer", m_swapChain.SwapChainImages[ImageIndex],
+                                                           m_swapChain.SwapChainImageViews[ImageIndex],
+                                                           VK_IMAGE_ASPECT_COLOR_BIT, BackBufferInitial,
+                                                           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        m_renderGraph->MarkOutput(BackBuffer);
+
+        RGTextureDesc MSAAColorDesc;
+        MSAAColorDesc.Width = m_swapChain.Extent.width;
+        MSAAColorDesc.Height = m_swapChain.Extent.height;
+        MSAAColorDesc.Format = m_swapChain.Format;
+        MSAAColorDesc.Samples = GetVKSampleCount(m_msaaSamples);
+        MSAAColorDesc.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        RGHandle MSAAColor = m_renderGraph->CreateTexture("MSAAColor", MSAAColorDesc);
+        RGTextureDesc MSAADepthDesc = MSAAColorDesc;
+        MSAADepthDesc.Format = GetVKFormat(TextureFormat::Depth32);
+        MSAADepthDesc.Usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        MSAADepthDesc.Aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        RGHandle MSAADepth = m_renderGraph->CreateTexture("MSAADepth", MSAADepthDesc);
+
+        m_renderGraph->AddPass("Forward", [this, ImageIndex](VkCommandBuffer PassCommandBuffer) {
+                    RecordForwardPass(PassCommandBuffer, ImageIndex);
+                })
+                .Write(MSAAColor, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                .Write(MSAADepth,
+                       VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                       VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                       VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+                // Resolve target, the render pass leaves it ready to present
+                .Write(BackBuffer, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        m_renderGraph->Compile();
+
+        if (m_swapChainFrameBuffers.empty() || m_frameBufferGeneration != m_renderGraph->GetGeneration()) {
+            // A new generation means the graph waited for the device, the old frame buffers are unused
+            for (auto &FrameBuffer: m_swapChainFrameBuffers) {
+                vkDestroyFramebuffer(m_device, FrameBuffer, nullptr);
+            }
+            CreateFrameBuffers(m_renderGraph->GetImageView(MSAAColor), m_renderGraph->GetImageView(MSAADepth));
+            m_frameBufferGeneration = m_renderGraph->GetGeneration();
+        }
 
+        m_renderGraph->Execute(CommandBuffer);
+        RecordImGui(CommandBuffer, ImageIndex);
+
+        VK_CHECK(vkEndCommandBuffer(CommandBuffer));
+    }
+
+    void VulkanBackendApp::RecordForwardPass(VkCommandBuffer CommandBuffer, uint ImageIndex) {
         VkRenderPassBeginInfo RenderPassInfo{};
         RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         RenderPassInfo.renderPass = m_renderPass;
@@ -1180,29 +1574,51 @@ namespace HWPT {
         RenderPassInfo.clearValueCount = ClearValues.size();
         RenderPassInfo.pClearValues = ClearValues.data();
 
-        vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        // The draws are recorded into secondary command buffers on the workers
+        vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-        MVPData MVP{};
-        MVP.ModelTrans = glm::identity<glm::mat4>();
-        glm::vec3 CameraPos = glm::vec3(0.f, 0.f, 2.f);
-        MVP.ViewTrans = glm::lookAt(CameraPos, CameraPos + glm::vec3(0.f, 0.f, -1.f),
-                                    glm::vec3(0.f, 1.f, 0.f)) * mat4_cast(glm::quat(glm::vec3(
-                glm::radians(0.f),
-                glm::radians(0.f),
-                glm::radians(0.f)
-        )));
-        MVP.ProjTrans = glm::perspective(glm::radians(60.f),
-                                         static_cast<float>(m_windowWidth) /
-                                         static_cast<float>(m_windowHeight),
-                                         1e-3f, 1000.f);
-        MVP.DebugColor = glm::vec3(.5f, .9f, .6f);
-        MVP.DeltaTime = m_fpsCalculator ? static_cast<float>(m_fpsCalculator->GetDeltaTime()) : 0.f;
-        m_MVPUniformBuffers[ImageIndex]->Update(&MVP);
+        std::vector<ForwardDraw> Draws = BuildForwardDraws();
+        std::vector<float> Costs(Draws.size());
+        for (size_t i = 0; i < Draws.size(); i++) {
+            Costs[i] = Draws[i].Cost;
+        }
+        VkCommandBufferInheritanceInfo Inheritance{};
+        Inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        Inheritance.renderPass = m_renderPass;
+        Inheritance.subpass = 0;
+        Inheritance.framebuffer = m_swapChainFrameBuffers[ImageIndex];
+        std::vector<VkCommandBuffer> SecondaryCommandBuffers = m_commandRecorder->Record(
+                Inheritance, Costs, [&](VkCommandBuffer Secondary, uint Begin, uint End) {
+                    RecordForwardDraws(Secondary, Draws, Begin, End);
+                });
+        vkCmdExecuteCommands(CommandBuffer, static_cast<uint>(SecondaryCommandBuffers.size()),
+                             SecondaryCommandBuffers.data());
+
+        vkCmdEndRenderPass(CommandBuffer);
+    }
+
+    auto VulkanBackendApp::BuildForwardDraws() -> std::vector<ForwardDraw> {
+        std::vector<ForwardDraw> Draws;
+        // Model::DrawIndexed binds its vertex and index buffers before drawing
+        Draws.push_back({m_graphicsPipeline, [this](VkCommandBuffer CommandBuffer) {
+            m_vikingRoom->DrawIndexed(CommandBuffer);
+        }, 3.f});
+        Draws.push_back({m_particleGraphicsPipeline, [this](VkCommandBuffer CommandBuffer) {
+            VkDeviceSize Offsets = 0;
+            vkCmdBindVertexBuffers(CommandBuffer, 0, 1,
+                                   &(m_particleStorageBuffers[m_currentFrame]->GetHandle()), &Offsets);
+            vkCmdDraw(CommandBuffer, s_particleCount, 1, 0, 0);
+        }, 2.f});
+        return Draws;
+    }
 
+    void VulkanBackendApp::RecordForwardDraws(VkCommandBuffer CommandBuffer, const std::vector<ForwardDraw> &Draws,
+                                              uint Begin, uint End) {
+        // Secondary command buffers inherit no state, every range sets up its own
         vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 m_graphicsPipelineLayout,
-                                0, 1, m_graphicsDescriptorSets.data(), 0, nullptr);
+                                0, 1, m_graphicsDescriptorSets.data(), 1, &m_frameConstantsOffset);
+        m_bindlessHeap->Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipelineLayout);
 
         VkViewport Viewport{};
         Viewport.x = 0.f;
@@ -1217,18 +1633,41 @@ namespace HWPT {
         Scissor.extent = m_swapChain.Extent;
         vkCmdSetScissorWithCount(CommandBuffer, 1, &Scissor);
 
-        m_vikingRoom->DrawIndexed(CommandBuffer);
-
-        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          m_particleGraphicsPipeline);
-        VkDeviceSize Offsets = 0;
-        vkCmdBindVertexBuffers(CommandBuffer, 0, 1,
-                               &(m_particleStorageBuffers[m_currentFrame]->GetHandle()), &Offsets);
-        vkCmdDraw(CommandBuffer, s_particleCount, 1, 0, 0);
-
-        vkCmdEndRenderPass(CommandBuffer);
+        VkPipeline BoundPipeline = VK_NULL_HANDLE;
+        for (uint i = Begin; i < End; i++) {
+            if (Draws[i].Pipeline != BoundPipeline) {
+                vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Draws[i].Pipeline);
+                BoundPipeline = Draws[i].Pipeline;
+            }
+            Draws[i].Draw(CommandBuffer);
+        }
+    }
 
-        VK_CHECK(vkEndCommandBuffer(CommandBuffer));
+    void VulkanBackendApp::RunRecordingBenchmark() {
+        // Many copies of the model draw, recorded but never submitted. The buffers go back to the frame's
+        // pools with the next reset
+        constexpr uint NumDraws = 4096;
+        constexpr uint NumRepeats = 5;
+        std::vector<ForwardDraw> ModelDraws = BuildForwardDraws();
+        std::vector<ForwardDraw> Draws(NumDraws, ModelDraws[0]);
+        std::vector<float> Costs(NumDraws, Draws[0].Cost);
+        VkCommandBufferInheritanceInfo Inheritance{};
+        Inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        Inheritance.renderPass = m_renderPass;
+        Inheritance.subpass = 0;
+
+        m_recordingBenchmark.clear();
+        for (uint NumRanges = 1; NumRanges <= m_commandRecorder->GetMaxRanges(); NumRanges *= 2) {
+            double BestMs = std::numeric_limits<double>::max();
+            for (uint Repeat = 0; Repeat < NumRepeats; Repeat++) {
+                m_commandRecorder->Record(Inheritance, Costs, [&](VkCommandBuffer Secondary, uint Begin, uint End) {
+                    RecordForwardDraws(Secondary, Draws, Begin, End);
+                }, NumRanges);
+                BestMs = std::min(BestMs, m_commandRecorder->GetStats().RecordMilliseconds);
+            }
+            m_recordingBenchmark.emplace_back(NumRanges, BestMs);
+            std::cout << "Recording " << NumDraws << " draws on " << NumRanges << " threads: " << BestMs << " ms\n";
+        }
     }
 
     void VulkanBackendApp::RecreateSwapChain() {
@@ -1243,20 +1682,27 @@ namespace HWPT {
 
         CleanUpSwapChain();
         CreateSwapChain();
-        delete m_msaaBuffers;
-        CreateMSAABuffers();
-        CreateFrameBuffers();
+        // The MSAA targets follow the swap chain extent, the next frame recreates them and the frame buffers
+        m_renderGraph->ReleaseTransients();
     }
 
     void VulkanBackendApp::CreateModelAndSampler() {
         m_vikingRoom = new Model("../../asset/viking_room/viking_room.obj",
                                  "../../asset/viking_room/viking_room.png", true);
+        // Read from Cache/ when a previous run integrated the same settings
+        m_brdfLUT = new BRDFLUT();
+        m_brdfLUT->CreateGPUResources();
+        m_sobolSequence = new SobolSequence();
+        m_sobolSequence->CreateGPUResources();
+        m_blueNoise = new BlueNoise();
+        m_blueNoise->CreateGPUResources();
 
         m_sampler = new Sampler();
     }
 
     void VulkanBackendApp::InitImGui() {
-        m_imguiInfrastructure = new ImGuiInfrastructure(MAX_FRAMES_IN_FLIGHT);
+        // One frame buffer per swap chain image
+        m_imguiInfrastructure = new ImGuiInfrastructure(static_cast<uint>(m_swapChain.SwapChainImages.size()));
 
         // Setup Dear ImGui context
         IMGUI_CHECKVERSION();
@@ -1297,12 +1743,18 @@ namespace HWPT {
     }
 
     void VulkanBackendApp::EndImGui() {
-        auto CommandBuffer = BeginIntermediateCommand();
+        // For ImGui MultiView
+        ImGui::UpdatePlatformWindows();
+        ImGui::RenderPlatformWindowsDefault();
+        glfwMakeContextCurrent(m_window);
+    }
 
+    void VulkanBackendApp::RecordImGui(VkCommandBuffer CommandBuffer, uint ImageIndex) {
+        // Loads the resolved image the render graph left ready to present
         VkRenderPassBeginInfo RenderPassInfo{};
         RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         RenderPassInfo.renderPass = m_imguiInfrastructure->m_renderPass;
-        RenderPassInfo.framebuffer = m_imguiInfrastructure->m_frameBuffers[m_imageIndex];
+        RenderPassInfo.framebuffer = m_imguiInfrastructure->m_frameBuffers[ImageIndex];
         RenderPassInfo.renderArea.offset = {0, 0};
         RenderPassInfo.renderArea.extent = m_swapChain.Extent;
         VkClearValue ClearValue = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
@@ -1310,16 +1762,9 @@ namespace HWPT {
         RenderPassInfo.pClearValues = &ClearValue;
         vkCmdBeginRenderPass(CommandBuffer, &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), CommandBuffer);
 
         vkCmdEndRenderPass(CommandBuffer);
-        EndIntermediateCommand(CommandBuffer);
-
-        // For ImGui MultiView
-        ImGui::UpdatePlatformWindows();
-        ImGui::RenderPlatformWindowsDefault();
-        glfwMakeContextCurrent(m_window);
     }
 
     void VulkanBackendApp::CleanUpImGui() {
@@ -1344,8 +1789,6 @@ namespace HWPT {
         } else if (Result != VK_SUCCESS) {
             throw std::runtime_error("Failed to present swap chain images");
         }
-
-        m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
     void VulkanBackendApp::EnableWholeScreenDocking() {
@@ -1404,21 +1847,6 @@ namespace HWPT {
         m_imguiInfrastructure->RecreateFrameBuffer();
     }
 
-    void VulkanBackendApp::CreateMSAABuffers() {
-        m_msaaBuffers = new MSAABuffer();
-
-        m_msaaBuffers->MSAAColorBuffer = new Texture2D(m_swapChain.Extent.width,
-                                                       m_swapChain.Extent.height,
-                                                       TextureFormat::RGBA,
-                                                       TextureUsage::ColorAttachmentMSAA,
-                                                       GetVKSampleCount(m_msaaSamples));
-        m_msaaBuffers->MSAADepthBuffer = new Texture2D(m_swapChain.Extent.width,
-                                                       m_swapChain.Extent.height,
-                                                       TextureFormat::Depth32,
-                                                       TextureUsage::DepthStencilAttachmentMSAA,
-                                                       GetVKSampleCount(m_msaaSamples));
-    }
-
     void VulkanBackendApp::CreateParticleStorageBuffers() {
         m_particleStorageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
@@ -1451,57 +1879,17 @@ namespace HWPT {
     }
 
     void VulkanBackendApp::CreateComputeDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> Layouts(MAX_FRAMES_IN_FLIGHT,
-                                                   m_computeDescriptorSetLayout);
-        VkDescriptorSetAllocateInfo AllocateInfo{};
-        AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        AllocateInfo.descriptorPool = m_descriptorPool;
-        AllocateInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
-        AllocateInfo.pSetLayouts = Layouts.data();
-
         m_computeDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        VK_CHECK(vkAllocateDescriptorSets(m_device, &AllocateInfo, m_computeDescriptorSets.data()));
-
-        std::array<VkWriteDescriptorSet, 3> DescriptorWrites{};
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo BufferInfo{};
-            BufferInfo.buffer = m_MVPUniformBuffers[i]->GetHandle();
-            BufferInfo.offset = 0;
-            BufferInfo.range = VK_WHOLE_SIZE;
-            DescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            DescriptorWrites[0].dstSet = m_computeDescriptorSets[i];
-            DescriptorWrites[0].dstBinding = 0;
-            DescriptorWrites[0].dstArrayElement = 0;
-            DescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            DescriptorWrites[0].descriptorCount = 1;
-            DescriptorWrites[0].pBufferInfo = &BufferInfo;
-
-            VkDescriptorBufferInfo LastFrameStorageBufferInfo{};
             int LastFrameIndex = i == 0 ? MAX_FRAMES_IN_FLIGHT - 1 : i - 1;
-            LastFrameStorageBufferInfo.buffer = m_particleStorageBuffers[LastFrameIndex]->GetHandle();
-            LastFrameStorageBufferInfo.offset = 0;
-            LastFrameStorageBufferInfo.range = VK_WHOLE_SIZE;
-            DescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            DescriptorWrites[1].dstSet = m_computeDescriptorSets[i];
-            DescriptorWrites[1].dstBinding = 1;
-            DescriptorWrites[1].dstArrayElement = 0;
-            DescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-            DescriptorWrites[1].descriptorCount = 1;
-            DescriptorWrites[1].pBufferInfo = &LastFrameStorageBufferInfo;
-
-            VkDescriptorBufferInfo CurrentFrameStorageBufferInfo{};
-            CurrentFrameStorageBufferInfo.buffer = m_particleStorageBuffers[i]->GetHandle();
-            CurrentFrameStorageBufferInfo.offset = 0;
-            CurrentFrameStorageBufferInfo.range = VK_WHOLE_SIZE;
-            DescriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            DescriptorWrites[2].dstSet = m_computeDescriptorSets[i];
-            DescriptorWrites[2].dstBinding = 2;
-            DescriptorWrites[2].dstArrayElement = 0;
-            DescriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-            DescriptorWrites[2].descriptorCount = 1;
-            DescriptorWrites[2].pBufferInfo = &CurrentFrameStorageBufferInfo;
-
-            vkUpdateDescriptorSets(m_device, 3, DescriptorWrites.data(), 0, nullptr);
+            m_computeDescriptorSets[i] = m_descriptorCache->GetSet(m_computeDescriptorSetLayout, {
+                    DescriptorWrite::BufferWrite(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                                 m_frameAllocator->GetHandle(), 0, sizeof(MVPData)),
+                    DescriptorWrite::BufferWrite(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                 m_particleStorageBuffers[LastFrameIndex]->GetHandle()),
+                    DescriptorWrite::BufferWrite(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                 m_particleStorageBuffers[i]->GetHandle())
+            });
         }
     }
 
@@ -11,6 +11,7 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <array>
 #include <chrono>
 #include <optional>
 #include <functional>
@@ -18,20 +19,45 @@
 #include "core/buffer/IndexBuffer.h"
 #include "core/buffer/UniformBuffer.h"
 #include "core/buffer/StorageBuffer.h"
+#include "core/buffer/FrameLinearAllocator.h"
 #include "core/FPSCalculator.h"
 #include "core/texture/Texture2D.h"
 #include "core/texture/Sampler.h"
 #include "ImGuiIntegration.h"
 #include "core/Model.h"
+#include "core/sampling/BRDFLUT.h"
+#include "core/sampling/SobolSequence.h"
+#include "core/sampling/BlueNoise.h"
+#include "core/memory/DeviceMemoryAllocator.h"
+#include "core/memory/UploadManager.h"
+#include "core/memory/MemoryBudget.h"
+#include "core/rendergraph/RenderGraph.h"
+#include "core/texture/BarrierBatcher.h"
+#include "core/descriptor/BindlessHeap.h"
+#include "core/descriptor/DescriptorCache.h"
+#include "core/pipeline/PipelineCache.h"
+#include "core/command/FrameCommandPool.h"
+#include "core/command/ParallelCommandRecorder.h"
 
 
 namespace HWPT {
-    const int MAX_FRAMES_IN_FLIGHT = 2;
+    // Per frame resources are allocated for this many frames, how many are actually queued is set at runtime
+    const int MAX_FRAMES_IN_FLIGHT = 4;
+
+    struct FramePacingResult {
+        int FramesInFlight = 0;
+        double FrameMilliseconds = 0.;  // Between the starts of consecutive frames, the throughput side
+        double LatencyMilliseconds = 0.;  // From polling a frame's input to the GPU finishing it
+        double WaitMilliseconds = 0.;  // CPU blocked on the frame timeline per frame
+    };
 
     struct QueueFamilyIndices {
         std::optional<uint> GraphicsFamily;
         std::optional<uint> ComputeFamily;
         std::optional<uint> PresentFamily;
+        // Transfer without graphics, preferably without compute too, usually the copy engine. Optional,
+        // uploads fall back to the graphics queue
+        std::optional<uint> TransferFamily;
 
         [[nodiscard]] auto IsComplete() const -> bool {
             return GraphicsFamily.has_value() && ComputeFamily.has_value() && PresentFamily.has_value();
@@ -48,6 +74,7 @@ namespace HWPT {
         VkQueue GraphicsQueue = VK_NULL_HANDLE;
         VkQueue ComputeQueue = VK_NULL_HANDLE;
         VkQueue PresentQueue = VK_NULL_HANDLE;
+        VkQueue TransferQueue = VK_NULL_HANDLE;
     };
 
     struct SwapChain {
@@ -63,24 +90,21 @@ namespace HWPT {
     };
 
     struct CommandPool {
-        VkCommandPool GraphicsPool = VK_NULL_HANDLE;
-        VkCommandPool ComputePool = VK_NULL_HANDLE;
-    };
-
-    struct MSAABuffer {
-        Texture2D* MSAAColorBuffer = nullptr;
-        Texture2D* MSAADepthBuffer = nullptr;
-
-        ~MSAABuffer() {
-            delete MSAAColorBuffer;
-            delete MSAADepthBuffer;
-        }
+        FrameCommandPool* GraphicsPool = nullptr;
+        FrameCommandPool* ComputePool = nullptr;
+        // One "frame", recycled whenever no intermediate command is outstanding
+        FrameCommandPool* IntermediatePool = nullptr;
+        uint NumPendingIntermediateCommands = 0;
     };
 
     class VulkanBackendApp : public ApplicationBase {
     public:
         void Run() override;
 
+        // Runs the named reports in place of the viewer and cleans up, "all" runs every one. They print to
+        // std::cout and run after Init so the GPU ones find the device
+        void RunBenchmarks(const std::vector<std::string>& Names);
+
         void Init() override;
 
         void DrawFrame() override;
@@ -91,6 +115,13 @@ namespace HWPT {
 
         void EndIntermediateCommand(VkCommandBuffer commandBuffer);
 
+        // Blocks until the frame timeline reaches the last submitted frame, so nothing queued so far still
+        // reads the resources it was given. For overwriting a resource that is already in use
+        void WaitForSubmittedFrames();
+
+        // Blocks until FrameNumber is done, or the last submitted frame if FrameNumber has not been submitted
+        void WaitForFrame(uint64_t FrameNumber);
+
         auto GetVkInstance() -> VkInstance {
             return m_instance;
         }
@@ -111,6 +142,35 @@ namespace HWPT {
             return m_swapChain;
         }
 
+        auto GetMemoryAllocator() -> DeviceMemoryAllocator* {
+            return m_memoryAllocator;
+        }
+
+        auto GetUploadManager() -> UploadManager* {
+            return m_uploadManager;
+        }
+
+        auto GetMemoryBudget() -> MemoryBudget* {
+            return m_memoryBudget;
+        }
+
+        // Flushed at the start of every graphics command buffer the application records
+        auto GetBarrierBatcher() -> BarrierBatcher* {
+            return m_barrierBatcher;
+        }
+
+        auto GetBindlessHeap() -> BindlessHeap* {
+            return m_bindlessHeap;
+        }
+
+        auto GetDescriptorCache() -> DescriptorCache* {
+            return m_descriptorCache;
+        }
+
+        auto GetPipelineCache() -> PipelineCache* {
+            return m_pipelineCache;
+        }
+
     private:
         // Init GLFW Windows
         void InitWindow();
@@ -122,12 +182,36 @@ namespace HWPT {
 
         void Present();
 
+        // Advances the frame number and waits for the frame timeline, so no more than m_framesInFlight frames
+        // are queued. Also accumulates the pacing measurements
+        void BeginFramePacing();
+
         // FrameBuffer Resize Callback
         static void FrameBufferResizeCallback(GLFWwindow* Window, int Width, int Height);
 
         void RecreateSwapChain();
 
-        void CreateMSAABuffers();
+        void CreateUploadManager();
+
+        void DrawMemoryPanel();
+
+        // Forward pass of the frame graph, m_renderPass over the MSAA targets resolved into the swap chain image
+        void RecordForwardPass(VkCommandBuffer CommandBuffer, uint ImageIndex);
+
+        // One draw of the forward pass, recorded on whichever worker its range lands on
+        struct ForwardDraw {
+            VkPipeline Pipeline = VK_NULL_HANDLE;
+            std::function<void(VkCommandBuffer CommandBuffer)> Draw;
+            float Cost = 0.f;  // Commands it records, what the split across workers balances
+        };
+
+        auto BuildForwardDraws() -> std::vector<ForwardDraw>;
+
+        void RecordForwardDraws(VkCommandBuffer CommandBuffer, const std::vector<ForwardDraw>& Draws, uint Begin,
+                                uint End);
+
+        // CPU time of recording a few thousand draws on 1, 2, 4... threads
+        void RunRecordingBenchmark();
 
     private:
         void InitImGui();
@@ -136,6 +220,8 @@ namespace HWPT {
 
         void EndImGui();
 
+        void RecordImGui(VkCommandBuffer CommandBuffer, uint ImageIndex);
+
         void CleanUpImGui();
 
         void EnableWholeScreenDocking();
@@ -154,6 +240,8 @@ namespace HWPT {
 
         static auto IsDeviceExtensionSupport(VkPhysicalDevice PhysicalDevice) -> bool;
 
+        [[nodiscard]] auto IsDeviceExtensionEnabled(const char* Extension) const -> bool;
+
         auto QuerySwapChainSupport(VkPhysicalDevice PhysicalDevice) -> SwapChainSupportDetails;
 
         auto IsSuitableDevice(VkPhysicalDevice PhysicalDevice) -> bool;
@@ -166,11 +254,10 @@ namespace HWPT {
 
         void CreateRenderPass();
 
-        void CreateFrameBuffers();
+        void CreateFrameBuffers(VkImageView MSAAColorView, VkImageView MSAADepthView);
 
         void CreateCommandPool();
 
-        void CreateCommandBuffers();
 
         void CreateGraphicsDescriptorSetLayout();
 
@@ -182,7 +269,10 @@ namespace HWPT {
 
         void CreateComputePipeline();
 
-        void CreateDescriptorPool();
+        // The Create*Pipeline calls only queue their compiles, this collects the results
+        void WaitForPipelines();
+
+        void CreateDescriptorCache();
 
         void CreateGraphicsDescriptorSets();
 
@@ -192,7 +282,10 @@ namespace HWPT {
 
         void RecordCommandBuffer(VkCommandBuffer CommandBuffer, uint ImageIndex);
 
-        void CreateUniformBuffers();
+        void CreateFrameAllocator();
+
+        // Pushes this frame's MVPData, shared by the particle update and the forward pass
+        void UpdateFrameConstants();
 
         void CreateModelAndSampler();
 
@@ -218,6 +311,8 @@ namespace HWPT {
         inline static bool m_enableValidationLayers = false;
         inline static const std::vector<const char *> ValidationLayers = {};
 #endif
+        // Requested by the instance and required of the physical device
+        inline static constexpr uint32_t VulkanApiVersion = VK_API_VERSION_1_3;
         inline static std::vector<const char *> DeviceExtensions = {
                 VK_KHR_SWAPCHAIN_EXTENSION_NAME,
                 VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
@@ -226,10 +321,23 @@ namespace HWPT {
                 VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
                 VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME
         };
+        // Enabled when the device has them
+        inline static std::vector<const char *> OptionalDeviceExtensions = {
+                VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+        };
 
         VkInstance m_instance = VK_NULL_HANDLE;
         VkSurfaceKHR m_surface = VK_NULL_HANDLE;
         VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        DeviceMemoryAllocator* m_memoryAllocator = nullptr;
+        UploadManager* m_uploadManager = nullptr;
+        MemoryBudget* m_memoryBudget = nullptr;
+        BarrierBatcher* m_barrierBatcher = nullptr;
+        BindlessHeap* m_bindlessHeap = nullptr;
+        // Owns the pipelines below
+        PipelineCache* m_pipelineCache = nullptr;
+        double m_startupMilliseconds = 0.;  // Of InitVulkan
+        std::vector<const char *> m_enabledDeviceExtensions;
         Queue m_queue;
         SwapChain m_swapChain;
         std::vector<VkFramebuffer> m_swapChainFrameBuffers;
@@ -237,8 +345,9 @@ namespace HWPT {
 //        std::vector<VkFramebuffer> m_viewportFrameBuffer;
         VkRenderPass m_renderPass = VK_NULL_HANDLE;
         CommandPool m_commandPool;
-        std::vector<VkCommandBuffer> m_graphicsCommandBuffers;
-        std::vector<VkCommandBuffer> m_computeCommandBuffers;
+        ParallelCommandRecorder* m_commandRecorder = nullptr;
+        bool m_runRecordingBenchmark = false;
+        std::vector<std::pair<uint, double>> m_recordingBenchmark;  // Threads and best recording time in ms
         // Graphics Pipeline
         VkDescriptorSetLayout m_graphicsDescriptorSetLayout = VK_NULL_HANDLE;
         VkPipelineLayout m_graphicsPipelineLayout = VK_NULL_HANDLE;
@@ -248,8 +357,12 @@ namespace HWPT {
         VkDescriptorSetLayout m_computeDescriptorSetLayout = VK_NULL_HANDLE;
         VkPipelineLayout m_computePipelineLayout = VK_NULL_HANDLE;
         VkPipeline m_computePipeline = VK_NULL_HANDLE;
+        std::shared_future<VkPipeline> m_graphicsPipelineRequest;
+        std::shared_future<VkPipeline> m_particleGraphicsPipelineRequest;
+        std::shared_future<VkPipeline> m_computePipelineRequest;
 
-        VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+        // Layouts and the immutable sets below, owned by the cache
+        DescriptorCache* m_descriptorCache = nullptr;
         std::vector<VkDescriptorSet> m_graphicsDescriptorSets;
         std::vector<VkDescriptorSet> m_computeDescriptorSets;
 
@@ -258,23 +371,49 @@ namespace HWPT {
 
         inline static VulkanBackendApp* s_application = nullptr;
 
-        std::vector<UniformBuffer*> m_MVPUniformBuffers;
+        FrameLinearAllocator* m_frameAllocator = nullptr;
+        uint m_frameConstantsOffset = 0;  // Dynamic offset of this frame's MVPData
         Sampler* m_sampler = nullptr;
 
         std::vector<VkSemaphore> m_imageAvailableSemaphores;
         std::vector<VkSemaphore> m_renderFinishedSemaphores;
-        std::vector<VkFence> m_graphicsInFlightFences;
-        std::vector<VkFence> m_computeInFlightFences;
-        std::vector<VkSemaphore> m_computeFinishedSemaphores;
+        // Frame N signals N on both, m_computeTimeline from its dispatch and m_frameTimeline from its graphics
+        VkSemaphore m_frameTimeline = VK_NULL_HANDLE;
+        VkSemaphore m_computeTimeline = VK_NULL_HANDLE;
+        uint64_t m_frameNumber = 0;
+        uint64_t m_submittedFrameNumber = 0;  // Last frame whose graphics work reached the queue
+        int m_framesInFlight = 2;  // 1 to MAX_FRAMES_IN_FLIGHT
+
+        struct PacingWindow {
+            uint NumFrames = 0;
+            uint NumLatencySamples = 0;
+            double FrameMilliseconds = 0.;
+            double LatencyMilliseconds = 0.;
+            double WaitMilliseconds = 0.;
+        };
+
+        std::chrono::high_resolution_clock::time_point m_frameStartTime;
+        std::chrono::high_resolution_clock::time_point m_previousFrameStartTime;
+        std::array<std::chrono::high_resolution_clock::time_point, MAX_FRAMES_IN_FLIGHT> m_frameStartTimes;
+        uint64_t m_lastCompletedFrame = 0;
+        PacingWindow m_pacingWindow;
+        FramePacingResult m_pacing;  // Averages over the last window
+        int m_pacingSweepWindow = -1;  // Windows into the frames in flight sweep, -1 when not sweeping
+        int m_pacingSweepRestore = 0;
+        std::vector<FramePacingResult> m_pacingResults;
 
         ImGuiInfrastructure* m_imguiInfrastructure = nullptr;
 
         glm::vec2 m_viewportSize = glm::vec2(0.f, 0.f);
 
         Model* m_vikingRoom = nullptr;
+        BRDFLUT* m_brdfLUT = nullptr;
+        SobolSequence* m_sobolSequence = nullptr;
+        BlueNoise* m_blueNoise = nullptr;
         uint m_msaaSamples = 8;
 
-        MSAABuffer* m_msaaBuffers = nullptr;
+        RenderGraph* m_renderGraph = nullptr;
+        uint64_t m_frameBufferGeneration = 0;  // RenderGraph generation the frame buffers were created for
 
         // For GPU Particles
         inline static uint s_particleCount = 81920;
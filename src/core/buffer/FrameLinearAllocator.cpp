@@ -0,0 +1,61 @@
+//
+// Created by HUSTLX on 2024/11/6.
+//
+
+#include "FrameLinearAllocator.h"
+#include "core/RHI.h"
+#include <algorithm>
+
+
+namespace HWPT {
+
+    FrameLinearAllocator::FrameLinearAllocator(VkDeviceSize FrameSize, uint NumFrames, VkBufferUsageFlags Usage)
+            : m_numFrames(NumFrames) {
+        VkPhysicalDeviceProperties Properties;
+        vkGetPhysicalDeviceProperties(GetVKPhysicalDevice(), &Properties);
+        m_alignment = std::max<VkDeviceSize>(Properties.limits.minUniformBufferOffsetAlignment, 16);
+        if (Usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+            m_alignment = std::max(m_alignment, Properties.limits.minStorageBufferOffsetAlignment);
+        }
+        // Every region starts aligned, so offsets aligned within a region stay aligned in the buffer
+        m_frameSize = (FrameSize + m_alignment - 1) / m_alignment * m_alignment;
+
+        RHI::CreateBuffer(m_frameSize * m_numFrames, Usage,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          m_buffer, m_memory);
+        // Host visible blocks stay mapped in the device allocator
+        m_mappedData = static_cast<uint8_t*>(m_memory->MappedData);
+    }
+
+    FrameLinearAllocator::~FrameLinearAllocator() {
+        RHI::DestroyBuffer(m_buffer, m_memory);
+    }
+
+    void FrameLinearAllocator::BeginFrame(uint Frame) {
+        Check(Frame < m_numFrames);
+        m_frame = Frame;
+        m_head = 0;
+        m_stats.NumAllocations = 0;
+        m_stats.UsedBytes = 0;
+    }
+
+    auto FrameLinearAllocator::Allocate(VkDeviceSize Size) -> FrameAllocation {
+        VkDeviceSize AlignedSize = (Size + m_alignment - 1) / m_alignment * m_alignment;
+        if (m_head + AlignedSize > m_frameSize) {
+            throw std::runtime_error("FrameLinearAllocator: frame region exhausted");
+        }
+
+        VkDeviceSize Offset = static_cast<VkDeviceSize>(m_frame) * m_frameSize + m_head;
+        m_head += AlignedSize;
+        m_stats.NumAllocations++;
+        m_stats.UsedBytes = m_head;
+        m_stats.PeakBytes = std::max(m_stats.PeakBytes, m_head);
+
+        FrameAllocation Allocation;
+        Allocation.Data = m_mappedData + Offset;
+        Allocation.Offset = static_cast<uint>(Offset);
+        Allocation.Size = Size;
+        return Allocation;
+    }
+
+}  // namespace HWPT
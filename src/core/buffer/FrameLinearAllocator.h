@@ -0,0 +1,81 @@
+//
+// Created by HUSTLX on 2024/11/6.
+//
+
+#ifndef HARDWAREPATHTRACER_FRAMELINEARALLOCATOR_H
+#define HARDWAREPATHTRACER_FRAMELINEARALLOCATOR_H
+
+#include "core/Core.h"
+#include <cstring>
+
+
+namespace HWPT {
+    struct MemoryAllocation;
+
+    // Sub-range of the current frame's region, Offset is what goes into pDynamicOffsets
+    struct FrameAllocation {
+        void* Data = nullptr;
+        uint Offset = 0;
+        VkDeviceSize Size = 0;
+    };
+
+    struct FrameLinearAllocatorStats {
+        uint NumAllocations = 0;  // In the current frame
+        VkDeviceSize UsedBytes = 0;  // In the current frame, including alignment padding
+        VkDeviceSize PeakBytes = 0;  // Highest UsedBytes of any frame
+    };
+
+    // One persistently mapped, host coherent buffer split into a region per frame in flight. Per frame data
+    // such as uniform blocks is bump allocated from the region of the current frame and bound through
+    // UNIFORM_BUFFER_DYNAMIC descriptors, so a new constant block is a pointer increment instead of another
+    // buffer and descriptor set. A region is reused by BeginFrame once the frame that used it last has
+    // finished on the GPU, i.e. after BeginFramePacing has waited for the frame timeline value
+    class FrameLinearAllocator {
+    public:
+        FrameLinearAllocator(VkDeviceSize FrameSize, uint NumFrames,
+                             VkBufferUsageFlags Usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+        ~FrameLinearAllocator();
+
+        void BeginFrame(uint Frame);
+
+        // Throws when the frame region is exhausted
+        auto Allocate(VkDeviceSize Size) -> FrameAllocation;
+
+        // Copies Data into a new allocation and returns its dynamic offset
+        template<typename T>
+        auto Push(const T& Data) -> uint {
+            FrameAllocation Allocation = Allocate(sizeof(T));
+            memcpy(Allocation.Data, &Data, sizeof(T));
+            return Allocation.Offset;
+        }
+
+        auto GetHandle() -> VkBuffer& {
+            return m_buffer;
+        }
+
+        // Offsets are multiples of this, minUniformBufferOffsetAlignment or the storage one when larger
+        [[nodiscard]] auto GetAlignment() const -> VkDeviceSize {
+            return m_alignment;
+        }
+
+        [[nodiscard]] auto GetStats() const -> const FrameLinearAllocatorStats& {
+            return m_stats;
+        }
+
+    private:
+        VkBuffer m_buffer = VK_NULL_HANDLE;
+        MemoryAllocation* m_memory = nullptr;
+        uint8_t* m_mappedData = nullptr;
+        VkDeviceSize m_frameSize = 0;
+        uint m_numFrames = 0;
+        VkDeviceSize m_alignment = 0;
+
+        uint m_frame = 0;
+        VkDeviceSize m_head = 0;  // Relative to the start of the current frame region
+
+        FrameLinearAllocatorStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_FRAMELINEARALLOCATOR_H
@@ -9,6 +9,8 @@
 
 
 namespace HWPT {
+    struct MemoryAllocation;
+
     class IndexBuffer {
     public:
         IndexBuffer(uint IndexCount, const void *Data);
@@ -29,7 +31,7 @@ namespace HWPT {
 
     private:
         VkBuffer m_indexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_indexBufferMemory = VK_NULL_HANDLE;
+        MemoryAllocation* m_indexBufferMemory = nullptr;
         uint m_indexCount = 0;
     };
 }  // namespace HWPT
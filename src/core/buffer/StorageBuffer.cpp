@@ -9,25 +9,52 @@
 
 namespace HWPT {
 
-    StorageBuffer::StorageBuffer(VkDeviceSize Size, void *Data) {
+    StorageBuffer::StorageBuffer(VkDeviceSize Size, void *Data) : m_size(Size) {
+        RHI::CreateBuffer(Size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_storageBuffer, m_storageBufferMemory);
+        // Nothing has seen the buffer yet, so the initial contents go through the batched path
+        if (Data) {
+            VulkanBackendApp::GetApplication()->GetUploadManager()->UploadBuffer(m_storageBuffer, Data, Size);
+        }
+    }
+
+    void StorageBuffer::Upload(const void *Data, VkDeviceSize Size) {
+        Size = Size == VK_WHOLE_SIZE ? m_size : Size;
+        Check(Size <= m_size);
+        uint64_t LastFrameUse = m_bindlessIndex == InvalidBindlessIndex ? m_lastFrameUse : UploadManager::AnyFrameUse;
+        VulkanBackendApp::GetApplication()->GetUploadManager()->UpdateBuffer(m_storageBuffer, Data, Size, 0,
+                                                                             LastFrameUse);
+    }
+
+    void StorageBuffer::Download(void *Data, VkDeviceSize Size) {
+        Size = Size == VK_WHOLE_SIZE ? m_size : Size;
+        Check(Size <= m_size);
+        // Staging buffers are host visible and also usable as transfer destination. CopyBuffer flushes
+        // pending uploads first, so they land before the readback
         auto [StagingBuffer, StagingBufferMemory] = RHI::CreateStagingBuffer(Size);
+        RHI::CopyBuffer(m_storageBuffer, StagingBuffer, Size);
 
-        void* MappedData;
-        vkMapMemory(GetVKDevice(), StagingBufferMemory, 0, Size, 0, &MappedData);
-        memcpy(MappedData, Data, Size);
-        vkUnmapMemory(GetVKDevice(), StagingBufferMemory);
+        memcpy(Data, StagingBufferMemory->MappedData, Size);
 
-        RHI::CreateBuffer(Size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_storageBuffer, m_storageBufferMemory);
-        RHI::CopyBuffer(StagingBuffer, m_storageBuffer, Size);
+        RHI::DestroyBuffer(StagingBuffer, StagingBufferMemory);
+    }
 
-        vkDestroyBuffer(GetVKDevice(), StagingBuffer, nullptr);
-        vkFreeMemory(GetVKDevice(), StagingBufferMemory, nullptr);
+    auto StorageBuffer::GetBindlessIndex() -> uint {
+        if (m_bindlessIndex == InvalidBindlessIndex) {
+            m_bindlessIndex = VulkanBackendApp::GetApplication()->GetBindlessHeap()->RegisterStorageBuffer(
+                    m_storageBuffer);
+        }
+        return m_bindlessIndex;
     }
 
     StorageBuffer::~StorageBuffer() {
-        vkFreeMemory(GetVKDevice(), m_storageBufferMemory, nullptr);
-        vkDestroyBuffer(GetVKDevice(), m_storageBuffer, nullptr);
+        if (m_bindlessIndex != InvalidBindlessIndex) {
+            VulkanBackendApp::GetApplication()->GetBindlessHeap()->Release(BindlessType::StorageBuffer,
+                                                                          m_bindlessIndex);
+        }
+        VulkanBackendApp::GetApplication()->GetDescriptorCache()->EvictBuffer(m_storageBuffer);
+        RHI::DestroyBuffer(m_storageBuffer, m_storageBufferMemory);
     }
 
 }  // namespace HWPT
@@ -6,22 +6,48 @@
 #define HARDWAREPATHTRACER_STORAGEBUFFER_H
 
 #include "core/Core.h"
+#include "core/descriptor/BindlessHeap.h"
 
 
 namespace HWPT {
+    struct MemoryAllocation;
+
     class StorageBuffer {
     public:
+        // Data may be nullptr for scratch buffers that are only written by the GPU
         StorageBuffer(VkDeviceSize Size, void* Data);
 
         ~StorageBuffer();
 
+        // Size defaults to the whole buffer. Upload goes through UploadManager::UpdateBuffer since frames in
+        // flight may read the buffer, Download is a blocking copy through a staging buffer
+        void Upload(const void* Data, VkDeviceSize Size = VK_WHOLE_SIZE);
+
+        // Frames that bind the buffer record their frame number, Upload then only waits for that frame. Once
+        // in the bindless heap any frame may read it and Upload waits for all of them
+        void MarkFrameUse(uint64_t FrameNumber) {
+            m_lastFrameUse = FrameNumber;
+        }
+
+        void Download(void* Data, VkDeviceSize Size = VK_WHOLE_SIZE);
+
         auto GetHandle() -> VkBuffer& {
             return m_storageBuffer;
         }
 
+        [[nodiscard]] auto GetSize() const -> VkDeviceSize {
+            return m_size;
+        }
+
+        // Index of the whole buffer in the application's BindlessHeap, registered on first use
+        auto GetBindlessIndex() -> uint;
+
     private:
+        VkDeviceSize m_size = 0;
         VkBuffer m_storageBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_storageBufferMemory = VK_NULL_HANDLE;
+        MemoryAllocation* m_storageBufferMemory = nullptr;
+        uint m_bindlessIndex = InvalidBindlessIndex;
+        uint64_t m_lastFrameUse = 0;
     };
 }  // namespace HWPT
 
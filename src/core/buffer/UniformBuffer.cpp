@@ -14,14 +14,14 @@ namespace HWPT {
                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                           m_uniformBuffer, m_uniformBufferMemory);
 
-        vkMapMemory(GetVKDevice(), m_uniformBufferMemory, 0, Size, 0, &m_mappedData);
+        // Host visible blocks stay mapped in the device allocator
+        m_mappedData = m_uniformBufferMemory->MappedData;
         memcpy(m_mappedData, Data, Size);
     }
 
     UniformBuffer::~UniformBuffer() {
-        vkUnmapMemory(GetVKDevice(), m_uniformBufferMemory);
-        vkFreeMemory(GetVKDevice(), m_uniformBufferMemory, nullptr);
-        vkDestroyBuffer(GetVKDevice(), m_uniformBuffer, nullptr);
+        VulkanBackendApp::GetApplication()->GetDescriptorCache()->EvictBuffer(m_uniformBuffer);
+        RHI::DestroyBuffer(m_uniformBuffer, m_uniformBufferMemory);
     }
 
     void UniformBuffer::Update(void *Data) {
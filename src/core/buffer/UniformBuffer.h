@@ -9,6 +9,8 @@
 
 
 namespace HWPT {
+    struct MemoryAllocation;
+
     class UniformBuffer {
     public:
         UniformBuffer(VkDeviceSize Size, const void *Data);
@@ -23,7 +25,7 @@ namespace HWPT {
 
     private:
         VkBuffer m_uniformBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_uniformBufferMemory = VK_NULL_HANDLE;
+        MemoryAllocation* m_uniformBufferMemory = nullptr;
         void* m_mappedData = nullptr;
         VkDeviceSize m_size = 0;
     };
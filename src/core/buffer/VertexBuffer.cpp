@@ -9,28 +9,17 @@
 
 namespace HWPT {
     VertexBuffer::VertexBuffer(VkDeviceSize Size, const void *Data) {
-        auto [StagingBuffer, StagingBufferMemory] = RHI::CreateStagingBuffer(Size);
-
-        void *MappedData = nullptr;
-        vkMapMemory(GetVKDevice(), StagingBufferMemory, 0, Size, 0, &MappedData);
-        memcpy(MappedData, Data, Size);
-        vkUnmapMemory(GetVKDevice(), StagingBufferMemory);
-
         RHI::CreateBuffer(Size,
                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                           m_vertexBuffer, m_vertexBufferMemory);
 
-        RHI::CopyBuffer(StagingBuffer, m_vertexBuffer, Size);
-
-        vkDestroyBuffer(GetVKDevice(), StagingBuffer, nullptr);
-        vkFreeMemory(GetVKDevice(), StagingBufferMemory, nullptr);
+        VulkanBackendApp::GetApplication()->GetUploadManager()->UploadBuffer(m_vertexBuffer, Data, Size);
     }
 
     VertexBuffer::~VertexBuffer() {
         delete m_layout;
-        vkFreeMemory(GetVKDevice(), m_vertexBufferMemory, nullptr);
-        vkDestroyBuffer(GetVKDevice(), m_vertexBuffer, nullptr);
+        RHI::DestroyBuffer(m_vertexBuffer, m_vertexBufferMemory);
     }
 
     void VertexBuffer::Bind(VkCommandBuffer CommandBuffer) {
@@ -19,6 +19,8 @@
 
 
 namespace HWPT {
+    struct MemoryAllocation;
+
     struct Vertex {
         glm::vec3 Pos;
         glm::vec3 Color;
@@ -60,7 +62,7 @@ namespace HWPT {
 
     private:
         VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_vertexBufferMemory = VK_NULL_HANDLE;
+        MemoryAllocation* m_vertexBufferMemory = nullptr;
         VertexBufferLayout *m_layout = nullptr;
     };
 }  // namespace HWPT
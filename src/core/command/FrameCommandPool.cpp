@@ -0,0 +1,59 @@
+//
+// Created by HUSTLX on 2024/11/11.
+//
+
+#include "FrameCommandPool.h"
+
+
+namespace HWPT {
+    FrameCommandPool::FrameCommandPool(VkDevice Device, uint QueueFamilyIndex, uint NumFrames) : m_device(Device) {
+        VkCommandPoolCreateInfo PoolInfo{};
+        PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        PoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        PoolInfo.queueFamilyIndex = QueueFamilyIndex;
+
+        m_frames.resize(NumFrames);
+        for (FramePool& Frame: m_frames) {
+            VK_CHECK(vkCreateCommandPool(m_device, &PoolInfo, nullptr, &Frame.Pool));
+        }
+    }
+
+    FrameCommandPool::~FrameCommandPool() {
+        for (FramePool& Frame: m_frames) {
+            // Frees the command buffers allocated from it as well
+            vkDestroyCommandPool(m_device, Frame.Pool, nullptr);
+        }
+    }
+
+    void FrameCommandPool::BeginFrame(uint Frame) {
+        m_frame = Frame;
+        FramePool& Pool = m_frames[m_frame];
+        if (Pool.NumPrimaryUsed > 0 || Pool.NumSecondaryUsed > 0) {
+            VK_CHECK(vkResetCommandPool(m_device, Pool.Pool, 0));
+            Pool.NumPrimaryUsed = 0;
+            Pool.NumSecondaryUsed = 0;
+            m_stats.NumResets++;
+        }
+        m_stats.NumAcquired = 0;
+    }
+
+    auto FrameCommandPool::Acquire(VkCommandBufferLevel Level) -> VkCommandBuffer {
+        FramePool& Pool = m_frames[m_frame];
+        bool IsPrimary = Level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        std::vector<VkCommandBuffer>& CommandBuffers = IsPrimary ? Pool.Primary : Pool.Secondary;
+        uint& NumUsed = IsPrimary ? Pool.NumPrimaryUsed : Pool.NumSecondaryUsed;
+        if (NumUsed == CommandBuffers.size()) {
+            VkCommandBufferAllocateInfo AllocateInfo{};
+            AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            AllocateInfo.commandPool = Pool.Pool;
+            AllocateInfo.level = Level;
+            AllocateInfo.commandBufferCount = 1;
+            VkCommandBuffer CommandBuffer;
+            VK_CHECK(vkAllocateCommandBuffers(m_device, &AllocateInfo, &CommandBuffer));
+            CommandBuffers.push_back(CommandBuffer);
+            m_stats.NumAllocated++;
+        }
+        m_stats.NumAcquired++;
+        return CommandBuffers[NumUsed++];
+    }
+}  // namespace HWPT
@@ -0,0 +1,55 @@
+//
+// Created by HUSTLX on 2024/11/11.
+//
+
+#ifndef HARDWAREPATHTRACER_FRAMECOMMANDPOOL_H
+#define HARDWAREPATHTRACER_FRAMECOMMANDPOOL_H
+
+#include "core/Core.h"
+#include <vector>
+
+
+namespace HWPT {
+    struct FrameCommandPoolStats {
+        uint NumAllocated = 0;  // Command buffers ever allocated, over all frames
+        uint NumAcquired = 0;  // Handed out since the current frame began
+        uint NumResets = 0;  // vkResetCommandPool calls
+    };
+
+    // A transient command pool per frame in flight. Command buffers are never freed or reset one by one:
+    // Acquire hands out the next buffer of the current frame's recycled list and only allocates when the list
+    // runs out, and BeginFrame resets the whole pool with vkResetCommandPool, which returns every buffer of that
+    // frame to the initial state at once. BeginFrame must only be called once the GPU is done with the frame,
+    // i.e. after BeginFramePacing has waited for the frame timeline value. Not thread safe, every recording
+    // thread needs its own FrameCommandPool
+    class FrameCommandPool {
+    public:
+        FrameCommandPool(VkDevice Device, uint QueueFamilyIndex, uint NumFrames);
+
+        ~FrameCommandPool();
+
+        void BeginFrame(uint Frame);
+
+        auto Acquire(VkCommandBufferLevel Level = VK_COMMAND_BUFFER_LEVEL_PRIMARY) -> VkCommandBuffer;
+
+        [[nodiscard]] auto GetStats() const -> const FrameCommandPoolStats& {
+            return m_stats;
+        }
+
+    private:
+        struct FramePool {
+            VkCommandPool Pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> Primary;
+            std::vector<VkCommandBuffer> Secondary;
+            uint NumPrimaryUsed = 0;  // Since the last reset
+            uint NumSecondaryUsed = 0;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        std::vector<FramePool> m_frames;
+        uint m_frame = 0;
+        FrameCommandPoolStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_FRAMECOMMANDPOOL_H
@@ -0,0 +1,81 @@
+//
+// Created by HUSTLX on 2024/11/10.
+//
+
+#include "ParallelCommandRecorder.h"
+#include "core/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+
+namespace HWPT {
+
+    ParallelCommandRecorder::ParallelCommandRecorder(VkDevice Device, uint QueueFamilyIndex, uint NumFramesInFlight)
+            : m_maxRanges(ThreadPool::Get().GetNumThreads()) {
+        m_rangePools.resize(m_maxRanges);
+        for (FrameCommandPool*& Pool: m_rangePools) {
+            Pool = new FrameCommandPool(Device, QueueFamilyIndex, NumFramesInFlight);
+        }
+    }
+
+    ParallelCommandRecorder::~ParallelCommandRecorder() {
+        for (FrameCommandPool* Pool: m_rangePools) {
+            delete Pool;
+        }
+    }
+
+    void ParallelCommandRecorder::BeginFrame(uint Frame) {
+        for (FrameCommandPool* Pool: m_rangePools) {
+            Pool->BeginFrame(Frame);
+        }
+    }
+
+    auto ParallelCommandRecorder::Record(const VkCommandBufferInheritanceInfo &Inheritance,
+                                         const std::vector<float> &Costs, const RecordFunction &RecordRange,
+                                         uint MaxRanges) -> std::vector<VkCommandBuffer> {
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        uint NumItems = static_cast<uint>(Costs.size());
+        if (NumItems == 0) {
+            m_stats = {};
+            return {};
+        }
+        uint NumRanges = std::min(MaxRanges == 0 ? m_maxRanges : std::min(MaxRanges, m_maxRanges), NumItems);
+
+        // Cut wherever the running cost passes the next multiple of Total / NumRanges, so a few expensive
+        // draws get a range of their own while cheap ones are batched
+        std::vector<uint> Bounds = {0};
+        float Total = std::accumulate(Costs.begin(), Costs.end(), 0.f);
+        float Accumulated = 0.f;
+        for (uint i = 0; i + 1 < NumItems && Bounds.size() < NumRanges; i++) {
+            Accumulated += Costs[i];
+            if (Accumulated >= Total * static_cast<float>(Bounds.size()) / static_cast<float>(NumRanges)) {
+                Bounds.push_back(i + 1);
+            }
+        }
+        Bounds.push_back(NumItems);
+        NumRanges = static_cast<uint>(Bounds.size()) - 1;
+
+        std::vector<VkCommandBuffer> CommandBuffers(NumRanges);
+        ThreadPool::Get().ParallelFor(NumRanges, [&](uint Begin, uint End) {
+            for (uint Range = Begin; Range < End; Range++) {
+                VkCommandBuffer CommandBuffer = m_rangePools[Range]->Acquire(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                VkCommandBufferBeginInfo BeginInfo{};
+                BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                                  VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                BeginInfo.pInheritanceInfo = &Inheritance;
+                VK_CHECK(vkBeginCommandBuffer(CommandBuffer, &BeginInfo));
+                RecordRange(CommandBuffer, Bounds[Range], Bounds[Range + 1]);
+                VK_CHECK(vkEndCommandBuffer(CommandBuffer));
+                CommandBuffers[Range] = CommandBuffer;
+            }
+        });
+
+        m_stats.NumItems = NumItems;
+        m_stats.NumRanges = NumRanges;
+        m_stats.RecordMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+        return CommandBuffers;
+    }
+}  // namespace HWPT
@@ -0,0 +1,57 @@
+//
+// Created by HUSTLX on 2024/11/10.
+//
+
+#ifndef HARDWAREPATHTRACER_PARALLELCOMMANDRECORDER_H
+#define HARDWAREPATHTRACER_PARALLELCOMMANDRECORDER_H
+
+#include "core/Core.h"
+#include "FrameCommandPool.h"
+#include <functional>
+#include <vector>
+
+
+namespace HWPT {
+    struct ParallelRecordStats {
+        uint NumItems = 0;
+        uint NumRanges = 0;  // Secondary command buffers recorded
+        double RecordMilliseconds = 0.;  // Wall time of the last Record
+    };
+
+    // Records a list of draws into secondary command buffers on the ThreadPool, to be run from the primary
+    // with vkCmdExecuteCommands inside a render pass begun with SECONDARY_COMMAND_BUFFERS contents.
+    // The draws are split into contiguous ranges of about equal summed cost, one range per worker at most,
+    // and every range records with its own FrameCommandPool so no pool is ever used by two threads at once.
+    // BeginFrame resets the frame's pools after BeginFramePacing has waited for the frame timeline value
+    class ParallelCommandRecorder {
+    public:
+        // Records Items [Begin, End) into CommandBuffer, which starts out without any bound state
+        using RecordFunction = std::function<void(VkCommandBuffer CommandBuffer, uint Begin, uint End)>;
+
+        ParallelCommandRecorder(VkDevice Device, uint QueueFamilyIndex, uint NumFramesInFlight);
+
+        ~ParallelCommandRecorder();
+
+        void BeginFrame(uint Frame);
+
+        // Costs holds one entry per item, MaxRanges limits the parallelism (0 is one range per pool thread).
+        // Returns the recorded secondary command buffers in item order
+        auto Record(const VkCommandBufferInheritanceInfo& Inheritance, const std::vector<float>& Costs,
+                    const RecordFunction& RecordRange, uint MaxRanges = 0) -> std::vector<VkCommandBuffer>;
+
+        [[nodiscard]] auto GetMaxRanges() const -> uint {
+            return m_maxRanges;
+        }
+
+        [[nodiscard]] auto GetStats() const -> const ParallelRecordStats& {
+            return m_stats;
+        }
+
+    private:
+        uint m_maxRanges = 0;
+        std::vector<FrameCommandPool*> m_rangePools;
+        ParallelRecordStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_PARALLELCOMMANDRECORDER_H
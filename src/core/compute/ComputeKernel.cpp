@@ -0,0 +1,172 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#include "ComputeKernel.h"
+#include "core/shader/ShaderBase.h"
+#include "core/application/VulkanBackendApp.h"
+#include <map>
+
+
+namespace HWPT {
+
+    ComputeKernel::ComputeKernel(const std::filesystem::path &ShaderPath, const std::string &Entry,
+                                 const std::vector<VkDescriptorType> &Bindings, uint PushConstantSize,
+                                 uint MaxDescriptorSets)
+            : m_bindings(Bindings), m_pushConstantSize(PushConstantSize) {
+        VkDevice Device = GetVKDevice();
+
+        std::vector<VkDescriptorSetLayoutBinding> LayoutBindings(m_bindings.size());
+        std::map<VkDescriptorType, uint> DescriptorCounts;
+        for (uint i = 0; i < m_bindings.size(); i++) {
+            LayoutBindings[i].binding = i;
+            LayoutBindings[i].descriptorCount = 1;
+            LayoutBindings[i].descriptorType = m_bindings[i];
+            LayoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            LayoutBindings[i].pImmutableSamplers = nullptr;
+            DescriptorCounts[m_bindings[i]] += MaxDescriptorSets;
+        }
+
+        VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+        LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        LayoutInfo.bindingCount = static_cast<uint>(LayoutBindings.size());
+        LayoutInfo.pBindings = LayoutBindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(Device, &LayoutInfo, nullptr, &m_descriptorSetLayout));
+
+        VkPushConstantRange PushConstantRange{};
+        PushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        PushConstantRange.offset = 0;
+        PushConstantRange.size = m_pushConstantSize;
+
+        VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
+        PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PipelineLayoutInfo.setLayoutCount = 1;
+        PipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+        PipelineLayoutInfo.pushConstantRangeCount = m_pushConstantSize > 0 ? 1 : 0;
+        PipelineLayoutInfo.pPushConstantRanges = &PushConstantRange;
+        VK_CHECK(vkCreatePipelineLayout(Device, &PipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+        ShaderBase ComputeShader(ShaderType::Compute, ShaderPath);
+
+        VkPipelineShaderStageCreateInfo ComputeShaderStageInfo{};
+        ComputeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        ComputeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        ComputeShaderStageInfo.module = ComputeShader.GetHandle();
+        ComputeShaderStageInfo.pName = Entry.c_str();
+
+        VkComputePipelineCreateInfo PipelineInfo{};
+        PipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        PipelineInfo.stage = ComputeShaderStageInfo;
+        PipelineInfo.layout = m_pipelineLayout;
+        // Compiled through the application's driver cache, the kernel keeps ownership of its pipeline
+        VkPipelineCache Cache = VulkanBackendApp::GetApplication()->GetPipelineCache()->GetHandle();
+        VK_CHECK(vkCreateComputePipelines(Device, Cache, 1, &PipelineInfo, nullptr, &m_pipeline));
+
+        std::vector<VkDescriptorPoolSize> PoolSizes;
+        for (auto [Type, Count]: DescriptorCounts) {
+            PoolSizes.push_back({Type, Count});
+        }
+        VkDescriptorPoolCreateInfo PoolInfo{};
+        PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        PoolInfo.poolSizeCount = static_cast<uint>(PoolSizes.size());
+        PoolInfo.pPoolSizes = PoolSizes.data();
+        PoolInfo.maxSets = MaxDescriptorSets;
+        VK_CHECK(vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &m_descriptorPool));
+    }
+
+    ComputeKernel::~ComputeKernel() {
+        VkDevice Device = GetVKDevice();
+        vkDestroyDescriptorPool(Device, m_descriptorPool, nullptr);
+        vkDestroyPipeline(Device, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(Device, m_pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(Device, m_descriptorSetLayout, nullptr);
+    }
+
+    auto ComputeKernel::AllocateDescriptorSet() -> VkDescriptorSet {
+        VkDescriptorSetAllocateInfo AllocateInfo{};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        AllocateInfo.descriptorPool = m_descriptorPool;
+        AllocateInfo.descriptorSetCount = 1;
+        AllocateInfo.pSetLayouts = &m_descriptorSetLayout;
+
+        VkDescriptorSet DescriptorSet;
+        VK_CHECK(vkAllocateDescriptorSets(GetVKDevice(), &AllocateInfo, &DescriptorSet));
+        return DescriptorSet;
+    }
+
+    void ComputeKernel::UpdateBuffer(VkDescriptorSet DescriptorSet, uint Binding, VkBuffer Buffer,
+                                     VkDeviceSize Size) {
+        Check(Binding < m_bindings.size());
+        VkDescriptorBufferInfo BufferInfo{};
+        BufferInfo.buffer = Buffer;
+        BufferInfo.offset = 0;
+        BufferInfo.range = Size;
+
+        VkWriteDescriptorSet DescriptorWrite{};
+        DescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        DescriptorWrite.dstSet = DescriptorSet;
+        DescriptorWrite.dstBinding = Binding;
+        DescriptorWrite.dstArrayElement = 0;
+        DescriptorWrite.descriptorType = m_bindings[Binding];
+        DescriptorWrite.descriptorCount = 1;
+        DescriptorWrite.pBufferInfo = &BufferInfo;
+        vkUpdateDescriptorSets(GetVKDevice(), 1, &DescriptorWrite, 0, nullptr);
+    }
+
+    void ComputeKernel::UpdateImage(VkDescriptorSet DescriptorSet, uint Binding, VkImageView ImageView,
+                                    VkImageLayout Layout, VkSampler Sampler) {
+        Check(Binding < m_bindings.size());
+        VkDescriptorImageInfo ImageInfo{};
+        ImageInfo.imageLayout = Layout;
+        ImageInfo.imageView = ImageView;
+        ImageInfo.sampler = Sampler;
+
+        VkWriteDescriptorSet DescriptorWrite{};
+        DescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        DescriptorWrite.dstSet = DescriptorSet;
+        DescriptorWrite.dstBinding = Binding;
+        DescriptorWrite.dstArrayElement = 0;
+        DescriptorWrite.descriptorType = m_bindings[Binding];
+        DescriptorWrite.descriptorCount = 1;
+        DescriptorWrite.pImageInfo = &ImageInfo;
+        vkUpdateDescriptorSets(GetVKDevice(), 1, &DescriptorWrite, 0, nullptr);
+    }
+
+    void ComputeKernel::Dispatch(VkCommandBuffer CommandBuffer, VkDescriptorSet DescriptorSet,
+                                 uint GroupCountX, uint GroupCountY, uint GroupCountZ,
+                                 const void *PushConstants) {
+        vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1,
+                                &DescriptorSet, 0, nullptr);
+        if (PushConstants) {
+            Check(m_pushConstantSize > 0);
+            vkCmdPushConstants(CommandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               m_pushConstantSize, PushConstants);
+        }
+        vkCmdDispatch(CommandBuffer, GroupCountX, GroupCountY, GroupCountZ);
+    }
+
+    void ComputeKernel::Barrier(VkCommandBuffer CommandBuffer) {
+        VkMemoryBarrier MemoryBarrier{};
+        MemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        MemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        MemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &MemoryBarrier, 0, nullptr,
+                             0, nullptr);
+    }
+
+    void ComputeKernel::ReadbackBarrier(VkCommandBuffer CommandBuffer, VkBuffer Buffer) {
+        VkBufferMemoryBarrier BufferBarrier{};
+        BufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        BufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        BufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        BufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        BufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        BufferBarrier.buffer = Buffer;
+        BufferBarrier.offset = 0;
+        BufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 1, &BufferBarrier, 0, nullptr);
+    }
+}  // namespace HWPT
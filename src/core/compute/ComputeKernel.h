@@ -0,0 +1,58 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#ifndef HARDWAREPATHTRACER_COMPUTEKERNEL_H
+#define HARDWAREPATHTRACER_COMPUTEKERNEL_H
+
+#include "core/Core.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace HWPT {
+    // One compute entry point with its own descriptor set layout (set 0, binding i = Bindings[i]),
+    // pipeline layout and a small descriptor pool. Used by the standalone GPU passes that are not
+    // part of the per-frame work in VulkanBackendApp
+    class ComputeKernel {
+    public:
+        ComputeKernel(const std::filesystem::path& ShaderPath, const std::string& Entry,
+                      const std::vector<VkDescriptorType>& Bindings, uint PushConstantSize = 0,
+                      uint MaxDescriptorSets = 4);
+
+        ~ComputeKernel();
+
+        auto AllocateDescriptorSet() -> VkDescriptorSet;
+
+        void UpdateBuffer(VkDescriptorSet DescriptorSet, uint Binding, VkBuffer Buffer,
+                          VkDeviceSize Size = VK_WHOLE_SIZE);
+
+        void UpdateImage(VkDescriptorSet DescriptorSet, uint Binding, VkImageView ImageView,
+                         VkImageLayout Layout, VkSampler Sampler = VK_NULL_HANDLE);
+
+        void Dispatch(VkCommandBuffer CommandBuffer, VkDescriptorSet DescriptorSet, uint GroupCountX,
+                      uint GroupCountY = 1, uint GroupCountZ = 1, const void* PushConstants = nullptr);
+
+        // Shader write to shader read/write dependency between two dispatches
+        static void Barrier(VkCommandBuffer CommandBuffer);
+
+        // Shader write to transfer read dependency on Buffer, before copying a dispatch's output to the host
+        static void ReadbackBarrier(VkCommandBuffer CommandBuffer, VkBuffer Buffer);
+
+        auto GetPipelineLayout() -> VkPipelineLayout {
+            return m_pipelineLayout;
+        }
+
+    private:
+        std::vector<VkDescriptorType> m_bindings;
+        uint m_pushConstantSize = 0;
+
+        VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline m_pipeline = VK_NULL_HANDLE;
+        VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_COMPUTEKERNEL_H
@@ -0,0 +1,373 @@
+//
+// Created by HUSTLX on 2024/10/26.
+//
+
+#include "GPUBVH.h"
+#include "core/accel/BVH.h"
+#include "core/sampling/PCGRandom.h"
+#include "core/application/VulkanBackendApp.h"
+#include <chrono>
+
+
+namespace HWPT {
+    static constexpr uint BuildGroupSize = 256;
+    static constexpr uint TraversalGroupSize = 64;
+    static constexpr uint NumBuildBindings = 13;
+    // Header slots, see GPUBVHBuild.hlsl
+    static constexpr uint HeaderRoot = 0;
+    static constexpr uint HeaderClusterCount = 1;
+    static constexpr uint HeaderTraversalOverflows = 4;
+    static constexpr uint HeaderSize = 5;
+    // TRAVERSAL_STACK_SIZE in BVHTraversal.hlsl, one entry per level below the root
+    static constexpr uint TraversalStackSize = 64;
+    // PLOC iterations recorded per submission before the cluster count is read back
+    static constexpr uint ClusterIterationsPerSubmit = 8;
+
+    static_assert(sizeof(GPUBVHNode) == 32, "GPUBVHNode has to match the HLSL layout");
+    static_assert(sizeof(Ray) == 32, "Ray is uploaded as GPURay");
+
+    struct GPURayHit {
+        float T;
+        uint PrimitiveID;
+        glm::vec2 Barycentrics;
+    };
+
+    GPUBVH::GPUBVH(const std::vector<glm::vec3> &Positions, const std::vector<uint> &Indices)
+            : m_numTriangles(static_cast<uint>(Indices.size() / 3)) {
+        if (m_numTriangles == 0) {
+            throw std::runtime_error("GPUBVH needs at least one triangle");
+        }
+        std::vector<glm::vec4> PaddedPositions(Positions.size());
+        for (size_t i = 0; i < Positions.size(); i++) {
+            PaddedPositions[i] = glm::vec4(Positions[i], 1.f);
+        }
+        for (uint Index: Indices) {
+            m_sceneBounds.Extend(Positions[Index]);
+        }
+
+        const uint NumNodes = 2 * m_numTriangles - 1;
+        const uint NumBlocks = (m_numTriangles + BuildGroupSize - 1) / BuildGroupSize;
+        m_positionBuffer = new StorageBuffer(sizeof(glm::vec4) * PaddedPositions.size(), PaddedPositions.data());
+        m_indexBuffer = new StorageBuffer(sizeof(uint) * 3 * m_numTriangles, const_cast<uint*>(Indices.data()));
+        m_nodeBuffer = new StorageBuffer(sizeof(GPUBVHNode) * NumNodes, nullptr);
+        m_parentBuffer = new StorageBuffer(sizeof(uint) * NumNodes, nullptr);
+        m_flagBuffer = new StorageBuffer(sizeof(uint) * NumNodes, nullptr);
+        m_headerBuffer = new StorageBuffer(sizeof(uint) * HeaderSize, nullptr);
+        for (auto& ClusterBuffer: m_clusterBuffers) {
+            ClusterBuffer = new StorageBuffer(sizeof(uint) * m_numTriangles, nullptr);
+        }
+        m_nearestBuffer = new StorageBuffer(sizeof(uint) * m_numTriangles, nullptr);
+        m_validBuffer = new StorageBuffer(sizeof(uint) * m_numTriangles, nullptr);
+        m_blockSumBuffer = new StorageBuffer(sizeof(uint) * NumBlocks, nullptr);
+        m_sorter = new GPURadixSort(m_numTriangles);
+
+        const char* EntryNames[NumBuildStages] = {
+                "LBVHMorton", "LBVHLeaves", "LBVHHierarchy", "LBVHRefit", "PLOCNearest", "PLOCMerge",
+                "PLOCCount", "PLOCScan", "PLOCScatter", "PLOCFinalize"
+        };
+        const std::vector<VkDescriptorType> Bindings(NumBuildBindings, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        for (uint Stage = 0; Stage < NumBuildStages; Stage++) {
+            auto& Build = m_buildKernels[Stage];
+            Build.Kernel = new ComputeKernel(std::string("../../shader/HLSL/") + EntryNames[Stage] + ".spv",
+                                             EntryNames[Stage], Bindings, sizeof(BuildConstants), 2);
+            for (int i = 0; i < 2; i++) {
+                Build.Sets[i] = Build.Kernel->AllocateDescriptorSet();
+                VkBuffer Buffers[NumBuildBindings] = {
+                        m_positionBuffer->GetHandle(), m_indexBuffer->GetHandle(),
+                        m_sorter->GetKeyBuffer()->GetHandle(), m_sorter->GetValueBuffer()->GetHandle(),
+                        m_nodeBuffer->GetHandle(), m_parentBuffer->GetHandle(), m_flagBuffer->GetHandle(),
+                        m_headerBuffer->GetHandle(), m_clusterBuffers[i]->GetHandle(),
+                        m_clusterBuffers[1 - i]->GetHandle(), m_nearestBuffer->GetHandle(),
+                        m_validBuffer->GetHandle(), m_blockSumBuffer->GetHandle()
+                };
+                for (uint Binding = 0; Binding < NumBuildBindings; Binding++) {
+                    Build.Kernel->UpdateBuffer(Build.Sets[i], Binding, Buffers[Binding]);
+                }
+            }
+        }
+
+        const std::vector<VkDescriptorType> TraversalBindings(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        m_traversalKernel = new ComputeKernel("../../shader/HLSL/TraceClosestHit.spv", "TraceClosestHit",
+                                              TraversalBindings, sizeof(TraversalConstants), 1);
+        m_traversalSet = m_traversalKernel->AllocateDescriptorSet();
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 0, m_nodeBuffer->GetHandle());
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 1, m_positionBuffer->GetHandle());
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 2, m_indexBuffer->GetHandle());
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 3, m_headerBuffer->GetHandle());
+
+        m_timer = new GPUTimer(16);
+    }
+
+    GPUBVH::~GPUBVH() {
+        for (auto& Build: m_buildKernels) {
+            delete Build.Kernel;
+        }
+        delete m_traversalKernel;
+        delete m_timer;
+        delete m_sorter;
+        delete m_positionBuffer;
+        delete m_indexBuffer;
+        delete m_nodeBuffer;
+        delete m_parentBuffer;
+        delete m_flagBuffer;
+        delete m_headerBuffer;
+        for (auto& ClusterBuffer: m_clusterBuffers) {
+            delete ClusterBuffer;
+        }
+        delete m_nearestBuffer;
+        delete m_validBuffer;
+        delete m_blockSumBuffer;
+        delete m_rayBuffer;
+        delete m_hitBuffer;
+    }
+
+    void GPUBVH::Dispatch(VkCommandBuffer CommandBuffer, BuildStage Stage, uint NumThreads,
+                          const BuildConstants &Constants) {
+        const uint NumGroups = (NumThreads + BuildGroupSize - 1) / BuildGroupSize;
+        m_buildKernels[Stage].Kernel->Dispatch(CommandBuffer, m_buildKernels[Stage].Sets[Constants.Parity],
+                                               std::max(NumGroups, 1u), 1, 1, &Constants);
+        ComputeKernel::Barrier(CommandBuffer);
+    }
+
+    auto GPUBVH::Build(GPUBVHBuildMode Mode, uint SearchRadius) -> const GPUBVHBuildTimings& {
+        m_timings = {};
+        BuildConstants Constants{};
+        Constants.SceneMin = m_sceneBounds.Min;
+        Constants.SceneInvExtent = 1.f / glm::max(m_sceneBounds.GetExtent(), glm::vec3(1e-12f));
+        Constants.NumLeaves = m_numTriangles;
+        Constants.SearchRadius = std::max(SearchRadius, 1u);
+
+        // Morton codes, sort and leaves, plus the whole hierarchy for LBVH
+        auto *App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        m_timer->Reset(CommandBuffer);
+        uint Start = m_timer->Write(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        Dispatch(CommandBuffer, Morton, m_numTriangles, Constants);
+        uint MortonEnd = m_timer->Write(CommandBuffer);
+        // 10 bits per axis
+        m_sorter->Record(CommandBuffer, m_numTriangles, 30);
+        uint SortEnd = m_timer->Write(CommandBuffer);
+        Dispatch(CommandBuffer, Leaves, m_numTriangles, Constants);
+        uint HierarchyEnd = SortEnd, RefitEnd = SortEnd;
+        if (Mode == GPUBVHBuildMode::LBVH) {
+            Dispatch(CommandBuffer, Hierarchy, m_numTriangles, Constants);
+            HierarchyEnd = m_timer->Write(CommandBuffer);
+            Dispatch(CommandBuffer, Refit, m_numTriangles, Constants);
+            RefitEnd = m_timer->Write(CommandBuffer);
+        }
+        else {
+            HierarchyEnd = m_timer->Write(CommandBuffer);
+        }
+        // The depth check and GetRoot read the tree back on the host
+        ComputeKernel::ReadbackBarrier(CommandBuffer, m_nodeBuffer->GetHandle());
+        ComputeKernel::ReadbackBarrier(CommandBuffer, m_headerBuffer->GetHandle());
+        App->EndIntermediateCommand(CommandBuffer);
+
+        m_timings.MortonMs = m_timer->GetElapsedMs(Start, MortonEnd);
+        m_timings.SortMs = m_timer->GetElapsedMs(MortonEnd, SortEnd);
+        m_timings.HierarchyMs = m_timer->GetElapsedMs(SortEnd, HierarchyEnd);
+        m_timings.RefitMs = m_timer->GetElapsedMs(HierarchyEnd, RefitEnd);
+
+        // PLOC needs the cluster count on the host to know when to stop, so the iterations are
+        // submitted in chunks. Every iteration halves the count or better in practice
+        if (Mode == GPUBVHBuildMode::PLOC) {
+            uint NumClusters = m_numTriangles;
+            Constants.Parity = 0;
+            while (NumClusters > 1) {
+                CommandBuffer = App->BeginIntermediateCommand();
+                m_timer->Reset(CommandBuffer);
+                uint ChunkStart = m_timer->Write(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                for (uint i = 0; i < ClusterIterationsPerSubmit; i++) {
+                    Dispatch(CommandBuffer, Nearest, NumClusters, Constants);
+                    Dispatch(CommandBuffer, Merge, NumClusters, Constants);
+                    Dispatch(CommandBuffer, Count, NumClusters, Constants);
+                    Dispatch(CommandBuffer, Scan, 1, Constants);
+                    Dispatch(CommandBuffer, Scatter, NumClusters, Constants);
+                    Constants.Parity = 1 - Constants.Parity;
+                }
+                Dispatch(CommandBuffer, Finalize, 1, Constants);
+                uint ChunkEnd = m_timer->Write(CommandBuffer);
+                // The host reads the cluster count, and the tree once the last chunk is done
+                ComputeKernel::ReadbackBarrier(CommandBuffer, m_nodeBuffer->GetHandle());
+                ComputeKernel::ReadbackBarrier(CommandBuffer, m_headerBuffer->GetHandle());
+                App->EndIntermediateCommand(CommandBuffer);
+                m_timings.ClusterMs += m_timer->GetElapsedMs(ChunkStart, ChunkEnd);
+                m_timings.ClusterIterations += ClusterIterationsPerSubmit;
+
+                uint Header[HeaderSize];
+                m_headerBuffer->Download(Header, sizeof(Header));
+                uint Remaining = Header[HeaderClusterCount + Constants.Parity];
+                if (Remaining >= NumClusters) {
+                    throw std::runtime_error("PLOC made no progress");
+                }
+                NumClusters = Remaining;
+            }
+        }
+        m_timings.TotalMs = m_timings.MortonMs + m_timings.SortMs + m_timings.HierarchyMs + m_timings.RefitMs +
+                            m_timings.ClusterMs;
+
+        // The traversal stack holds at most one entry per level, a deeper tree would make rays give up
+        m_timings.MaxDepth = ComputeMaxDepth();
+        if (m_timings.MaxDepth > TraversalStackSize) {
+            throw std::runtime_error("GPUBVH depth " + std::to_string(m_timings.MaxDepth) +
+                                     " exceeds TRAVERSAL_STACK_SIZE " + std::to_string(TraversalStackSize));
+        }
+        return m_timings;
+    }
+
+    void GPUBVH::ReserveRays(uint NumRays) {
+        if (NumRays <= m_maxRays) {
+            return;
+        }
+        delete m_rayBuffer;
+        delete m_hitBuffer;
+        m_maxRays = NumRays;
+        m_rayBuffer = new StorageBuffer(sizeof(Ray) * m_maxRays, nullptr);
+        m_hitBuffer = new StorageBuffer(sizeof(GPURayHit) * m_maxRays, nullptr);
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 4, m_rayBuffer->GetHandle());
+        m_traversalKernel->UpdateBuffer(m_traversalSet, 5, m_hitBuffer->GetHandle());
+    }
+
+    auto GPUBVH::Trace(const std::vector<Ray> &Rays, std::vector<RayHit> &Hits) -> double {
+        const auto NumRays = static_cast<uint>(Rays.size());
+        Hits.assign(NumRays, RayHit{});
+        if (NumRays == 0) {
+            return 0.;
+        }
+        ReserveRays(NumRays);
+        m_rayBuffer->Upload(Rays.data(), sizeof(Ray) * NumRays);
+
+        TraversalConstants Constants{};
+        Constants.NumRays = NumRays;
+        auto *App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        m_timer->Reset(CommandBuffer);
+        uint Start = m_timer->Write(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        m_traversalKernel->Dispatch(CommandBuffer, m_traversalSet, (NumRays + TraversalGroupSize - 1) /
+                                                                   TraversalGroupSize, 1, 1, &Constants);
+        uint End = m_timer->Write(CommandBuffer);
+        ComputeKernel::ReadbackBarrier(CommandBuffer, m_hitBuffer->GetHandle());
+        ComputeKernel::ReadbackBarrier(CommandBuffer, m_headerBuffer->GetHandle());
+        App->EndIntermediateCommand(CommandBuffer);
+        double TraceMs = m_timer->GetElapsedMs(Start, End);
+        if (uint Overflows = GetTraversalOverflows(); Overflows > 0) {
+            std::cerr << "GPUBVH: " << Overflows << " rays ran out of traversal stack\n";
+        }
+
+        std::vector<GPURayHit> GPUHits(NumRays);
+        m_hitBuffer->Download(GPUHits.data(), sizeof(GPURayHit) * NumRays);
+        for (uint i = 0; i < NumRays; i++) {
+            if (GPUHits[i].PrimitiveID != RayHit::InvalidID) {
+                Hits[i].T = GPUHits[i].T;
+                Hits[i].PrimitiveID = GPUHits[i].PrimitiveID;
+                Hits[i].Barycentrics = GPUHits[i].Barycentrics;
+            }
+        }
+        return TraceMs;
+    }
+
+    auto GPUBVH::DownloadNodes() -> std::vector<GPUBVHNode> {
+        std::vector<GPUBVHNode> Nodes(2 * m_numTriangles - 1);
+        m_nodeBuffer->Download(Nodes.data(), sizeof(GPUBVHNode) * Nodes.size());
+        return Nodes;
+    }
+
+    auto GPUBVH::GetRoot() -> uint {
+        uint Header[HeaderSize];
+        m_headerBuffer->Download(Header, sizeof(Header));
+        return Header[HeaderRoot];
+    }
+
+    auto GPUBVH::GetTraversalOverflows() -> uint {
+        uint Header[HeaderSize];
+        m_headerBuffer->Download(Header, sizeof(Header));
+        return Header[HeaderTraversalOverflows];
+    }
+
+    auto GPUBVH::ComputeMaxDepth() -> uint {
+        std::vector<GPUBVHNode> Nodes = DownloadNodes();
+        uint MaxDepth = 0;
+        std::vector<std::pair<uint, uint>> Stack = {{GetRoot(), 0}};
+        while (!Stack.empty()) {
+            auto [NodeIndex, Depth] = Stack.back();
+            Stack.pop_back();
+            const GPUBVHNode& Node = Nodes[NodeIndex];
+            if (Node.IsLeaf()) {
+                MaxDepth = std::max(MaxDepth, Depth);
+                continue;
+            }
+            Stack.emplace_back(Node.Left, Depth + 1);
+            Stack.emplace_back(Node.Right, Depth + 1);
+        }
+        return MaxDepth;
+    }
+
+    auto GPUBVH::ComputeSAHCost(float TraversalCost, float IntersectionCost) -> float {
+        std::vector<GPUBVHNode> Nodes = DownloadNodes();
+        const GPUBVHNode& Root = Nodes[GetRoot()];
+        float RootArea = AABB{Root.Min, Root.Max}.GetSurfaceArea();
+        if (RootArea <= 0.f) {
+            return 0.f;
+        }
+        float Cost = 0.f;
+        for (const auto& Node: Nodes) {
+            float Area = AABB{Node.Min, Node.Max}.GetSurfaceArea() / RootArea;
+            Cost += Area * (Node.IsLeaf() ? IntersectionCost : TraversalCost);
+        }
+        return Cost;
+    }
+
+    void GPUBVH::Benchmark(const std::vector<glm::vec3> &Positions, const std::vector<uint> &Indices,
+                           uint NumRays) {
+        BVH Reference;
+        Reference.Build(Positions, Indices);
+        AABB Bounds = Reference.GetBounds();
+        std::vector<Ray> Rays(NumRays);
+        PCGRandom Random(NumRays);
+        for (auto& TestRay: Rays) {
+            TestRay.Origin = Bounds.Min + glm::vec3(Random.NextFloat(), Random.NextFloat(), Random.NextFloat()) *
+                                          Bounds.GetExtent();
+            float Z = 1.f - 2.f * Random.NextFloat();
+            float Phi = 2.f * 3.14159265f * Random.NextFloat();
+            float R = std::sqrt(std::max(0.f, 1.f - Z * Z));
+            TestRay.Direction = glm::vec3(R * std::cos(Phi), R * std::sin(Phi), Z);
+        }
+        std::vector<RayHit> ReferenceHits(NumRays);
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        for (uint i = 0; i < NumRays; i++) {
+            Reference.Intersect(Rays[i], ReferenceHits[i]);
+        }
+        double CPUTraceMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        std::cout << "GPUBVH " << Indices.size() / 3 << " triangles, " << NumRays << " random rays\n";
+        std::cout << "Mode | Morton ms | Sort ms | Hierarchy ms | Refit ms | Cluster ms (iterations) | "
+                     "Build ms | Depth | SAH cost | Trace ms | Mismatches\n";
+        std::cout << "CPU SAH | - | - | - | - | - | " << Reference.GetStats().BuildTimeMs << " | "
+                  << Reference.GetStats().MaxDepth << " | " << Reference.GetStats().SAHCost << " | " << CPUTraceMs
+                  << " | -\n";
+
+        GPUBVH Tree(Positions, Indices);
+        for (auto Mode: {GPUBVHBuildMode::LBVH, GPUBVHBuildMode::PLOC}) {
+            const GPUBVHBuildTimings& Timings = Tree.Build(Mode);
+            std::vector<RayHit> Hits;
+            double TraceMs = Tree.Trace(Rays, Hits);
+            uint Mismatches = 0;
+            for (uint i = 0; i < NumRays; i++) {
+                bool Same = Hits[i].IsValid() == ReferenceHits[i].IsValid() &&
+                            (!Hits[i].IsValid() || std::abs(Hits[i].T - ReferenceHits[i].T) <=
+                                                   1e-4f * std::max(1.f, ReferenceHits[i].T));
+                Mismatches += Same ? 0 : 1;
+            }
+            std::cout << (Mode == GPUBVHBuildMode::LBVH ? "LBVH" : "PLOC") << " | " << Timings.MortonMs << " | "
+                      << Timings.SortMs << " | " << Timings.HierarchyMs << " | " << Timings.RefitMs << " | "
+                      << Timings.ClusterMs << " (" << Timings.ClusterIterations << ") | " << Timings.TotalMs
+                      << " | " << Timings.MaxDepth << " | " << Tree.ComputeSAHCost() << " | " << TraceMs << " | "
+                      << Mismatches << "\n";
+        }
+        if (!Tree.m_timer->IsSupported()) {
+            std::cout << "Timestamps are not supported on this queue, GPU times read 0\n";
+        }
+        std::cout.flush();
+    }
+}  // namespace HWPT
@@ -0,0 +1,162 @@
+//
+// Created by HUSTLX on 2024/10/26.
+//
+
+#ifndef HARDWAREPATHTRACER_GPUBVH_H
+#define HARDWAREPATHTRACER_GPUBVH_H
+
+#include "core/Core.h"
+#include "core/compute/ComputeKernel.h"
+#include "core/compute/GPURadixSort.h"
+#include "core/compute/GPUTimer.h"
+#include "core/buffer/StorageBuffer.h"
+#include "core/pathtracer/Ray.h"
+#include <vector>
+
+
+namespace HWPT {
+    enum class GPUBVHBuildMode : uint8_t {
+        LBVH,  // Karras hierarchy over the sorted Morton codes, then a bottom-up refit
+        PLOC   // Parallel locally-ordered clustering of the Morton ordered leaves, better trees
+    };
+
+    // Matches GPUBVHNode in shader/HLSL/GPUBVHCommon.hlsl. Nodes [0, NumTriangles) are the leaves
+    // in Morton order with the triangle in Left, internal nodes follow and store both children
+    struct GPUBVHNode {
+        glm::vec3 Min;
+        uint Left;
+        glm::vec3 Max;
+        uint Right;
+
+        static constexpr uint LeafMarker = ~0u;
+
+        [[nodiscard]] auto IsLeaf() const -> bool {
+            return Right == LeafMarker;
+        }
+    };
+
+    // GPU times from timestamp queries
+    struct GPUBVHBuildTimings {
+        double MortonMs = 0.;
+        double SortMs = 0.;
+        double HierarchyMs = 0.;
+        double RefitMs = 0.;
+        double ClusterMs = 0.;
+        double TotalMs = 0.;
+        uint ClusterIterations = 0;
+        uint MaxDepth = 0;  // Edges from the root to the deepest leaf
+    };
+
+    // Triangle BVH built and traversed entirely with compute shaders (GPUBVHBuild.hlsl and
+    // BVHTraversal.hlsl), for devices without hardware ray tracing
+    class GPUBVH {
+    public:
+        GPUBVH(const std::vector<glm::vec3>& Positions, const std::vector<uint>& Indices);
+
+        ~GPUBVH();
+
+        auto Build(GPUBVHBuildMode Mode = GPUBVHBuildMode::LBVH, uint SearchRadius = 16) -> const GPUBVHBuildTimings&;
+
+        // Closest hits of Rays in one blocking submission, returns the GPU time of the traversal
+        auto Trace(const std::vector<Ray>& Rays, std::vector<RayHit>& Hits) -> double;
+
+        auto DownloadNodes() -> std::vector<GPUBVHNode>;
+
+        auto GetRoot() -> uint;
+
+        // Same cost model as BVHStats::SAHCost with one triangle per leaf
+        auto ComputeSAHCost(float TraversalCost = 1.f, float IntersectionCost = 1.f) -> float;
+
+        auto ComputeMaxDepth() -> uint;
+
+        // Rays that ran out of traversal stack since the last Build, 0 unless the depth check is bypassed
+        auto GetTraversalOverflows() -> uint;
+
+        // Bindings 0-3 of shader/HLSL/BVHTraversal.hlsl, in that order
+        auto GetNodeBuffer() -> StorageBuffer* {
+            return m_nodeBuffer;
+        }
+
+        auto GetPositionBuffer() -> StorageBuffer* {
+            return m_positionBuffer;
+        }
+
+        auto GetIndexBuffer() -> StorageBuffer* {
+            return m_indexBuffer;
+        }
+
+        auto GetHeaderBuffer() -> StorageBuffer* {
+            return m_headerBuffer;
+        }
+
+        [[nodiscard]] auto GetNumTriangles() const -> uint {
+            return m_numTriangles;
+        }
+
+        [[nodiscard]] auto GetTimings() const -> const GPUBVHBuildTimings& {
+            return m_timings;
+        }
+
+        // Builds LBVH and PLOC over the geometry, reports timings and tree quality and checks the
+        // compute traversal against the CPU BVH
+        static void Benchmark(const std::vector<glm::vec3>& Positions, const std::vector<uint>& Indices,
+                              uint NumRays = 1u << 16);
+
+    private:
+        struct BuildConstants {
+            glm::vec3 SceneMin;
+            uint NumLeaves;
+            glm::vec3 SceneInvExtent;
+            uint Parity;
+            uint SearchRadius;
+            uint Padding[3];
+        };
+
+        struct TraversalConstants {
+            uint NumRays;
+            uint Padding[3];
+        };
+
+        struct BuildKernel {
+            ComputeKernel* Kernel = nullptr;
+            VkDescriptorSet Sets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+        };
+
+        enum BuildStage : uint {
+            Morton, Leaves, Hierarchy, Refit, Nearest, Merge, Count, Scan, Scatter, Finalize, NumBuildStages
+        };
+
+        void Dispatch(VkCommandBuffer CommandBuffer, BuildStage Stage, uint NumThreads, const BuildConstants& Constants);
+
+        void ReserveRays(uint NumRays);
+
+        uint m_numTriangles = 0;
+        AABB m_sceneBounds;
+
+        StorageBuffer* m_positionBuffer = nullptr;
+        StorageBuffer* m_indexBuffer = nullptr;
+        StorageBuffer* m_nodeBuffer = nullptr;
+        StorageBuffer* m_parentBuffer = nullptr;
+        StorageBuffer* m_flagBuffer = nullptr;
+        StorageBuffer* m_headerBuffer = nullptr;
+        StorageBuffer* m_clusterBuffers[2] = {nullptr, nullptr};
+        StorageBuffer* m_nearestBuffer = nullptr;
+        StorageBuffer* m_validBuffer = nullptr;
+        StorageBuffer* m_blockSumBuffer = nullptr;
+        GPURadixSort* m_sorter = nullptr;
+
+        // Set i reads the clusters from buffer i and compacts them into buffer 1 - i
+        BuildKernel m_buildKernels[NumBuildStages];
+
+        uint m_maxRays = 0;
+        StorageBuffer* m_rayBuffer = nullptr;
+        StorageBuffer* m_hitBuffer = nullptr;
+        ComputeKernel* m_traversalKernel = nullptr;
+        VkDescriptorSet m_traversalSet = VK_NULL_HANDLE;
+
+        GPUTimer* m_timer = nullptr;
+        GPUBVHBuildTimings m_timings;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_GPUBVH_H
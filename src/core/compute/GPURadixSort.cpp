@@ -0,0 +1,129 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#include "GPURadixSort.h"
+#include "core/pathtracer/RaySorter.h"
+#include "core/application/VulkanBackendApp.h"
+#include <chrono>
+#include <numeric>
+#include <random>
+
+
+namespace HWPT {
+
+    GPURadixSort::GPURadixSort(uint MaxKeys) : m_maxKeys(std::max(MaxKeys, 1u)) {
+        const uint MaxGroups = (m_maxKeys + GroupSize - 1) / GroupSize;
+        for (int i = 0; i < 2; i++) {
+            m_keyBuffers[i] = new StorageBuffer(sizeof(uint) * m_maxKeys, nullptr);
+            m_valueBuffers[i] = new StorageBuffer(sizeof(uint) * m_maxKeys, nullptr);
+        }
+        m_histogramBuffer = new StorageBuffer(sizeof(uint) * (1u << RadixBits) * MaxGroups, nullptr);
+
+        const std::vector<VkDescriptorType> Bindings(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        m_countKernel = new ComputeKernel("../../shader/HLSL/RadixCount.spv", "RadixCount", Bindings,
+                                          sizeof(Constants), 2);
+        m_scanKernel = new ComputeKernel("../../shader/HLSL/RadixScan.spv", "RadixScan", Bindings,
+                                         sizeof(Constants), 1);
+        m_scatterKernel = new ComputeKernel("../../shader/HLSL/RadixScatter.spv", "RadixScatter", Bindings,
+                                            sizeof(Constants), 2);
+
+        auto WriteBindings = [&](ComputeKernel* Kernel, VkDescriptorSet Set, int Src) {
+            Kernel->UpdateBuffer(Set, 0, m_keyBuffers[Src]->GetHandle());
+            Kernel->UpdateBuffer(Set, 1, m_valueBuffers[Src]->GetHandle());
+            Kernel->UpdateBuffer(Set, 2, m_keyBuffers[1 - Src]->GetHandle());
+            Kernel->UpdateBuffer(Set, 3, m_valueBuffers[1 - Src]->GetHandle());
+            Kernel->UpdateBuffer(Set, 4, m_histogramBuffer->GetHandle());
+        };
+        for (int i = 0; i < 2; i++) {
+            m_countSets[i] = m_countKernel->AllocateDescriptorSet();
+            WriteBindings(m_countKernel, m_countSets[i], i);
+            m_scatterSets[i] = m_scatterKernel->AllocateDescriptorSet();
+            WriteBindings(m_scatterKernel, m_scatterSets[i], i);
+        }
+        m_scanSet = m_scanKernel->AllocateDescriptorSet();
+        WriteBindings(m_scanKernel, m_scanSet, 0);
+    }
+
+    GPURadixSort::~GPURadixSort() {
+        delete m_countKernel;
+        delete m_scanKernel;
+        delete m_scatterKernel;
+        for (int i = 0; i < 2; i++) {
+            delete m_keyBuffers[i];
+            delete m_valueBuffers[i];
+        }
+        delete m_histogramBuffer;
+    }
+
+    void GPURadixSort::Record(VkCommandBuffer CommandBuffer, uint NumKeys, uint NumKeyBits) {
+        Check(NumKeys <= m_maxKeys);
+        if (NumKeys <= 1) {
+            return;
+        }
+        uint NumPasses = (std::min(NumKeyBits, 32u) + RadixBits - 1) / RadixBits;
+        NumPasses += NumPasses & 1u;
+
+        Constants PassConstants{};
+        PassConstants.NumKeys = NumKeys;
+        PassConstants.NumGroups = (NumKeys + GroupSize - 1) / GroupSize;
+        for (uint Pass = 0; Pass < NumPasses; Pass++) {
+            const uint Src = Pass & 1u;
+            PassConstants.Shift = Pass * RadixBits;
+            m_countKernel->Dispatch(CommandBuffer, m_countSets[Src], PassConstants.NumGroups, 1, 1,
+                                    &PassConstants);
+            ComputeKernel::Barrier(CommandBuffer);
+            m_scanKernel->Dispatch(CommandBuffer, m_scanSet, 1, 1, 1, &PassConstants);
+            ComputeKernel::Barrier(CommandBuffer);
+            m_scatterKernel->Dispatch(CommandBuffer, m_scatterSets[Src], PassConstants.NumGroups, 1, 1,
+                                      &PassConstants);
+            ComputeKernel::Barrier(CommandBuffer);
+        }
+    }
+
+    auto GPURadixSort::Sort(std::vector<uint> &Keys, std::vector<uint> &Values, uint NumKeyBits) -> double {
+        Check(Keys.size() == Values.size());
+        const auto NumKeys = static_cast<uint>(Keys.size());
+        if (NumKeys <= 1) {
+            return 0.;
+        }
+        m_keyBuffers[0]->Upload(Keys.data(), sizeof(uint) * NumKeys);
+        m_valueBuffers[0]->Upload(Values.data(), sizeof(uint) * NumKeys);
+
+        auto *App = VulkanBackendApp::GetApplication();
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        Record(CommandBuffer, NumKeys, NumKeyBits);
+        App->EndIntermediateCommand(CommandBuffer);
+        double ElapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        m_keyBuffers[0]->Download(Keys.data(), sizeof(uint) * NumKeys);
+        m_valueBuffers[0]->Download(Values.data(), sizeof(uint) * NumKeys);
+        return ElapsedMs;
+    }
+
+    void GPURadixSort::Benchmark(uint NumKeys) {
+        std::mt19937 RndEngine(NumKeys);
+        std::vector<uint> Keys(NumKeys), Values(NumKeys);
+        for (uint i = 0; i < NumKeys; i++) {
+            Keys[i] = RndEngine();
+            Values[i] = i;
+        }
+        std::vector<uint> CPUKeys = Keys, CPUValues = Values;
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        RaySorter::RadixSort(CPUKeys, CPUValues);
+        double CPUMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        GPURadixSort Sorter(NumKeys);
+        double GPUMs = Sorter.Sort(Keys, Values);
+
+        // Both sorts are stable, so the values have to match exactly
+        bool Matches = Keys == CPUKeys && Values == CPUValues;
+        std::cout << "GPURadixSort " << NumKeys << " pairs, GPU: " << GPUMs << " ms, CPU: " << CPUMs
+                  << " ms, results " << (Matches ? "match" : "DIFFER") << "\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
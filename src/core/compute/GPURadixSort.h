@@ -0,0 +1,69 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#ifndef HARDWAREPATHTRACER_GPURADIXSORT_H
+#define HARDWAREPATHTRACER_GPURADIXSORT_H
+
+#include "core/Core.h"
+#include "core/compute/ComputeKernel.h"
+#include "core/buffer/StorageBuffer.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Key/value radix sort with the kernels in shader/HLSL/RadixSort.hlsl. The number of passes is
+    // always even, so the sorted pairs end up back in GetKeyBuffer() / GetValueBuffer()
+    class GPURadixSort {
+    public:
+        static constexpr uint GroupSize = 256;
+        static constexpr uint RadixBits = 4;
+
+        explicit GPURadixSort(uint MaxKeys);
+
+        ~GPURadixSort();
+
+        // Records all passes into CommandBuffer, the keys and values have to be in the buffers already
+        void Record(VkCommandBuffer CommandBuffer, uint NumKeys, uint NumKeyBits = 32);
+
+        // Upload, sort and read back in one blocking submission, returns the wall time of the submission
+        auto Sort(std::vector<uint>& Keys, std::vector<uint>& Values, uint NumKeyBits = 32) -> double;
+
+        auto GetKeyBuffer() -> StorageBuffer* {
+            return m_keyBuffers[0];
+        }
+
+        auto GetValueBuffer() -> StorageBuffer* {
+            return m_valueBuffers[0];
+        }
+
+        // Sorts random keys on the GPU and with RaySorter::RadixSort, checks the results match and
+        // reports both timings
+        static void Benchmark(uint NumKeys = 1u << 20);
+
+    private:
+        struct Constants {
+            uint NumKeys;
+            uint Shift;
+            uint NumGroups;
+            uint Padding;
+        };
+
+        uint m_maxKeys = 0;
+
+        StorageBuffer* m_keyBuffers[2] = {nullptr, nullptr};
+        StorageBuffer* m_valueBuffers[2] = {nullptr, nullptr};
+        StorageBuffer* m_histogramBuffer = nullptr;
+
+        ComputeKernel* m_countKernel = nullptr;
+        ComputeKernel* m_scanKernel = nullptr;
+        ComputeKernel* m_scatterKernel = nullptr;
+
+        // Index i reads from buffers i and writes to buffers 1 - i
+        VkDescriptorSet m_countSets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+        VkDescriptorSet m_scanSet = VK_NULL_HANDLE;
+        VkDescriptorSet m_scatterSets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_GPURADIXSORT_H
@@ -0,0 +1,50 @@
+//
+// Created by HUSTLX on 2024/10/26.
+//
+
+#include "GPUTimer.h"
+
+
+namespace HWPT {
+
+    GPUTimer::GPUTimer(uint MaxQueries) : m_maxQueries(MaxQueries) {
+        VkPhysicalDeviceProperties Properties;
+        vkGetPhysicalDeviceProperties(GetVKPhysicalDevice(), &Properties);
+        m_supported = Properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        m_timestampPeriod = Properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo QueryPoolInfo{};
+        QueryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        QueryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        QueryPoolInfo.queryCount = m_maxQueries;
+        VK_CHECK(vkCreateQueryPool(GetVKDevice(), &QueryPoolInfo, nullptr, &m_queryPool));
+    }
+
+    GPUTimer::~GPUTimer() {
+        vkDestroyQueryPool(GetVKDevice(), m_queryPool, nullptr);
+    }
+
+    void GPUTimer::Reset(VkCommandBuffer CommandBuffer) {
+        vkCmdResetQueryPool(CommandBuffer, m_queryPool, 0, m_maxQueries);
+        m_numQueries = 0;
+    }
+
+    auto GPUTimer::Write(VkCommandBuffer CommandBuffer, VkPipelineStageFlagBits Stage) -> uint {
+        Check(m_numQueries < m_maxQueries);
+        vkCmdWriteTimestamp(CommandBuffer, Stage, m_queryPool, m_numQueries);
+        return m_numQueries++;
+    }
+
+    auto GPUTimer::GetElapsedMs(uint BeginQuery, uint EndQuery) -> double {
+        if (!m_supported) {
+            return 0.;
+        }
+        Check(BeginQuery < m_numQueries && EndQuery < m_numQueries);
+        uint64_t Timestamps[2];
+        VK_CHECK(vkGetQueryPoolResults(GetVKDevice(), m_queryPool, BeginQuery, 1, sizeof(uint64_t), &Timestamps[0],
+                                       sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+        VK_CHECK(vkGetQueryPoolResults(GetVKDevice(), m_queryPool, EndQuery, 1, sizeof(uint64_t), &Timestamps[1],
+                                       sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+        return static_cast<double>(Timestamps[1] - Timestamps[0]) * m_timestampPeriod * 1e-6;
+    }
+}  // namespace HWPT
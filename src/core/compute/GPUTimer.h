@@ -0,0 +1,41 @@
+//
+// Created by HUSTLX on 2024/10/26.
+//
+
+#ifndef HARDWAREPATHTRACER_GPUTIMER_H
+#define HARDWAREPATHTRACER_GPUTIMER_H
+
+#include "core/Core.h"
+
+
+namespace HWPT {
+    // Timestamp query pool, Write() returns the query index and GetElapsedMs() waits for both results.
+    // Timings are zero on devices without timestampComputeAndGraphics
+    class GPUTimer {
+    public:
+        explicit GPUTimer(uint MaxQueries = 64);
+
+        ~GPUTimer();
+
+        // Has to be recorded before the first Write() of a submission, outside of a render pass
+        void Reset(VkCommandBuffer CommandBuffer);
+
+        auto Write(VkCommandBuffer CommandBuffer,
+                   VkPipelineStageFlagBits Stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT) -> uint;
+
+        auto GetElapsedMs(uint BeginQuery, uint EndQuery) -> double;
+
+        [[nodiscard]] auto IsSupported() const -> bool {
+            return m_supported;
+        }
+
+    private:
+        VkQueryPool m_queryPool = VK_NULL_HANDLE;
+        uint m_maxQueries = 0;
+        uint m_numQueries = 0;
+        double m_timestampPeriod = 1.;
+        bool m_supported = false;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_GPUTIMER_H
@@ -0,0 +1,160 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#include "GPUVolume.h"
+#include "core/pathtracer/VolumeTracking.h"
+#include "core/sampling/PCGRandom.h"
+#include "core/application/VulkanBackendApp.h"
+#include <cmath>
+
+
+namespace HWPT {
+    static constexpr uint VolumeGroupSize = 64;
+    static constexpr uint VolumeLocalMajorantsFlag = 1u << 0;
+
+    static_assert(sizeof(GPUVolumeResult) == 16, "GPUVolumeResult has to match the HLSL layout");
+    static_assert(sizeof(Ray) == 32, "Ray is uploaded as GPURay");
+
+    GPUVolume::GPUVolume(const DensityGrid &Grid, const MajorantGrid &Majorants, float SigmaTScale) {
+        m_constants.Dims = Grid.GetDims();
+        m_constants.BrickDims = Grid.GetBrickDims();
+        m_constants.MajorantDims = Majorants.GetDims();
+        m_constants.CellSize = Majorants.GetCellSize();
+        m_constants.BoundsMin = Grid.GetBounds().Min;
+        m_constants.SigmaTScale = SigmaTScale;
+        m_constants.WorldToGrid = Grid.GetWorldToGrid();
+        m_constants.MaxDensity = Grid.GetMaxDensity();
+
+        // An empty grid still needs a bound brick buffer
+        std::vector<float> BrickData = Grid.GetBrickData();
+        if (BrickData.empty()) {
+            BrickData.assign(VolumeBrickVoxels, 0.f);
+        }
+        m_brickTableBuffer = new StorageBuffer(sizeof(uint) * Grid.GetBrickTable().size(),
+                                               const_cast<uint*>(Grid.GetBrickTable().data()));
+        m_brickDataBuffer = new StorageBuffer(sizeof(float) * BrickData.size(), BrickData.data());
+        m_majorantBuffer = new StorageBuffer(sizeof(float) * Majorants.GetMajorants().size(),
+                                             const_cast<float*>(Majorants.GetMajorants().data()));
+
+        const char* EntryNames[2] = {"VolumeRatioTracking", "VolumeDeltaTracking"};
+        const std::vector<VkDescriptorType> Bindings(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        for (int i = 0; i < 2; i++) {
+            m_kernels[i] = new ComputeKernel(std::string("../../shader/HLSL/") + EntryNames[i] + ".spv",
+                                             EntryNames[i], Bindings, sizeof(Constants), 1);
+            m_sets[i] = m_kernels[i]->AllocateDescriptorSet();
+            m_kernels[i]->UpdateBuffer(m_sets[i], 0, m_brickTableBuffer->GetHandle());
+            m_kernels[i]->UpdateBuffer(m_sets[i], 1, m_brickDataBuffer->GetHandle());
+            m_kernels[i]->UpdateBuffer(m_sets[i], 2, m_majorantBuffer->GetHandle());
+        }
+        m_timer = new GPUTimer(4);
+    }
+
+    GPUVolume::~GPUVolume() {
+        for (auto* Kernel: m_kernels) {
+            delete Kernel;
+        }
+        delete m_timer;
+        delete m_brickTableBuffer;
+        delete m_brickDataBuffer;
+        delete m_majorantBuffer;
+        delete m_rayBuffer;
+        delete m_resultBuffer;
+    }
+
+    void GPUVolume::ReserveRays(uint NumRays) {
+        if (NumRays <= m_maxRays) {
+            return;
+        }
+        delete m_rayBuffer;
+        delete m_resultBuffer;
+        m_maxRays = NumRays;
+        m_rayBuffer = new StorageBuffer(sizeof(Ray) * m_maxRays, nullptr);
+        m_resultBuffer = new StorageBuffer(sizeof(GPUVolumeResult) * m_maxRays, nullptr);
+        for (int i = 0; i < 2; i++) {
+            m_kernels[i]->UpdateBuffer(m_sets[i], 3, m_rayBuffer->GetHandle());
+            m_kernels[i]->UpdateBuffer(m_sets[i], 4, m_resultBuffer->GetHandle());
+        }
+    }
+
+    auto GPUVolume::Track(const std::vector<Ray> &Rays, std::vector<GPUVolumeResult> &Results,
+                          GPUVolumeEstimator Estimator, bool LocalMajorants, uint SamplesPerRay, uint Seed) -> double {
+        const auto NumRays = static_cast<uint>(Rays.size());
+        Results.assign(NumRays, GPUVolumeResult{});
+        if (NumRays == 0) {
+            return 0.;
+        }
+        ReserveRays(NumRays);
+        m_rayBuffer->Upload(Rays.data(), sizeof(Ray) * NumRays);
+
+        Constants PushConstants = m_constants;
+        PushConstants.NumRays = NumRays;
+        PushConstants.SamplesPerRay = std::max(SamplesPerRay, 1u);
+        PushConstants.Flags = LocalMajorants ? VolumeLocalMajorantsFlag : 0;
+        PushConstants.Seed = Seed;
+        auto Index = static_cast<uint>(Estimator);
+
+        auto *App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        m_timer->Reset(CommandBuffer);
+        uint Start = m_timer->Write(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        m_kernels[Index]->Dispatch(CommandBuffer, m_sets[Index], (NumRays + VolumeGroupSize - 1) / VolumeGroupSize,
+                                   1, 1, &PushConstants);
+        uint End = m_timer->Write(CommandBuffer);
+        // The readback copy is a later submission on the same queue, ordered behind this barrier
+        ComputeKernel::ReadbackBarrier(CommandBuffer, m_resultBuffer->GetHandle());
+        App->EndIntermediateCommand(CommandBuffer);
+        double TrackMs = m_timer->GetElapsedMs(Start, End);
+
+        m_resultBuffer->Download(Results.data(), sizeof(GPUVolumeResult) * NumRays);
+        return TrackMs;
+    }
+
+    void GPUVolume::Benchmark(uint Resolution, uint NumRays, uint SamplesPerRay, float SigmaTScale) {
+        DensityGrid Grid = DensityGrid::CreateCloud(Resolution);
+        MajorantGrid Majorants(Grid);
+        std::vector<Ray> Rays(NumRays);
+        PCGRandom Random(NumRays);
+        for (auto& TestRay: Rays) {
+            float Z = 1.f - 2.f * Random.NextFloat();
+            float Phi = 2.f * 3.14159265f * Random.NextFloat();
+            float R = std::sqrt(std::max(0.f, 1.f - Z * Z));
+            TestRay.Origin = 2.f * glm::vec3(R * std::cos(Phi), R * std::sin(Phi), Z);
+            glm::vec3 Target(Random.NextFloat() - .5f, Random.NextFloat() - .5f, Random.NextFloat() - .5f);
+            TestRay.Direction = glm::normalize(Target - TestRay.Origin);
+        }
+
+        // A subset of the rays is checked against CPU ray marching
+        const uint NumChecked = std::min(NumRays, 1024u);
+        VolumeTracker Reference(Grid, Majorants, SigmaTScale, true);
+        std::vector<float> Expected(NumChecked);
+        for (uint i = 0; i < NumChecked; i++) {
+            Expected[i] = Reference.RayMarchTransmittance(Rays[i]);
+        }
+
+        GPUVolume Volume(Grid, Majorants, SigmaTScale);
+        std::cout << "GPUVolume " << Resolution << "^3, " << Grid.GetNumBricks() << " bricks, " << NumRays
+                  << " rays x " << SamplesPerRay << " samples\n";
+        std::cout << "Majorant | Estimator | GPU ms | lookups/sample | segments/sample | mean |T - T_ref|\n";
+        for (bool Local: {false, true}) {
+            for (auto Estimator: {GPUVolumeEstimator::RatioTracking, GPUVolumeEstimator::DeltaTracking}) {
+                std::vector<GPUVolumeResult> Results;
+                double Ms = Volume.Track(Rays, Results, Estimator, Local, SamplesPerRay, 1);
+                double Lookups = 0., Segments = 0., Error = 0.;
+                for (uint i = 0; i < NumRays; i++) {
+                    Lookups += Results[i].DensityLookups;
+                    Segments += Results[i].MajorantSegments;
+                }
+                for (uint i = 0; i < NumChecked; i++) {
+                    Error += std::abs(Results[i].Transmittance - Expected[i]);
+                }
+                double NumSamples = static_cast<double>(NumRays) * SamplesPerRay;
+                std::cout << (Local ? "local" : "global") << " | "
+                          << (Estimator == GPUVolumeEstimator::RatioTracking ? "ratio" : "delta (escape)") << " | "
+                          << Ms << " | " << Lookups / NumSamples << " | " << Segments / NumSamples << " | "
+                          << Error / NumChecked << "\n";
+            }
+        }
+        std::cout.flush();
+    }
+}  // namespace HWPT
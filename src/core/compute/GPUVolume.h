@@ -0,0 +1,82 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#ifndef HARDWAREPATHTRACER_GPUVOLUME_H
+#define HARDWAREPATHTRACER_GPUVOLUME_H
+
+#include "core/Core.h"
+#include "core/buffer/StorageBuffer.h"
+#include "core/compute/ComputeKernel.h"
+#include "core/compute/GPUTimer.h"
+#include "core/pathtracer/VolumeGrid.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Matches VolumeResult in shader/HLSL/VolumeTracking.hlsl
+    struct GPUVolumeResult {
+        float Transmittance = 1.f;
+        float CollisionT = -1.f;
+        uint DensityLookups = 0;
+        uint MajorantSegments = 0;
+    };
+
+    enum class GPUVolumeEstimator : uint8_t {
+        RatioTracking,
+        DeltaTracking
+    };
+
+    // Brick table, brick data and majorant grid of a DensityGrid in storage buffers, with the tracking
+    // kernels of shader/HLSL/VolumeTracking.hlsl. Same estimators as VolumeTracker on the CPU
+    class GPUVolume {
+    public:
+        GPUVolume(const DensityGrid& Grid, const MajorantGrid& Majorants, float SigmaTScale = 1.f);
+
+        ~GPUVolume();
+
+        // One blocking submission over all rays, returns the GPU time of the dispatch
+        auto Track(const std::vector<Ray>& Rays, std::vector<GPUVolumeResult>& Results, GPUVolumeEstimator Estimator,
+                   bool LocalMajorants = true, uint SamplesPerRay = 1, uint Seed = 0) -> double;
+
+        // GPU times and lookups of both estimators with the global and the local majorants, and the mean
+        // difference to the ray-marched transmittance on the CPU
+        static void Benchmark(uint Resolution = 128, uint NumRays = 1u << 18, uint SamplesPerRay = 4,
+                              float SigmaTScale = 8.f);
+
+    private:
+        struct Constants {
+            glm::uvec3 Dims;
+            uint NumRays;
+            glm::uvec3 BrickDims;
+            uint SamplesPerRay;
+            glm::uvec3 MajorantDims;
+            uint CellSize;
+            glm::vec3 BoundsMin;
+            float SigmaTScale;
+            glm::vec3 WorldToGrid;
+            float MaxDensity;
+            uint Flags;
+            uint Seed;
+            uint Padding[2];
+        };
+
+        void ReserveRays(uint NumRays);
+
+        Constants m_constants{};
+
+        StorageBuffer* m_brickTableBuffer = nullptr;
+        StorageBuffer* m_brickDataBuffer = nullptr;
+        StorageBuffer* m_majorantBuffer = nullptr;
+        StorageBuffer* m_rayBuffer = nullptr;
+        StorageBuffer* m_resultBuffer = nullptr;
+        uint m_maxRays = 0;
+
+        // Indexed by GPUVolumeEstimator
+        ComputeKernel* m_kernels[2] = {nullptr, nullptr};
+        VkDescriptorSet m_sets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+        GPUTimer* m_timer = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_GPUVOLUME_H
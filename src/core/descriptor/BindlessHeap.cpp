@@ -0,0 +1,209 @@
+//
+// Created by HUSTLX on 2024/11/7.
+//
+
+#include "BindlessHeap.h"
+#include <algorithm>
+#include <array>
+#include <string>
+
+
+namespace HWPT {
+    auto GetBindlessTypeName(BindlessType Type) -> const char* {
+        switch (Type) {
+            case BindlessType::SampledImage:
+                return "SampledImage";
+            case BindlessType::StorageBuffer:
+                return "StorageBuffer";
+            case BindlessType::Sampler:
+                return "Sampler";
+            default:
+                return "Unknown";
+        }
+    }
+
+    BindlessHeap::BindlessHeap(VkDevice Device, VkPhysicalDevice PhysicalDevice, uint NumFramesInFlight,
+                               const BindlessHeapSettings &Settings)
+            : m_device(Device), m_numFramesInFlight(NumFramesInFlight) {
+        VkPhysicalDeviceDescriptorIndexingProperties IndexingProperties{};
+        IndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 Properties{};
+        Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        Properties.pNext = &IndexingProperties;
+        vkGetPhysicalDeviceProperties2(PhysicalDevice, &Properties);
+
+        auto& SampledImages = m_tables[static_cast<uint>(BindlessType::SampledImage)];
+        auto& StorageBuffers = m_tables[static_cast<uint>(BindlessType::StorageBuffer)];
+        auto& Samplers = m_tables[static_cast<uint>(BindlessType::Sampler)];
+        SampledImages.Capacity = std::min({Settings.MaxSampledImages,
+                                           IndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                           IndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages});
+        StorageBuffers.Capacity = std::min({Settings.MaxStorageBuffers,
+                                            IndexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                            IndexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        Samplers.Capacity = std::min({Settings.MaxSamplers,
+                                      IndexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                                      IndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+        constexpr uint NumBindings = static_cast<uint>(BindlessType::Count);
+        const std::array<VkDescriptorType, NumBindings> DescriptorTypes = {
+                VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_DESCRIPTOR_TYPE_SAMPLER
+        };
+        std::array<VkDescriptorSetLayoutBinding, NumBindings> Bindings{};
+        std::array<VkDescriptorBindingFlags, NumBindings> BindingFlags{};
+        std::array<VkDescriptorPoolSize, NumBindings> PoolSizes{};
+        for (uint Binding = 0; Binding < NumBindings; Binding++) {
+            Bindings[Binding].binding = Binding;
+            Bindings[Binding].descriptorType = DescriptorTypes[Binding];
+            Bindings[Binding].descriptorCount = m_tables[Binding].Capacity;
+            Bindings[Binding].stageFlags = VK_SHADER_STAGE_ALL;
+            // Unused entries may hold stale or no descriptors, and entries no command buffer in flight uses
+            // can be rewritten while the set is bound
+            BindingFlags[Binding] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                    VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+            PoolSizes[Binding].type = DescriptorTypes[Binding];
+            PoolSizes[Binding].descriptorCount = m_tables[Binding].Capacity;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo BindingFlagsInfo{};
+        BindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        BindingFlagsInfo.bindingCount = NumBindings;
+        BindingFlagsInfo.pBindingFlags = BindingFlags.data();
+        VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+        LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        LayoutInfo.pNext = &BindingFlagsInfo;
+        LayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        LayoutInfo.bindingCount = NumBindings;
+        LayoutInfo.pBindings = Bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_device, &LayoutInfo, nullptr, &m_layout));
+
+        VkDescriptorPoolCreateInfo PoolInfo{};
+        PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        PoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        PoolInfo.poolSizeCount = NumBindings;
+        PoolInfo.pPoolSizes = PoolSizes.data();
+        PoolInfo.maxSets = 1;
+        VK_CHECK(vkCreateDescriptorPool(m_device, &PoolInfo, nullptr, &m_pool));
+
+        VkDescriptorSetAllocateInfo AllocateInfo{};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        AllocateInfo.descriptorPool = m_pool;
+        AllocateInfo.descriptorSetCount = 1;
+        AllocateInfo.pSetLayouts = &m_layout;
+        VK_CHECK(vkAllocateDescriptorSets(m_device, &AllocateInfo, &m_set));
+    }
+
+    BindlessHeap::~BindlessHeap() {
+        vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+    }
+
+    void BindlessHeap::BeginFrame() {
+        m_frame++;
+        for (auto& Current: m_tables) {
+            auto It = std::remove_if(Current.Retired.begin(), Current.Retired.end(),
+                                     [&](const std::pair<uint, uint64_t>& Entry) {
+                                         if (Entry.second + m_numFramesInFlight > m_frame) {
+                                             return false;
+                                         }
+                                         Current.FreeList.push_back(Entry.first);
+                                         return true;
+                                     });
+            Current.Retired.erase(It, Current.Retired.end());
+        }
+    }
+
+    auto BindlessHeap::AllocateIndex(BindlessType Type) -> uint {
+        Table& Current = m_tables[static_cast<uint>(Type)];
+        uint Index;
+        if (!Current.FreeList.empty()) {
+            Index = Current.FreeList.back();
+            Current.FreeList.pop_back();
+        } else if (Current.Next < Current.Capacity) {
+            Index = Current.Next++;
+        } else {
+            throw std::runtime_error(std::string("BindlessHeap: out of ") + GetBindlessTypeName(Type) + " slots");
+        }
+        Current.Live++;
+        return Index;
+    }
+
+    auto BindlessHeap::RegisterSampledImage(VkImageView View, VkImageLayout Layout) -> uint {
+        uint Index = AllocateIndex(BindlessType::SampledImage);
+        VkDescriptorImageInfo ImageInfo{};
+        ImageInfo.imageView = View;
+        ImageInfo.imageLayout = Layout;
+        VkWriteDescriptorSet Write{};
+        Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet = m_set;
+        Write.dstBinding = static_cast<uint>(BindlessType::SampledImage);
+        Write.dstArrayElement = Index;
+        Write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        Write.descriptorCount = 1;
+        Write.pImageInfo = &ImageInfo;
+        vkUpdateDescriptorSets(m_device, 1, &Write, 0, nullptr);
+        return Index;
+    }
+
+    auto BindlessHeap::RegisterStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range) -> uint {
+        uint Index = AllocateIndex(BindlessType::StorageBuffer);
+        VkDescriptorBufferInfo BufferInfo{};
+        BufferInfo.buffer = Buffer;
+        BufferInfo.offset = Offset;
+        BufferInfo.range = Range;
+        VkWriteDescriptorSet Write{};
+        Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet = m_set;
+        Write.dstBinding = static_cast<uint>(BindlessType::StorageBuffer);
+        Write.dstArrayElement = Index;
+        Write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        Write.descriptorCount = 1;
+        Write.pBufferInfo = &BufferInfo;
+        vkUpdateDescriptorSets(m_device, 1, &Write, 0, nullptr);
+        return Index;
+    }
+
+    auto BindlessHeap::RegisterSampler(VkSampler Sampler) -> uint {
+        uint Index = AllocateIndex(BindlessType::Sampler);
+        VkDescriptorImageInfo ImageInfo{};
+        ImageInfo.sampler = Sampler;
+        VkWriteDescriptorSet Write{};
+        Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        Write.dstSet = m_set;
+        Write.dstBinding = static_cast<uint>(BindlessType::Sampler);
+        Write.dstArrayElement = Index;
+        Write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        Write.descriptorCount = 1;
+        Write.pImageInfo = &ImageInfo;
+        vkUpdateDescriptorSets(m_device, 1, &Write, 0, nullptr);
+        return Index;
+    }
+
+    void BindlessHeap::Release(BindlessType Type, uint Index) {
+        if (Index == InvalidBindlessIndex) {
+            return;
+        }
+        Table& Current = m_tables[static_cast<uint>(Type)];
+        Check(Index < Current.Next && Current.Live > 0);
+        Current.Live--;
+        Current.Retired.emplace_back(Index, m_frame);
+    }
+
+    void BindlessHeap::Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint,
+                            VkPipelineLayout Layout) const {
+        vkCmdBindDescriptorSets(CommandBuffer, BindPoint, Layout, SetIndex, 1, &m_set, 0, nullptr);
+    }
+
+    auto BindlessHeap::GetStats() const -> BindlessHeapStats {
+        BindlessHeapStats Stats;
+        for (uint Type = 0; Type < static_cast<uint>(BindlessType::Count); Type++) {
+            Stats.Live[Type] = m_tables[Type].Live;
+            Stats.Capacity[Type] = m_tables[Type].Capacity;
+            Stats.Retired[Type] = static_cast<uint>(m_tables[Type].Retired.size());
+        }
+        return Stats;
+    }
+}  // namespace HWPT
@@ -0,0 +1,101 @@
+//
+// Created by HUSTLX on 2024/11/7.
+//
+
+#ifndef HARDWAREPATHTRACER_BINDLESSHEAP_H
+#define HARDWAREPATHTRACER_BINDLESSHEAP_H
+
+#include "core/Core.h"
+#include <vector>
+
+
+namespace HWPT {
+    constexpr uint InvalidBindlessIndex = ~0u;
+
+    // Also the binding of each array in the heap's set layout
+    enum class BindlessType : uint8_t {
+        SampledImage,
+        StorageBuffer,
+        Sampler,
+        Count
+    };
+
+    auto GetBindlessTypeName(BindlessType Type) -> const char*;
+
+    struct BindlessHeapSettings {
+        // Clamped to the device's update after bind limits
+        uint MaxSampledImages = 16384;
+        uint MaxStorageBuffers = 4096;
+        uint MaxSamplers = 128;
+    };
+
+    struct BindlessHeapStats {
+        uint Live[static_cast<uint>(BindlessType::Count)] = {};
+        uint Capacity[static_cast<uint>(BindlessType::Count)] = {};
+        uint Retired[static_cast<uint>(BindlessType::Count)] = {};  // Released, waiting for in flight frames
+    };
+
+    // One descriptor set of large update after bind, partially bound arrays of sampled images, storage buffers
+    // and samplers, built on descriptor indexing (core in Vulkan 1.2). Resources register once and keep their
+    // array index for their lifetime, shaders index the arrays with it, so the frame binds this set once no
+    // matter how many textures the scene has. Released indices are recycled through a free list after
+    // NumFramesInFlight calls to BeginFrame, command buffers still in flight may index them until then.
+    // Owned by VulkanBackendApp, bound as set BindlessHeap::SetIndex of the pipelines that use it
+    class BindlessHeap {
+    public:
+        // Reserved across the shaders, their own resources live in set 0, Sampling.hlsl in set 2 and
+        // EnvironmentSampling.hlsl in set 3
+        static constexpr uint SetIndex = 1;
+
+        BindlessHeap(VkDevice Device, VkPhysicalDevice PhysicalDevice, uint NumFramesInFlight,
+                     const BindlessHeapSettings& Settings = {});
+
+        ~BindlessHeap();
+
+        // Recycles the indices released NumFramesInFlight frames ago
+        void BeginFrame();
+
+        auto RegisterSampledImage(VkImageView View,
+                                  VkImageLayout Layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL) -> uint;
+
+        auto RegisterStorageBuffer(VkBuffer Buffer, VkDeviceSize Offset = 0,
+                                   VkDeviceSize Range = VK_WHOLE_SIZE) -> uint;
+
+        auto RegisterSampler(VkSampler Sampler) -> uint;
+
+        void Release(BindlessType Type, uint Index);
+
+        void Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout Layout) const;
+
+        [[nodiscard]] auto GetLayout() const -> VkDescriptorSetLayout {
+            return m_layout;
+        }
+
+        [[nodiscard]] auto GetSet() const -> VkDescriptorSet {
+            return m_set;
+        }
+
+        [[nodiscard]] auto GetStats() const -> BindlessHeapStats;
+
+    private:
+        struct Table {
+            uint Capacity = 0;
+            uint Next = 0;  // Indices below Next have been handed out at least once
+            std::vector<uint> FreeList;
+            std::vector<std::pair<uint, uint64_t>> Retired;  // Index and the frame it was released in
+            uint Live = 0;
+        };
+
+        auto AllocateIndex(BindlessType Type) -> uint;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        uint m_numFramesInFlight = 0;
+        VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+        VkDescriptorPool m_pool = VK_NULL_HANDLE;
+        VkDescriptorSet m_set = VK_NULL_HANDLE;
+        Table m_tables[static_cast<uint>(BindlessType::Count)];
+        uint64_t m_frame = 0;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_BINDLESSHEAP_H
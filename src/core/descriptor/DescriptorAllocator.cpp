@@ -0,0 +1,93 @@
+//
+// Created by HUSTLX on 2024/11/8.
+//
+
+#include "DescriptorAllocator.h"
+#include <algorithm>
+
+
+namespace HWPT {
+
+    DescriptorAllocator::DescriptorAllocator(VkDevice Device, const DescriptorAllocatorSettings &Settings)
+            : m_device(Device), m_settings(Settings), m_nextSetsPerPool(Settings.SetsPerPool) {}
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        if (m_currentPool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(m_device, m_currentPool, nullptr);
+        }
+        for (VkDescriptorPool Pool: m_fullPools) {
+            vkDestroyDescriptorPool(m_device, Pool, nullptr);
+        }
+        for (VkDescriptorPool Pool: m_freePools) {
+            vkDestroyDescriptorPool(m_device, Pool, nullptr);
+        }
+    }
+
+    auto DescriptorAllocator::GrabPool() -> VkDescriptorPool {
+        if (!m_freePools.empty()) {
+            VkDescriptorPool Pool = m_freePools.back();
+            m_freePools.pop_back();
+            return Pool;
+        }
+
+        uint NumSets = m_nextSetsPerPool;
+        m_nextSetsPerPool = std::min(static_cast<uint>(static_cast<float>(NumSets) * m_settings.GrowthFactor),
+                                     m_settings.MaxSetsPerPool);
+        std::vector<VkDescriptorPoolSize> PoolSizes;
+        PoolSizes.reserve(m_settings.Ratios.size());
+        for (const auto& Ratio: m_settings.Ratios) {
+            uint Count = static_cast<uint>(Ratio.PerSet * static_cast<float>(NumSets));
+            PoolSizes.push_back({Ratio.Type, std::max(1u, Count)});
+        }
+
+        VkDescriptorPoolCreateInfo PoolInfo{};
+        PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        PoolInfo.maxSets = NumSets;
+        PoolInfo.poolSizeCount = static_cast<uint>(PoolSizes.size());
+        PoolInfo.pPoolSizes = PoolSizes.data();
+        VkDescriptorPool Pool;
+        VK_CHECK(vkCreateDescriptorPool(m_device, &PoolInfo, nullptr, &Pool));
+        m_stats.NumPools++;
+        return Pool;
+    }
+
+    auto DescriptorAllocator::Allocate(VkDescriptorSetLayout Layout) -> VkDescriptorSet {
+        if (m_currentPool == VK_NULL_HANDLE) {
+            m_currentPool = GrabPool();
+        }
+
+        VkDescriptorSetAllocateInfo AllocateInfo{};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        AllocateInfo.descriptorPool = m_currentPool;
+        AllocateInfo.descriptorSetCount = 1;
+        AllocateInfo.pSetLayouts = &Layout;
+
+        VkDescriptorSet Set;
+        VkResult Result = vkAllocateDescriptorSets(m_device, &AllocateInfo, &Set);
+        if (Result == VK_ERROR_OUT_OF_POOL_MEMORY || Result == VK_ERROR_FRAGMENTED_POOL) {
+            m_fullPools.push_back(m_currentPool);
+            m_currentPool = GrabPool();
+            AllocateInfo.descriptorPool = m_currentPool;
+            m_stats.NumPoolOverflows++;
+            // A fresh pool failing means the layout needs more of a type than the ratios give a whole pool
+            Result = vkAllocateDescriptorSets(m_device, &AllocateInfo, &Set);
+        }
+        VK_CHECK(Result);
+        m_stats.NumSets++;
+        return Set;
+    }
+
+    void DescriptorAllocator::Reset() {
+        if (m_currentPool != VK_NULL_HANDLE) {
+            m_fullPools.push_back(m_currentPool);
+            m_currentPool = VK_NULL_HANDLE;
+        }
+        for (VkDescriptorPool Pool: m_fullPools) {
+            VK_CHECK(vkResetDescriptorPool(m_device, Pool, 0));
+            m_freePools.push_back(Pool);
+        }
+        m_fullPools.clear();
+        m_stats.NumSets = 0;
+    }
+
+}  // namespace HWPT
@@ -0,0 +1,72 @@
+//
+// Created by HUSTLX on 2024/11/8.
+//
+
+#ifndef HARDWAREPATHTRACER_DESCRIPTORALLOCATOR_H
+#define HARDWAREPATHTRACER_DESCRIPTORALLOCATOR_H
+
+#include "core/Core.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Descriptors per set for each type in a new pool, a pool holds SetsPerPool sets worth of them
+    struct DescriptorPoolRatio {
+        VkDescriptorType Type;
+        float PerSet;
+    };
+
+    struct DescriptorAllocatorSettings {
+        std::vector<DescriptorPoolRatio> Ratios = {
+                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.f},
+                {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+                {VK_DESCRIPTOR_TYPE_SAMPLER, .5f},
+                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f},
+                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f}
+        };
+        uint SetsPerPool = 64;  // Of the first pool, every new pool grows by GrowthFactor up to MaxSetsPerPool
+        float GrowthFactor = 1.5f;
+        uint MaxSetsPerPool = 4096;
+    };
+
+    struct DescriptorAllocatorStats {
+        uint NumPools = 0;
+        uint NumSets = 0;  // Allocated since the last Reset
+        uint NumPoolOverflows = 0;  // Allocations that found the current pool full and moved on to another
+    };
+
+    // Allocates descriptor sets from a chain of pools. A full pool is set aside and the allocation retried from
+    // a recycled or new, larger pool, so running out is never fatal. Reset returns every set at once, which
+    // makes a per frame instance the home of transient sets: reset it after BeginFramePacing has waited for the
+    // frame timeline value
+    class DescriptorAllocator {
+    public:
+        explicit DescriptorAllocator(VkDevice Device, const DescriptorAllocatorSettings& Settings = {});
+
+        ~DescriptorAllocator();
+
+        auto Allocate(VkDescriptorSetLayout Layout) -> VkDescriptorSet;
+
+        // Frees every set allocated so far, none may still be in use by the GPU
+        void Reset();
+
+        [[nodiscard]] auto GetStats() const -> const DescriptorAllocatorStats& {
+            return m_stats;
+        }
+
+    private:
+        auto GrabPool() -> VkDescriptorPool;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        DescriptorAllocatorSettings m_settings;
+        uint m_nextSetsPerPool = 0;
+        VkDescriptorPool m_currentPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> m_fullPools;
+        std::vector<VkDescriptorPool> m_freePools;  // Reset and ready for reuse
+        DescriptorAllocatorStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_DESCRIPTORALLOCATOR_H
@@ -0,0 +1,191 @@
+//
+// Created by HUSTLX on 2024/11/8.
+//
+
+#include "DescriptorCache.h"
+#include <algorithm>
+#include <functional>
+
+
+namespace HWPT {
+    static void HashCombine(uint64_t& Seed, uint64_t Value) {
+        Seed ^= Value + 0x9e3779b97f4a7c15ull + (Seed << 6u) + (Seed >> 2u);
+    }
+
+    template<typename T>
+    static auto HashHandle(T Handle) -> uint64_t {
+        return std::hash<T>{}(Handle);
+    }
+
+    auto DescriptorWrite::BufferWrite(uint Binding, VkDescriptorType Type, VkBuffer Buffer, VkDeviceSize Offset,
+                                      VkDeviceSize Range) -> DescriptorWrite {
+        DescriptorWrite Write;
+        Write.Binding = Binding;
+        Write.Type = Type;
+        Write.Buffer = Buffer;
+        Write.Offset = Offset;
+        Write.Range = Range;
+        return Write;
+    }
+
+    auto DescriptorWrite::ImageWrite(uint Binding, VkDescriptorType Type, VkImageView View, VkSampler Sampler,
+                                     VkImageLayout Layout) -> DescriptorWrite {
+        DescriptorWrite Write;
+        Write.Binding = Binding;
+        Write.Type = Type;
+        Write.View = View;
+        Write.Sampler = Sampler;
+        Write.Layout = Layout;
+        return Write;
+    }
+
+    auto DescriptorWrite::operator==(const DescriptorWrite &Other) const -> bool {
+        return Binding == Other.Binding && Type == Other.Type && Buffer == Other.Buffer && Offset == Other.Offset &&
+               Range == Other.Range && View == Other.View && Sampler == Other.Sampler && Layout == Other.Layout;
+    }
+
+    static auto HashBindings(const std::vector<DescriptorBinding>& Bindings) -> uint64_t {
+        uint64_t Hash = Bindings.size();
+        for (const auto& Binding: Bindings) {
+            HashCombine(Hash, Binding.Binding);
+            HashCombine(Hash, Binding.Type);
+            HashCombine(Hash, Binding.Count);
+            HashCombine(Hash, Binding.Stages);
+        }
+        return Hash;
+    }
+
+    static auto HashWrites(VkDescriptorSetLayout Layout, const std::vector<DescriptorWrite>& Writes) -> uint64_t {
+        uint64_t Hash = HashHandle(Layout);
+        for (const auto& Write: Writes) {
+            HashCombine(Hash, Write.Binding);
+            HashCombine(Hash, Write.Type);
+            HashCombine(Hash, HashHandle(Write.Buffer));
+            HashCombine(Hash, Write.Offset);
+            HashCombine(Hash, Write.Range);
+            HashCombine(Hash, HashHandle(Write.View));
+            HashCombine(Hash, HashHandle(Write.Sampler));
+            HashCombine(Hash, Write.Layout);
+        }
+        return Hash;
+    }
+
+    DescriptorCache::DescriptorCache(VkDevice Device) : m_device(Device), m_setAllocator(Device) {}
+
+    DescriptorCache::~DescriptorCache() {
+        for (auto& [Hash, Entry]: m_layouts) {
+            vkDestroyDescriptorSetLayout(m_device, Entry.Layout, nullptr);
+        }
+    }
+
+    auto DescriptorCache::GetLayout(const std::vector<DescriptorBinding> &Bindings) -> VkDescriptorSetLayout {
+        uint64_t Hash = HashBindings(Bindings);
+        auto [Begin, End] = m_layouts.equal_range(Hash);
+        for (auto It = Begin; It != End; ++It) {
+            if (It->second.Bindings == Bindings) {
+                m_layoutHits++;
+                return It->second.Layout;
+            }
+        }
+        m_layoutMisses++;
+
+        std::vector<VkDescriptorSetLayoutBinding> LayoutBindings(Bindings.size());
+        for (size_t i = 0; i < Bindings.size(); i++) {
+            LayoutBindings[i].binding = Bindings[i].Binding;
+            LayoutBindings[i].descriptorType = Bindings[i].Type;
+            LayoutBindings[i].descriptorCount = Bindings[i].Count;
+            LayoutBindings[i].stageFlags = Bindings[i].Stages;
+            LayoutBindings[i].pImmutableSamplers = nullptr;
+        }
+
+        VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+        LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        LayoutInfo.bindingCount = static_cast<uint>(LayoutBindings.size());
+        LayoutInfo.pBindings = LayoutBindings.data();
+        VkDescriptorSetLayout Layout;
+        VK_CHECK(vkCreateDescriptorSetLayout(m_device, &LayoutInfo, nullptr, &Layout));
+        m_layouts.emplace(Hash, LayoutEntry{Bindings, Layout});
+        return Layout;
+    }
+
+    auto DescriptorCache::GetSet(VkDescriptorSetLayout Layout,
+                                 const std::vector<DescriptorWrite> &Writes) -> VkDescriptorSet {
+        uint64_t Hash = HashWrites(Layout, Writes);
+        auto [Begin, End] = m_sets.equal_range(Hash);
+        for (auto It = Begin; It != End; ++It) {
+            if (It->second.Layout == Layout && It->second.Writes == Writes) {
+                m_setHits++;
+                return It->second.Set;
+            }
+        }
+        m_setMisses++;
+
+        VkDescriptorSet Set = m_setAllocator.Allocate(Layout);
+        // Reserved up front so the pointers stored in the writes stay valid
+        std::vector<VkDescriptorBufferInfo> BufferInfos;
+        std::vector<VkDescriptorImageInfo> ImageInfos;
+        BufferInfos.reserve(Writes.size());
+        ImageInfos.reserve(Writes.size());
+        std::vector<VkWriteDescriptorSet> DescriptorWrites(Writes.size());
+        for (size_t i = 0; i < Writes.size(); i++) {
+            const DescriptorWrite& Write = Writes[i];
+            DescriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            DescriptorWrites[i].dstSet = Set;
+            DescriptorWrites[i].dstBinding = Write.Binding;
+            DescriptorWrites[i].dstArrayElement = 0;
+            DescriptorWrites[i].descriptorType = Write.Type;
+            DescriptorWrites[i].descriptorCount = 1;
+            if (Write.Buffer != VK_NULL_HANDLE) {
+                BufferInfos.push_back({Write.Buffer, Write.Offset, Write.Range});
+                DescriptorWrites[i].pBufferInfo = &BufferInfos.back();
+            } else {
+                ImageInfos.push_back({Write.Sampler, Write.View, Write.Layout});
+                DescriptorWrites[i].pImageInfo = &ImageInfos.back();
+            }
+        }
+        vkUpdateDescriptorSets(m_device, static_cast<uint>(DescriptorWrites.size()), DescriptorWrites.data(),
+                               0, nullptr);
+        m_sets.emplace(Hash, SetEntry{Layout, Writes, Set});
+        return Set;
+    }
+
+    void DescriptorCache::ClearSets() {
+        m_sets.clear();
+        m_setAllocator.Reset();
+    }
+
+    template<typename Predicate>
+    void DescriptorCache::EvictIf(Predicate&& Matches) {
+        for (auto It = m_sets.begin(); It != m_sets.end();) {
+            const auto& Writes = It->second.Writes;
+            if (std::any_of(Writes.begin(), Writes.end(), Matches)) {
+                It = m_sets.erase(It);
+            } else {
+                ++It;
+            }
+        }
+    }
+
+    void DescriptorCache::EvictBuffer(VkBuffer Buffer) {
+        EvictIf([Buffer](const DescriptorWrite& Write) { return Write.Buffer == Buffer; });
+    }
+
+    void DescriptorCache::EvictImageView(VkImageView View) {
+        EvictIf([View](const DescriptorWrite& Write) { return Write.View == View; });
+    }
+
+    void DescriptorCache::EvictSampler(VkSampler Sampler) {
+        EvictIf([Sampler](const DescriptorWrite& Write) { return Write.Sampler == Sampler; });
+    }
+
+    auto DescriptorCache::GetStats() const -> DescriptorCacheStats {
+        DescriptorCacheStats Stats;
+        Stats.NumLayouts = static_cast<uint>(m_layouts.size());
+        Stats.NumSets = static_cast<uint>(m_sets.size());
+        Stats.LayoutHits = m_layoutHits;
+        Stats.LayoutMisses = m_layoutMisses;
+        Stats.SetHits = m_setHits;
+        Stats.SetMisses = m_setMisses;
+        return Stats;
+    }
+}  // namespace HWPT
@@ -0,0 +1,114 @@
+//
+// Created by HUSTLX on 2024/11/8.
+//
+
+#ifndef HARDWAREPATHTRACER_DESCRIPTORCACHE_H
+#define HARDWAREPATHTRACER_DESCRIPTORCACHE_H
+
+#include "core/Core.h"
+#include "DescriptorAllocator.h"
+#include <unordered_map>
+#include <vector>
+
+
+namespace HWPT {
+    struct DescriptorBinding {
+        uint Binding = 0;
+        VkDescriptorType Type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uint Count = 1;
+        VkShaderStageFlags Stages = 0;
+
+        auto operator==(const DescriptorBinding& Other) const -> bool {
+            return Binding == Other.Binding && Type == Other.Type && Count == Other.Count && Stages == Other.Stages;
+        }
+    };
+
+    // One descriptor of an immutable set, a buffer range or an image view and sampler
+    struct DescriptorWrite {
+        uint Binding = 0;
+        VkDescriptorType Type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkDeviceSize Offset = 0;
+        VkDeviceSize Range = VK_WHOLE_SIZE;
+        VkImageView View = VK_NULL_HANDLE;
+        VkSampler Sampler = VK_NULL_HANDLE;
+        VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        static auto BufferWrite(uint Binding, VkDescriptorType Type, VkBuffer Buffer, VkDeviceSize Offset = 0,
+                                VkDeviceSize Range = VK_WHOLE_SIZE) -> DescriptorWrite;
+
+        static auto ImageWrite(uint Binding, VkDescriptorType Type, VkImageView View, VkSampler Sampler,
+                               VkImageLayout Layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL) -> DescriptorWrite;
+
+        auto operator==(const DescriptorWrite& Other) const -> bool;
+    };
+
+    struct DescriptorCacheStats {
+        uint NumLayouts = 0;
+        uint NumSets = 0;
+        uint LayoutHits = 0;
+        uint LayoutMisses = 0;
+        uint SetHits = 0;
+        uint SetMisses = 0;
+    };
+
+    // Creates descriptor set layouts and immutable descriptor sets once and hands out the same handle for every
+    // identical request afterwards. Layouts are keyed by a hash of their bindings, sets by their layout and
+    // writes, both compared in full on a hash match. Sets come from a growable DescriptorAllocator of their own
+    // and live until ClearSets, layouts until the cache is destroyed. Sets written every frame don't belong
+    // here, allocate them from a per frame DescriptorAllocator instead
+    class DescriptorCache {
+    public:
+        explicit DescriptorCache(VkDevice Device);
+
+        ~DescriptorCache();
+
+        auto GetLayout(const std::vector<DescriptorBinding>& Bindings) -> VkDescriptorSetLayout;
+
+        auto GetSet(VkDescriptorSetLayout Layout, const std::vector<DescriptorWrite>& Writes) -> VkDescriptorSet;
+
+        // Frees every cached set, none may still be in use by the GPU
+        void ClearSets();
+
+        // Drop the cached sets that reference a handle about to be destroyed, otherwise a new object that
+        // gets the same handle would hit them. Called from the destructors of the wrappers, the sets stay
+        // allocated until ClearSets since frames in flight may still bind them
+        void EvictBuffer(VkBuffer Buffer);
+
+        void EvictImageView(VkImageView View);
+
+        void EvictSampler(VkSampler Sampler);
+
+        [[nodiscard]] auto GetStats() const -> DescriptorCacheStats;
+
+        [[nodiscard]] auto GetAllocatorStats() const -> const DescriptorAllocatorStats& {
+            return m_setAllocator.GetStats();
+        }
+
+    private:
+        struct LayoutEntry {
+            std::vector<DescriptorBinding> Bindings;
+            VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+        };
+
+        struct SetEntry {
+            VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+            std::vector<DescriptorWrite> Writes;
+            VkDescriptorSet Set = VK_NULL_HANDLE;
+        };
+
+        template<typename Predicate>
+        void EvictIf(Predicate&& Matches);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        DescriptorAllocator m_setAllocator;
+        std::unordered_multimap<uint64_t, LayoutEntry> m_layouts;
+        std::unordered_multimap<uint64_t, SetEntry> m_sets;
+        uint m_layoutHits = 0;
+        uint m_layoutMisses = 0;
+        uint m_setHits = 0;
+        uint m_setMisses = 0;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_DESCRIPTORCACHE_H
@@ -0,0 +1,448 @@
+//
+// Created by HUSTLX on 2024/10/31.
+//
+
+#include "DeviceMemoryAllocator.h"
+#include "core/application/VulkanBackendApp.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+
+
+namespace HWPT {
+    static auto IsPowerOfTwo(VkDeviceSize Value) -> bool {
+        return Value != 0 && (Value & (Value - 1)) == 0;
+    }
+
+    static auto Log2(VkDeviceSize Value) -> uint {
+        uint Result = 0;
+        while (Value > 1) {
+            Value >>= 1u;
+            Result++;
+        }
+        return Result;
+    }
+
+    auto GetMemoryCategoryName(MemoryCategory Category) -> const char* {
+        switch (Category) {
+            case MemoryCategory::Buffer:
+                return "Buffer";
+            case MemoryCategory::Texture:
+                return "Texture";
+            case MemoryCategory::RenderTarget:
+                return "RenderTarget";
+            case MemoryCategory::Staging:
+                return "Staging";
+            default:
+                return "Unknown";
+        }
+    }
+
+    BuddyBlock::BuddyBlock(VkDeviceSize Size, VkDeviceSize MinNodeSize) : m_size(Size), m_freeBytes(Size) {
+        if (!IsPowerOfTwo(Size) || !IsPowerOfTwo(MinNodeSize) || MinNodeSize > Size) {
+            throw std::runtime_error("BuddyBlock sizes have to be powers of two");
+        }
+        m_maxLevel = Log2(Size / MinNodeSize);
+        const size_t NumNodes = (size_t(2) << m_maxLevel) - 1;
+        m_states.assign(NumNodes, NodeUnused);
+        m_freeSlots.assign(NumNodes, 0);
+        m_freeLists.resize(m_maxLevel + 1);
+        m_states[0] = NodeFree;
+        PushFree(0, 0);
+    }
+
+    auto BuddyBlock::GetLevel(uint Node) -> uint {
+        return Log2(static_cast<VkDeviceSize>(Node) + 1);
+    }
+
+    void BuddyBlock::PushFree(uint Node, uint Level) {
+        m_freeSlots[Node] = static_cast<uint>(m_freeLists[Level].size());
+        m_freeLists[Level].push_back(Node);
+    }
+
+    void BuddyBlock::RemoveFree(uint Node, uint Level) {
+        auto& List = m_freeLists[Level];
+        uint Slot = m_freeSlots[Node];
+        List[Slot] = List.back();
+        m_freeSlots[List[Slot]] = Slot;
+        List.pop_back();
+    }
+
+    auto BuddyBlock::Allocate(VkDeviceSize Size, VkDeviceSize Alignment, VkDeviceSize &Offset, uint &Node) -> bool {
+        VkDeviceSize NodeSize = m_size >> m_maxLevel;
+        VkDeviceSize Needed = std::max(std::max(Size, Alignment), static_cast<VkDeviceSize>(1));
+        uint Level = m_maxLevel;
+        while (NodeSize < Needed) {
+            if (Level == 0) {
+                return false;
+            }
+            NodeSize <<= 1u;
+            Level--;
+        }
+
+        // Smallest free node at or above the wanted level, split down to it
+        int SourceLevel = static_cast<int>(Level);
+        while (SourceLevel >= 0 && m_freeLists[SourceLevel].empty()) {
+            SourceLevel--;
+        }
+        if (SourceLevel < 0) {
+            return false;
+        }
+        uint Current = m_freeLists[SourceLevel].back();
+        RemoveFree(Current, SourceLevel);
+        for (auto CurrentLevel = static_cast<uint>(SourceLevel); CurrentLevel < Level; CurrentLevel++) {
+            m_states[Current] = NodeSplit;
+            uint Right = 2 * Current + 2;
+            m_states[Right] = NodeFree;
+            PushFree(Right, CurrentLevel + 1);
+            Current = 2 * Current + 1;
+        }
+        m_states[Current] = NodeAllocated;
+        m_freeBytes -= NodeSize;
+
+        Node = Current;
+        Offset = (static_cast<VkDeviceSize>(Current) + 1 - (VkDeviceSize(1) << Level)) * NodeSize;
+        return true;
+    }
+
+    void BuddyBlock::Free(uint Node) {
+        Check(m_states[Node] == NodeAllocated);
+        uint Level = GetLevel(Node);
+        m_freeBytes += m_size >> Level;
+        // Merge with free buddies towards the root
+        while (Level > 0) {
+            uint Buddy = (Node & 1u) ? Node + 1 : Node - 1;
+            if (m_states[Buddy] != NodeFree) {
+                break;
+            }
+            RemoveFree(Buddy, Level);
+            m_states[Buddy] = NodeUnused;
+            m_states[Node] = NodeUnused;
+            Node = (Node - 1) / 2;
+            Level--;
+        }
+        m_states[Node] = NodeFree;
+        PushFree(Node, Level);
+    }
+
+    auto BuddyBlock::GetLargestFreeNode() const -> VkDeviceSize {
+        for (uint Level = 0; Level <= m_maxLevel; Level++) {
+            if (!m_freeLists[Level].empty()) {
+                return m_size >> Level;
+            }
+        }
+        return 0;
+    }
+
+    DeviceMemoryAllocator::DeviceMemoryAllocator(VkDevice Device, VkPhysicalDevice PhysicalDevice,
+                                                 const DeviceMemoryAllocatorSettings &Settings)
+            : m_device(Device), m_settings(Settings) {
+        if (!IsPowerOfTwo(m_settings.BlockSize) || !IsPowerOfTwo(m_settings.MinAllocationSize)) {
+            throw std::runtime_error("DeviceMemoryAllocator block and allocation sizes have to be powers of two");
+        }
+        vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &m_memoryProperties);
+        m_pools.resize(2 * m_memoryProperties.memoryTypeCount);
+        for (uint Type = 0; Type < m_memoryProperties.memoryTypeCount; Type++) {
+            VkDeviceSize HeapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[Type].heapIndex].size;
+            VkDeviceSize BlockSize = m_settings.BlockSize;
+            while (BlockSize > m_settings.MinAllocationSize && BlockSize > HeapSize / 8) {
+                BlockSize >>= 1u;
+            }
+            m_pools[2 * Type].BlockSize = BlockSize;
+            m_pools[2 * Type + 1].BlockSize = BlockSize;
+        }
+    }
+
+    DeviceMemoryAllocator::~DeviceMemoryAllocator() {
+        if (m_numAllocations != 0 || m_numDedicated != 0) {
+            std::cerr << "DeviceMemoryAllocator destroyed with " << m_numAllocations + m_numDedicated
+                      << " live allocations\n";
+        }
+        for (uint PoolIndex = 0; PoolIndex < m_pools.size(); PoolIndex++) {
+            for (auto& MemoryBlock: m_pools[PoolIndex].Blocks) {
+                if (MemoryBlock.Memory != VK_NULL_HANDLE) {
+                    FreeDeviceMemory(MemoryBlock.Memory, MemoryBlock.MappedData, PoolIndex / 2,
+                                     m_pools[PoolIndex].BlockSize);
+                }
+                delete MemoryBlock.Buddy;
+            }
+        }
+    }
+
+    auto DeviceMemoryAllocator::FindMemoryType(uint TypeFilter, VkMemoryPropertyFlags Properties) const -> uint {
+        for (uint i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((TypeFilter & (1u << i)) &&
+                (m_memoryProperties.memoryTypes[i].propertyFlags & Properties) == Properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("No memory type with the requested properties");
+    }
+
+    auto DeviceMemoryAllocator::AllocateDeviceMemory(VkDeviceSize Size, uint MemoryType, VkDeviceMemory &Memory,
+                                                     void *&MappedData, const void* Next) -> bool {
+        VkMemoryAllocateInfo AllocateInfo{};
+        AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        AllocateInfo.pNext = Next;
+        AllocateInfo.allocationSize = Size;
+        AllocateInfo.memoryTypeIndex = MemoryType;
+        if (vkAllocateMemory(m_device, &AllocateInfo, nullptr, &Memory) != VK_SUCCESS) {
+            return false;
+        }
+        m_totalDeviceAllocations++;
+        m_heapBytes[m_memoryProperties.memoryTypes[MemoryType].heapIndex] += Size;
+        MappedData = nullptr;
+        if (m_memoryProperties.memoryTypes[MemoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            VK_CHECK(vkMapMemory(m_device, Memory, 0, VK_WHOLE_SIZE, 0, &MappedData));
+        }
+        return true;
+    }
+
+    void DeviceMemoryAllocator::FreeDeviceMemory(VkDeviceMemory Memory, void *MappedData, uint MemoryType,
+                                                 VkDeviceSize Size) {
+        m_heapBytes[m_memoryProperties.memoryTypes[MemoryType].heapIndex] -= Size;
+        if (MappedData != nullptr) {
+            vkUnmapMemory(m_device, Memory);
+        }
+        vkFreeMemory(m_device, Memory, nullptr);
+    }
+
+    auto DeviceMemoryAllocator::Allocate(const VkMemoryRequirements &Requirements, VkMemoryPropertyFlags Properties,
+                                         MemoryResourceKind Kind, MemoryCategory Category,
+                                         const MemoryDedication& Dedication) -> MemoryAllocation* {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        const uint MemoryType = FindMemoryType(Requirements.memoryTypeBits, Properties);
+        const uint PoolIndex = 2 * MemoryType + (Kind == MemoryResourceKind::Optimal ? 1 : 0);
+        Pool& MemoryPool = m_pools[PoolIndex];
+
+        auto* Allocation = new MemoryAllocation();
+        Allocation->Size = Requirements.size;
+        Allocation->MemoryType = MemoryType;
+        Allocation->m_pool = PoolIndex;
+        Allocation->m_category = Category;
+
+        VkDeviceSize Needed = std::max(Requirements.size, Requirements.alignment);
+        if (Dedication.Requires || Dedication.Prefers || Needed > m_settings.DedicatedThreshold ||
+            Needed > MemoryPool.BlockSize) {
+            VkMemoryDedicatedAllocateInfo DedicatedInfo{};
+            DedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+            DedicatedInfo.buffer = Dedication.Buffer;
+            DedicatedInfo.image = Dedication.Image;
+            const bool HasResource = Dedication.Buffer != VK_NULL_HANDLE || Dedication.Image != VK_NULL_HANDLE;
+            void* MappedData = nullptr;
+            if (!AllocateDeviceMemory(Requirements.size, MemoryType, Allocation->Memory, MappedData,
+                                      HasResource ? &DedicatedInfo : nullptr)) {
+                delete Allocation;
+                throw std::runtime_error("Failed to allocate dedicated device memory");
+            }
+            Allocation->MappedData = MappedData;
+            Allocation->m_dedicated = true;
+            m_numDedicated++;
+            m_dedicatedBytes += Requirements.size;
+            m_categoryBytes[static_cast<size_t>(Category)] += Requirements.size;
+            m_categoryAllocations[static_cast<size_t>(Category)]++;
+            return Allocation;
+        }
+
+        // First fit over the existing blocks, reusing the slot of a released block before growing
+        VkDeviceSize Offset = 0;
+        uint Node = 0;
+        int BlockIndex = -1;
+        for (uint i = 0; i < MemoryPool.Blocks.size(); i++) {
+            Block& Candidate = MemoryPool.Blocks[i];
+            if (Candidate.Memory != VK_NULL_HANDLE &&
+                Candidate.Buddy->Allocate(Requirements.size, Requirements.alignment, Offset, Node)) {
+                BlockIndex = static_cast<int>(i);
+                break;
+            }
+        }
+        if (BlockIndex < 0) {
+            Block NewBlock;
+            if (!AllocateDeviceMemory(MemoryPool.BlockSize, MemoryType, NewBlock.Memory, NewBlock.MappedData)) {
+                delete Allocation;
+                throw std::runtime_error("Failed to allocate a device memory block");
+            }
+            NewBlock.Buddy = new BuddyBlock(MemoryPool.BlockSize,
+                                            std::min(m_settings.MinAllocationSize, MemoryPool.BlockSize));
+            NewBlock.Buddy->Allocate(Requirements.size, Requirements.alignment, Offset, Node);
+            for (uint i = 0; i < MemoryPool.Blocks.size() && BlockIndex < 0; i++) {
+                if (MemoryPool.Blocks[i].Memory == VK_NULL_HANDLE) {
+                    BlockIndex = static_cast<int>(i);
+                }
+            }
+            if (BlockIndex < 0) {
+                BlockIndex = static_cast<int>(MemoryPool.Blocks.size());
+                MemoryPool.Blocks.emplace_back();
+            }
+            MemoryPool.Blocks[BlockIndex] = NewBlock;
+        }
+
+        Block& Target = MemoryPool.Blocks[BlockIndex];
+        Target.NumAllocations++;
+        Allocation->Memory = Target.Memory;
+        Allocation->Offset = Offset;
+        Allocation->MappedData = Target.MappedData ? static_cast<char*>(Target.MappedData) + Offset : nullptr;
+        Allocation->m_block = static_cast<uint>(BlockIndex);
+        Allocation->m_node = Node;
+        m_numAllocations++;
+        m_usedBytes += Requirements.size;
+        m_nodeBytes += Target.Buddy->GetNodeSize(Node);
+        m_categoryBytes[static_cast<size_t>(Category)] += Requirements.size;
+        m_categoryAllocations[static_cast<size_t>(Category)]++;
+        return Allocation;
+    }
+
+    void DeviceMemoryAllocator::Free(MemoryAllocation *Allocation) {
+        if (Allocation == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_categoryBytes[static_cast<size_t>(Allocation->m_category)] -= Allocation->Size;
+        m_categoryAllocations[static_cast<size_t>(Allocation->m_category)]--;
+        if (Allocation->m_dedicated) {
+            FreeDeviceMemory(Allocation->Memory, Allocation->MappedData, Allocation->MemoryType, Allocation->Size);
+            m_numDedicated--;
+            m_dedicatedBytes -= Allocation->Size;
+            delete Allocation;
+            return;
+        }
+
+        Pool& MemoryPool = m_pools[Allocation->m_pool];
+        Block& Source = MemoryPool.Blocks[Allocation->m_block];
+        m_nodeBytes -= Source.Buddy->GetNodeSize(Allocation->m_node);
+        m_usedBytes -= Allocation->Size;
+        m_numAllocations--;
+        Source.Buddy->Free(Allocation->m_node);
+        Source.NumAllocations--;
+
+        // Keep one empty block per pool around so alternating allocate / free does not hit the driver
+        if (Source.NumAllocations == 0) {
+            for (uint i = 0; i < MemoryPool.Blocks.size(); i++) {
+                const Block& Other = MemoryPool.Blocks[i];
+                if (i != Allocation->m_block && Other.Memory != VK_NULL_HANDLE && Other.NumAllocations == 0) {
+                    FreeDeviceMemory(Source.Memory, Source.MappedData, Allocation->MemoryType, MemoryPool.BlockSize);
+                    delete Source.Buddy;
+                    Source = Block();
+                    break;
+                }
+            }
+        }
+        delete Allocation;
+    }
+
+    auto DeviceMemoryAllocator::ReleaseEmptyBlocks(uint Heap) -> VkDeviceSize {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        VkDeviceSize Released = 0;
+        for (uint PoolIndex = 0; PoolIndex < m_pools.size(); PoolIndex++) {
+            const uint MemoryType = PoolIndex / 2;
+            if (m_memoryProperties.memoryTypes[MemoryType].heapIndex != Heap) {
+                continue;
+            }
+            Pool& MemoryPool = m_pools[PoolIndex];
+            for (auto& MemoryBlock: MemoryPool.Blocks) {
+                if (MemoryBlock.Memory != VK_NULL_HANDLE && MemoryBlock.NumAllocations == 0) {
+                    FreeDeviceMemory(MemoryBlock.Memory, MemoryBlock.MappedData, MemoryType, MemoryPool.BlockSize);
+                    delete MemoryBlock.Buddy;
+                    MemoryBlock = Block();
+                    Released += MemoryPool.BlockSize;
+                }
+            }
+        }
+        return Released;
+    }
+
+    auto DeviceMemoryAllocator::GetStats() -> DeviceMemoryStats {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        DeviceMemoryStats Stats;
+        for (const auto& MemoryPool: m_pools) {
+            for (const auto& MemoryBlock: MemoryPool.Blocks) {
+                if (MemoryBlock.Memory == VK_NULL_HANDLE) {
+                    continue;
+                }
+                Stats.NumBlocks++;
+                Stats.BlockBytes += MemoryBlock.Buddy->GetSize();
+                Stats.LargestFreeNode = std::max(Stats.LargestFreeNode, MemoryBlock.Buddy->GetLargestFreeNode());
+            }
+        }
+        Stats.NumDedicated = m_numDedicated;
+        Stats.NumAllocations = m_numAllocations;
+        Stats.UsedBytes = m_usedBytes;
+        Stats.NodeBytes = m_nodeBytes;
+        Stats.DedicatedBytes = m_dedicatedBytes;
+        Stats.TotalDeviceAllocations = m_totalDeviceAllocations;
+        for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); i++) {
+            Stats.CategoryBytes[i] = m_categoryBytes[i];
+            Stats.CategoryAllocations[i] = m_categoryAllocations[i];
+        }
+        return Stats;
+    }
+
+    void DeviceMemoryAllocator::Benchmark(uint NumCycles, uint MaxLive) {
+        VkDevice Device = GetVKDevice();
+        DeviceMemoryAllocator Allocator(Device, GetVKPhysicalDevice());
+        const uint MemoryType = Allocator.FindMemoryType(~0u, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // Log-uniform sizes between 256 B and 4 MB, the mix of uniform, vertex and texture allocations
+        auto RandomRequirements = [&](PCGRandom& Random) {
+            VkMemoryRequirements Requirements{};
+            Requirements.size = static_cast<VkDeviceSize>(256.f * std::exp2(14.f * Random.NextFloat()));
+            Requirements.alignment = 256;
+            Requirements.memoryTypeBits = 1u << MemoryType;
+            return Requirements;
+        };
+
+        std::vector<MemoryAllocation*> Live(MaxLive, nullptr);
+        PCGRandom Random(NumCycles);
+        DeviceMemoryStats PeakStats;
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        for (uint Cycle = 0; Cycle < NumCycles; Cycle++) {
+            uint Slot = Random.NextUInt() % MaxLive;
+            Allocator.Free(Live[Slot]);
+            Live[Slot] = Allocator.Allocate(RandomRequirements(Random), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                            MemoryResourceKind::Linear, MemoryCategory::Buffer);
+            if (Cycle == NumCycles - 1) {
+                PeakStats = Allocator.GetStats();
+            }
+        }
+        for (auto*& Allocation: Live) {
+            Allocator.Free(Allocation);
+            Allocation = nullptr;
+        }
+        double SubAllocateMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        // maxMemoryAllocationCount is often 4096, so the per resource path keeps fewer allocations alive
+        const uint DirectLive = std::min(MaxLive, 256u);
+        std::vector<VkDeviceMemory> DirectMemory(DirectLive, VK_NULL_HANDLE);
+        Random = PCGRandom(NumCycles);
+        StartTime = std::chrono::high_resolution_clock::now();
+        for (uint Cycle = 0; Cycle < NumCycles; Cycle++) {
+            uint Slot = Random.NextUInt() % DirectLive;
+            if (DirectMemory[Slot] != VK_NULL_HANDLE) {
+                vkFreeMemory(Device, DirectMemory[Slot], nullptr);
+            }
+            VkMemoryAllocateInfo AllocateInfo{};
+            AllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            AllocateInfo.allocationSize = RandomRequirements(Random).size;
+            AllocateInfo.memoryTypeIndex = MemoryType;
+            VK_CHECK(vkAllocateMemory(Device, &AllocateInfo, nullptr, &DirectMemory[Slot]));
+        }
+        for (auto Memory: DirectMemory) {
+            if (Memory != VK_NULL_HANDLE) {
+                vkFreeMemory(Device, Memory, nullptr);
+            }
+        }
+        double DirectMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        std::cout << "DeviceMemoryAllocator " << NumCycles << " allocate/free cycles, 256 B - 4 MB\n";
+        std::cout << "Path | live | ms | ns/cycle | vkAllocateMemory calls\n";
+        std::cout << "Buddy sub-allocation | " << MaxLive << " | " << SubAllocateMs << " | "
+                  << SubAllocateMs * 1e6 / NumCycles << " | " << PeakStats.TotalDeviceAllocations << "\n";
+        std::cout << "vkAllocateMemory per resource | " << DirectLive << " | " << DirectMs << " | "
+                  << DirectMs * 1e6 / NumCycles << " | " << NumCycles << "\n";
+        std::cout << "End state: " << PeakStats.NumBlocks << " blocks (" << (PeakStats.BlockBytes >> 20)
+                  << " MB), " << PeakStats.NumAllocations << " allocations, " << (PeakStats.UsedBytes >> 20)
+                  << " MB used in " << (PeakStats.NodeBytes >> 20) << " MB of buddy nodes\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
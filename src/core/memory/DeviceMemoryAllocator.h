@@ -0,0 +1,209 @@
+//
+// Created by HUSTLX on 2024/10/31.
+//
+
+#ifndef HARDWAREPATHTRACER_DEVICEMEMORYALLOCATOR_H
+#define HARDWAREPATHTRACER_DEVICEMEMORYALLOCATOR_H
+
+#include "core/Core.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+namespace HWPT {
+    // Buffers and linear images never share a block with optimal tiling images, which keeps every
+    // neighbour pair apart by bufferImageGranularity without checking it per allocation
+    enum class MemoryResourceKind : uint8_t {
+        Linear,
+        Optimal
+    };
+
+    // What an allocation is used for, only for accounting
+    enum class MemoryCategory : uint8_t {
+        Buffer,
+        Texture,
+        RenderTarget,  // Color and depth attachments, e.g. the MSAA targets
+        Staging,
+        Count
+    };
+
+    auto GetMemoryCategoryName(MemoryCategory Category) -> const char*;
+
+    // The resource behind an allocation and its VkMemoryDedicatedRequirements. A resource that gets its
+    // own VkDeviceMemory is chained into VkMemoryDedicatedAllocateInfo so the driver can optimize for it
+    struct MemoryDedication {
+        VkBuffer Buffer = VK_NULL_HANDLE;
+        VkImage Image = VK_NULL_HANDLE;
+        bool Prefers = false;
+        bool Requires = false;
+    };
+
+    // Handle returned by DeviceMemoryAllocator::Allocate, bind the resource to Memory at Offset.
+    // Host visible memory stays mapped for the lifetime of its block, MappedData already includes Offset
+    struct MemoryAllocation {
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        VkDeviceSize Offset = 0;
+        VkDeviceSize Size = 0;  // Requested size, the buddy node may be larger
+        void* MappedData = nullptr;
+        uint MemoryType = 0;
+
+    private:
+        friend class DeviceMemoryAllocator;
+
+        uint m_pool = 0;
+        uint m_block = 0;
+        uint m_node = 0;
+        bool m_dedicated = false;
+        MemoryCategory m_category = MemoryCategory::Buffer;
+    };
+
+    // Binary buddy allocator over [0, Size), the nodes of the implicit tree are 0 for the root and
+    // 2n + 1, 2n + 2 for the children of n. A node of level l is (Size >> l) bytes and aligned to that,
+    // which also satisfies every power of two alignment up to its size. CPU only, so it can be tested
+    // without a device
+    class BuddyBlock {
+    public:
+        BuddyBlock(VkDeviceSize Size, VkDeviceSize MinNodeSize);
+
+        // Returns false when no node is large enough
+        auto Allocate(VkDeviceSize Size, VkDeviceSize Alignment, VkDeviceSize& Offset, uint& Node) -> bool;
+
+        void Free(uint Node);
+
+        [[nodiscard]] auto GetNodeSize(uint Node) const -> VkDeviceSize {
+            return m_size >> GetLevel(Node);
+        }
+
+        [[nodiscard]] auto GetSize() const -> VkDeviceSize {
+            return m_size;
+        }
+
+        [[nodiscard]] auto GetFreeBytes() const -> VkDeviceSize {
+            return m_freeBytes;
+        }
+
+        [[nodiscard]] auto GetLargestFreeNode() const -> VkDeviceSize;
+
+        [[nodiscard]] auto IsEmpty() const -> bool {
+            return m_freeBytes == m_size;
+        }
+
+    private:
+        enum NodeState : uint8_t {
+            NodeUnused, NodeFree, NodeSplit, NodeAllocated
+        };
+
+        static auto GetLevel(uint Node) -> uint;
+
+        void PushFree(uint Node, uint Level);
+
+        void RemoveFree(uint Node, uint Level);
+
+        VkDeviceSize m_size = 0;
+        uint m_maxLevel = 0;
+        VkDeviceSize m_freeBytes = 0;
+        std::vector<NodeState> m_states;
+        // Free nodes per level, m_freeSlots[Node] is the node's position in its list for O(1) removal
+        std::vector<std::vector<uint>> m_freeLists;
+        std::vector<uint> m_freeSlots;
+    };
+
+    struct DeviceMemoryAllocatorSettings {
+        VkDeviceSize BlockSize = 64ull << 20;  // Shrunk to an eighth of small heaps
+        VkDeviceSize MinAllocationSize = 1024;
+        // Requests above this get their own VkDeviceMemory, e.g. large render targets
+        VkDeviceSize DedicatedThreshold = 32ull << 20;
+    };
+
+    struct DeviceMemoryStats {
+        uint NumBlocks = 0;
+        uint NumDedicated = 0;
+        uint NumAllocations = 0;
+        VkDeviceSize BlockBytes = 0;  // Reserved in blocks
+        VkDeviceSize UsedBytes = 0;  // Requested by live sub-allocations
+        VkDeviceSize NodeBytes = 0;  // Taken by their buddy nodes, the difference is internal fragmentation
+        VkDeviceSize DedicatedBytes = 0;
+        VkDeviceSize LargestFreeNode = 0;
+        uint64_t TotalDeviceAllocations = 0;  // vkAllocateMemory calls since creation
+        // Requested bytes and live allocations per MemoryCategory, dedicated ones included
+        VkDeviceSize CategoryBytes[static_cast<size_t>(MemoryCategory::Count)] = {};
+        uint CategoryAllocations[static_cast<size_t>(MemoryCategory::Count)] = {};
+    };
+
+    // Allocates VkDeviceMemory in large blocks per memory type and resource kind and sub-allocates them
+    // with BuddyBlock. Owned by VulkanBackendApp and used by RHI::CreateBuffer / CreateTexture2D
+    class DeviceMemoryAllocator {
+    public:
+        DeviceMemoryAllocator(VkDevice Device, VkPhysicalDevice PhysicalDevice,
+                              const DeviceMemoryAllocatorSettings& Settings = {});
+
+        ~DeviceMemoryAllocator();
+
+        // Dedicated when the resource prefers or requires it, or when the request is too large for a block
+        auto Allocate(const VkMemoryRequirements& Requirements, VkMemoryPropertyFlags Properties,
+                      MemoryResourceKind Kind, MemoryCategory Category,
+                      const MemoryDedication& Dedication = {}) -> MemoryAllocation*;
+
+        void Free(MemoryAllocation* Allocation);
+
+        // Frees the empty blocks Free keeps around for reuse in the heap, returns the bytes given back.
+        // For memory pressure, the next allocation from those pools goes to the driver again
+        auto ReleaseEmptyBlocks(uint Heap) -> VkDeviceSize;
+
+        // Against the memory properties queried once at creation
+        [[nodiscard]] auto FindMemoryType(uint TypeFilter, VkMemoryPropertyFlags Properties) const -> uint;
+
+        [[nodiscard]] auto GetStats() -> DeviceMemoryStats;
+
+        // VkDeviceMemory this allocator holds in the heap, blocks and dedicated allocations
+        [[nodiscard]] auto GetHeapBytes(uint Heap) const -> VkDeviceSize {
+            return m_heapBytes[Heap].load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] auto GetMemoryProperties() const -> const VkPhysicalDeviceMemoryProperties& {
+            return m_memoryProperties;
+        }
+
+        // NumCycles random allocate / free pairs through the allocator with up to MaxLive allocations
+        // alive, against the same pattern with one vkAllocateMemory per resource
+        static void Benchmark(uint NumCycles = 100000, uint MaxLive = 1024);
+
+    private:
+        struct Block {
+            BuddyBlock* Buddy = nullptr;
+            VkDeviceMemory Memory = VK_NULL_HANDLE;
+            void* MappedData = nullptr;
+            uint NumAllocations = 0;
+        };
+
+        // One per memory type and MemoryResourceKind
+        struct Pool {
+            std::vector<Block> Blocks;
+            VkDeviceSize BlockSize = 0;
+        };
+
+        auto AllocateDeviceMemory(VkDeviceSize Size, uint MemoryType, VkDeviceMemory& Memory, void*& MappedData,
+                                  const void* Next = nullptr) -> bool;
+
+        void FreeDeviceMemory(VkDeviceMemory Memory, void* MappedData, uint MemoryType, VkDeviceSize Size);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        DeviceMemoryAllocatorSettings m_settings;
+        VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+        std::vector<Pool> m_pools;
+        uint m_numDedicated = 0;
+        VkDeviceSize m_dedicatedBytes = 0;
+        uint m_numAllocations = 0;
+        VkDeviceSize m_usedBytes = 0;
+        VkDeviceSize m_nodeBytes = 0;
+        uint64_t m_totalDeviceAllocations = 0;
+        VkDeviceSize m_categoryBytes[static_cast<size_t>(MemoryCategory::Count)] = {};
+        uint m_categoryAllocations[static_cast<size_t>(MemoryCategory::Count)] = {};
+        // Read by MemoryBudget without taking the lock
+        std::atomic<VkDeviceSize> m_heapBytes[VK_MAX_MEMORY_HEAPS] = {};
+        std::mutex m_mutex;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_DEVICEMEMORYALLOCATOR_H
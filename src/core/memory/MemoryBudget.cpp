@@ -0,0 +1,112 @@
+//
+// Created by HUSTLX on 2024/11/3.
+//
+
+#include "MemoryBudget.h"
+#include "DeviceMemoryAllocator.h"
+
+
+namespace HWPT {
+    auto GetMemoryPressureName(MemoryPressure Pressure) -> const char* {
+        switch (Pressure) {
+            case MemoryPressure::None:
+                return "None";
+            case MemoryPressure::Warning:
+                return "Warning";
+            case MemoryPressure::Critical:
+                return "Critical";
+            default:
+                return "Unknown";
+        }
+    }
+
+    MemoryBudget::MemoryBudget(VkPhysicalDevice PhysicalDevice, const DeviceMemoryAllocator *Allocator,
+                               bool HasBudgetExtension, const MemoryBudgetSettings &Settings)
+            : m_physicalDevice(PhysicalDevice), m_allocator(Allocator), m_hasBudgetExtension(HasBudgetExtension),
+              m_settings(Settings) {
+        const auto& MemoryProperties = m_allocator->GetMemoryProperties();
+        m_heaps.resize(MemoryProperties.memoryHeapCount);
+        for (uint Heap = 0; Heap < MemoryProperties.memoryHeapCount; Heap++) {
+            m_heaps[Heap].Size = MemoryProperties.memoryHeaps[Heap].size;
+            m_heaps[Heap].Flags = MemoryProperties.memoryHeaps[Heap].flags;
+        }
+        Update();
+    }
+
+    void MemoryBudget::Update() {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT BudgetProperties{};
+        BudgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        if (m_hasBudgetExtension) {
+            VkPhysicalDeviceMemoryProperties2 MemoryProperties{};
+            MemoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            MemoryProperties.pNext = &BudgetProperties;
+            vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &MemoryProperties);
+        }
+
+        for (uint Heap = 0; Heap < m_heaps.size(); Heap++) {
+            HeapBudget& Current = m_heaps[Heap];
+            Current.AllocatorBytes = m_allocator->GetHeapBytes(Heap);
+            if (m_hasBudgetExtension) {
+                Current.Budget = BudgetProperties.heapBudget[Heap];
+                Current.Usage = BudgetProperties.heapUsage[Heap];
+            } else {
+                Current.Budget = static_cast<VkDeviceSize>(
+                        static_cast<double>(Current.Size) * m_settings.FallbackBudgetRatio);
+                Current.Usage = Current.AllocatorBytes;
+            }
+
+            MemoryPressure Pressure = EvaluatePressure(Current);
+            if (Pressure == Current.Pressure) {
+                continue;
+            }
+            Current.Pressure = Pressure;
+            for (auto& [Handle, Callback]: m_callbacks) {
+                Callback(Heap, Pressure, Current);
+            }
+        }
+    }
+
+    auto MemoryBudget::EvaluatePressure(const HeapBudget &Heap) const -> MemoryPressure {
+        if (Heap.Budget == 0) {
+            return MemoryPressure::None;
+        }
+        double Ratio = static_cast<double>(Heap.Usage) / static_cast<double>(Heap.Budget);
+        // Thresholds of the current level and the ones below are lowered by the hysteresis, so a heap
+        // sitting right at a threshold does not fire callbacks every frame
+        auto Threshold = [&](float Value, MemoryPressure Level) {
+            return Heap.Pressure >= Level ? Value - m_settings.Hysteresis : Value;
+        };
+        if (Ratio >= Threshold(m_settings.CriticalRatio, MemoryPressure::Critical)) {
+            return MemoryPressure::Critical;
+        }
+        if (Ratio >= Threshold(m_settings.WarningRatio, MemoryPressure::Warning)) {
+            return MemoryPressure::Warning;
+        }
+        return MemoryPressure::None;
+    }
+
+    auto MemoryBudget::AddPressureCallback(PressureCallback Callback) -> uint {
+        uint Handle = m_nextHandle++;
+        m_callbacks.emplace_back(Handle, std::move(Callback));
+        return Handle;
+    }
+
+    void MemoryBudget::RemovePressureCallback(uint Handle) {
+        for (auto It = m_callbacks.begin(); It != m_callbacks.end(); ++It) {
+            if (It->first == Handle) {
+                m_callbacks.erase(It);
+                return;
+            }
+        }
+    }
+
+    auto MemoryBudget::GetDeviceLocalPressure() const -> MemoryPressure {
+        MemoryPressure Result = MemoryPressure::None;
+        for (const auto& Heap: m_heaps) {
+            if ((Heap.Flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && Heap.Pressure > Result) {
+                Result = Heap.Pressure;
+            }
+        }
+        return Result;
+    }
+}  // namespace HWPT
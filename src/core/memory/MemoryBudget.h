@@ -0,0 +1,84 @@
+//
+// Created by HUSTLX on 2024/11/3.
+//
+
+#ifndef HARDWAREPATHTRACER_MEMORYBUDGET_H
+#define HARDWAREPATHTRACER_MEMORYBUDGET_H
+
+#include "core/Core.h"
+#include <functional>
+#include <vector>
+
+
+namespace HWPT {
+    class DeviceMemoryAllocator;
+
+    enum class MemoryPressure : uint8_t {
+        None,
+        Warning,  // Usage above WarningRatio of the budget, time to drop optional data like top mips
+        Critical  // Above CriticalRatio, the next large allocation is likely to fail or page
+    };
+
+    auto GetMemoryPressureName(MemoryPressure Pressure) -> const char*;
+
+    struct HeapBudget {
+        VkDeviceSize Size = 0;
+        VkDeviceSize Budget = 0;  // What the process can use before the OS starts paging or failing allocations
+        VkDeviceSize Usage = 0;  // Process wide, includes swap chain and driver memory with VK_EXT_memory_budget
+        VkDeviceSize AllocatorBytes = 0;  // Held by DeviceMemoryAllocator
+        VkMemoryHeapFlags Flags = 0;
+        MemoryPressure Pressure = MemoryPressure::None;
+    };
+
+    struct MemoryBudgetSettings {
+        float WarningRatio = .8f;
+        float CriticalRatio = .95f;
+        float Hysteresis = .05f;  // A heap only leaves a level once it is this far below its threshold
+        // Budget guess without VK_EXT_memory_budget, as a fraction of the heap size
+        float FallbackBudgetRatio = .8f;
+    };
+
+    // Polls per heap usage and budget, from VK_EXT_memory_budget when the device has it and otherwise
+    // from the allocator's own bytes against a fraction of the heap size. Callbacks run inside Update
+    // whenever a heap changes its MemoryPressure, so texture streaming can drop mips before allocations
+    // start to fail, they must not add or remove callbacks. Owned by VulkanBackendApp, which updates it once
+    // per frame
+    class MemoryBudget {
+    public:
+        using PressureCallback = std::function<void(uint Heap, MemoryPressure Pressure, const HeapBudget& Budget)>;
+
+        MemoryBudget(VkPhysicalDevice PhysicalDevice, const DeviceMemoryAllocator* Allocator,
+                     bool HasBudgetExtension, const MemoryBudgetSettings& Settings = {});
+
+        void Update();
+
+        // Returns a handle for RemovePressureCallback
+        auto AddPressureCallback(PressureCallback Callback) -> uint;
+
+        void RemovePressureCallback(uint Handle);
+
+        [[nodiscard]] auto GetHeaps() const -> const std::vector<HeapBudget>& {
+            return m_heaps;
+        }
+
+        // The highest pressure over the device local heaps
+        [[nodiscard]] auto GetDeviceLocalPressure() const -> MemoryPressure;
+
+        [[nodiscard]] auto HasBudgetExtension() const -> bool {
+            return m_hasBudgetExtension;
+        }
+
+    private:
+        auto EvaluatePressure(const HeapBudget& Heap) const -> MemoryPressure;
+
+        VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        const DeviceMemoryAllocator* m_allocator = nullptr;
+        bool m_hasBudgetExtension = false;
+        MemoryBudgetSettings m_settings;
+        std::vector<HeapBudget> m_heaps;
+        std::vector<std::pair<uint, PressureCallback>> m_callbacks;
+        uint m_nextHandle = 0;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_MEMORYBUDGET_H
@@ -0,0 +1,169 @@
+//
+// Created by HUSTLX on 2024/11/1.
+//
+
+#ifndef HARDWAREPATHTRACER_UPLOADMANAGER_H
+#define HARDWAREPATHTRACER_UPLOADMANAGER_H
+
+#include "core/Core.h"
+#include "core/texture/BarrierBatcher.h"
+#include <deque>
+#include <vector>
+
+
+namespace HWPT {
+    struct MemoryAllocation;
+
+    struct UploadManagerStats {
+        uint64_t NumUploads = 0;
+        uint64_t NumBatches = 0;
+        uint64_t NumRingWaits = 0;  // Times an upload had to wait for the GPU to free ring space
+        uint64_t NumOversized = 0;  // Uploads larger than the ring, staged in a temporary buffer
+        VkDeviceSize BytesUploaded = 0;
+    };
+
+    // Where UploadManager submits: copies go to the upload queue, the data is consumed on the consumer queue.
+    // With a dedicated transfer family the two differ and every batch hands ownership over
+    struct UploadQueues {
+        VkQueue UploadQueue = VK_NULL_HANDLE;
+        uint UploadFamily = 0;
+        VkQueue ConsumerQueue = VK_NULL_HANDLE;
+        uint ConsumerFamily = 0;
+    };
+
+    // Copies CPU data to device local buffers and images through a persistently mapped staging ring.
+    // Uploads are recorded into one command buffer until Flush submits the batch, nothing waits on the CPU.
+    //
+    // With a transfer family the copies run on the transfer queue and end with queue family release
+    // barriers, a second command buffer on the consumer queue waits for them through a timeline semaphore
+    // and records the acquire barriers (and the mip blits, which a transfer queue can not do). Otherwise
+    // both halves go to the consumer queue in one submission. Either way the consumer queue signals the
+    // timeline semaphore with the batch number, so everything later on that queue sees the data, other
+    // queues wait on GetTimelineSemaphore() for GetSubmittedValue(), and streaming code polls IsComplete
+    // with the ticket returned by the upload. Ring space is reclaimed once the batch value is reached.
+    // Owned by VulkanBackendApp, destination resources have to outlive their pending uploads. UploadBuffer and
+    // UploadTexture are for resources the GPU has not used yet, UpdateBuffer overwrites one that frames in
+    // flight may still read. Ownership is never handed back to the transfer family, so uploading into a
+    // resource again through UploadBuffer or UploadTexture only keeps the bytes that upload writes
+    class UploadManager {
+    public:
+        static constexpr uint64_t AnyFrameUse = UINT64_MAX;
+
+        UploadManager(VkDevice Device, const UploadQueues& Queues, VkDeviceSize RingSize = 64ull << 20);
+
+        ~UploadManager();
+
+        // Returns the timeline value that signals completion
+        auto UploadBuffer(VkBuffer Dst, const void* Data, VkDeviceSize Size, VkDeviceSize DstOffset = 0) -> uint64_t;
+
+        // Waits for LastFrameUse, the frame timeline value of the last frame that read Dst, before staging so
+        // the copy never overwrites bytes a frame in flight reads. 0 means no frame did, AnyFrameUse falls back
+        // to every submitted frame. The consumer family owns Dst by now, so the copy is recorded on the consumer
+        // side of the batch and needs no ownership transfer. The batch goes out with the next Flush, which the
+        // application does before submitting a frame. Returns the timeline value that signals completion
+        auto UpdateBuffer(VkBuffer Dst, const void* Data, VkDeviceSize Size, VkDeviceSize DstOffset = 0,
+                          uint64_t LastFrameUse = AnyFrameUse) -> uint64_t;
+
+        // The image of State goes to READ_ONLY_OPTIMAL, with mips generated from level 0 when it has more than
+        // one. The transitions go through the manager's own BarrierBatcher, so State follows every level on the
+        // way, and State has to outlive the upload like the image
+        auto UploadTexture(ImageLayoutState& State, uint Width, uint Height, const void* Pixels,
+                           VkDeviceSize Size) -> uint64_t;
+
+        // Submits the recorded batch, does not wait
+        void Flush();
+
+        // Flushes and waits for every submitted batch
+        void WaitIdle();
+
+        [[nodiscard]] auto IsComplete(uint64_t Value) const -> bool;
+
+        [[nodiscard]] auto GetTimelineSemaphore() const -> VkSemaphore {
+            return m_timeline;
+        }
+
+        // Value of the last submitted batch, 0 before the first
+        [[nodiscard]] auto GetSubmittedValue() const -> uint64_t {
+            return m_nextValue - 1;
+        }
+
+        [[nodiscard]] auto UsesTransferQueue() const -> bool {
+            return m_queues.UploadFamily != m_queues.ConsumerFamily;
+        }
+
+        [[nodiscard]] auto GetStats() const -> const UploadManagerStats& {
+            return m_stats;
+        }
+
+        // Uploads NumResources buffers of ResourceSize bytes once with a queue wait per resource and
+        // once batched through the ring
+        static void Benchmark(uint NumResources = 256, VkDeviceSize ResourceSize = 256 << 10);
+
+    private:
+        struct Batch {
+            VkCommandBuffer UploadCommandBuffer = VK_NULL_HANDLE;
+            VkCommandBuffer ConsumerCommandBuffer = VK_NULL_HANDLE;  // Only with a transfer queue
+            uint64_t Value = 0;
+            VkDeviceSize RingEnd = 0;  // Ring head when the batch was closed, becomes the tail once retired
+            VkDeviceSize RingBytes = 0;  // Consumed by the batch including alignment and wrap padding
+            std::vector<std::pair<VkBuffer, MemoryAllocation*>> TempBuffers;
+        };
+
+        struct PendingMips {
+            ImageLayoutState* State;
+            uint Width, Height;
+        };
+
+        struct PendingUpdate {
+            VkBuffer Src, Dst;
+            VkBufferCopy Region;
+        };
+
+        // Returns the staging buffer and offset to copy from, Data is already written there
+        auto Stage(const void* Data, VkDeviceSize Size, VkDeviceSize Alignment) -> std::pair<VkBuffer, VkDeviceSize>;
+
+        auto TryAllocateRing(VkDeviceSize Size, VkDeviceSize Alignment, VkDeviceSize& Offset) -> bool;
+
+        void BeginBatch();
+
+        static auto AllocateCommandBuffer(VkDevice Device, VkCommandPool Pool,
+                                          std::vector<VkCommandBuffer>& FreeList) -> VkCommandBuffer;
+
+        // Retires finished batches from the front, waits for the oldest one first when Wait is set
+        void Retire(bool Wait);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        UploadQueues m_queues;
+        VkCommandPool m_uploadPool = VK_NULL_HANDLE;
+        VkCommandPool m_consumerPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> m_freeUploadCommandBuffers;
+        std::vector<VkCommandBuffer> m_freeConsumerCommandBuffers;
+        // Signaled by the consumer queue when a batch is usable, and by the transfer queue when its copies are done
+        VkSemaphore m_timeline = VK_NULL_HANDLE;
+        VkSemaphore m_transferTimeline = VK_NULL_HANDLE;
+        uint64_t m_nextValue = 1;
+
+        VkBuffer m_ringBuffer = VK_NULL_HANDLE;
+        MemoryAllocation* m_ringMemory = nullptr;
+        VkDeviceSize m_ringSize = 0;
+        VkDeviceSize m_head = 0;
+        VkDeviceSize m_tail = 0;
+        VkDeviceSize m_usedBytes = 0;  // Distinguishes a full ring from an empty one when head == tail
+
+        Batch m_recording;
+        bool m_isRecording = false;
+        // Ownership transfer barriers of the recorded batch, the release half goes to the upload queue
+        std::vector<VkBufferMemoryBarrier> m_bufferReleases;
+        std::vector<VkImageMemoryBarrier> m_imageReleases;
+        std::vector<PendingMips> m_pendingMips;
+        // Flushed right after every request, into whichever command buffer the transition belongs to
+        BarrierBatcher m_barrierBatcher;
+        // UpdateBuffer copies, recorded on the consumer side when the batch is flushed
+        std::vector<PendingUpdate> m_pendingUpdates;
+        std::deque<Batch> m_inFlight;
+
+        UploadManagerStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_UPLOADMANAGER_H
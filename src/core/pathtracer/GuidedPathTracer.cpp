@@ -0,0 +1,390 @@
+//
+// Created by HUSTLX on 2024/10/28.
+//
+
+#include "GuidedPathTracer.h"
+#include "core/ThreadPool.h"
+#include "core/accel/BVH.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+#include <cmath>
+
+
+namespace HWPT {
+    static constexpr float GuidingPI = 3.14159265358979323846f;
+
+    // Two rooms split by a wall with a doorway, the area light is in the far room
+    struct GuidedPathTracer::Scene {
+        std::vector<glm::vec3> Positions;
+        std::vector<uint> Indices;
+        std::vector<glm::vec3> TriangleAlbedo;
+        std::vector<glm::vec3> TriangleEmission;
+        BVH Tree;
+
+        glm::vec3 LightCorner, LightEdge1, LightEdge2, LightNormal, LightEmission;
+        float LightArea = 0.f;
+
+        glm::vec3 CameraPosition, CameraForward, CameraRight, CameraUp;
+        float TanHalfFov = 0.f;
+
+        void AddQuad(const glm::vec3& A, const glm::vec3& B, const glm::vec3& C, const glm::vec3& D,
+                     const glm::vec3& Albedo, const glm::vec3& Emission = glm::vec3(0.f)) {
+            auto Base = static_cast<uint>(Positions.size());
+            Positions.insert(Positions.end(), {A, B, C, D});
+            Indices.insert(Indices.end(), {Base, Base + 1, Base + 2, Base, Base + 2, Base + 3});
+            TriangleAlbedo.insert(TriangleAlbedo.end(), {Albedo, Albedo});
+            TriangleEmission.insert(TriangleEmission.end(), {Emission, Emission});
+        }
+
+        Scene() {
+            const glm::vec3 White(.75f), Floor(.5f, .45f, .4f);
+            const float HalfX = 4.f, Height = 3.f, HalfZ = 3.f;
+            const float DoorHalfWidth = .5f, DoorHeight = 2.f;
+            AddQuad({-HalfX, 0.f, -HalfZ}, {HalfX, 0.f, -HalfZ}, {HalfX, 0.f, HalfZ}, {-HalfX, 0.f, HalfZ}, Floor);
+            AddQuad({-HalfX, Height, -HalfZ}, {HalfX, Height, -HalfZ}, {HalfX, Height, HalfZ},
+                    {-HalfX, Height, HalfZ}, White);
+            AddQuad({-HalfX, 0.f, -HalfZ}, {HalfX, 0.f, -HalfZ}, {HalfX, Height, -HalfZ}, {-HalfX, Height, -HalfZ},
+                    White);
+            AddQuad({-HalfX, 0.f, HalfZ}, {HalfX, 0.f, HalfZ}, {HalfX, Height, HalfZ}, {-HalfX, Height, HalfZ},
+                    White);
+            AddQuad({-HalfX, 0.f, -HalfZ}, {-HalfX, 0.f, HalfZ}, {-HalfX, Height, HalfZ}, {-HalfX, Height, -HalfZ},
+                    White);
+            AddQuad({HalfX, 0.f, -HalfZ}, {HalfX, 0.f, HalfZ}, {HalfX, Height, HalfZ}, {HalfX, Height, -HalfZ},
+                    White);
+            // Dividing wall at x = 0 around the doorway
+            AddQuad({0.f, 0.f, -HalfZ}, {0.f, 0.f, -DoorHalfWidth}, {0.f, Height, -DoorHalfWidth},
+                    {0.f, Height, -HalfZ}, White);
+            AddQuad({0.f, 0.f, DoorHalfWidth}, {0.f, 0.f, HalfZ}, {0.f, Height, HalfZ}, {0.f, Height, DoorHalfWidth},
+                    White);
+            AddQuad({0.f, DoorHeight, -DoorHalfWidth}, {0.f, DoorHeight, DoorHalfWidth},
+                    {0.f, Height, DoorHalfWidth}, {0.f, Height, -DoorHalfWidth}, White);
+
+            LightCorner = glm::vec3(2.5f, Height - 1e-3f, -.5f);
+            LightEdge1 = glm::vec3(0.f, 0.f, 1.f);
+            LightEdge2 = glm::vec3(1.f, 0.f, 0.f);
+            LightNormal = glm::vec3(0.f, -1.f, 0.f);
+            LightEmission = glm::vec3(60.f, 55.f, 45.f);
+            LightArea = glm::length(glm::cross(LightEdge1, LightEdge2));
+            AddQuad(LightCorner, LightCorner + LightEdge1, LightCorner + LightEdge1 + LightEdge2,
+                    LightCorner + LightEdge2, glm::vec3(0.f), LightEmission);
+            Tree.Build(Positions, Indices);
+
+            CameraPosition = glm::vec3(-.5f, 1.5f, 2.5f);
+            CameraForward = glm::normalize(glm::vec3(-4.f, .8f, -1.5f) - CameraPosition);
+            CameraRight = glm::normalize(glm::cross(CameraForward, glm::vec3(0.f, 1.f, 0.f)));
+            CameraUp = glm::cross(CameraRight, CameraForward);
+            TanHalfFov = std::tan(.5f * glm::radians(60.f));
+        }
+    };
+
+    // Path vertex waiting for the radiance that arrives along its sampled direction
+    struct GuidingVertex {
+        DTreeWrapper* Wrapper;
+        glm::vec3 Direction;
+        glm::vec3 Throughput;  // Including this vertex's BSDF weight
+        glm::vec3 Radiance;  // Path contributions recorded after this vertex
+        float Pdf;
+
+        void Commit() {
+            glm::vec3 Incident(0.f);
+            for (int i = 0; i < 3; i++) {
+                Incident[i] = Throughput[i] > 0.f ? Radiance[i] / Throughput[i] : 0.f;
+            }
+            Wrapper->Building.Record(Direction, glm::dot(Incident, glm::vec3(.2126f, .7152f, .0722f)) / Pdf);
+        }
+    };
+
+    static auto PowerHeuristic(float Pdf, float OtherPdf) -> float {
+        float Squared = Pdf * Pdf, OtherSquared = OtherPdf * OtherPdf;
+        return Squared + OtherSquared > 0.f ? Squared / (Squared + OtherSquared) : 0.f;
+    }
+
+    static auto SampleCosineHemisphere(const glm::vec3& Normal, const glm::vec2& U) -> glm::vec3 {
+        float Radius = std::sqrt(U.x), Phi = 2.f * GuidingPI * U.y;
+        glm::vec3 Tangent = glm::normalize(std::abs(Normal.x) > .5f ? glm::cross(Normal, glm::vec3(0.f, 1.f, 0.f))
+                                                                    : glm::cross(Normal, glm::vec3(1.f, 0.f, 0.f)));
+        glm::vec3 Bitangent = glm::cross(Normal, Tangent);
+        return Tangent * (Radius * std::cos(Phi)) + Bitangent * (Radius * std::sin(Phi)) +
+               Normal * std::sqrt(std::max(0.f, 1.f - U.x));
+    }
+
+    GuidedPathTracer::GuidedPathTracer(uint Width, uint Height, const PathGuidingSettings &Settings)
+            : m_width(Width), m_height(Height), m_settings(Settings), m_scene(new Scene()) {
+    }
+
+    GuidedPathTracer::~GuidedPathTracer() {
+        delete m_scene;
+    }
+
+    auto GuidedPathTracer::TracePath(uint X, uint Y, PCGRandom &Random, SDTree* Guide, bool Train) -> glm::vec3 {
+        const Scene& World = *m_scene;
+        float NDCX = (static_cast<float>(X) + Random.NextFloat()) / static_cast<float>(m_width) * 2.f - 1.f;
+        float NDCY = 1.f - (static_cast<float>(Y) + Random.NextFloat()) / static_cast<float>(m_height) * 2.f;
+        float Aspect = static_cast<float>(m_width) / static_cast<float>(m_height);
+        Ray PathRay;
+        PathRay.Origin = World.CameraPosition;
+        PathRay.Direction = glm::normalize(World.CameraForward + World.CameraRight * (NDCX * World.TanHalfFov * Aspect) +
+                                           World.CameraUp * (NDCY * World.TanHalfFov));
+
+        GuidingVertex Vertices[32];
+        uint NumVertices = 0;
+        glm::vec3 Radiance(0.f), Throughput(1.f);
+        float PrevPdf = 0.f;
+        const uint MaxDepth = std::min(m_settings.MaxDepth, 32u);
+
+        // Contribution adds to the pixel and to the incident radiance of the vertices before it
+        auto AddContribution = [&](const glm::vec3& Contribution, uint NumReceivers) {
+            Radiance += Contribution;
+            for (uint i = 0; i < NumReceivers; i++) {
+                Vertices[i].Radiance += Contribution;
+            }
+        };
+
+        for (uint Depth = 0; Depth <= MaxDepth; Depth++) {
+            RayHit Hit;
+            if (!World.Tree.Intersect(PathRay, Hit)) {
+                break;
+            }
+            glm::vec3 Position = PathRay.At(Hit.T);
+            const uint* Triangle = &World.Indices[3 * Hit.PrimitiveID];
+            glm::vec3 Normal = glm::normalize(glm::cross(World.Positions[Triangle[1]] - World.Positions[Triangle[0]],
+                                                         World.Positions[Triangle[2]] - World.Positions[Triangle[0]]));
+            const glm::vec3& Emission = World.TriangleEmission[Hit.PrimitiveID];
+            if (Emission != glm::vec3(0.f)) {
+                float CosLight = -glm::dot(PathRay.Direction, World.LightNormal);
+                if (CosLight > 0.f) {
+                    float Weight = 1.f;
+                    if (Depth > 0) {
+                        float LightPdf = Hit.T * Hit.T / (CosLight * World.LightArea);
+                        Weight = PowerHeuristic(PrevPdf, LightPdf);
+                    }
+                    AddContribution(Throughput * Emission * Weight, NumVertices);
+                }
+                break;
+            }
+            if (Depth == MaxDepth) {
+                break;
+            }
+            if (glm::dot(Normal, PathRay.Direction) > 0.f) {
+                Normal = -Normal;
+            }
+            const glm::vec3 Albedo = World.TriangleAlbedo[Hit.PrimitiveID];
+            DTreeWrapper* Wrapper = Guide ? &Guide->GetDTree(Position) : nullptr;
+            const bool Guided = Wrapper && Wrapper->Sampling.GetFlux() > 0.f;
+            const float BSDFFraction = Guided ? m_settings.BSDFSamplingFraction : 1.f;
+            auto MixturePdf = [&](const glm::vec3& Direction, float CosTheta) {
+                float Pdf = BSDFFraction * std::max(CosTheta, 0.f) / GuidingPI;
+                if (Guided) {
+                    Pdf += (1.f - BSDFFraction) * Wrapper->Sampling.GetPdf(Direction);
+                }
+                return Pdf;
+            };
+            glm::vec3 Origin = Position + Normal * 1e-4f;
+
+            // Next event estimation on the area light
+            glm::vec3 LightPoint = World.LightCorner + World.LightEdge1 * Random.NextFloat() +
+                                   World.LightEdge2 * Random.NextFloat();
+            glm::vec3 ToLight = LightPoint - Origin;
+            float DistanceSquared = glm::dot(ToLight, ToLight);
+            glm::vec3 LightDirection = ToLight / std::sqrt(DistanceSquared);
+            float CosSurface = glm::dot(Normal, LightDirection);
+            float CosLight = -glm::dot(LightDirection, World.LightNormal);
+            if (CosSurface > 0.f && CosLight > 0.f) {
+                Ray Shadow;
+                Shadow.Origin = Origin;
+                Shadow.Direction = ToLight;
+                Shadow.TMax = .999f;
+                if (!World.Tree.IsOccluded(Shadow)) {
+                    float LightPdf = DistanceSquared / (CosLight * World.LightArea);
+                    float Weight = PowerHeuristic(LightPdf, MixturePdf(LightDirection, CosSurface));
+                    AddContribution(Throughput * Albedo / GuidingPI * CosSurface * World.LightEmission * Weight /
+                                    LightPdf, NumVertices);
+                }
+            }
+
+            // Direction from the BSDF or the D-tree, weighted by the mixture pdf
+            glm::vec3 Direction;
+            if (Random.NextFloat() < BSDFFraction) {
+                Direction = SampleCosineHemisphere(Normal, {Random.NextFloat(), Random.NextFloat()});
+            } else {
+                Direction = Wrapper->Sampling.Sample({Random.NextFloat(), Random.NextFloat()});
+            }
+            float CosTheta = glm::dot(Normal, Direction);
+            float Pdf = MixturePdf(Direction, CosTheta);
+            if (CosTheta <= 0.f || Pdf <= 0.f) {
+                break;
+            }
+            Throughput *= Albedo / GuidingPI * CosTheta / Pdf;
+            if (Train && Wrapper) {
+                Vertices[NumVertices++] = {Wrapper, Direction, Throughput, glm::vec3(0.f), Pdf};
+            }
+            PrevPdf = Pdf;
+            PathRay.Origin = Origin;
+            PathRay.Direction = Direction;
+            PathRay.TMax = std::numeric_limits<float>::max();
+        }
+
+        for (uint i = 0; i < NumVertices; i++) {
+            Vertices[i].Commit();
+        }
+        return Radiance;
+    }
+
+    void GuidedPathTracer::RenderPass(std::vector<glm::vec3> &Image, uint SamplesPerPixel, uint Seed, SDTree* Guide,
+                                      bool Train, std::vector<glm::vec3>* SquaredImage) {
+        Image.resize(static_cast<size_t>(m_width) * m_height, glm::vec3(0.f));
+        if (SquaredImage) {
+            SquaredImage->resize(Image.size(), glm::vec3(0.f));
+        }
+        ThreadPool::Get().ParallelFor(m_width * m_height, [&](uint Begin, uint End) {
+            for (uint PixelIndex = Begin; PixelIndex < End; PixelIndex++) {
+                PCGRandom Random((static_cast<uint64_t>(Seed) << 32u) | PixelIndex);
+                glm::vec3 Sum(0.f), SquaredSum(0.f);
+                for (uint Sample = 0; Sample < SamplesPerPixel; Sample++) {
+                    glm::vec3 Value = TracePath(PixelIndex % m_width, PixelIndex / m_width, Random, Guide, Train);
+                    if (std::isfinite(Value.x) && std::isfinite(Value.y) && std::isfinite(Value.z)) {
+                        Sum += Value;
+                        SquaredSum += Value * Value;
+                    }
+                }
+                Image[PixelIndex] += Sum;
+                if (SquaredImage) {
+                    (*SquaredImage)[PixelIndex] += SquaredSum;
+                }
+            }
+        }, 64);
+    }
+
+    auto GuidedPathTracer::RenderUnguided(double BudgetMs, std::vector<glm::vec3> &Image) -> uint {
+        Image.assign(static_cast<size_t>(m_width) * m_height, glm::vec3(0.f));
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        uint SamplesPerPixel = 0;
+        do {
+            RenderPass(Image, 1, SamplesPerPixel, nullptr, false);
+            SamplesPerPixel++;
+        } while (std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count() < BudgetMs);
+        for (auto& Pixel: Image) {
+            Pixel /= static_cast<float>(SamplesPerPixel);
+        }
+        return SamplesPerPixel;
+    }
+
+    auto GuidedPathTracer::RenderGuided(double BudgetMs, std::vector<glm::vec3> &Image) -> PathGuidingStats {
+        PathGuidingStats Stats;
+        SDTree Guide(m_scene->Tree.GetBounds());
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        auto ElapsedMs = [&]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime)
+                    .count();
+        };
+
+        // Adds the averaged Sum of one iteration with weight 1 / Var, Var being the mean over the pixels of
+        // the variance of the pixel estimate. Iterations with a single sample per pixel have no variance
+        // estimate and are skipped
+        const size_t NumPixels = static_cast<size_t>(m_width) * m_height;
+        std::vector<glm::vec3> WeightedSum(NumPixels, glm::vec3(0.f));
+        double TotalWeight = 0.;
+        auto Combine = [&](const std::vector<glm::vec3>& Sum, const std::vector<glm::vec3>& SquaredSum,
+                           uint SamplesPerPixel) {
+            if (SamplesPerPixel < 2) {
+                return;
+            }
+            const auto N = static_cast<float>(SamplesPerPixel);
+            double Variance = 0.;
+            for (size_t i = 0; i < NumPixels; i++) {
+                glm::vec3 SampleVariance = glm::max(SquaredSum[i] - Sum[i] * Sum[i] / N, glm::vec3(0.f)) / (N - 1.f);
+                Variance += glm::dot(SampleVariance, glm::vec3(1.f / 3.f)) / N;
+            }
+            const auto Weight = static_cast<float>(1. / std::max(Variance / static_cast<double>(NumPixels), 1e-12));
+            for (size_t i = 0; i < NumPixels; i++) {
+                WeightedSum[i] += Weight * Sum[i] / N;
+            }
+            TotalWeight += Weight;
+            Stats.CombinedIterations++;
+        };
+
+        // Iteration doubling, the next iteration takes about twice as long as the last one
+        std::vector<glm::vec3> Scratch, SquaredScratch;
+        double LastIterationMs = 0.;
+        uint Seed = 1u << 16;
+        while (Stats.TrainingIterations == 0 ||
+               ElapsedMs() + 2. * LastIterationMs <= BudgetMs * m_settings.TrainingBudgetFraction) {
+            double IterationStart = ElapsedMs();
+            Scratch.assign(NumPixels, glm::vec3(0.f));
+            SquaredScratch.assign(NumPixels, glm::vec3(0.f));
+            const uint SamplesPerPixel = 1u << Stats.TrainingIterations;
+            RenderPass(Scratch, SamplesPerPixel, Seed++, &Guide, true, &SquaredScratch);
+            Combine(Scratch, SquaredScratch, SamplesPerPixel);
+            Guide.Refine(Stats.TrainingIterations, m_settings.Tree);
+            LastIterationMs = ElapsedMs() - IterationStart;
+            Stats.TrainingIterations++;
+        }
+        Stats.TrainingMs = ElapsedMs();
+
+        // Final iteration with the learned distributions, no more training
+        Scratch.assign(NumPixels, glm::vec3(0.f));
+        SquaredScratch.assign(NumPixels, glm::vec3(0.f));
+        do {
+            RenderPass(Scratch, 1, Seed++, &Guide, false, &SquaredScratch);
+            Stats.FinalSamplesPerPixel++;
+        } while (ElapsedMs() < BudgetMs);
+        Combine(Scratch, SquaredScratch, Stats.FinalSamplesPerPixel);
+        if (TotalWeight > 0.) {
+            Image.resize(NumPixels);
+            for (size_t i = 0; i < NumPixels; i++) {
+                Image[i] = WeightedSum[i] / static_cast<float>(TotalWeight);
+            }
+        }
+        else {
+            // Only single sample passes, nothing to weight them by
+            Image = Scratch;
+            Stats.CombinedIterations = 1;
+        }
+        Stats.TotalMs = ElapsedMs();
+        Stats.SpatialLeaves = Guide.GetNumLeaves();
+        Stats.DTreeNodes = Guide.GetNumDTreeNodes();
+        Stats.MemoryBytes = Guide.GetMemoryBytes();
+        Stats.HitMemoryCap = Guide.HitMemoryCap();
+        return Stats;
+    }
+
+    void GuidedPathTracer::ReportEqualTime(uint Width, uint Height, double BudgetMs, uint ReferenceSamplesPerPixel) {
+        GuidedPathTracer Tracer(Width, Height);
+        std::vector<glm::vec3> Reference;
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        Tracer.RenderPass(Reference, ReferenceSamplesPerPixel, ~0u, nullptr, false);
+        for (auto& Pixel: Reference) {
+            Pixel /= static_cast<float>(ReferenceSamplesPerPixel);
+        }
+        double ReferenceMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+
+        auto Report = [&](const char* Name, const std::vector<glm::vec3>& Image, uint SamplesPerPixel) {
+            double SquaredSum = 0., RelativeSum = 0.;
+            for (size_t i = 0; i < Image.size(); i++) {
+                glm::vec3 Difference = Image[i] - Reference[i];
+                float Expected = glm::dot(Reference[i], glm::vec3(1.f / 3.f));
+                SquaredSum += glm::dot(Difference, Difference) / 3.f;
+                RelativeSum += glm::dot(Difference, Difference) / 3.f / (Expected * Expected + 1e-2f);
+            }
+            std::cout << Name << " | " << SamplesPerPixel << " | " << SquaredSum / Image.size() << " | "
+                      << RelativeSum / Image.size() << "\n";
+        };
+
+        std::cout << "Path guiding " << Width << "x" << Height << ", " << BudgetMs << " ms budget, reference "
+                  << ReferenceSamplesPerPixel << " spp in " << ReferenceMs << " ms\n";
+        std::cout << "Method | Final spp | MSE | relMSE\n";
+        std::vector<glm::vec3> Image;
+        uint UnguidedSamples = Tracer.RenderUnguided(BudgetMs, Image);
+        Report("Unguided", Image, UnguidedSamples);
+        PathGuidingStats Stats = Tracer.RenderGuided(BudgetMs, Image);
+        Report("SD-tree guided", Image, Stats.FinalSamplesPerPixel);
+        std::cout << "SD-tree: " << Stats.TrainingIterations << " training iterations in " << Stats.TrainingMs
+                  << " ms, " << Stats.CombinedIterations << " iterations combined, " << Stats.SpatialLeaves
+                  << " spatial leaves, " << Stats.DTreeNodes
+                  << " directional nodes, " << Stats.MemoryBytes / 1024 << " KB"
+                  << (Stats.HitMemoryCap ? ", memory cap reached" : "") << "\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
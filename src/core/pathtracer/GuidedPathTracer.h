@@ -0,0 +1,75 @@
+//
+// Created by HUSTLX on 2024/10/28.
+//
+
+#ifndef HARDWAREPATHTRACER_GUIDEDPATHTRACER_H
+#define HARDWAREPATHTRACER_GUIDEDPATHTRACER_H
+
+#include "core/Core.h"
+#include "core/pathtracer/SDTree.h"
+#include <vector>
+
+
+namespace HWPT {
+    class PCGRandom;
+
+    struct PathGuidingSettings {
+        uint MaxDepth = 8;
+        // Probability of sampling the BSDF instead of the D-tree, both are combined with one-sample MIS
+        float BSDFSamplingFraction = .5f;
+        // Training stops once half of the time budget is spent, the rest renders the final iteration
+        float TrainingBudgetFraction = .5f;
+        SDTreeSettings Tree;
+    };
+
+    struct PathGuidingStats {
+        uint TrainingIterations = 0;
+        uint FinalSamplesPerPixel = 0;
+        uint CombinedIterations = 0;  // Iterations, final pass included, in the inverse variance weighted image
+        uint SpatialLeaves = 0;
+        size_t DTreeNodes = 0;
+        size_t MemoryBytes = 0;
+        bool HitMemoryCap = false;
+        double TrainingMs = 0.;
+        double TotalMs = 0.;
+    };
+
+    // CPU path tracer of diffuse triangles with next event estimation, optionally guided by an SD-tree
+    // trained online with iteration doubling: iteration k renders 2^k spp and splats its incident
+    // radiance into the building trees, then the tree is refined and the next iteration samples it
+    class GuidedPathTracer {
+    public:
+        GuidedPathTracer(uint Width, uint Height, const PathGuidingSettings& Settings = {});
+
+        ~GuidedPathTracer();
+
+        // Adds SamplesPerPixel path samples per pixel to Image (summed, not averaged), and their squares to
+        // SquaredImage when given
+        void RenderPass(std::vector<glm::vec3>& Image, uint SamplesPerPixel, uint Seed, SDTree* Guide, bool Train,
+                        std::vector<glm::vec3>* SquaredImage = nullptr);
+
+        // Returns the averaged image and the samples per pixel after BudgetMs
+        auto RenderUnguided(double BudgetMs, std::vector<glm::vec3>& Image) -> uint;
+
+        // Every iteration is unbiased, so the returned image weights the training iterations and the final
+        // pass by the inverse of their estimated variance (Muller et al. 2017) instead of dropping the
+        // training samples
+        auto RenderGuided(double BudgetMs, std::vector<glm::vec3>& Image) -> PathGuidingStats;
+
+        // Light through a doorway: the camera room only receives light bounced off the lit room. Reports
+        // the error of guided and unguided rendering at equal time against a long unguided reference
+        static void ReportEqualTime(uint Width = 128, uint Height = 96, double BudgetMs = 20000.,
+                                    uint ReferenceSamplesPerPixel = 2048);
+
+    private:
+        struct Scene;
+
+        auto TracePath(uint X, uint Y, PCGRandom& Random, SDTree* Guide, bool Train) -> glm::vec3;
+
+        uint m_width = 0, m_height = 0;
+        PathGuidingSettings m_settings;
+        Scene* m_scene = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_GUIDEDPATHTRACER_H
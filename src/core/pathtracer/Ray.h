@@ -0,0 +1,86 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#ifndef HARDWAREPATHTRACER_RAY_H
+#define HARDWAREPATHTRACER_RAY_H
+
+#include "core/Core.h"
+#include <limits>
+#include <algorithm>
+
+
+namespace HWPT {
+    struct Ray {
+        glm::vec3 Origin = glm::vec3(0.f);
+        float TMin = 0.f;
+        glm::vec3 Direction = glm::vec3(0.f, 0.f, 1.f);
+        float TMax = std::numeric_limits<float>::max();
+
+        [[nodiscard]] auto At(float T) const -> glm::vec3 {
+            return Origin + Direction * T;
+        }
+    };
+
+    struct RayHit {
+        float T = std::numeric_limits<float>::max();
+        uint PrimitiveID = InvalidID;
+        uint MaterialID = InvalidID;
+        uint InstanceID = InvalidID;
+        glm::vec2 Barycentrics = glm::vec2(0.f);
+
+        static constexpr uint InvalidID = ~0u;
+
+        [[nodiscard]] auto IsValid() const -> bool {
+            return PrimitiveID != InvalidID;
+        }
+    };
+
+    struct AABB {
+        glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+
+        void Extend(const glm::vec3& Point) {
+            Min = glm::min(Min, Point);
+            Max = glm::max(Max, Point);
+        }
+
+        void Extend(const AABB& Other) {
+            Min = glm::min(Min, Other.Min);
+            Max = glm::max(Max, Other.Max);
+        }
+
+        [[nodiscard]] auto IsValid() const -> bool {
+            return Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z;
+        }
+
+        [[nodiscard]] auto GetCenter() const -> glm::vec3 {
+            return (Min + Max) * .5f;
+        }
+
+        [[nodiscard]] auto GetExtent() const -> glm::vec3 {
+            return Max - Min;
+        }
+
+        [[nodiscard]] auto GetSurfaceArea() const -> float {
+            if (!IsValid()) {
+                return 0.f;
+            }
+            glm::vec3 Extent = GetExtent();
+            return 2.f * (Extent.x * Extent.y + Extent.y * Extent.z + Extent.z * Extent.x);
+        }
+
+        // Slab test, InvDirection is 1 / Ray.Direction
+        [[nodiscard]] auto Intersect(const glm::vec3& Origin, const glm::vec3& InvDirection, float TMin,
+                                     float TMax) const -> bool {
+            glm::vec3 T0 = (Min - Origin) * InvDirection;
+            glm::vec3 T1 = (Max - Origin) * InvDirection;
+            glm::vec3 TNear = glm::min(T0, T1), TFar = glm::max(T0, T1);
+            TMin = std::max(std::max(TNear.x, TNear.y), std::max(TNear.z, TMin));
+            TMax = std::min(std::min(TFar.x, TFar.y), std::min(TFar.z, TMax));
+            return TMin <= TMax;
+        }
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_RAY_H
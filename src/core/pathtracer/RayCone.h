@@ -0,0 +1,70 @@
+//
+// Created by HUSTLX on 2024/10/23.
+//
+
+#ifndef HARDWAREPATHTRACER_RAYCONE_H
+#define HARDWAREPATHTRACER_RAYCONE_H
+
+#include "core/Core.h"
+#include <cmath>
+#include <algorithm>
+
+
+namespace HWPT {
+    // Ray cone texture LOD (Akenine-Moller et al., Ray Tracing Gems ch. 20 and RTG II ch. 7).
+    // The cone footprint travels with the path, every hit turns its width into a mip level through
+    // the per-triangle constant from Model::GetTriangleLODConstant. Mirrors shader/HLSL/RayCone.hlsl
+    struct RayCone {
+        float Width = 0.f;
+        float SpreadAngle = 0.f;
+
+        // Pixel spread angle of a pinhole camera, the cone of a primary ray starts with zero width
+        static auto FromCamera(float VerticalFov, uint ImageHeight) -> RayCone {
+            RayCone Cone;
+            Cone.SpreadAngle = std::atan(2.f * std::tan(VerticalFov * .5f) / static_cast<float>(ImageHeight));
+            return Cone;
+        }
+
+        // Width at the hit distance T
+        [[nodiscard]] auto Propagate(float T) const -> RayCone {
+            RayCone Cone = *this;
+            Cone.Width = Width + SpreadAngle * T;
+            return Cone;
+        }
+
+        // Cone continuing after a bounce, SurfaceSpreadAngle widens or narrows it (curvature, roughness)
+        [[nodiscard]] auto Bounce(float SurfaceSpreadAngle) const -> RayCone {
+            RayCone Cone = *this;
+            Cone.SpreadAngle = SpreadAngle + SurfaceSpreadAngle;
+            return Cone;
+        }
+
+        // Spread added by a rough lobe, treats the GGX alpha as the tangent of the lobe half-angle
+        static auto RoughnessSpreadAngle(float Roughness) -> float {
+            return 2.f * std::atan(Roughness * Roughness);
+        }
+
+        // Spread added by a curved surface, Curvature is the change of the normal per unit length
+        [[nodiscard]] auto CurvatureSpreadAngle(float Curvature) const -> float {
+            return 2.f * Curvature * Width;
+        }
+
+        // Mip level at a hit with the triangle LOD constant, unclamped so callers can clamp to the
+        // mip count of the texture they fetch from. The constant is in object space: an instance scaled by
+        // InstanceScale has s^2 times the world area, which moves the constant by -log2(s)
+        [[nodiscard]] auto ComputeTextureLOD(float TriangleLODConstant, const glm::vec3& RayDirection,
+                                             const glm::vec3& Normal, float InstanceScale = 1.f) const -> float {
+            float CosTheta = std::max(std::abs(glm::dot(RayDirection, Normal)), 1e-4f);
+            return TriangleLODConstant - std::log2(InstanceScale) + std::log2(std::max(std::abs(Width), 1e-8f)) -
+                   std::log2(CosTheta);
+        }
+
+        // InstanceScale of an object to world transform, exact for uniform scale and the geometric mean
+        // of the axis scales otherwise
+        static auto GetInstanceScale(const glm::mat3& ObjectToWorld) -> float {
+            return std::max(std::cbrt(std::abs(glm::determinant(ObjectToWorld))), 1e-8f);
+        }
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_RAYCONE_H
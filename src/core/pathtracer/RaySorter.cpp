@@ -0,0 +1,385 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#include "RaySorter.h"
+#include "core/ThreadPool.h"
+#include "core/sampling/PCGRandom.h"
+#include "core/sampling/SobolSequence.h"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+
+namespace HWPT {
+    static constexpr uint RadixBits = 8;
+    static constexpr uint RadixSize = 1u << RadixBits;
+    // Keys per radix block, a block keeps its own histogram so the scatter stays stable
+    static constexpr uint RadixBlockSize = 1u << 14;
+
+    // Spreads the low 10 bits so that two zero bits sit between each of them
+    static auto ExpandBits(uint Value) -> uint {
+        Value &= 0x3ffu;
+        Value = (Value | (Value << 16u)) & 0x030000ffu;
+        Value = (Value | (Value << 8u)) & 0x0300f00fu;
+        Value = (Value | (Value << 4u)) & 0x030c30c3u;
+        Value = (Value | (Value << 2u)) & 0x09249249u;
+        return Value;
+    }
+
+    static auto DirectionOctant(const glm::vec3& Direction) -> uint {
+        return (Direction.x < 0.f ? 1u : 0u) | (Direction.y < 0.f ? 2u : 0u) | (Direction.z < 0.f ? 4u : 0u);
+    }
+
+    auto RaySorter::GetKeyBits(RaySortKeyType Type) -> uint {
+        return Type == RaySortKeyType::OriginDirection ? 18 : 30;
+    }
+
+    void RaySorter::ComputeKeys(const std::vector<Ray> &Rays, const AABB &SceneBounds, RaySortKeyType Type,
+                                std::vector<uint> &Keys) {
+        Keys.resize(Rays.size());
+        const uint CellBits = Type == RaySortKeyType::OriginDirection ? 5 : 9;
+        const float NumCells = static_cast<float>(1u << CellBits);
+        const glm::vec3 Extent = glm::max(SceneBounds.GetExtent(), glm::vec3(1e-6f));
+
+        ThreadPool::Get().ParallelFor(static_cast<uint>(Rays.size()), [&](uint Begin, uint End) {
+            for (uint i = Begin; i < End; i++) {
+                glm::vec3 Normalized = (Rays[i].Origin - SceneBounds.Min) / Extent;
+                glm::vec3 Cell = glm::clamp(Normalized * NumCells, glm::vec3(0.f), glm::vec3(NumCells - 1.f));
+                uint X = static_cast<uint>(Cell.x), Y = static_cast<uint>(Cell.y), Z = static_cast<uint>(Cell.z);
+                uint CellKey = Type == RaySortKeyType::OriginDirection ?
+                               (Z << (2 * CellBits)) | (Y << CellBits) | X :
+                               (ExpandBits(Z) << 2u) | (ExpandBits(Y) << 1u) | ExpandBits(X);
+                Keys[i] = (DirectionOctant(Rays[i].Direction) << (3 * CellBits)) | CellKey;
+            }
+        }, 4096);
+    }
+
+    void RaySorter::RadixSort(std::vector<uint> &Keys, std::vector<uint> &Values, uint NumKeyBits) {
+        Check(Keys.size() == Values.size());
+        const auto Count = static_cast<uint>(Keys.size());
+        const uint NumBlocks = (Count + RadixBlockSize - 1) / RadixBlockSize;
+        const uint NumPasses = (std::min(NumKeyBits, 32u) + RadixBits - 1) / RadixBits;
+        if (Count <= 1) {
+            return;
+        }
+
+        std::vector<uint> KeysTemp(Count), ValuesTemp(Count);
+        std::vector<std::array<uint, RadixSize>> BlockOffsets(NumBlocks);
+        uint *SrcKeys = Keys.data(), *SrcValues = Values.data();
+        uint *DstKeys = KeysTemp.data(), *DstValues = ValuesTemp.data();
+
+        for (uint Pass = 0; Pass < NumPasses; Pass++) {
+            const uint Shift = Pass * RadixBits;
+
+            ThreadPool::Get().ParallelFor(NumBlocks, [&](uint BlockBegin, uint BlockEnd) {
+                for (uint Block = BlockBegin; Block < BlockEnd; Block++) {
+                    auto &Histogram = BlockOffsets[Block];
+                    Histogram.fill(0);
+                    uint End = std::min(Count, (Block + 1) * RadixBlockSize);
+                    for (uint i = Block * RadixBlockSize; i < End; i++) {
+                        Histogram[(SrcKeys[i] >> Shift) & (RadixSize - 1)]++;
+                    }
+                }
+            });
+
+            // Exclusive scan in digit major, block minor order turns the histograms into scatter offsets
+            uint Sum = 0;
+            for (uint Digit = 0; Digit < RadixSize; Digit++) {
+                for (uint Block = 0; Block < NumBlocks; Block++) {
+                    uint BucketSize = BlockOffsets[Block][Digit];
+                    BlockOffsets[Block][Digit] = Sum;
+                    Sum += BucketSize;
+                }
+            }
+
+            ThreadPool::Get().ParallelFor(NumBlocks, [&](uint BlockBegin, uint BlockEnd) {
+                for (uint Block = BlockBegin; Block < BlockEnd; Block++) {
+                    auto &Offsets = BlockOffsets[Block];
+                    uint End = std::min(Count, (Block + 1) * RadixBlockSize);
+                    for (uint i = Block * RadixBlockSize; i < End; i++) {
+                        uint Destination = Offsets[(SrcKeys[i] >> Shift) & (RadixSize - 1)]++;
+                        DstKeys[Destination] = SrcKeys[i];
+                        DstValues[Destination] = SrcValues[i];
+                    }
+                }
+            });
+
+            std::swap(SrcKeys, DstKeys);
+            std::swap(SrcValues, DstValues);
+        }
+
+        // Odd number of passes leaves the result in the temporaries
+        if (SrcKeys != Keys.data()) {
+            Keys.swap(KeysTemp);
+            Values.swap(ValuesTemp);
+        }
+    }
+
+    auto RaySorter::SortRays(const std::vector<Ray> &Rays, const AABB &SceneBounds,
+                             RaySortKeyType Type) -> std::vector<uint> {
+        std::vector<uint> Keys;
+        ComputeKeys(Rays, SceneBounds, Type, Keys);
+        std::vector<uint> Permutation(Rays.size());
+        std::iota(Permutation.begin(), Permutation.end(), 0u);
+        RadixSort(Keys, Permutation, GetKeyBits(Type));
+        return Permutation;
+    }
+
+    auto RaySorter::SortHitsByMaterial(const std::vector<RayHit> &Hits, uint NumMaterials) -> std::vector<uint> {
+        // Misses get the largest key and end up in one run at the back
+        std::vector<uint> Keys(Hits.size());
+        for (size_t i = 0; i < Hits.size(); i++) {
+            Keys[i] = Hits[i].IsValid() ? Hits[i].MaterialID : NumMaterials;
+        }
+        std::vector<uint> Permutation(Hits.size());
+        std::iota(Permutation.begin(), Permutation.end(), 0u);
+        uint NumKeyBits = 1;
+        while ((1u << NumKeyBits) <= NumMaterials && NumKeyBits < 32) {
+            NumKeyBits++;
+        }
+        RadixSort(Keys, Permutation, NumKeyBits);
+        return Permutation;
+    }
+
+    // Benchmark scene: a uniform grid with at most one sphere per cell, every sphere references one of
+    // many textured materials. Traversal is a 3D DDA, so memory access follows the ray like in a BVH
+    struct SphereGridScene {
+        static constexpr uint GridResolution = 64;
+        static constexpr uint NumMaterials = 256;
+        static constexpr uint TextureSize = 64;
+
+        struct Sphere {
+            glm::vec3 Center;
+            float Radius;  // 0 for empty cells
+            uint MaterialID;
+        };
+
+        std::vector<Sphere> Cells;
+        std::vector<glm::vec4> Textures;  // NumMaterials * TextureSize * TextureSize
+        AABB Bounds;
+
+        SphereGridScene() {
+            const uint NumCells = GridResolution * GridResolution * GridResolution;
+            Cells.resize(NumCells);
+            PCGRandom Random(7);
+            for (uint i = 0; i < NumCells; i++) {
+                glm::vec3 Cell(static_cast<float>(i % GridResolution),
+                               static_cast<float>((i / GridResolution) % GridResolution),
+                               static_cast<float>(i / (GridResolution * GridResolution)));
+                bool Occupied = Random.NextFloat() < .15f;
+                float Radius = .3f + .15f * Random.NextFloat();
+                glm::vec3 Jitter(Random.NextFloat(), Random.NextFloat(), Random.NextFloat());
+                Cells[i].Radius = Occupied ? Radius : 0.f;
+                Cells[i].Center = Cell + glm::vec3(.5f) + (Jitter - glm::vec3(.5f)) * (1.f - 2.f * Radius);
+                Cells[i].MaterialID = Random.NextUInt() % NumMaterials;
+            }
+
+            Textures.resize(static_cast<size_t>(NumMaterials) * TextureSize * TextureSize);
+            for (auto &Texel: Textures) {
+                Texel = glm::vec4(Random.NextFloat(), Random.NextFloat(), Random.NextFloat(), 1.f);
+            }
+            Bounds.Min = glm::vec3(0.f);
+            Bounds.Max = glm::vec3(static_cast<float>(GridResolution));
+        }
+
+        [[nodiscard]] auto Trace(const Ray &InRay) const -> RayHit {
+            RayHit Hit;
+            glm::vec3 InvDirection = 1.f / InRay.Direction;
+            glm::vec3 T0 = (Bounds.Min - InRay.Origin) * InvDirection;
+            glm::vec3 T1 = (Bounds.Max - InRay.Origin) * InvDirection;
+            glm::vec3 TNear = glm::min(T0, T1), TFar = glm::max(T0, T1);
+            float TEnter = std::max(std::max(TNear.x, TNear.y), std::max(TNear.z, InRay.TMin));
+            float TExit = std::min(std::min(TFar.x, TFar.y), std::min(TFar.z, InRay.TMax));
+            if (TEnter > TExit) {
+                return Hit;
+            }
+
+            const int Resolution = static_cast<int>(GridResolution);
+            glm::vec3 Entry = InRay.At(TEnter);
+            int Cell[3], Step[3];
+            float TNext[3], TDelta[3];
+            for (int Axis = 0; Axis < 3; Axis++) {
+                Cell[Axis] = std::clamp(static_cast<int>(Entry[Axis]), 0, Resolution - 1);
+                Step[Axis] = InRay.Direction[Axis] < 0.f ? -1 : 1;
+                float Boundary = static_cast<float>(Cell[Axis] + (Step[Axis] > 0 ? 1 : 0));
+                TDelta[Axis] = std::abs(InvDirection[Axis]);
+                TNext[Axis] = InRay.Direction[Axis] != 0.f ?
+                              TEnter + (Boundary - Entry[Axis]) * InvDirection[Axis] :
+                              std::numeric_limits<float>::max();
+            }
+
+            while (true) {
+                uint CellIndex = (static_cast<uint>(Cell[2]) * GridResolution + static_cast<uint>(Cell[1])) *
+                                 GridResolution + static_cast<uint>(Cell[0]);
+                const Sphere &CellSphere = Cells[CellIndex];
+                if (CellSphere.Radius > 0.f) {
+                    glm::vec3 OC = InRay.Origin - CellSphere.Center;
+                    float B = glm::dot(OC, InRay.Direction);
+                    float C = glm::dot(OC, OC) - CellSphere.Radius * CellSphere.Radius;
+                    float Discriminant = B * B - C;
+                    if (Discriminant >= 0.f) {
+                        float T = -B - std::sqrt(Discriminant);
+                        if (T > InRay.TMin && T < InRay.TMax) {
+                            // Spheres never leave their cell, so the first hit along the walk is the closest
+                            Hit.T = T;
+                            Hit.PrimitiveID = CellIndex;
+                            Hit.MaterialID = CellSphere.MaterialID;
+                            return Hit;
+                        }
+                    }
+                }
+
+                int Axis = TNext[0] < TNext[1] ? (TNext[0] < TNext[2] ? 0 : 2) : (TNext[1] < TNext[2] ? 1 : 2);
+                if (TNext[Axis] > TExit) {
+                    return Hit;
+                }
+                Cell[Axis] += Step[Axis];
+                if (Cell[Axis] < 0 || Cell[Axis] >= Resolution) {
+                    return Hit;
+                }
+                TNext[Axis] += TDelta[Axis];
+            }
+        }
+
+        // Bilinear texture fetch and a diffuse bounce, returns false when the path is terminated
+        auto Shade(const Ray &InRay, const RayHit &Hit, uint PathID, uint Depth, glm::vec3 &Throughput,
+                   Ray &OutRay) const -> bool {
+            if (!Hit.IsValid()) {
+                return false;
+            }
+            const Sphere &HitSphere = Cells[Hit.PrimitiveID];
+            glm::vec3 Position = InRay.At(Hit.T);
+            glm::vec3 Normal = glm::normalize(Position - HitSphere.Center);
+
+            float U = (std::atan2(Normal.z, Normal.x) / 3.14159265f * .5f + .5f) * (TextureSize - 1);
+            float V = std::acos(std::clamp(Normal.y, -1.f, 1.f)) / 3.14159265f * (TextureSize - 1);
+            uint X0 = std::min(static_cast<uint>(U), TextureSize - 2);
+            uint Y0 = std::min(static_cast<uint>(V), TextureSize - 2);
+            float FX = U - static_cast<float>(X0), FY = V - static_cast<float>(Y0);
+            const glm::vec4 *Texture = Textures.data() + static_cast<size_t>(Hit.MaterialID) * TextureSize * TextureSize;
+            glm::vec4 Albedo = (Texture[Y0 * TextureSize + X0] * (1.f - FX) + Texture[Y0 * TextureSize + X0 + 1] * FX) *
+                               (1.f - FY) +
+                               (Texture[(Y0 + 1) * TextureSize + X0] * (1.f - FX) +
+                                Texture[(Y0 + 1) * TextureSize + X0 + 1] * FX) * FY;
+            Throughput *= glm::vec3(Albedo);
+
+            // Path seeded random numbers keep the result independent of the processing order
+            PCGRandom Random(SobolSequence::HashCombine(PathID, Depth), PathID);
+            float Z = 1.f - 2.f * Random.NextFloat();
+            float Phi = 2.f * 3.14159265f * Random.NextFloat();
+            float R = std::sqrt(std::max(0.f, 1.f - Z * Z));
+            glm::vec3 Direction = Normal + glm::vec3(R * std::cos(Phi), R * std::sin(Phi), Z);
+            OutRay.Origin = Position + Normal * 1e-3f;
+            OutRay.Direction = glm::normalize(glm::dot(Direction, Direction) > 1e-8f ? Direction : Normal);
+            OutRay.TMin = 0.f;
+            OutRay.TMax = std::numeric_limits<float>::max();
+            return true;
+        }
+    };
+
+    void RaySorter::BenchmarkBounces(uint NumRays, uint MaxDepth, RaySortKeyType Type) {
+        using Clock = std::chrono::high_resolution_clock;
+        auto ElapsedMs = [](Clock::time_point Start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        };
+
+        SphereGridScene Scene;
+        ThreadPool &Pool = ThreadPool::Get();
+
+        // Coherent camera rays entering the grid from the -X side
+        std::vector<Ray> Rays(NumRays);
+        std::vector<uint> PathIDs(NumRays);
+        std::vector<glm::vec3> Throughputs(NumRays, glm::vec3(1.f));
+        const auto Side = static_cast<uint>(std::sqrt(static_cast<float>(NumRays)));
+        const float GridSize = static_cast<float>(SphereGridScene::GridResolution);
+        for (uint i = 0; i < NumRays; i++) {
+            float X = (static_cast<float>(i % Side) + .5f) / static_cast<float>(Side) - .5f;
+            float Y = (static_cast<float>(i / Side) + .5f) / static_cast<float>(Side) - .5f;
+            Rays[i].Origin = glm::vec3(-GridSize * .5f, GridSize * .5f, GridSize * .5f);
+            Rays[i].Direction = glm::normalize(glm::vec3(1.f, Y, X));
+            PathIDs[i] = i;
+        }
+
+        std::cout << "RaySorter " << NumRays << " paths, " << (Type == RaySortKeyType::Morton ? "Morton" : "cell/octant")
+                  << " keys, " << Pool.GetNumThreads() << " threads\n";
+        std::cout << "Depth | Rays | Unsorted ms | Sort ms | Sorted trace+shade ms | Speedup\n";
+
+        std::vector<RayHit> Hits;
+        std::vector<Ray> NextRays;
+        std::vector<uint8_t> Alive;
+        for (uint Depth = 0; Depth < MaxDepth && !Rays.empty(); Depth++) {
+            const auto Count = static_cast<uint>(Rays.size());
+            Hits.assign(Count, RayHit());
+            NextRays.assign(Count, Ray());
+            Alive.assign(Count, 0);
+            std::vector<glm::vec3> ScratchThroughputs = Throughputs;
+
+            // Generation order
+            auto Start = Clock::now();
+            Pool.ParallelFor(Count, [&](uint Begin, uint End) {
+                for (uint i = Begin; i < End; i++) {
+                    Hits[i] = Scene.Trace(Rays[i]);
+                }
+            }, 256);
+            Pool.ParallelFor(Count, [&](uint Begin, uint End) {
+                for (uint i = Begin; i < End; i++) {
+                    Alive[i] = Scene.Shade(Rays[i], Hits[i], PathIDs[i], Depth, Throughputs[PathIDs[i]],
+                                           NextRays[i]) ? 1 : 0;
+                }
+            }, 256);
+            double UnsortedMs = ElapsedMs(Start);
+
+            // Sorted, the reordering is part of the cost
+            Start = Clock::now();
+            std::vector<uint> RayOrder = SortRays(Rays, Scene.Bounds, Type);
+            std::vector<Ray> SortedRays(Count);
+            for (uint i = 0; i < Count; i++) {
+                SortedRays[i] = Rays[RayOrder[i]];
+            }
+            double SortMs = ElapsedMs(Start);
+
+            auto TraceStart = Clock::now();
+            std::vector<RayHit> SortedHits(Count);
+            Pool.ParallelFor(Count, [&](uint Begin, uint End) {
+                for (uint i = Begin; i < End; i++) {
+                    SortedHits[i] = Scene.Trace(SortedRays[i]);
+                }
+            }, 256);
+            double SortedMs = ElapsedMs(TraceStart);
+
+            Start = Clock::now();
+            std::vector<uint> HitOrder = SortHitsByMaterial(SortedHits, SphereGridScene::NumMaterials);
+            SortMs += ElapsedMs(Start);
+
+            auto ShadeStart = Clock::now();
+            std::vector<Ray> SortedNextRays(Count);
+            Pool.ParallelFor(Count, [&](uint Begin, uint End) {
+                for (uint i = Begin; i < End; i++) {
+                    uint Index = HitOrder[i];
+                    uint PathID = PathIDs[RayOrder[Index]];
+                    Scene.Shade(SortedRays[Index], SortedHits[Index], PathID, Depth, ScratchThroughputs[PathID],
+                                SortedNextRays[i]);
+                }
+            }, 256);
+            SortedMs += ElapsedMs(ShadeStart);
+
+            std::cout << Depth << " | " << Count << " | " << UnsortedMs << " | " << SortMs << " | " << SortedMs
+                      << " | " << UnsortedMs / (SortMs + SortedMs) << "x\n";
+
+            // Both orders produce the same paths, continue with the compacted generation order result
+            uint NumAlive = 0;
+            for (uint i = 0; i < Count; i++) {
+                if (Alive[i]) {
+                    Rays[NumAlive] = NextRays[i];
+                    PathIDs[NumAlive] = PathIDs[i];
+                    NumAlive++;
+                }
+            }
+            Rays.resize(NumAlive);
+            PathIDs.resize(NumAlive);
+        }
+        std::cout.flush();
+    }
+}  // namespace HWPT
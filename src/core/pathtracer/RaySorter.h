@@ -0,0 +1,46 @@
+//
+// Created by HUSTLX on 2024/10/22.
+//
+
+#ifndef HARDWAREPATHTRACER_RAYSORTER_H
+#define HARDWAREPATHTRACER_RAYSORTER_H
+
+#include "core/Core.h"
+#include "core/pathtracer/Ray.h"
+#include <vector>
+
+
+namespace HWPT {
+    enum class RaySortKeyType : uint8_t {
+        // [Octant:3][Linear origin cell in a 32^3 grid:15]
+        OriginDirection,
+        // [Octant:3][Morton code of the origin, 9 bits per axis:27]
+        Morton
+    };
+
+    // Reorders secondary rays before traversal and hits before shading, so neighbouring rays walk the
+    // same nodes and neighbouring hits fetch the same material data
+    class RaySorter {
+    public:
+        static auto GetKeyBits(RaySortKeyType Type) -> uint;
+
+        static void ComputeKeys(const std::vector<Ray>& Rays, const AABB& SceneBounds, RaySortKeyType Type,
+                                std::vector<uint>& Keys);
+
+        // Stable parallel LSD radix sort with 8 bit digits, only the low NumKeyBits bits are sorted
+        static void RadixSort(std::vector<uint>& Keys, std::vector<uint>& Values, uint NumKeyBits = 32);
+
+        // Permutations, Result[i] is the index of the ray or hit that should be processed i-th
+        static auto SortRays(const std::vector<Ray>& Rays, const AABB& SceneBounds,
+                             RaySortKeyType Type = RaySortKeyType::Morton) -> std::vector<uint>;
+
+        static auto SortHitsByMaterial(const std::vector<RayHit>& Hits, uint NumMaterials) -> std::vector<uint>;
+
+        // Traces a synthetic scene of textured spheres bounce by bounce, once in generation order and once
+        // with ray and hit sorting, and reports the per-depth timings and speedup
+        static void BenchmarkBounces(uint NumRays = 1u << 20, uint MaxDepth = 6,
+                                     RaySortKeyType Type = RaySortKeyType::Morton);
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_RAYSORTER_H
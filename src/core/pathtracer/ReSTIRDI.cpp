@@ -0,0 +1,665 @@
+//
+// Created by HUSTLX on 2024/10/27.
+//
+
+#include "ReSTIRDI.h"
+#include "core/ThreadPool.h"
+#include "core/accel/BVH.h"
+#include "core/application/VulkanBackendApp.h"
+#include "core/sampling/AliasTable.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <string>
+
+
+namespace HWPT {
+    static constexpr uint ReSTIRGroupSize = 8;
+    static constexpr uint TemporalFlag = 1u << 0;
+    static constexpr uint SpatialFlag = 1u << 1;
+    static constexpr float ReSTIRPI = 3.14159265358979323846f;
+
+    static_assert(sizeof(PointLight) == 32, "PointLight has to match the HLSL layout");
+    static_assert(sizeof(GBufferTexel) == 32, "GBufferTexel has to match the HLSL layout");
+    static_assert(sizeof(PackedReservoir) == 12, "PackedReservoir has to match the HLSL layout");
+
+    ReSTIRDI::ReSTIRDI(uint Width, uint Height, const std::vector<PointLight> &Lights, GPUBVH* Scene)
+            : m_width(Width), m_height(Height), m_numLights(static_cast<uint>(Lights.size())) {
+        if (Lights.empty()) {
+            throw std::runtime_error("ReSTIRDI needs at least one light");
+        }
+        std::vector<float> Powers(m_numLights);
+        for (uint i = 0; i < m_numLights; i++) {
+            Powers[i] = Lights[i].Power;
+        }
+        AliasTable LightTable(Powers.data(), m_numLights);
+        m_lightWeightSum = LightTable.GetWeightSum();
+
+        const uint NumPixels = m_width * m_height;
+        m_lightBuffer = new StorageBuffer(sizeof(PointLight) * m_numLights, const_cast<PointLight*>(Lights.data()));
+        m_lightAliasBuffer = new StorageBuffer(sizeof(AliasEntry) * m_numLights,
+                                               const_cast<AliasEntry*>(LightTable.GetEntries().data()));
+        for (int i = 0; i < 2; i++) {
+            m_gBuffers[i] = new StorageBuffer(sizeof(GBufferTexel) * NumPixels, nullptr);
+            m_historyReservoirs[i] = new StorageBuffer(sizeof(PackedReservoir) * NumPixels, nullptr);
+        }
+        m_motionVectorBuffer = new StorageBuffer(sizeof(glm::vec2) * NumPixels, nullptr);
+        m_candidateReservoirs = new StorageBuffer(sizeof(PackedReservoir) * NumPixels, nullptr);
+        m_temporalReservoirs = new StorageBuffer(sizeof(PackedReservoir) * NumPixels, nullptr);
+        m_outputBuffer = new StorageBuffer(sizeof(glm::vec4) * NumPixels, nullptr);
+
+        // Bindings 0-3 are the BVH, see shader/HLSL/BVHTraversal.hlsl
+        const char* EntryNames[NumPasses] = {"ReSTIRInitial", "ReSTIRTemporal", "ReSTIRSpatial", "ReSTIRShade"};
+        const std::vector<VkDescriptorType> Bindings(14, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        for (uint PassIndex = 0; PassIndex < NumPasses; PassIndex++) {
+            auto* Kernel = new ComputeKernel(std::string("../../shader/HLSL/") + EntryNames[PassIndex] + ".spv",
+                                             EntryNames[PassIndex], Bindings, sizeof(Constants), 2);
+            m_kernels[PassIndex] = Kernel;
+            for (int i = 0; i < 2; i++) {
+                VkBuffer Buffers[14] = {
+                        Scene->GetNodeBuffer()->GetHandle(), Scene->GetPositionBuffer()->GetHandle(),
+                        Scene->GetIndexBuffer()->GetHandle(), Scene->GetHeaderBuffer()->GetHandle(),
+                        m_lightBuffer->GetHandle(), m_lightAliasBuffer->GetHandle(),
+                        m_gBuffers[i]->GetHandle(), m_gBuffers[1 - i]->GetHandle(),
+                        m_motionVectorBuffer->GetHandle(), m_candidateReservoirs->GetHandle(),
+                        m_temporalReservoirs->GetHandle(), m_historyReservoirs[1 - i]->GetHandle(),
+                        m_historyReservoirs[i]->GetHandle(), m_outputBuffer->GetHandle()
+                };
+                m_sets[PassIndex][i] = Kernel->AllocateDescriptorSet();
+                for (uint Binding = 0; Binding < 14; Binding++) {
+                    Kernel->UpdateBuffer(m_sets[PassIndex][i], Binding, Buffers[Binding]);
+                }
+            }
+        }
+    }
+
+    ReSTIRDI::~ReSTIRDI() {
+        for (auto* Kernel: m_kernels) {
+            delete Kernel;
+        }
+        delete m_lightBuffer;
+        delete m_lightAliasBuffer;
+        for (int i = 0; i < 2; i++) {
+            delete m_gBuffers[i];
+            delete m_historyReservoirs[i];
+        }
+        delete m_motionVectorBuffer;
+        delete m_candidateReservoirs;
+        delete m_temporalReservoirs;
+        delete m_outputBuffer;
+    }
+
+    void ReSTIRDI::Record(VkCommandBuffer CommandBuffer, const ReSTIRSettings &Settings) {
+        Constants FrameConstants{};
+        FrameConstants.Width = m_width;
+        FrameConstants.Height = m_height;
+        FrameConstants.NumLights = m_numLights;
+        FrameConstants.FrameIndex = m_frameIndex;
+        FrameConstants.NumCandidates = std::max(Settings.NumCandidates, 1u);
+        FrameConstants.MaxHistory = Settings.MaxHistory;
+        FrameConstants.NumSpatialSamples = Settings.NumSpatialSamples;
+        // The first frame has no history to reuse
+        FrameConstants.Flags = (Settings.Temporal && m_frameIndex > 0 ? TemporalFlag : 0u) |
+                               (Settings.Spatial ? SpatialFlag : 0u);
+        FrameConstants.SpatialRadius = Settings.SpatialRadius;
+        FrameConstants.DepthThreshold = Settings.DepthThreshold;
+        FrameConstants.NormalThreshold = Settings.NormalThreshold;
+        FrameConstants.LightWeightSum = m_lightWeightSum;
+
+        const uint GroupsX = (m_width + ReSTIRGroupSize - 1) / ReSTIRGroupSize;
+        const uint GroupsY = (m_height + ReSTIRGroupSize - 1) / ReSTIRGroupSize;
+        for (uint PassIndex = 0; PassIndex < NumPasses; PassIndex++) {
+            m_kernels[PassIndex]->Dispatch(CommandBuffer, m_sets[PassIndex][m_parity], GroupsX, GroupsY, 1,
+                                           &FrameConstants);
+            ComputeKernel::Barrier(CommandBuffer);
+        }
+        m_frameIndex++;
+        m_parity = 1 - m_parity;
+    }
+
+    // ---------------------------------------------------------------------------------------------- CPU
+    // Mirrors shader/HLSL/ReSTIRDI.hlsl, only the random numbers differ
+
+    namespace {
+        struct ReSTIRScene {
+            std::vector<glm::vec3> Positions;
+            std::vector<uint> Indices;
+            std::vector<glm::vec3> TriangleAlbedo;
+            BVH Tree;
+            std::vector<PointLight> Lights;
+            AliasTable LightTable;
+        };
+
+        struct ReSTIRCamera {
+            glm::vec3 Position;
+            glm::vec3 Forward, Right, Up;
+            float TanHalfFov;
+            float Aspect;
+            uint Width, Height;
+
+            ReSTIRCamera(const glm::vec3& InPosition, const glm::vec3& Target, uint InWidth, uint InHeight)
+                    : Position(InPosition), TanHalfFov(std::tan(.5f * glm::radians(45.f))),
+                      Aspect(static_cast<float>(InWidth) / static_cast<float>(InHeight)), Width(InWidth),
+                      Height(InHeight) {
+                Forward = glm::normalize(Target - Position);
+                Right = glm::normalize(glm::cross(Forward, glm::vec3(0.f, 1.f, 0.f)));
+                Up = glm::cross(Right, Forward);
+            }
+
+            [[nodiscard]] auto GenerateRay(uint X, uint Y) const -> Ray {
+                float NDCX = (static_cast<float>(X) + .5f) / static_cast<float>(Width) * 2.f - 1.f;
+                float NDCY = 1.f - (static_cast<float>(Y) + .5f) / static_cast<float>(Height) * 2.f;
+                Ray Primary;
+                Primary.Origin = Position;
+                Primary.Direction = glm::normalize(Forward + Right * (NDCX * TanHalfFov * Aspect) +
+                                                   Up * (NDCY * TanHalfFov));
+                return Primary;
+            }
+
+            // Pixel coordinates with pixel centers on integers, the convention of the motion vectors
+            [[nodiscard]] auto Project(const glm::vec3& Point) const -> glm::vec2 {
+                glm::vec3 Offset = Point - Position;
+                float Depth = std::max(glm::dot(Offset, Forward), 1e-6f);
+                float NDCX = glm::dot(Offset, Right) / (Depth * TanHalfFov * Aspect);
+                float NDCY = glm::dot(Offset, Up) / (Depth * TanHalfFov);
+                return {(NDCX + 1.f) * .5f * static_cast<float>(Width) - .5f,
+                        (1.f - NDCY) * .5f * static_cast<float>(Height) - .5f};
+            }
+        };
+
+        struct Reservoir {
+            uint LightIndex = ~0u;
+            float WeightSum = 0.f;
+            uint M = 0;
+            float TargetPdf = 0.f;
+        };
+
+        // Inputs and reservoirs of one frame, the same buffers the GPU passes bind
+        struct ReSTIRFrame {
+            const ReSTIRScene* Scene = nullptr;
+            const ReSTIRSettings* Settings = nullptr;
+            uint Width = 0, Height = 0, FrameIndex = 0;
+            bool Temporal = false;
+            const std::vector<GBufferTexel>* GBuffer = nullptr;
+            const std::vector<GBufferTexel>* PrevGBuffer = nullptr;
+            const std::vector<glm::vec2>* MotionVectors = nullptr;
+            std::vector<PackedReservoir>* Candidates = nullptr;
+            std::vector<PackedReservoir>* Temporals = nullptr;
+            const std::vector<PackedReservoir>* PrevHistory = nullptr;
+            std::vector<PackedReservoir>* History = nullptr;
+            std::vector<glm::vec3>* Output = nullptr;
+        };
+    }
+
+    static auto PackAlbedo(const glm::vec3& Albedo) -> uint {
+        glm::uvec3 Bytes = glm::uvec3(glm::clamp(Albedo, 0.f, 1.f) * 255.f + .5f);
+        return Bytes.x | (Bytes.y << 8u) | (Bytes.z << 16u) | (255u << 24u);
+    }
+
+    static auto UnpackAlbedo(uint Packed) -> glm::vec3 {
+        return glm::vec3(static_cast<float>(Packed & 0xffu), static_cast<float>((Packed >> 8u) & 0xffu),
+                         static_cast<float>((Packed >> 16u) & 0xffu)) / 255.f;
+    }
+
+    static auto Luminance(const glm::vec3& Color) -> float {
+        return glm::dot(Color, glm::vec3(.2126f, .7152f, .0722f));
+    }
+
+    static auto EvaluateLight(const ReSTIRScene& Scene, const GBufferTexel& Texel, uint LightIndex) -> glm::vec3 {
+        const PointLight& Light = Scene.Lights[LightIndex];
+        glm::vec3 ToLight = Light.Position - Texel.Position;
+        float DistanceSquared = std::max(glm::dot(ToLight, ToLight), 1e-8f);
+        float CosTheta = glm::dot(Texel.Normal, ToLight) / std::sqrt(DistanceSquared);
+        return UnpackAlbedo(Texel.Albedo) / ReSTIRPI * Light.Intensity * std::max(CosTheta, 0.f) /
+               DistanceSquared;
+    }
+
+    static auto TargetPdf(const ReSTIRScene& Scene, const GBufferTexel& Texel, uint LightIndex) -> float {
+        return LightIndex < Scene.Lights.size() ? Luminance(EvaluateLight(Scene, Texel, LightIndex)) : 0.f;
+    }
+
+    static auto IsLightVisible(const ReSTIRScene& Scene, const GBufferTexel& Texel, uint LightIndex) -> bool {
+        Ray Shadow;
+        Shadow.Origin = Texel.Position + Texel.Normal * 1e-3f;
+        Shadow.Direction = Scene.Lights[LightIndex].Position - Shadow.Origin;
+        Shadow.TMin = 0.f;
+        Shadow.TMax = .999f;
+        return !Scene.Tree.IsOccluded(Shadow);
+    }
+
+    static auto UpdateReservoir(Reservoir& Result, uint LightIndex, float Weight, float Pdf, uint M,
+                                float U) -> bool {
+        Result.WeightSum += Weight;
+        Result.M += M;
+        if (Weight > 0.f && U * Result.WeightSum < Weight) {
+            Result.LightIndex = LightIndex;
+            Result.TargetPdf = Pdf;
+            return true;
+        }
+        return false;
+    }
+
+    static void MergeReservoir(const ReSTIRScene& Scene, Reservoir& Result, const PackedReservoir& Other,
+                               const GBufferTexel& Texel, float U) {
+        if (Other.M == 0) {
+            return;
+        }
+        float Pdf = TargetPdf(Scene, Texel, Other.LightIndex);
+        UpdateReservoir(Result, Other.LightIndex, Pdf * Other.W * static_cast<float>(Other.M), Pdf, Other.M, U);
+    }
+
+    static auto PackReservoir(const Reservoir& Result) -> PackedReservoir {
+        PackedReservoir Packed;
+        Packed.LightIndex = Result.LightIndex;
+        Packed.M = Result.M;
+        Packed.W = Result.TargetPdf > 0.f ? Result.WeightSum / (static_cast<float>(Result.M) * Result.TargetPdf)
+                                          : 0.f;
+        return Packed;
+    }
+
+    static auto IsSimilar(const ReSTIRSettings& Settings, const GBufferTexel& Texel, const GBufferTexel& Other) -> bool {
+        return Other.ViewDepth > 0.f &&
+               std::abs(Other.ViewDepth - Texel.ViewDepth) <= Settings.DepthThreshold * Texel.ViewDepth &&
+               glm::dot(Other.Normal, Texel.Normal) >= Settings.NormalThreshold;
+    }
+
+    static auto SampleLight(const ReSTIRScene& Scene, float U, float& Pdf) -> uint {
+        return Scene.LightTable.Sample(U, &Pdf);
+    }
+
+    static auto PixelRandom(uint PixelIndex, uint FrameIndex, uint Pass) -> PCGRandom {
+        return PCGRandom((static_cast<uint64_t>(FrameIndex) << 32u) | PixelIndex, Pass);
+    }
+
+    static void ParallelPixels(uint NumPixels, const std::function<void(uint PixelIndex)>& Func) {
+        ThreadPool::Get().ParallelFor(NumPixels, [&](uint Begin, uint End) {
+            for (uint i = Begin; i < End; i++) {
+                Func(i);
+            }
+        }, 256);
+    }
+
+    static void RunInitialPass(const ReSTIRFrame& Frame) {
+        const ReSTIRScene& Scene = *Frame.Scene;
+        ParallelPixels(Frame.Width * Frame.Height, [&](uint PixelIndex) {
+            const GBufferTexel& Texel = (*Frame.GBuffer)[PixelIndex];
+            if (Texel.ViewDepth <= 0.f) {
+                (*Frame.Candidates)[PixelIndex] = PackedReservoir{};
+                return;
+            }
+            PCGRandom Random = PixelRandom(PixelIndex, Frame.FrameIndex, 0);
+            Reservoir Result;
+            for (uint i = 0; i < std::max(Frame.Settings->NumCandidates, 1u); i++) {
+                float SourcePdf;
+                uint LightIndex = SampleLight(Scene, Random.NextFloat(), SourcePdf);
+                float Pdf = TargetPdf(Scene, Texel, LightIndex);
+                UpdateReservoir(Result, LightIndex, Pdf / SourcePdf, Pdf, 1, Random.NextFloat());
+            }
+            PackedReservoir Packed = PackReservoir(Result);
+            if (Packed.W > 0.f && !IsLightVisible(Scene, Texel, Packed.LightIndex)) {
+                Packed.W = 0.f;
+            }
+            (*Frame.Candidates)[PixelIndex] = Packed;
+        });
+    }
+
+    static void RunTemporalPass(const ReSTIRFrame& Frame) {
+        const ReSTIRScene& Scene = *Frame.Scene;
+        ParallelPixels(Frame.Width * Frame.Height, [&](uint PixelIndex) {
+            const PackedReservoir& Current = (*Frame.Candidates)[PixelIndex];
+            const GBufferTexel& Texel = (*Frame.GBuffer)[PixelIndex];
+            if (!Frame.Temporal || Texel.ViewDepth <= 0.f) {
+                (*Frame.Temporals)[PixelIndex] = Current;
+                return;
+            }
+            PCGRandom Random = PixelRandom(PixelIndex, Frame.FrameIndex, 1);
+            Reservoir Result;
+            MergeReservoir(Scene, Result, Current, Texel, Random.NextFloat());
+
+            glm::vec2 Pixel(static_cast<float>(PixelIndex % Frame.Width), static_cast<float>(PixelIndex / Frame.Width));
+            glm::vec2 Previous = glm::floor(Pixel + .5f + (*Frame.MotionVectors)[PixelIndex]);
+            if (Previous.x >= 0.f && Previous.y >= 0.f && Previous.x < static_cast<float>(Frame.Width) &&
+                Previous.y < static_cast<float>(Frame.Height)) {
+                uint PrevIndex = static_cast<uint>(Previous.y) * Frame.Width + static_cast<uint>(Previous.x);
+                if (IsSimilar(*Frame.Settings, Texel, (*Frame.PrevGBuffer)[PrevIndex])) {
+                    PackedReservoir History = (*Frame.PrevHistory)[PrevIndex];
+                    History.M = std::min(History.M, Frame.Settings->MaxHistory * std::max(Current.M, 1u));
+                    MergeReservoir(Scene, Result, History, Texel, Random.NextFloat());
+                }
+            }
+            (*Frame.Temporals)[PixelIndex] = PackReservoir(Result);
+        });
+    }
+
+    static void RunSpatialPass(const ReSTIRFrame& Frame) {
+        const ReSTIRScene& Scene = *Frame.Scene;
+        const ReSTIRSettings& Settings = *Frame.Settings;
+        ParallelPixels(Frame.Width * Frame.Height, [&](uint PixelIndex) {
+            const PackedReservoir& Center = (*Frame.Temporals)[PixelIndex];
+            const GBufferTexel& Texel = (*Frame.GBuffer)[PixelIndex];
+            if (!Settings.Spatial || Texel.ViewDepth <= 0.f) {
+                (*Frame.History)[PixelIndex] = Center;
+                return;
+            }
+            PCGRandom Random = PixelRandom(PixelIndex, Frame.FrameIndex, 2);
+            Reservoir Result;
+            MergeReservoir(Scene, Result, Center, Texel, Random.NextFloat());
+            const int X = static_cast<int>(PixelIndex % Frame.Width), Y = static_cast<int>(PixelIndex / Frame.Width);
+            for (uint i = 0; i < Settings.NumSpatialSamples; i++) {
+                float Radius = Settings.SpatialRadius * std::sqrt(Random.NextFloat());
+                float Angle = 2.f * ReSTIRPI * Random.NextFloat();
+                int NeighbourX = X + static_cast<int>(std::round(Radius * std::cos(Angle)));
+                int NeighbourY = Y + static_cast<int>(std::round(Radius * std::sin(Angle)));
+                if (NeighbourX < 0 || NeighbourY < 0 || NeighbourX >= static_cast<int>(Frame.Width) ||
+                    NeighbourY >= static_cast<int>(Frame.Height)) {
+                    continue;
+                }
+                uint NeighbourIndex = static_cast<uint>(NeighbourY) * Frame.Width + static_cast<uint>(NeighbourX);
+                if (NeighbourIndex != PixelIndex && IsSimilar(Settings, Texel, (*Frame.GBuffer)[NeighbourIndex])) {
+                    MergeReservoir(Scene, Result, (*Frame.Temporals)[NeighbourIndex], Texel, Random.NextFloat());
+                }
+            }
+            (*Frame.History)[PixelIndex] = PackReservoir(Result);
+        });
+    }
+
+    static void RunShadePass(const ReSTIRFrame& Frame) {
+        const ReSTIRScene& Scene = *Frame.Scene;
+        ParallelPixels(Frame.Width * Frame.Height, [&](uint PixelIndex) {
+            const PackedReservoir& Final = (*Frame.History)[PixelIndex];
+            const GBufferTexel& Texel = (*Frame.GBuffer)[PixelIndex];
+            glm::vec3 Radiance(0.f);
+            if (Texel.ViewDepth > 0.f && Final.W > 0.f && Final.LightIndex < Scene.Lights.size() &&
+                IsLightVisible(Scene, Texel, Final.LightIndex)) {
+                Radiance = EvaluateLight(Scene, Texel, Final.LightIndex) * Final.W;
+            }
+            (*Frame.Output)[PixelIndex] = Radiance;
+        });
+    }
+
+    static auto CreateReSTIRScene(uint NumLights) -> ReSTIRScene {
+        ReSTIRScene Scene;
+        PCGRandom Random(7);
+        auto AddQuad = [&](const glm::vec3& A, const glm::vec3& B, const glm::vec3& C, const glm::vec3& D,
+                           const glm::vec3& Albedo) {
+            auto Base = static_cast<uint>(Scene.Positions.size());
+            Scene.Positions.insert(Scene.Positions.end(), {A, B, C, D});
+            Scene.Indices.insert(Scene.Indices.end(), {Base, Base + 1, Base + 2, Base, Base + 2, Base + 3});
+            Scene.TriangleAlbedo.insert(Scene.TriangleAlbedo.end(), {Albedo, Albedo});
+        };
+
+        const float GroundSize = 20.f;
+        AddQuad({-GroundSize, 0.f, -GroundSize}, {GroundSize, 0.f, -GroundSize}, {GroundSize, 0.f, GroundSize},
+                {-GroundSize, 0.f, GroundSize}, glm::vec3(.7f));
+        // Boxes that cast the shadows plain light sampling struggles with
+        for (uint i = 0; i < 48; i++) {
+            glm::vec3 Center(Random.NextFloat() * 32.f - 16.f, 0.f, Random.NextFloat() * 32.f - 16.f);
+            glm::vec3 HalfSize(.25f + Random.NextFloat(), .25f + 1.75f * Random.NextFloat(), .25f + Random.NextFloat());
+            glm::vec3 Albedo = glm::vec3(.2f) + .6f * glm::vec3(Random.NextFloat(), Random.NextFloat(),
+                                                                Random.NextFloat());
+            glm::vec3 Min = Center - glm::vec3(HalfSize.x, 0.f, HalfSize.z);
+            glm::vec3 Max = Center + glm::vec3(HalfSize.x, 2.f * HalfSize.y, HalfSize.z);
+            auto Corner = [&](uint Mask) {
+                return glm::vec3(Mask & 1u ? Max.x : Min.x, Mask & 2u ? Max.y : Min.y, Mask & 4u ? Max.z : Min.z);
+            };
+            AddQuad(Corner(0), Corner(1), Corner(3), Corner(2), Albedo);
+            AddQuad(Corner(4), Corner(5), Corner(7), Corner(6), Albedo);
+            AddQuad(Corner(0), Corner(1), Corner(5), Corner(4), Albedo);
+            AddQuad(Corner(2), Corner(3), Corner(7), Corner(6), Albedo);
+            AddQuad(Corner(0), Corner(2), Corner(6), Corner(4), Albedo);
+            AddQuad(Corner(1), Corner(3), Corner(7), Corner(5), Albedo);
+        }
+        Scene.Tree.Build(Scene.Positions, Scene.Indices);
+
+        // Heavy-tailed powers, a few lights dominate like in real scenes
+        Scene.Lights.resize(NumLights);
+        std::vector<float> Powers(NumLights);
+        for (uint i = 0; i < NumLights; i++) {
+            PointLight& Light = Scene.Lights[i];
+            Light.Position = glm::vec3(Random.NextFloat() * 36.f - 18.f, .3f + 3.2f * Random.NextFloat(),
+                                       Random.NextFloat() * 36.f - 18.f);
+            glm::vec3 Color = glm::vec3(.2f) + .8f * glm::vec3(Random.NextFloat(), Random.NextFloat(),
+                                                               Random.NextFloat());
+            Light.Intensity = Color * std::min(2.f / std::pow(std::max(Random.NextFloat(), 1e-3f), 1.5f), 200.f);
+            Light.Power = 4.f * ReSTIRPI * Luminance(Light.Intensity);
+            Powers[i] = Light.Power;
+        }
+        Scene.LightTable.Build(Powers.data(), NumLights);
+        return Scene;
+    }
+
+    static void RenderGBuffer(const ReSTIRScene& Scene, const ReSTIRCamera& Camera, const ReSTIRCamera& PrevCamera,
+                              std::vector<GBufferTexel>& GBuffer, std::vector<glm::vec2>& MotionVectors) {
+        const uint NumPixels = Camera.Width * Camera.Height;
+        GBuffer.assign(NumPixels, GBufferTexel{});
+        MotionVectors.assign(NumPixels, glm::vec2(0.f));
+        ParallelPixels(NumPixels, [&](uint PixelIndex) {
+            uint X = PixelIndex % Camera.Width, Y = PixelIndex / Camera.Width;
+            Ray Primary = Camera.GenerateRay(X, Y);
+            RayHit Hit;
+            if (!Scene.Tree.Intersect(Primary, Hit)) {
+                return;
+            }
+            const uint* Triangle = &Scene.Indices[3 * Hit.PrimitiveID];
+            glm::vec3 Normal = glm::normalize(glm::cross(Scene.Positions[Triangle[1]] - Scene.Positions[Triangle[0]],
+                                                         Scene.Positions[Triangle[2]] - Scene.Positions[Triangle[0]]));
+            if (glm::dot(Normal, Primary.Direction) > 0.f) {
+                Normal = -Normal;
+            }
+            GBufferTexel& Texel = GBuffer[PixelIndex];
+            Texel.Position = Primary.At(Hit.T);
+            Texel.ViewDepth = glm::dot(Texel.Position - Camera.Position, Camera.Forward);
+            Texel.Normal = Normal;
+            Texel.Albedo = PackAlbedo(Scene.TriangleAlbedo[Hit.PrimitiveID]);
+            MotionVectors[PixelIndex] = PrevCamera.Project(Texel.Position) -
+                                        glm::vec2(static_cast<float>(X), static_cast<float>(Y));
+        });
+    }
+
+    static auto CameraAt(uint Frame, uint Width, uint Height) -> ReSTIRCamera {
+        float Offset = .15f * static_cast<float>(Frame);
+        return {{Offset - 2.f, 9.f, -22.f}, {Offset, 0.f, 0.f}, Width, Height};
+    }
+
+    // G-buffers of a sideways camera path over the scene
+    static void RenderCameraPath(const ReSTIRScene& Scene, uint Width, uint Height, uint NumFrames,
+                                 std::vector<std::vector<GBufferTexel>>& GBuffers,
+                                 std::vector<std::vector<glm::vec2>>& MotionVectors) {
+        GBuffers.resize(NumFrames);
+        MotionVectors.resize(NumFrames);
+        for (uint Frame = 0; Frame < NumFrames; Frame++) {
+            RenderGBuffer(Scene, CameraAt(Frame, Width, Height), CameraAt(Frame > 0 ? Frame - 1 : 0, Width, Height),
+                          GBuffers[Frame], MotionVectors[Frame]);
+        }
+    }
+
+    // Exact direct lighting, the sum over every light with its shadow ray
+    static auto RenderReference(const ReSTIRScene& Scene, const std::vector<GBufferTexel>& GBuffer)
+            -> std::vector<glm::vec3> {
+        std::vector<glm::vec3> Reference(GBuffer.size(), glm::vec3(0.f));
+        ParallelPixels(static_cast<uint>(GBuffer.size()), [&](uint PixelIndex) {
+            const GBufferTexel& Texel = GBuffer[PixelIndex];
+            if (Texel.ViewDepth <= 0.f) {
+                return;
+            }
+            for (uint LightIndex = 0; LightIndex < Scene.Lights.size(); LightIndex++) {
+                glm::vec3 Contribution = EvaluateLight(Scene, Texel, LightIndex);
+                if (Luminance(Contribution) > 0.f && IsLightVisible(Scene, Texel, LightIndex)) {
+                    Reference[PixelIndex] += Contribution;
+                }
+            }
+        });
+        return Reference;
+    }
+
+    // Runs the CPU passes over the whole camera path, returns the average ms per frame and the last frame's image
+    static auto RenderReSTIRCPU(const ReSTIRScene& Scene, const ReSTIRSettings& Config, uint Width, uint Height,
+                                const std::vector<std::vector<GBufferTexel>>& GBuffers,
+                                const std::vector<std::vector<glm::vec2>>& MotionVectors,
+                                std::vector<glm::vec3>& Image) -> double {
+        const uint NumPixels = Width * Height;
+        const auto NumFrames = static_cast<uint>(GBuffers.size());
+        std::vector<PackedReservoir> Candidates(NumPixels), Temporals(NumPixels);
+        std::vector<PackedReservoir> Histories[2] = {std::vector<PackedReservoir>(NumPixels),
+                                                     std::vector<PackedReservoir>(NumPixels)};
+        Image.assign(NumPixels, glm::vec3(0.f));
+        double TotalMs = 0.;
+        for (uint FrameIndex = 0; FrameIndex < NumFrames; FrameIndex++) {
+            ReSTIRFrame Frame;
+            Frame.Scene = &Scene;
+            Frame.Settings = &Config;
+            Frame.Width = Width;
+            Frame.Height = Height;
+            Frame.FrameIndex = FrameIndex;
+            Frame.Temporal = Config.Temporal && FrameIndex > 0;
+            Frame.GBuffer = &GBuffers[FrameIndex];
+            Frame.PrevGBuffer = &GBuffers[FrameIndex > 0 ? FrameIndex - 1 : 0];
+            Frame.MotionVectors = &MotionVectors[FrameIndex];
+            Frame.Candidates = &Candidates;
+            Frame.Temporals = &Temporals;
+            Frame.PrevHistory = &Histories[1 - (FrameIndex & 1u)];
+            Frame.History = &Histories[FrameIndex & 1u];
+            Frame.Output = &Image;
+
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            RunInitialPass(Frame);
+            RunTemporalPass(Frame);
+            RunSpatialPass(Frame);
+            RunShadePass(Frame);
+            TotalMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - StartTime).count();
+        }
+        return TotalMs / NumFrames;
+    }
+
+    static void MeasureError(const std::vector<glm::vec3>& Image, const std::vector<glm::vec3>& Reference,
+                             double& RMSE, double& RelMSE) {
+        double SquaredSum = 0., RelativeSum = 0.;
+        for (size_t i = 0; i < Image.size(); i++) {
+            double Difference = Luminance(Image[i]) - Luminance(Reference[i]);
+            double Expected = Luminance(Reference[i]);
+            SquaredSum += Difference * Difference;
+            RelativeSum += Difference * Difference / (Expected * Expected + 1e-2);
+        }
+        RMSE = std::sqrt(SquaredSum / static_cast<double>(Image.size()));
+        RelMSE = RelativeSum / static_cast<double>(Image.size());
+    }
+
+    void ReSTIRDI::CompareEqualTime(uint Width, uint Height, uint NumLights, uint NumFrames,
+                                    const ReSTIRSettings &Settings) {
+        ReSTIRScene Scene = CreateReSTIRScene(NumLights);
+        const uint NumPixels = Width * Height;
+
+        // G-buffers of the whole camera path, shared by every configuration
+        std::vector<std::vector<GBufferTexel>> GBuffers;
+        std::vector<std::vector<glm::vec2>> MotionVectors;
+        RenderCameraPath(Scene, Width, Height, NumFrames, GBuffers, MotionVectors);
+        const std::vector<GBufferTexel>& LastGBuffer = GBuffers[NumFrames - 1];
+        std::vector<glm::vec3> Reference = RenderReference(Scene, LastGBuffer);
+
+        // One power-proportional light sample and shadow ray per sample
+        auto RenderLightSampling = [&](uint SamplesPerPixel, std::vector<glm::vec3>& Image) {
+            Image.assign(NumPixels, glm::vec3(0.f));
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            ParallelPixels(NumPixels, [&](uint PixelIndex) {
+                const GBufferTexel& Texel = LastGBuffer[PixelIndex];
+                if (Texel.ViewDepth <= 0.f) {
+                    return;
+                }
+                PCGRandom Random = PixelRandom(PixelIndex, NumFrames, 3);
+                glm::vec3 Sum(0.f);
+                for (uint i = 0; i < SamplesPerPixel; i++) {
+                    float Pdf;
+                    uint LightIndex = SampleLight(Scene, Random.NextFloat(), Pdf);
+                    glm::vec3 Contribution = EvaluateLight(Scene, Texel, LightIndex);
+                    if (Pdf > 0.f && Luminance(Contribution) > 0.f && IsLightVisible(Scene, Texel, LightIndex)) {
+                        Sum += Contribution / Pdf;
+                    }
+                }
+                Image[PixelIndex] = Sum / static_cast<float>(SamplesPerPixel);
+            });
+            return std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - StartTime).count();
+        };
+
+        std::cout << "ReSTIR DI " << Width << "x" << Height << ", " << NumLights << " lights, " << NumFrames
+                  << " frames, " << Settings.NumCandidates << " candidates, "
+                  << (sizeof(PackedReservoir) * 4 * NumPixels) / 1024 << " KB of reservoirs\n";
+        std::cout << "Method | ms/frame | RMSE | relMSE\n";
+        auto Report = [&](const std::string& Name, double Ms, const std::vector<glm::vec3>& Image) {
+            double RMSE, RelMSE;
+            MeasureError(Image, Reference, RMSE, RelMSE);
+            std::cout << Name << " | " << Ms << " | " << RMSE << " | " << RelMSE << "\n";
+        };
+
+        std::vector<glm::vec3> Image;
+        ReSTIRSettings RISOnly = Settings, TemporalOnly = Settings;
+        RISOnly.Temporal = RISOnly.Spatial = false;
+        TemporalOnly.Spatial = false;
+        Report("RIS", RenderReSTIRCPU(Scene, RISOnly, Width, Height, GBuffers, MotionVectors, Image), Image);
+        Report("RIS + temporal", RenderReSTIRCPU(Scene, TemporalOnly, Width, Height, GBuffers, MotionVectors, Image),
+               Image);
+        double ReSTIRMs = RenderReSTIRCPU(Scene, Settings, Width, Height, GBuffers, MotionVectors, Image);
+        Report("RIS + temporal + spatial", ReSTIRMs, Image);
+
+        double OneSampleMs = RenderLightSampling(1, Image);
+        Report("Light sampling 1 spp", OneSampleMs, Image);
+        auto EqualTimeSamples = static_cast<uint>(std::max(1., std::round(ReSTIRMs / std::max(OneSampleMs, 1e-3))));
+        double EqualTimeMs = RenderLightSampling(EqualTimeSamples, Image);
+        Report("Light sampling " + std::to_string(EqualTimeSamples) + " spp (equal time)", EqualTimeMs, Image);
+        std::cout.flush();
+    }
+
+    void ReSTIRDI::CompareGPU(uint Width, uint Height, uint NumLights, uint NumFrames,
+                              const ReSTIRSettings &Settings) {
+        ReSTIRScene Scene = CreateReSTIRScene(NumLights);
+        const uint NumPixels = Width * Height;
+        std::vector<std::vector<GBufferTexel>> GBuffers;
+        std::vector<std::vector<glm::vec2>> MotionVectors;
+        RenderCameraPath(Scene, Width, Height, NumFrames, GBuffers, MotionVectors);
+        std::vector<glm::vec3> Reference = RenderReference(Scene, GBuffers[NumFrames - 1]);
+
+        std::vector<glm::vec3> CPUImage;
+        double CPUMs = RenderReSTIRCPU(Scene, Settings, Width, Height, GBuffers, MotionVectors, CPUImage);
+
+        GPUBVH SceneBVH(Scene.Positions, Scene.Indices);
+        SceneBVH.Build();
+        ReSTIRDI GPUReSTIR(Width, Height, Scene.Lights, &SceneBVH);
+        auto *App = VulkanBackendApp::GetApplication();
+        double GPUMs = 0.;
+        for (uint Frame = 0; Frame < NumFrames; Frame++) {
+            GPUReSTIR.GetGBuffer()->Upload(GBuffers[Frame].data());
+            GPUReSTIR.GetMotionVectorBuffer()->Upload(MotionVectors[Frame].data());
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            auto CommandBuffer = App->BeginIntermediateCommand();
+            GPUReSTIR.Record(CommandBuffer, Settings);
+            if (Frame + 1 == NumFrames) {
+                ComputeKernel::ReadbackBarrier(CommandBuffer, GPUReSTIR.GetOutputBuffer()->GetHandle());
+            }
+            App->EndIntermediateCommand(CommandBuffer);
+            GPUMs += std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - StartTime).count();
+        }
+        std::vector<glm::vec4> Output(NumPixels);
+        GPUReSTIR.GetOutputBuffer()->Download(Output.data());
+        std::vector<glm::vec3> GPUImage(NumPixels);
+        double CPUSum = 0., GPUSum = 0.;
+        for (uint i = 0; i < NumPixels; i++) {
+            GPUImage[i] = glm::vec3(Output[i]);
+            CPUSum += Luminance(CPUImage[i]);
+            GPUSum += Luminance(GPUImage[i]);
+        }
+
+        double CPURMSE, CPURelMSE, GPURMSE, GPURelMSE;
+        MeasureError(CPUImage, Reference, CPURMSE, CPURelMSE);
+        MeasureError(GPUImage, Reference, GPURMSE, GPURelMSE);
+        std::cout << "ReSTIR DI GPU vs CPU " << Width << "x" << Height << ", " << NumLights << " lights, "
+                  << NumFrames << " frames\n";
+        std::cout << "Passes | ms/frame | mean luminance | RMSE | relMSE\n";
+        std::cout << "CPU | " << CPUMs << " | " << CPUSum / NumPixels << " | " << CPURMSE << " | " << CPURelMSE << "\n";
+        std::cout << "GPU | " << GPUMs / NumFrames << " | " << GPUSum / NumPixels << " | " << GPURMSE << " | "
+                  << GPURelMSE << "\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
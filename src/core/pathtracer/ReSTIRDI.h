@@ -0,0 +1,132 @@
+//
+// Created by HUSTLX on 2024/10/27.
+//
+
+#ifndef HARDWAREPATHTRACER_RESTIRDI_H
+#define HARDWAREPATHTRACER_RESTIRDI_H
+
+#include "core/Core.h"
+#include "core/compute/ComputeKernel.h"
+#include "core/compute/GPUBVH.h"
+#include "core/buffer/StorageBuffer.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Same layout as PointLight in shader/HLSL/ReSTIRDI.hlsl, Power drives the light selection pdf
+    struct PointLight {
+        glm::vec3 Position = glm::vec3(0.f);
+        float Power = 0.f;
+        glm::vec3 Intensity = glm::vec3(0.f);
+        float Padding = 0.f;
+    };
+
+    // Same layout as GBufferTexel in shader/HLSL/ReSTIRDI.hlsl, ViewDepth <= 0 marks the background
+    struct GBufferTexel {
+        glm::vec3 Position = glm::vec3(0.f);
+        float ViewDepth = 0.f;
+        glm::vec3 Normal = glm::vec3(0.f, 1.f, 0.f);
+        uint Albedo = 0;  // RGBA8
+    };
+
+    // 12 bytes per pixel, W is the unbiased contribution weight of the selected light
+    struct PackedReservoir {
+        uint LightIndex = ~0u;
+        float W = 0.f;
+        uint M = 0;
+    };
+
+    struct ReSTIRSettings {
+        uint NumCandidates = 32;
+        bool Temporal = true;
+        uint MaxHistory = 20;  // Clamp of the previous M relative to the current one
+        bool Spatial = true;
+        uint NumSpatialSamples = 5;
+        float SpatialRadius = 30.f;
+        float DepthThreshold = .1f;  // Relative view depth difference
+        float NormalThreshold = .9f;  // Cosine between the normals
+    };
+
+    // ReSTIR DI over point lights with the kernels in shader/HLSL/ReSTIRDI.hlsl. The caller fills
+    // GetGBuffer() and GetMotionVectorBuffer() every frame, Record() runs the four passes and leaves
+    // the shaded direct lighting in GetOutputBuffer(). Shadow rays go through the compute BVH
+    class ReSTIRDI {
+    public:
+        ReSTIRDI(uint Width, uint Height, const std::vector<PointLight>& Lights, GPUBVH* Scene);
+
+        ~ReSTIRDI();
+
+        // Records the passes of one frame and swaps the G-buffer and reservoir history
+        void Record(VkCommandBuffer CommandBuffer, const ReSTIRSettings& Settings = {});
+
+        // This frame's G-buffer, the other one is kept as the previous frame for temporal reuse
+        auto GetGBuffer() -> StorageBuffer* {
+            return m_gBuffers[m_parity];
+        }
+
+        // glm::vec2 per pixel, previous pixel minus current pixel
+        auto GetMotionVectorBuffer() -> StorageBuffer* {
+            return m_motionVectorBuffer;
+        }
+
+        auto GetOutputBuffer() -> StorageBuffer* {
+            return m_outputBuffer;
+        }
+
+        [[nodiscard]] auto GetReservoirBytes() const -> size_t {
+            return sizeof(PackedReservoir) * 4 * m_width * m_height;
+        }
+
+        // Renders a moving camera over a synthetic scene of boxes lit by NumLights point lights on the
+        // CPU with the same passes, and reports the error against the exact sum over all lights for
+        // ReSTIR and for plain power-proportional light sampling at equal time
+        static void CompareEqualTime(uint Width = 192, uint Height = 108, uint NumLights = 1024,
+                                     uint NumFrames = 8, const ReSTIRSettings& Settings = {});
+
+        // Feeds the same camera path's CPU G-buffers to Record and compares GetOutputBuffer() with the CPU
+        // passes. Only the random numbers differ, so both images are measured against the exact lighting
+        static void CompareGPU(uint Width = 192, uint Height = 108, uint NumLights = 1024, uint NumFrames = 8,
+                               const ReSTIRSettings& Settings = {});
+
+    private:
+        struct Constants {
+            uint Width;
+            uint Height;
+            uint NumLights;
+            uint FrameIndex;
+            uint NumCandidates;
+            uint MaxHistory;
+            uint NumSpatialSamples;
+            uint Flags;
+            float SpatialRadius;
+            float DepthThreshold;
+            float NormalThreshold;
+            float LightWeightSum;
+        };
+
+        enum Pass : uint {
+            Initial, Temporal, Spatial, Shade, NumPasses
+        };
+
+        uint m_width = 0, m_height = 0;
+        uint m_numLights = 0;
+        float m_lightWeightSum = 0.f;
+        uint m_frameIndex = 0;
+        uint m_parity = 0;
+
+        StorageBuffer* m_lightBuffer = nullptr;
+        StorageBuffer* m_lightAliasBuffer = nullptr;
+        StorageBuffer* m_gBuffers[2] = {nullptr, nullptr};
+        StorageBuffer* m_motionVectorBuffer = nullptr;
+        StorageBuffer* m_candidateReservoirs = nullptr;
+        StorageBuffer* m_temporalReservoirs = nullptr;
+        StorageBuffer* m_historyReservoirs[2] = {nullptr, nullptr};
+        StorageBuffer* m_outputBuffer = nullptr;
+
+        // Set i treats G-buffer and history i as the current frame
+        ComputeKernel* m_kernels[NumPasses] = {};
+        VkDescriptorSet m_sets[NumPasses][2] = {};
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_RESTIRDI_H
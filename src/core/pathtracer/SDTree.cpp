@@ -0,0 +1,248 @@
+//
+// Created by HUSTLX on 2024/10/28.
+//
+
+#include "SDTree.h"
+#include <cmath>
+#include <queue>
+
+
+namespace HWPT {
+    static constexpr float SDTreePI = 3.14159265358979323846f;
+
+    DTree::DTree() : m_nodes(1) {
+    }
+
+    auto DTree::DirectionToCanonical(const glm::vec3 &Direction) -> glm::vec2 {
+        float CosTheta = std::clamp(Direction.z, -1.f, 1.f);
+        float Phi = std::atan2(Direction.y, Direction.x);
+        if (Phi < 0.f) {
+            Phi += 2.f * SDTreePI;
+        }
+        return glm::clamp(glm::vec2((CosTheta + 1.f) * .5f, Phi / (2.f * SDTreePI)), 0.f, 0.99999994f);
+    }
+
+    auto DTree::CanonicalToDirection(const glm::vec2 &Canonical) -> glm::vec3 {
+        float CosTheta = 2.f * Canonical.x - 1.f;
+        float SinTheta = std::sqrt(std::max(0.f, 1.f - CosTheta * CosTheta));
+        float Phi = 2.f * SDTreePI * Canonical.y;
+        return {SinTheta * std::cos(Phi), SinTheta * std::sin(Phi), CosTheta};
+    }
+
+    void DTree::Record(const glm::vec3 &Direction, float Value) {
+        AtomicAddFloat(m_statisticalWeight.Value, 1.f);
+        if (!(Value > 0.f) || !std::isfinite(Value)) {
+            return;
+        }
+        glm::vec2 Point = DirectionToCanonical(Direction);
+        uint NodeIndex = 0;
+        while (true) {
+            uint X = Point.x >= .5f ? 1 : 0, Y = Point.y >= .5f ? 1 : 0;
+            uint Quadrant = X | (Y << 1u);
+            Node& Current = m_nodes[NodeIndex];
+            AtomicAddFloat(Current.Sums[Quadrant].Value, Value);
+            if (Current.Children[Quadrant] == 0) {
+                return;
+            }
+            NodeIndex = Current.Children[Quadrant];
+            Point = Point * 2.f - glm::vec2(static_cast<float>(X), static_cast<float>(Y));
+        }
+    }
+
+    auto DTree::Sample(glm::vec2 U) const -> glm::vec3 {
+        // One bit of each random number per level, x half first, then the y half within that column
+        glm::vec2 Origin(0.f);
+        float Size = 1.f;
+        uint NodeIndex = 0;
+        while (true) {
+            const Node& Current = m_nodes[NodeIndex];
+            float Total = Current.GetTotal();
+            if (!(Total > 0.f)) {
+                break;
+            }
+            float Left = Current.GetSum(0) + Current.GetSum(2);
+            float LeftProbability = Left / Total;
+            uint X = 0;
+            if (U.x < LeftProbability) {
+                U.x /= LeftProbability;
+            } else {
+                X = 1;
+                U.x = (U.x - LeftProbability) / (1.f - LeftProbability);
+            }
+            float Column = Current.GetSum(X) + Current.GetSum(X + 2);
+            float BottomProbability = Current.GetSum(X) / Column;
+            uint Y = 0;
+            if (U.y < BottomProbability) {
+                U.y /= BottomProbability;
+            } else {
+                Y = 1;
+                U.y = (U.y - BottomProbability) / (1.f - BottomProbability);
+            }
+            U = glm::clamp(U, 0.f, 0.99999994f);
+
+            Size *= .5f;
+            Origin += glm::vec2(static_cast<float>(X), static_cast<float>(Y)) * Size;
+            uint Quadrant = X | (Y << 1u);
+            if (Current.Children[Quadrant] == 0) {
+                break;
+            }
+            NodeIndex = Current.Children[Quadrant];
+        }
+        return CanonicalToDirection(Origin + U * Size);
+    }
+
+    auto DTree::GetPdf(const glm::vec3 &Direction) const -> float {
+        glm::vec2 Point = DirectionToCanonical(Direction);
+        float Pdf = 1.f;
+        uint NodeIndex = 0;
+        while (true) {
+            const Node& Current = m_nodes[NodeIndex];
+            float Total = Current.GetTotal();
+            if (!(Total > 0.f)) {
+                break;
+            }
+            uint X = Point.x >= .5f ? 1 : 0, Y = Point.y >= .5f ? 1 : 0;
+            uint Quadrant = X | (Y << 1u);
+            Pdf *= 4.f * Current.GetSum(Quadrant) / Total;
+            if (Current.Children[Quadrant] == 0 || Pdf == 0.f) {
+                break;
+            }
+            NodeIndex = Current.Children[Quadrant];
+            Point = Point * 2.f - glm::vec2(static_cast<float>(X), static_cast<float>(Y));
+        }
+        return Pdf / (4.f * SDTreePI);
+    }
+
+    auto DTree::GetFlux() const -> float {
+        return m_nodes[0].GetTotal();
+    }
+
+    void DTree::Refine(float Threshold, uint MaxDepth, uint MaxNodes) {
+        struct Item {
+            uint NewIndex;
+            int OldIndex;  // -1 below an old leaf, the flux is assumed uniform there
+            uint Depth;
+            float Fraction;
+        };
+
+        const float Total = GetFlux();
+        std::vector<Node> Refined(1);
+        if (Total > 0.f) {
+            std::queue<Item> Pending;
+            Pending.push({0, 0, 1, 1.f});
+            while (!Pending.empty()) {
+                Item Current = Pending.front();
+                Pending.pop();
+                for (uint Quadrant = 0; Quadrant < 4; Quadrant++) {
+                    int OldChild = -1;
+                    float Fraction = Current.Fraction * .25f;
+                    if (Current.OldIndex >= 0) {
+                        const Node& Old = m_nodes[Current.OldIndex];
+                        Fraction = Old.GetSum(Quadrant) / Total;
+                        OldChild = Old.Children[Quadrant] != 0 ? static_cast<int>(Old.Children[Quadrant]) : -1;
+                    }
+                    if (Fraction <= Threshold || Current.Depth >= MaxDepth || Refined.size() >= MaxNodes) {
+                        continue;
+                    }
+                    auto ChildIndex = static_cast<uint>(Refined.size());
+                    Refined.emplace_back();
+                    Refined[Current.NewIndex].Children[Quadrant] = ChildIndex;
+                    Pending.push({ChildIndex, OldChild, Current.Depth + 1, Fraction});
+                }
+            }
+        }
+        m_nodes = std::move(Refined);
+        SetStatisticalWeight(0.f);
+    }
+
+    SDTree::SDTree(const AABB &Bounds) : m_bounds(Bounds), m_nodes(1), m_dTrees(1) {
+        // Cubic cells keep the axis cycling balanced
+        glm::vec3 Extent = m_bounds.GetExtent();
+        float Size = std::max(Extent.x, std::max(Extent.y, Extent.z));
+        m_bounds.Max = m_bounds.Min + glm::vec3(Size);
+    }
+
+    auto SDTree::GetDTree(const glm::vec3 &Position) -> DTreeWrapper& {
+        glm::vec3 Point = glm::clamp((Position - m_bounds.Min) / m_bounds.GetExtent(), 0.f, 0.99999994f);
+        uint NodeIndex = 0;
+        while (!m_nodes[NodeIndex].IsLeaf()) {
+            const SNode& Current = m_nodes[NodeIndex];
+            uint Side = Point[Current.Axis] >= .5f ? 1 : 0;
+            Point[Current.Axis] = Point[Current.Axis] * 2.f - static_cast<float>(Side);
+            NodeIndex = Current.Children[Side];
+        }
+        return m_dTrees[m_nodes[NodeIndex].DTreeIndex];
+    }
+
+    void SDTree::Refine(uint Iteration, const SDTreeSettings &Settings) {
+        m_hitMemoryCap = false;
+        const float SplitThreshold = Settings.SpatialThreshold * std::sqrt(std::pow(2.f, static_cast<float>(Iteration)));
+
+        // Spatial splits first, both halves inherit the parent's trees and half of its samples
+        std::vector<uint> Pending;
+        for (uint i = 0; i < m_nodes.size(); i++) {
+            if (m_nodes[i].IsLeaf()) {
+                Pending.push_back(i);
+            }
+        }
+        while (!Pending.empty()) {
+            uint NodeIndex = Pending.back();
+            Pending.pop_back();
+            DTreeWrapper& Wrapper = m_dTrees[m_nodes[NodeIndex].DTreeIndex];
+            if (Wrapper.Building.GetStatisticalWeight() <= SplitThreshold) {
+                continue;
+            }
+            size_t SplitBytes = 2 * sizeof(SNode) + sizeof(DTreeWrapper) + Wrapper.Building.GetMemoryBytes() +
+                                Wrapper.Sampling.GetMemoryBytes();
+            if (GetMemoryBytes() + SplitBytes > Settings.MaxMemoryBytes) {
+                m_hitMemoryCap = true;
+                continue;
+            }
+            Wrapper.Building.SetStatisticalWeight(Wrapper.Building.GetStatisticalWeight() * .5f);
+            uint ParentTree = m_nodes[NodeIndex].DTreeIndex;
+            auto NewTree = static_cast<uint>(m_dTrees.size());
+            m_dTrees.push_back(m_dTrees[ParentTree]);
+
+            auto FirstChild = static_cast<uint>(m_nodes.size());
+            SNode Children[2];
+            for (uint Side = 0; Side < 2; Side++) {
+                Children[Side].Axis = (m_nodes[NodeIndex].Axis + 1) % 3;
+                Children[Side].DTreeIndex = Side == 0 ? ParentTree : NewTree;
+            }
+            m_nodes.push_back(Children[0]);
+            m_nodes.push_back(Children[1]);
+            m_nodes[NodeIndex].Children[0] = FirstChild;
+            m_nodes[NodeIndex].Children[1] = FirstChild + 1;
+            Pending.push_back(FirstChild);
+            Pending.push_back(FirstChild + 1);
+        }
+
+        // Whatever the spatial tree leaves of the budget is shared evenly by the directional trees
+        size_t SpatialBytes = sizeof(SNode) * m_nodes.size() + sizeof(DTreeWrapper) * m_dTrees.size();
+        size_t DirectionalBudget = Settings.MaxMemoryBytes > SpatialBytes ? Settings.MaxMemoryBytes - SpatialBytes : 0;
+        const size_t NodeBytes = DTree().GetMemoryBytes();
+        auto MaxNodes = static_cast<uint>(std::max<size_t>(
+                DirectionalBudget / (m_dTrees.size() * 2 * NodeBytes), 1));
+        for (auto& Wrapper: m_dTrees) {
+            Wrapper.Sampling = Wrapper.Building;
+            Wrapper.Building.Refine(Settings.DirectionalThreshold, Settings.MaxDirectionalDepth, MaxNodes);
+            m_hitMemoryCap |= Wrapper.Building.GetNumNodes() >= MaxNodes && MaxNodes > 1;
+        }
+    }
+
+    auto SDTree::GetNumDTreeNodes() const -> size_t {
+        size_t NumNodes = 0;
+        for (const auto& Wrapper: m_dTrees) {
+            NumNodes += Wrapper.Building.GetNumNodes() + Wrapper.Sampling.GetNumNodes();
+        }
+        return NumNodes;
+    }
+
+    auto SDTree::GetMemoryBytes() const -> size_t {
+        size_t Bytes = sizeof(SNode) * m_nodes.size() + sizeof(DTreeWrapper) * m_dTrees.size();
+        for (const auto& Wrapper: m_dTrees) {
+            Bytes += Wrapper.Building.GetMemoryBytes() + Wrapper.Sampling.GetMemoryBytes();
+        }
+        return Bytes;
+    }
+}  // namespace HWPT
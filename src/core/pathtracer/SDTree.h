@@ -0,0 +1,161 @@
+//
+// Created by HUSTLX on 2024/10/28.
+//
+
+#ifndef HARDWAREPATHTRACER_SDTREE_H
+#define HARDWAREPATHTRACER_SDTREE_H
+
+#include "core/Core.h"
+#include "core/pathtracer/Ray.h"
+#include <atomic>
+#include <vector>
+
+
+namespace HWPT {
+    struct SDTreeSettings {
+        // A spatial leaf splits once it has seen SpatialThreshold * sqrt(2^Iteration) samples. Lower
+        // than the paper's 12000, which is tuned for full HD images
+        float SpatialThreshold = 4000.f;
+        // A directional quadrant subdivides while it holds more than this fraction of its tree's flux
+        float DirectionalThreshold = .01f;
+        uint MaxDirectionalDepth = 20;
+        // Refinement stops splitting once the building and sampling trees would exceed this
+        size_t MaxMemoryBytes = 64ull << 20;
+    };
+
+    // Lock-free float accumulation, std::atomic<float>::fetch_add is C++20
+    inline void AtomicAddFloat(std::atomic<float>& Target, float Value) {
+        float Current = Target.load(std::memory_order_relaxed);
+        while (!Target.compare_exchange_weak(Current, Current + Value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Directional quadtree over the cylindrical mapping of the sphere (cos theta, phi), which preserves
+    // area, so the pdf in the unit square divided by 4 pi is the solid angle pdf
+    class DTree {
+    public:
+        DTree();
+
+        DTree(const DTree& Other) = default;
+
+        auto operator=(const DTree& Other) -> DTree& = default;
+
+        // Thread safe, splats Value into every node on the way down to the leaf containing Direction
+        void Record(const glm::vec3& Direction, float Value);
+
+        [[nodiscard]] auto Sample(glm::vec2 U) const -> glm::vec3;
+
+        // Solid angle pdf of Sample
+        [[nodiscard]] auto GetPdf(const glm::vec3& Direction) const -> float;
+
+        [[nodiscard]] auto GetFlux() const -> float;
+
+        [[nodiscard]] auto GetStatisticalWeight() const -> float {
+            return m_statisticalWeight.Value.load(std::memory_order_relaxed);
+        }
+
+        void SetStatisticalWeight(float Weight) {
+            m_statisticalWeight.Value.store(Weight, std::memory_order_relaxed);
+        }
+
+        // Rebuilds the structure from the recorded flux and clears the sums, quadrants above Threshold
+        // of the total flux are subdivided breadth first until MaxNodes
+        void Refine(float Threshold, uint MaxDepth, uint MaxNodes);
+
+        [[nodiscard]] auto GetNumNodes() const -> uint {
+            return static_cast<uint>(m_nodes.size());
+        }
+
+        [[nodiscard]] auto GetMemoryBytes() const -> size_t {
+            return sizeof(Node) * m_nodes.size();
+        }
+
+        static auto DirectionToCanonical(const glm::vec3& Direction) -> glm::vec2;
+
+        static auto CanonicalToDirection(const glm::vec2& Canonical) -> glm::vec3;
+
+    private:
+        // std::atomic is neither copyable nor movable, the trees are copied between iterations only
+        struct AtomicFloat {
+            std::atomic<float> Value{0.f};
+
+            AtomicFloat() = default;
+
+            AtomicFloat(const AtomicFloat& Other) : Value(Other.Value.load(std::memory_order_relaxed)) {
+            }
+
+            auto operator=(const AtomicFloat& Other) -> AtomicFloat& {
+                Value.store(Other.Value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                return *this;
+            }
+        };
+
+        // Quadrant i covers x half i & 1 and y half i >> 1, child 0 marks a leaf since the root is never a child
+        struct Node {
+            AtomicFloat Sums[4];
+            uint Children[4] = {0, 0, 0, 0};
+
+            [[nodiscard]] auto GetSum(uint Quadrant) const -> float {
+                return Sums[Quadrant].Value.load(std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] auto GetTotal() const -> float {
+                return GetSum(0) + GetSum(1) + GetSum(2) + GetSum(3);
+            }
+        };
+
+        std::vector<Node> m_nodes;
+        AtomicFloat m_statisticalWeight;
+    };
+
+    // The tree that collects this iteration's samples and the one built from the last iteration
+    struct DTreeWrapper {
+        DTree Building;
+        DTree Sampling;
+    };
+
+    // Spatial binary tree over the scene bounds (Mueller et al. 2017), the axis cycles x, y, z and every
+    // split halves the cell. Each leaf owns a DTreeWrapper
+    class SDTree {
+    public:
+        explicit SDTree(const AABB& Bounds);
+
+        // Lookups are thread safe between calls to Refine
+        auto GetDTree(const glm::vec3& Position) -> DTreeWrapper&;
+
+        // End of training iteration Iteration: splits busy spatial leaves, moves the building trees to
+        // the sampling trees and refines the building trees from their flux
+        void Refine(uint Iteration, const SDTreeSettings& Settings);
+
+        [[nodiscard]] auto GetNumLeaves() const -> uint {
+            return static_cast<uint>(m_dTrees.size());
+        }
+
+        [[nodiscard]] auto GetNumDTreeNodes() const -> size_t;
+
+        [[nodiscard]] auto GetMemoryBytes() const -> size_t;
+
+        // True if the last Refine skipped splits because of SDTreeSettings::MaxMemoryBytes
+        [[nodiscard]] auto HitMemoryCap() const -> bool {
+            return m_hitMemoryCap;
+        }
+
+    private:
+        struct SNode {
+            uint Axis = 0;
+            uint Children[2] = {0, 0};  // Both 0 for leaves
+            uint DTreeIndex = 0;
+
+            [[nodiscard]] auto IsLeaf() const -> bool {
+                return Children[0] == 0;
+            }
+        };
+
+        AABB m_bounds;
+        std::vector<SNode> m_nodes;
+        std::vector<DTreeWrapper> m_dTrees;
+        bool m_hitMemoryCap = false;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_SDTREE_H
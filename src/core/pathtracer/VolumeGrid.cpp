@@ -0,0 +1,260 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#include "VolumeGrid.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+
+namespace HWPT {
+    static constexpr char VolumeFileMagic[8] = {'H', 'W', 'P', 'T', 'V', 'O', 'L', '1'};
+
+    static_assert(sizeof(VolumeFileHeader) == 56, "VolumeFileHeader is read and written as raw bytes");
+
+    DensityGrid::DensityGrid(const glm::uvec3 &Dims, const AABB &Bounds, const std::vector<float> &Densities)
+            : m_dims(Dims) {
+        if (Densities.size() != static_cast<size_t>(Dims.x) * Dims.y * Dims.z) {
+            throw std::runtime_error("DensityGrid expects Dims.x * Dims.y * Dims.z densities");
+        }
+        SetBounds(Bounds);
+        m_brickDims = (m_dims + glm::uvec3(VolumeBrickSize - 1)) / VolumeBrickSize;
+        m_brickTable.assign(static_cast<size_t>(m_brickDims.x) * m_brickDims.y * m_brickDims.z, VolumeEmptyBrick);
+
+        std::vector<float> Brick(VolumeBrickVoxels);
+        for (uint BZ = 0; BZ < m_brickDims.z; BZ++) {
+            for (uint BY = 0; BY < m_brickDims.y; BY++) {
+                for (uint BX = 0; BX < m_brickDims.x; BX++) {
+                    bool Empty = true;
+                    for (uint Local = 0; Local < VolumeBrickVoxels; Local++) {
+                        uint X = BX * VolumeBrickSize + Local % VolumeBrickSize;
+                        uint Y = BY * VolumeBrickSize + (Local / VolumeBrickSize) % VolumeBrickSize;
+                        uint Z = BZ * VolumeBrickSize + Local / (VolumeBrickSize * VolumeBrickSize);
+                        float Density = 0.f;
+                        if (X < m_dims.x && Y < m_dims.y && Z < m_dims.z) {
+                            Density = std::max(Densities[(static_cast<size_t>(Z) * m_dims.y + Y) * m_dims.x + X], 0.f);
+                        }
+                        Brick[Local] = Density;
+                        Empty &= Density == 0.f;
+                        m_maxDensity = std::max(m_maxDensity, Density);
+                    }
+                    if (!Empty) {
+                        m_brickTable[(BZ * m_brickDims.y + BY) * m_brickDims.x + BX] = GetNumBricks();
+                        m_brickData.insert(m_brickData.end(), Brick.begin(), Brick.end());
+                    }
+                }
+            }
+        }
+    }
+
+    void DensityGrid::SetBounds(const AABB &Bounds) {
+        m_bounds = Bounds;
+        m_worldToGrid = glm::vec3(m_dims) / m_bounds.GetExtent();
+    }
+
+    auto DensityGrid::Load(const std::filesystem::path &Path) -> DensityGrid {
+        std::ifstream File(Path, std::ios::binary);
+        if (!File.is_open()) {
+            throw std::runtime_error("Failed to open volume " + Path.string());
+        }
+        VolumeFileHeader Header{};
+        File.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+        if (!File || std::memcmp(Header.Magic, VolumeFileMagic, sizeof(VolumeFileMagic)) != 0) {
+            throw std::runtime_error("Not a HWPT volume: " + Path.string());
+        }
+        glm::uvec3 Dims(Header.Dims[0], Header.Dims[1], Header.Dims[2]);
+        AABB Bounds;
+        Bounds.Min = glm::vec3(Header.BoundsMin[0], Header.BoundsMin[1], Header.BoundsMin[2]);
+        Bounds.Max = glm::vec3(Header.BoundsMax[0], Header.BoundsMax[1], Header.BoundsMax[2]);
+        if (Dims.x == 0 || Dims.y == 0 || Dims.z == 0 || !Bounds.IsValid()) {
+            throw std::runtime_error("Invalid volume dimensions in " + Path.string());
+        }
+
+        if (Header.Sparse == 0) {
+            std::vector<float> Densities(static_cast<size_t>(Dims.x) * Dims.y * Dims.z);
+            File.read(reinterpret_cast<char*>(Densities.data()), static_cast<std::streamsize>(sizeof(float) * Densities.size()));
+            if (!File) {
+                throw std::runtime_error("Truncated volume " + Path.string());
+            }
+            return {Dims, Bounds, Densities};
+        }
+
+        DensityGrid Grid;
+        Grid.m_dims = Dims;
+        Grid.SetBounds(Bounds);
+        Grid.m_brickDims = (Dims + glm::uvec3(VolumeBrickSize - 1)) / VolumeBrickSize;
+        Grid.m_brickTable.resize(static_cast<size_t>(Grid.m_brickDims.x) * Grid.m_brickDims.y * Grid.m_brickDims.z);
+        Grid.m_brickData.resize(static_cast<size_t>(Header.NumBricks) * VolumeBrickVoxels);
+        File.read(reinterpret_cast<char*>(Grid.m_brickTable.data()),
+                  static_cast<std::streamsize>(sizeof(uint) * Grid.m_brickTable.size()));
+        File.read(reinterpret_cast<char*>(Grid.m_brickData.data()),
+                  static_cast<std::streamsize>(sizeof(float) * Grid.m_brickData.size()));
+        if (!File) {
+            throw std::runtime_error("Truncated volume " + Path.string());
+        }
+        for (uint Brick: Grid.m_brickTable) {
+            if (Brick != VolumeEmptyBrick && Brick >= Header.NumBricks) {
+                throw std::runtime_error("Brick index out of range in " + Path.string());
+            }
+        }
+        for (float& Density: Grid.m_brickData) {
+            Density = std::isfinite(Density) ? std::max(Density, 0.f) : 0.f;
+            Grid.m_maxDensity = std::max(Grid.m_maxDensity, Density);
+        }
+        return Grid;
+    }
+
+    void DensityGrid::Save(const std::filesystem::path &Path, bool Sparse) const {
+        std::ofstream File(Path, std::ios::binary);
+        if (!File.is_open()) {
+            throw std::runtime_error("Failed to write volume " + Path.string());
+        }
+        VolumeFileHeader Header{};
+        std::memcpy(Header.Magic, VolumeFileMagic, sizeof(VolumeFileMagic));
+        for (int Axis = 0; Axis < 3; Axis++) {
+            Header.Dims[Axis] = m_dims[Axis];
+            Header.BoundsMin[Axis] = m_bounds.Min[Axis];
+            Header.BoundsMax[Axis] = m_bounds.Max[Axis];
+        }
+        Header.Sparse = Sparse ? 1 : 0;
+        Header.NumBricks = Sparse ? GetNumBricks() : 0;
+        File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+
+        if (Sparse) {
+            File.write(reinterpret_cast<const char*>(m_brickTable.data()),
+                       static_cast<std::streamsize>(sizeof(uint) * m_brickTable.size()));
+            File.write(reinterpret_cast<const char*>(m_brickData.data()),
+                       static_cast<std::streamsize>(sizeof(float) * m_brickData.size()));
+        } else {
+            std::vector<float> Densities(static_cast<size_t>(m_dims.x) * m_dims.y * m_dims.z);
+            size_t Index = 0;
+            for (uint Z = 0; Z < m_dims.z; Z++) {
+                for (uint Y = 0; Y < m_dims.y; Y++) {
+                    for (uint X = 0; X < m_dims.x; X++) {
+                        Densities[Index++] = GetVoxel(static_cast<int>(X), static_cast<int>(Y), static_cast<int>(Z));
+                    }
+                }
+            }
+            File.write(reinterpret_cast<const char*>(Densities.data()),
+                       static_cast<std::streamsize>(sizeof(float) * Densities.size()));
+        }
+        if (!File) {
+            throw std::runtime_error("Failed to write volume " + Path.string());
+        }
+    }
+
+    static auto LatticeValue(int X, int Y, int Z, uint Seed) -> float {
+        uint Hash = static_cast<uint>(X) * 73856093u ^ static_cast<uint>(Y) * 19349663u ^
+                    static_cast<uint>(Z) * 83492791u ^ Seed * 2654435761u;
+        Hash ^= Hash >> 16u;
+        Hash *= 0x7feb352du;
+        Hash ^= Hash >> 15u;
+        Hash *= 0x846ca68bu;
+        Hash ^= Hash >> 16u;
+        return static_cast<float>(Hash) * 2.3283064365386963e-10f;
+    }
+
+    static auto ValueNoise(const glm::vec3& Position, uint Seed) -> float {
+        glm::vec3 Floor = glm::floor(Position);
+        glm::vec3 Fraction = Position - Floor;
+        glm::vec3 Weight = Fraction * Fraction * (3.f - 2.f * Fraction);
+        auto X = static_cast<int>(Floor.x), Y = static_cast<int>(Floor.y), Z = static_cast<int>(Floor.z);
+        float Result = 0.f;
+        for (int Corner = 0; Corner < 8; Corner++) {
+            int DX = Corner & 1, DY = (Corner >> 1) & 1, DZ = Corner >> 2;
+            float CornerWeight = (DX ? Weight.x : 1.f - Weight.x) * (DY ? Weight.y : 1.f - Weight.y) *
+                                 (DZ ? Weight.z : 1.f - Weight.z);
+            Result += CornerWeight * LatticeValue(X + DX, Y + DY, Z + DZ, Seed);
+        }
+        return Result;
+    }
+
+    auto DensityGrid::CreateCloud(uint Resolution, uint Seed) -> DensityGrid {
+        const glm::vec3 Cores[3] = {{.38f, .45f, .5f}, {.62f, .58f, .42f}, {.5f, .4f, .64f}};
+        std::vector<float> Densities(static_cast<size_t>(Resolution) * Resolution * Resolution);
+        size_t Index = 0;
+        for (uint Z = 0; Z < Resolution; Z++) {
+            for (uint Y = 0; Y < Resolution; Y++) {
+                for (uint X = 0; X < Resolution; X++) {
+                    glm::vec3 P = (glm::vec3(X, Y, Z) + .5f) / static_cast<float>(Resolution);
+                    float Noise = 0.f, Amplitude = .5f, Frequency = 4.f;
+                    for (int Octave = 0; Octave < 5; Octave++) {
+                        Noise += Amplitude * ValueNoise(P * Frequency, Seed + Octave);
+                        Amplitude *= .5f;
+                        Frequency *= 2.f;
+                    }
+                    float Falloff = 1.f - glm::length(P - glm::vec3(.5f)) / .42f;
+                    float Density = std::max(Noise - .45f + .5f * Falloff, 0.f) * (Falloff > 0.f ? 1.f : 0.f);
+                    for (const auto& Core: Cores) {
+                        glm::vec3 Offset = (P - Core) / .035f;
+                        Density += 40.f * std::exp(-glm::dot(Offset, Offset));
+                    }
+                    Densities[Index++] = Density < 1e-3f ? 0.f : Density;
+                }
+            }
+        }
+        AABB Bounds;
+        Bounds.Min = glm::vec3(-1.f);
+        Bounds.Max = glm::vec3(1.f);
+        return {glm::uvec3(Resolution), Bounds, Densities};
+    }
+
+    auto DensityGrid::Sample(const glm::vec3 &GridPosition) const -> float {
+        for (int Axis = 0; Axis < 3; Axis++) {
+            if (!(GridPosition[Axis] >= 0.f) || GridPosition[Axis] >= static_cast<float>(m_dims[Axis])) {
+                return 0.f;
+            }
+        }
+        glm::vec3 P = GridPosition - .5f;
+        glm::vec3 Floor = glm::floor(P);
+        glm::vec3 Fraction = P - Floor;
+        auto X = static_cast<int>(Floor.x), Y = static_cast<int>(Floor.y), Z = static_cast<int>(Floor.z);
+        float D00 = glm::mix(GetVoxel(X, Y, Z), GetVoxel(X + 1, Y, Z), Fraction.x);
+        float D10 = glm::mix(GetVoxel(X, Y + 1, Z), GetVoxel(X + 1, Y + 1, Z), Fraction.x);
+        float D01 = glm::mix(GetVoxel(X, Y, Z + 1), GetVoxel(X + 1, Y, Z + 1), Fraction.x);
+        float D11 = glm::mix(GetVoxel(X, Y + 1, Z + 1), GetVoxel(X + 1, Y + 1, Z + 1), Fraction.x);
+        return glm::mix(glm::mix(D00, D10, Fraction.y), glm::mix(D01, D11, Fraction.y), Fraction.z);
+    }
+
+    MajorantGrid::MajorantGrid(const DensityGrid &Grid, uint CellSize) : m_cellSize(std::max(CellSize, 1u)) {
+        const glm::uvec3& Dims = Grid.GetDims();
+        m_dims = (Dims + glm::uvec3(m_cellSize - 1)) / m_cellSize;
+        m_majorants.assign(static_cast<size_t>(m_dims.x) * m_dims.y * m_dims.z, 0.f);
+
+        // Scatter every non-zero voxel into the cells whose filter footprint reads it, empty bricks are skipped
+        const glm::uvec3& BrickDims = Grid.GetBrickDims();
+        const auto& BrickTable = Grid.GetBrickTable();
+        const auto& BrickData = Grid.GetBrickData();
+        const auto CellSizeInt = static_cast<int>(m_cellSize);
+        for (uint BZ = 0; BZ < BrickDims.z; BZ++) {
+            for (uint BY = 0; BY < BrickDims.y; BY++) {
+                for (uint BX = 0; BX < BrickDims.x; BX++) {
+                    uint Brick = BrickTable[(BZ * BrickDims.y + BY) * BrickDims.x + BX];
+                    if (Brick == VolumeEmptyBrick) {
+                        continue;
+                    }
+                    for (uint Local = 0; Local < VolumeBrickVoxels; Local++) {
+                        float Density = BrickData[Brick * VolumeBrickVoxels + Local];
+                        if (Density == 0.f) {
+                            continue;
+                        }
+                        glm::ivec3 Voxel(BX * VolumeBrickSize + Local % VolumeBrickSize,
+                                         BY * VolumeBrickSize + (Local / VolumeBrickSize) % VolumeBrickSize,
+                                         BZ * VolumeBrickSize + Local / (VolumeBrickSize * VolumeBrickSize));
+                        glm::ivec3 First = glm::max((Voxel - 1) / CellSizeInt, glm::ivec3(0));
+                        glm::ivec3 Last = glm::min((Voxel + 1) / CellSizeInt, glm::ivec3(m_dims) - 1);
+                        for (int Z = First.z; Z <= Last.z; Z++) {
+                            for (int Y = First.y; Y <= Last.y; Y++) {
+                                for (int X = First.x; X <= Last.x; X++) {
+                                    float& Majorant = m_majorants[(Z * m_dims.y + Y) * m_dims.x + X];
+                                    Majorant = std::max(Majorant, Density);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}  // namespace HWPT
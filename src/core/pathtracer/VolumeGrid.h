@@ -0,0 +1,151 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#ifndef HARDWAREPATHTRACER_VOLUMEGRID_H
+#define HARDWAREPATHTRACER_VOLUMEGRID_H
+
+#include "core/Core.h"
+#include "core/pathtracer/Ray.h"
+#include <filesystem>
+#include <vector>
+
+
+namespace HWPT {
+    // Header of the .vol files read by DensityGrid::Load. A dense file is followed by Dims.x * Dims.y *
+    // Dims.z floats in x-major order. A sparse file is followed by one uint per brick (x-major, ~0 for
+    // an empty brick) and then NumBricks * VolumeBrickVoxels floats, the same layout as the GPU buffers
+    struct VolumeFileHeader {
+        char Magic[8];  // "HWPTVOL1"
+        uint Dims[3];
+        uint Sparse;
+        float BoundsMin[3];
+        uint NumBricks;
+        float BoundsMax[3];
+        uint Padding;
+    };
+
+    static constexpr uint VolumeBrickSize = 8;
+    static constexpr uint VolumeBrickVoxels = VolumeBrickSize * VolumeBrickSize * VolumeBrickSize;
+    static constexpr uint VolumeEmptyBrick = ~0u;
+
+    // Voxel densities stored in 8^3 bricks behind a brick table, bricks that are entirely zero are not
+    // allocated. Voxel i covers [i, i + 1) in grid space and Sample() interpolates trilinearly between
+    // voxel centers, zero outside of the grid
+    class DensityGrid {
+    public:
+        DensityGrid() = default;
+
+        // Dense x-major densities, all-zero bricks are dropped
+        DensityGrid(const glm::uvec3& Dims, const AABB& Bounds, const std::vector<float>& Densities);
+
+        static auto Load(const std::filesystem::path& Path) -> DensityGrid;
+
+        void Save(const std::filesystem::path& Path, bool Sparse = true) const;
+
+        // fBm cloud in a sphere with a few dense cores, mostly empty towards the corners
+        static auto CreateCloud(uint Resolution, uint Seed = 0) -> DensityGrid;
+
+        [[nodiscard]] auto GetVoxel(int X, int Y, int Z) const -> float {
+            if (X < 0 || Y < 0 || Z < 0 || X >= static_cast<int>(m_dims.x) || Y >= static_cast<int>(m_dims.y) ||
+                Z >= static_cast<int>(m_dims.z)) {
+                return 0.f;
+            }
+            uint Brick = m_brickTable[((Z / VolumeBrickSize) * m_brickDims.y + Y / VolumeBrickSize) * m_brickDims.x +
+                                      X / VolumeBrickSize];
+            if (Brick == VolumeEmptyBrick) {
+                return 0.f;
+            }
+            uint Local = ((Z % VolumeBrickSize) * VolumeBrickSize + Y % VolumeBrickSize) * VolumeBrickSize +
+                         X % VolumeBrickSize;
+            return m_brickData[Brick * VolumeBrickVoxels + Local];
+        }
+
+        // GridPosition is in voxels, see WorldToGrid()
+        [[nodiscard]] auto Sample(const glm::vec3& GridPosition) const -> float;
+
+        [[nodiscard]] auto WorldToGrid(const glm::vec3& Position) const -> glm::vec3 {
+            return (Position - m_bounds.Min) * m_worldToGrid;
+        }
+
+        [[nodiscard]] auto GetDims() const -> const glm::uvec3& {
+            return m_dims;
+        }
+
+        [[nodiscard]] auto GetBrickDims() const -> const glm::uvec3& {
+            return m_brickDims;
+        }
+
+        [[nodiscard]] auto GetBounds() const -> const AABB& {
+            return m_bounds;
+        }
+
+        // Voxels per world unit along each axis
+        [[nodiscard]] auto GetWorldToGrid() const -> const glm::vec3& {
+            return m_worldToGrid;
+        }
+
+        [[nodiscard]] auto GetMaxDensity() const -> float {
+            return m_maxDensity;
+        }
+
+        [[nodiscard]] auto GetBrickTable() const -> const std::vector<uint>& {
+            return m_brickTable;
+        }
+
+        [[nodiscard]] auto GetBrickData() const -> const std::vector<float>& {
+            return m_brickData;
+        }
+
+        [[nodiscard]] auto GetNumBricks() const -> uint {
+            return static_cast<uint>(m_brickData.size() / VolumeBrickVoxels);
+        }
+
+        [[nodiscard]] auto GetMemoryBytes() const -> size_t {
+            return sizeof(uint) * m_brickTable.size() + sizeof(float) * m_brickData.size();
+        }
+
+    private:
+        void SetBounds(const AABB& Bounds);
+
+        glm::uvec3 m_dims = glm::uvec3(0);
+        glm::uvec3 m_brickDims = glm::uvec3(0);
+        AABB m_bounds;
+        glm::vec3 m_worldToGrid = glm::vec3(1.f);
+        float m_maxDensity = 0.f;
+        std::vector<uint> m_brickTable;
+        std::vector<float> m_brickData;
+    };
+
+    // Coarse grid of density upper bounds, cell c bounds Sample() over voxels [c * CellSize, (c + 1) *
+    // CellSize), which reads the voxels one further on each side through the trilinear filter
+    class MajorantGrid {
+    public:
+        MajorantGrid() = default;
+
+        MajorantGrid(const DensityGrid& Grid, uint CellSize = 8);
+
+        [[nodiscard]] auto GetMajorant(const glm::ivec3& Cell) const -> float {
+            return m_majorants[(Cell.z * m_dims.y + Cell.y) * m_dims.x + Cell.x];
+        }
+
+        [[nodiscard]] auto GetDims() const -> const glm::uvec3& {
+            return m_dims;
+        }
+
+        [[nodiscard]] auto GetCellSize() const -> uint {
+            return m_cellSize;
+        }
+
+        [[nodiscard]] auto GetMajorants() const -> const std::vector<float>& {
+            return m_majorants;
+        }
+
+    private:
+        glm::uvec3 m_dims = glm::uvec3(0);
+        uint m_cellSize = 8;
+        std::vector<float> m_majorants;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_VOLUMEGRID_H
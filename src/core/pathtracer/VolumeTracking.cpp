@@ -0,0 +1,239 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#include "VolumeTracking.h"
+#include "core/ThreadPool.h"
+#include "core/sampling/PCGRandom.h"
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+
+namespace HWPT {
+    VolumeTracker::VolumeTracker(const DensityGrid &Grid, const MajorantGrid &Majorants, float SigmaTScale,
+                                 bool LocalMajorants)
+            : m_grid(&Grid), m_majorants(&Majorants), m_sigmaTScale(SigmaTScale), m_localMajorants(LocalMajorants) {
+    }
+
+    template<typename Visitor>
+    void VolumeTracker::TraverseMajorants(const Ray &InRay, Visitor &&Visit) const {
+        // Work in majorant cell units, the ray parameter is the same as in world space
+        const float CellSize = static_cast<float>(m_majorants->GetCellSize());
+        const glm::vec3 Origin = m_grid->WorldToGrid(InRay.Origin) / CellSize;
+        const glm::vec3 Direction = InRay.Direction * m_grid->GetWorldToGrid() / CellSize;
+        const glm::ivec3 Dims(m_majorants->GetDims());
+        const glm::vec3 GridMax = glm::vec3(m_grid->GetDims()) / CellSize;
+
+        float TEnter = InRay.TMin, TExit = InRay.TMax;
+        for (int Axis = 0; Axis < 3; Axis++) {
+            if (Direction[Axis] == 0.f) {
+                if (Origin[Axis] < 0.f || Origin[Axis] >= GridMax[Axis]) {
+                    return;
+                }
+                continue;
+            }
+            float T0 = -Origin[Axis] / Direction[Axis];
+            float T1 = (GridMax[Axis] - Origin[Axis]) / Direction[Axis];
+            TEnter = std::max(TEnter, std::min(T0, T1));
+            TExit = std::min(TExit, std::max(T0, T1));
+        }
+        if (!(TEnter < TExit)) {
+            return;
+        }
+
+        if (!m_localMajorants) {
+            Visit(TEnter, TExit, m_sigmaTScale * m_grid->GetMaxDensity());
+            return;
+        }
+
+        glm::ivec3 Cell = glm::clamp(glm::ivec3(glm::floor(Origin + Direction * TEnter)), glm::ivec3(0), Dims - 1);
+        glm::ivec3 Step;
+        glm::vec3 TNext, TDelta;
+        for (int Axis = 0; Axis < 3; Axis++) {
+            if (Direction[Axis] == 0.f) {
+                Step[Axis] = 0;
+                TNext[Axis] = std::numeric_limits<float>::infinity();
+                TDelta[Axis] = std::numeric_limits<float>::infinity();
+                continue;
+            }
+            Step[Axis] = Direction[Axis] > 0.f ? 1 : -1;
+            float Boundary = static_cast<float>(Cell[Axis] + (Step[Axis] > 0 ? 1 : 0));
+            TNext[Axis] = (Boundary - Origin[Axis]) / Direction[Axis];
+            TDelta[Axis] = std::abs(1.f / Direction[Axis]);
+        }
+
+        float T = TEnter;
+        while (true) {
+            int Axis = TNext.x < TNext.y ? (TNext.x < TNext.z ? 0 : 2) : (TNext.y < TNext.z ? 1 : 2);
+            float SegmentEnd = std::min(TNext[Axis], TExit);
+            if (SegmentEnd > T && !Visit(T, SegmentEnd, m_sigmaTScale * m_majorants->GetMajorant(Cell))) {
+                return;
+            }
+            if (SegmentEnd >= TExit) {
+                return;
+            }
+            T = SegmentEnd;
+            Cell[Axis] += Step[Axis];
+            if (Cell[Axis] < 0 || Cell[Axis] >= Dims[Axis]) {
+                return;
+            }
+            TNext[Axis] += TDelta[Axis];
+        }
+    }
+
+    auto VolumeTracker::SampleFreeFlight(const Ray &InRay, PCGRandom &Random, float &CollisionT,
+                                         VolumeTrackingStats* Stats) const -> bool {
+        bool Collided = false;
+        uint64_t Lookups = 0, Segments = 0;
+        TraverseMajorants(InRay, [&](float T0, float T1, float Majorant) {
+            Segments++;
+            if (Majorant <= 0.f) {
+                return true;
+            }
+            // Exponential steps are memoryless, so leaving the segment just restarts at the next one
+            float T = T0;
+            while (true) {
+                T -= std::log(1.f - Random.NextFloat()) / Majorant;
+                if (T >= T1) {
+                    return true;
+                }
+                Lookups++;
+                if (Random.NextFloat() * Majorant < GetSigmaT(InRay.At(T))) {
+                    CollisionT = T;
+                    Collided = true;
+                    return false;
+                }
+            }
+        });
+        if (Stats != nullptr) {
+            Stats->DensityLookups += Lookups;
+            Stats->MajorantSegments += Segments;
+        }
+        return Collided;
+    }
+
+    auto VolumeTracker::Transmittance(const Ray &InRay, PCGRandom &Random, VolumeTrackingStats* Stats) const -> float {
+        float Result = 1.f;
+        uint64_t Lookups = 0, Segments = 0;
+        TraverseMajorants(InRay, [&](float T0, float T1, float Majorant) {
+            Segments++;
+            if (Majorant <= 0.f) {
+                return true;
+            }
+            float T = T0;
+            while (true) {
+                T -= std::log(1.f - Random.NextFloat()) / Majorant;
+                if (T >= T1) {
+                    return true;
+                }
+                Lookups++;
+                Result *= 1.f - GetSigmaT(InRay.At(T)) / Majorant;
+                if (Result <= 0.f) {
+                    Result = 0.f;
+                    return false;
+                }
+            }
+        });
+        if (Stats != nullptr) {
+            Stats->DensityLookups += Lookups;
+            Stats->MajorantSegments += Segments;
+        }
+        return Result;
+    }
+
+    auto VolumeTracker::RayMarchTransmittance(const Ray &InRay, uint StepsPerVoxel) const -> float {
+        float OpticalDepth = 0.f;
+        const float VoxelsPerUnit = glm::length(InRay.Direction * m_grid->GetWorldToGrid());
+        TraverseMajorants(InRay, [&](float T0, float T1, float) {
+            auto NumSteps = static_cast<uint>(std::ceil((T1 - T0) * VoxelsPerUnit * static_cast<float>(StepsPerVoxel)));
+            NumSteps = std::max(NumSteps, 1u);
+            float StepSize = (T1 - T0) / static_cast<float>(NumSteps);
+            for (uint i = 0; i < NumSteps; i++) {
+                OpticalDepth += GetSigmaT(InRay.At(T0 + (static_cast<float>(i) + .5f) * StepSize)) * StepSize;
+            }
+            return true;
+        });
+        return std::exp(-OpticalDepth);
+    }
+
+    void VolumeTracker::ReportMajorants(uint Resolution, uint NumRays, uint SamplesPerRay, float SigmaTScale,
+                                        const std::string &VolumePath) {
+        DensityGrid Cloud = DensityGrid::CreateCloud(Resolution);
+        Cloud.Save(VolumePath);
+        DensityGrid Grid = DensityGrid::Load(VolumePath);
+        MajorantGrid Majorants(Grid);
+
+        // Rays from a sphere around the volume towards its inner half
+        std::vector<Ray> Rays(NumRays);
+        PCGRandom RayRandom(7);
+        for (auto& R: Rays) {
+            float CosTheta = 2.f * RayRandom.NextFloat() - 1.f;
+            float SinTheta = std::sqrt(std::max(0.f, 1.f - CosTheta * CosTheta));
+            float Phi = 6.28318530718f * RayRandom.NextFloat();
+            R.Origin = 2.f * glm::vec3(SinTheta * std::cos(Phi), SinTheta * std::sin(Phi), CosTheta);
+            glm::vec3 Target(RayRandom.NextFloat() - .5f, RayRandom.NextFloat() - .5f, RayRandom.NextFloat() - .5f);
+            R.Direction = glm::normalize(Target - R.Origin);
+        }
+
+        VolumeTracker Reference(Grid, Majorants, SigmaTScale, true);
+        std::vector<float> Expected(NumRays);
+        ThreadPool::Get().ParallelFor(NumRays, [&](uint Begin, uint End) {
+            for (uint i = Begin; i < End; i++) {
+                Expected[i] = Reference.RayMarchTransmittance(Rays[i]);
+            }
+        });
+        double MeanTransmittance = 0.;
+        for (float Value: Expected) {
+            MeanTransmittance += Value;
+        }
+        MeanTransmittance /= NumRays;
+
+        size_t DenseBytes = sizeof(float) * static_cast<size_t>(Resolution) * Resolution * Resolution;
+        std::cout << "Volume " << Resolution << "^3, " << Grid.GetNumBricks() << " bricks, "
+                  << Grid.GetMemoryBytes() / 1024 << " KB sparse vs " << DenseBytes / 1024 << " KB dense, majorant grid "
+                  << Majorants.GetDims().x << "^3, max sigma_t " << SigmaTScale * Grid.GetMaxDensity() << ", "
+                  << NumRays << " rays x " << SamplesPerRay << " samples, mean T " << MeanTransmittance << "\n";
+        std::cout << "Majorant | Estimator | ms | lookups/sample | segments/sample | RMSE | mean error\n";
+
+        for (bool Local: {false, true}) {
+            VolumeTracker Tracker(Grid, Majorants, SigmaTScale, Local);
+            for (bool Delta: {false, true}) {
+                std::mutex StatsMutex;
+                VolumeTrackingStats Stats;
+                std::vector<float> Estimates(NumRays);
+                auto StartTime = std::chrono::high_resolution_clock::now();
+                ThreadPool::Get().ParallelFor(NumRays, [&](uint Begin, uint End) {
+                    VolumeTrackingStats LocalStats;
+                    for (uint i = Begin; i < End; i++) {
+                        PCGRandom Random(i, Local ? 1 : 2);
+                        float Sum = 0.f;
+                        for (uint Sample = 0; Sample < SamplesPerRay; Sample++) {
+                            float CollisionT;
+                            Sum += Delta ? (Tracker.SampleFreeFlight(Rays[i], Random, CollisionT, &LocalStats) ? 0.f : 1.f)
+                                         : Tracker.Transmittance(Rays[i], Random, &LocalStats);
+                        }
+                        Estimates[i] = Sum / static_cast<float>(SamplesPerRay);
+                    }
+                    std::lock_guard<std::mutex> Lock(StatsMutex);
+                    Stats.DensityLookups += LocalStats.DensityLookups;
+                    Stats.MajorantSegments += LocalStats.MajorantSegments;
+                });
+                double Ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::high_resolution_clock::now() - StartTime).count();
+
+                double SquaredError = 0., Bias = 0.;
+                for (uint i = 0; i < NumRays; i++) {
+                    SquaredError += (Estimates[i] - Expected[i]) * (Estimates[i] - Expected[i]);
+                    Bias += Estimates[i] - Expected[i];
+                }
+                double NumSamples = static_cast<double>(NumRays) * SamplesPerRay;
+                std::cout << (Local ? "local" : "global") << " | " << (Delta ? "delta (escape)" : "ratio") << " | "
+                          << Ms << " | " << static_cast<double>(Stats.DensityLookups) / NumSamples << " | "
+                          << static_cast<double>(Stats.MajorantSegments) / NumSamples << " | "
+                          << std::sqrt(SquaredError / NumRays) << " | " << Bias / NumRays << "\n";
+            }
+        }
+        std::cout.flush();
+    }
+}  // namespace HWPT
@@ -0,0 +1,65 @@
+//
+// Created by HUSTLX on 2024/10/29.
+//
+
+#ifndef HARDWAREPATHTRACER_VOLUMETRACKING_H
+#define HARDWAREPATHTRACER_VOLUMETRACKING_H
+
+#include "core/Core.h"
+#include "core/pathtracer/Ray.h"
+#include "core/pathtracer/VolumeGrid.h"
+#include <string>
+
+
+namespace HWPT {
+    class PCGRandom;
+
+    struct VolumeTrackingStats {
+        uint64_t DensityLookups = 0;
+        uint64_t MajorantSegments = 0;
+    };
+
+    // Delta and ratio tracking through a heterogeneous medium with sigma_t = SigmaTScale * density.
+    // With LocalMajorants the ray walks the majorant grid with a 3D DDA and samples tentative
+    // collisions against each cell's bound, otherwise against the single global maximum. Both are
+    // unbiased, the local bounds just reject far fewer null collisions in sparse or spiky media
+    class VolumeTracker {
+    public:
+        VolumeTracker(const DensityGrid& Grid, const MajorantGrid& Majorants, float SigmaTScale = 1.f,
+                      bool LocalMajorants = true);
+
+        // Delta tracking, returns true and the distance of a real collision in [TMin, TMax), false if
+        // the ray leaves the medium first
+        auto SampleFreeFlight(const Ray& InRay, PCGRandom& Random, float& CollisionT,
+                              VolumeTrackingStats* Stats = nullptr) const -> bool;
+
+        // Ratio tracking estimate of the transmittance over [TMin, TMax]
+        auto Transmittance(const Ray& InRay, PCGRandom& Random, VolumeTrackingStats* Stats = nullptr) const -> float;
+
+        // Deterministic midpoint quadrature of the optical depth with StepsPerVoxel steps per voxel
+        auto RayMarchTransmittance(const Ray& InRay, uint StepsPerVoxel = 8) const -> float;
+
+        [[nodiscard]] auto GetSigmaT(const glm::vec3& Position) const -> float {
+            return m_sigmaTScale * m_grid->Sample(m_grid->WorldToGrid(Position));
+        }
+
+        // Transmittance and free-flight sampling through the synthetic cloud with the global and the
+        // local majorants on the CPU, the error is measured against ray marching. The cloud is written
+        // to and loaded back from VolumePath to exercise the file format
+        static void ReportMajorants(uint Resolution = 128, uint NumRays = 65536, uint SamplesPerRay = 4,
+                                    float SigmaTScale = 8.f, const std::string& VolumePath = "Cloud.vol");
+
+    private:
+        // Calls Visit(T0, T1, SigmaMajorant) for the segments of the ray inside the grid, front to back,
+        // until Visit returns false
+        template<typename Visitor>
+        void TraverseMajorants(const Ray& InRay, Visitor&& Visit) const;
+
+        const DensityGrid* m_grid = nullptr;
+        const MajorantGrid* m_majorants = nullptr;
+        float m_sigmaTScale = 1.f;
+        bool m_localMajorants = true;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_VOLUMETRACKING_H
@@ -0,0 +1,341 @@
+//
+// Created by HUSTLX on 2024/11/9.
+//
+
+#include "PipelineCache.h"
+#include "core/ThreadPool.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+
+namespace HWPT {
+    static void HashCombine(uint64_t& Seed, uint64_t Value) {
+        Seed ^= Value + 0x9e3779b97f4a7c15ull + (Seed << 6u) + (Seed >> 2u);
+    }
+
+    // Flattens a pipeline description into words, two descriptions are the same pipeline iff their words are
+    struct PipelineKeyWriter {
+        std::vector<uint64_t> Words;
+
+        void Add(uint64_t Value) {
+            Words.push_back(Value);
+        }
+
+        void AddFloat(float Value) {
+            uint32_t Bits;
+            std::memcpy(&Bits, &Value, sizeof(Bits));
+            Words.push_back(Bits);
+        }
+
+        template<typename T>
+        void AddHandle(T Handle) {
+            uint64_t Value = 0;
+            std::memcpy(&Value, &Handle, sizeof(Handle));
+            Words.push_back(Value);
+        }
+
+        void AddBytes(const void* Data, size_t Size) {
+            Words.push_back(Size);
+            size_t Offset = Words.size();
+            Words.resize(Offset + (Size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+            if (Size > 0) {
+                std::memcpy(Words.data() + Offset, Data, Size);
+            }
+        }
+
+        void AddString(const char* String) {
+            AddBytes(String, String ? std::strlen(String) : 0);
+        }
+
+        void AddStage(const VkPipelineShaderStageCreateInfo& Stage, uint64_t CodeHash) {
+            Add(Stage.flags);
+            Add(Stage.stage);
+            Add(CodeHash);
+            AddString(Stage.pName);
+            const VkSpecializationInfo* Specialization = Stage.pSpecializationInfo;
+            Add(Specialization != nullptr);
+            if (Specialization) {
+                AddBytes(Specialization->pMapEntries, sizeof(VkSpecializationMapEntry) * Specialization->mapEntryCount);
+                AddBytes(Specialization->pData, Specialization->dataSize);
+            }
+        }
+
+        static auto HashWords(const std::vector<uint64_t>& Words) -> uint64_t {
+            uint64_t Hash = Words.size();
+            for (uint64_t Word: Words) {
+                HashCombine(Hash, Word);
+            }
+            return Hash;
+        }
+    };
+
+    static auto BuildGraphicsKey(const VkGraphicsPipelineCreateInfo& Info,
+                                 const std::vector<uint64_t>& StageCodeHashes) -> PipelineKeyWriter {
+        Check(StageCodeHashes.size() == Info.stageCount);
+        PipelineKeyWriter Key;
+        Key.Add(Info.flags);
+        Key.Add(Info.stageCount);
+        for (uint i = 0; i < Info.stageCount; i++) {
+            Key.AddStage(Info.pStages[i], StageCodeHashes[i]);
+        }
+
+        if (const auto* VertexInput = Info.pVertexInputState) {
+            Key.AddBytes(VertexInput->pVertexBindingDescriptions,
+                         sizeof(VkVertexInputBindingDescription) * VertexInput->vertexBindingDescriptionCount);
+            Key.AddBytes(VertexInput->pVertexAttributeDescriptions,
+                         sizeof(VkVertexInputAttributeDescription) * VertexInput->vertexAttributeDescriptionCount);
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* InputAssembly = Info.pInputAssemblyState) {
+            Key.Add(InputAssembly->topology);
+            Key.Add(InputAssembly->primitiveRestartEnable);
+        } else {
+            Key.Add(~0ull);
+        }
+        Key.Add(Info.pTessellationState ? Info.pTessellationState->patchControlPoints : ~0u);
+        if (const auto* Viewport = Info.pViewportState) {
+            Key.Add(Viewport->viewportCount);
+            Key.Add(Viewport->scissorCount);
+            // Null with dynamic viewports and scissors
+            Key.AddBytes(Viewport->pViewports, Viewport->pViewports ? sizeof(VkViewport) * Viewport->viewportCount : 0);
+            Key.AddBytes(Viewport->pScissors, Viewport->pScissors ? sizeof(VkRect2D) * Viewport->scissorCount : 0);
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* Rasterizer = Info.pRasterizationState) {
+            Key.Add(Rasterizer->depthClampEnable);
+            Key.Add(Rasterizer->rasterizerDiscardEnable);
+            Key.Add(Rasterizer->polygonMode);
+            Key.Add(Rasterizer->cullMode);
+            Key.Add(Rasterizer->frontFace);
+            Key.Add(Rasterizer->depthBiasEnable);
+            Key.AddFloat(Rasterizer->depthBiasConstantFactor);
+            Key.AddFloat(Rasterizer->depthBiasClamp);
+            Key.AddFloat(Rasterizer->depthBiasSlopeFactor);
+            Key.AddFloat(Rasterizer->lineWidth);
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* Multisampling = Info.pMultisampleState) {
+            Key.Add(Multisampling->rasterizationSamples);
+            Key.Add(Multisampling->sampleShadingEnable);
+            Key.AddFloat(Multisampling->minSampleShading);
+            size_t MaskWords = (static_cast<size_t>(Multisampling->rasterizationSamples) + 31) / 32;
+            Key.AddBytes(Multisampling->pSampleMask, Multisampling->pSampleMask ? sizeof(uint32_t) * MaskWords : 0);
+            Key.Add(Multisampling->alphaToCoverageEnable);
+            Key.Add(Multisampling->alphaToOneEnable);
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* DepthStencil = Info.pDepthStencilState) {
+            Key.Add(DepthStencil->depthTestEnable);
+            Key.Add(DepthStencil->depthWriteEnable);
+            Key.Add(DepthStencil->depthCompareOp);
+            Key.Add(DepthStencil->depthBoundsTestEnable);
+            Key.Add(DepthStencil->stencilTestEnable);
+            Key.AddBytes(&DepthStencil->front, sizeof(VkStencilOpState));
+            Key.AddBytes(&DepthStencil->back, sizeof(VkStencilOpState));
+            Key.AddFloat(DepthStencil->minDepthBounds);
+            Key.AddFloat(DepthStencil->maxDepthBounds);
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* ColorBlend = Info.pColorBlendState) {
+            Key.Add(ColorBlend->logicOpEnable);
+            Key.Add(ColorBlend->logicOp);
+            Key.AddBytes(ColorBlend->pAttachments,
+                         sizeof(VkPipelineColorBlendAttachmentState) * ColorBlend->attachmentCount);
+            for (float Constant: ColorBlend->blendConstants) {
+                Key.AddFloat(Constant);
+            }
+        } else {
+            Key.Add(~0ull);
+        }
+        if (const auto* Dynamic = Info.pDynamicState) {
+            Key.AddBytes(Dynamic->pDynamicStates, sizeof(VkDynamicState) * Dynamic->dynamicStateCount);
+        } else {
+            Key.Add(~0ull);
+        }
+        Key.AddHandle(Info.layout);
+        Key.AddHandle(Info.renderPass);
+        Key.Add(Info.subpass);
+        return Key;
+    }
+
+    PipelineCache::PipelineCache(VkDevice Device, VkPhysicalDevice PhysicalDevice, std::filesystem::path CachePath)
+            : m_device(Device), m_cachePath(std::move(CachePath)) {
+        vkGetPhysicalDeviceProperties(PhysicalDevice, &m_deviceProperties);
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        std::vector<char> InitialData = LoadCacheFile();
+        m_stats.WarmStart = !InitialData.empty();
+        m_stats.LoadedBytes = InitialData.size();
+
+        VkPipelineCacheCreateInfo CacheInfo{};
+        CacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        CacheInfo.initialDataSize = InitialData.size();
+        CacheInfo.pInitialData = InitialData.empty() ? nullptr : InitialData.data();
+        VK_CHECK(vkCreatePipelineCache(m_device, &CacheInfo, nullptr, &m_cache));
+        m_stats.LoadMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+    }
+
+    PipelineCache::~PipelineCache() {
+        for (auto& [Hash, Entry]: m_pipelines) {
+            // Waits for compiles still in flight, failed ones were removed from the map
+            vkDestroyPipeline(m_device, Entry.Pipeline.get(), nullptr);
+        }
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    }
+
+    auto PipelineCache::LoadCacheFile() -> std::vector<char> {
+        std::ifstream File(m_cachePath, std::ios::ate | std::ios::binary);
+        if (!File.is_open()) {
+            return {};
+        }
+        size_t FileSize = File.tellg();
+        std::vector<char> Data(FileSize);
+        File.seekg(0);
+        File.read(Data.data(), static_cast<std::streamsize>(FileSize));
+        if (!File) {
+            std::cerr << "Pipeline cache " << m_cachePath.string() << " is unreadable, starting cold\n";
+            return {};
+        }
+
+        // A cache from another driver or GPU is at best ignored by the driver, validate it before handing it over
+        VkPipelineCacheHeaderVersionOne Header{};
+        if (FileSize < sizeof(Header)) {
+            std::cerr << "Pipeline cache " << m_cachePath.string() << " is truncated, starting cold\n";
+            return {};
+        }
+        std::memcpy(&Header, Data.data(), sizeof(Header));
+        if (Header.headerSize < sizeof(Header) || Header.headerSize > FileSize ||
+            Header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+            std::cerr << "Pipeline cache " << m_cachePath.string() << " has an unknown header, starting cold\n";
+            return {};
+        }
+        if (Header.vendorID != m_deviceProperties.vendorID || Header.deviceID != m_deviceProperties.deviceID ||
+            std::memcmp(Header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            std::cerr << "Pipeline cache " << m_cachePath.string()
+                      << " was written by another device or driver, starting cold\n";
+            return {};
+        }
+        return Data;
+    }
+
+    void PipelineCache::Save() const {
+        size_t DataSize = 0;
+        VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &DataSize, nullptr));
+        std::vector<char> Data(DataSize);
+        VK_CHECK(vkGetPipelineCacheData(m_device, m_cache, &DataSize, Data.data()));
+
+        // Written next to the cache and renamed over it, a crash mid-write leaves the previous cache intact
+        std::filesystem::path TempPath = m_cachePath;
+        TempPath += ".tmp";
+        {
+            std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+            File.write(Data.data(), static_cast<std::streamsize>(DataSize));
+            if (!File) {
+                std::cerr << "Failed to write pipeline cache " << TempPath.string() << "\n";
+                return;
+            }
+        }
+        std::error_code Error;
+        std::filesystem::rename(TempPath, m_cachePath, Error);
+        if (Error) {
+            std::cerr << "Failed to replace pipeline cache " << m_cachePath.string() << ": " << Error.message()
+                      << "\n";
+        }
+    }
+
+    auto PipelineCache::FindOrCreate(std::vector<uint64_t> &&Key,
+                                     const std::function<VkPipeline()> &Create) -> VkPipeline {
+        uint64_t Hash = PipelineKeyWriter::HashWords(Key);
+        std::promise<VkPipeline> Promise;
+        std::shared_future<VkPipeline> Existing;
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            auto [Begin, End] = m_pipelines.equal_range(Hash);
+            for (auto It = Begin; It != End && !Existing.valid(); ++It) {
+                if (It->second.Key == Key) {
+                    Existing = It->second.Pipeline;
+                }
+            }
+            if (Existing.valid()) {
+                m_stats.Hits++;
+            } else {
+                m_stats.Misses++;
+                m_pipelines.emplace(Hash, PipelineEntry{Key, Promise.get_future().share()});
+            }
+        }
+        if (Existing.valid()) {
+            // Waited on outside the lock, other requests must not queue up behind a compile
+            return Existing.get();
+        }
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        VkPipeline Pipeline;
+        try {
+            Pipeline = Create();
+        } catch (...) {
+            // Threads already waiting get the exception, later requests try again
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            auto [Begin, End] = m_pipelines.equal_range(Hash);
+            for (auto It = Begin; It != End; ++It) {
+                if (It->second.Key == Key) {
+                    m_pipelines.erase(It);
+                    break;
+                }
+            }
+            Promise.set_exception(std::current_exception());
+            throw;
+        }
+        double ElapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+        Promise.set_value(Pipeline);
+
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        m_stats.CompileMilliseconds += ElapsedMs;
+        m_stats.NumPipelines++;
+        return Pipeline;
+    }
+
+    auto PipelineCache::GetGraphicsPipeline(const VkGraphicsPipelineCreateInfo &Info,
+                                            const std::vector<uint64_t> &StageCodeHashes) -> VkPipeline {
+        PipelineKeyWriter Key = BuildGraphicsKey(Info, StageCodeHashes);
+        return FindOrCreate(std::move(Key.Words), [&]() {
+            VkPipeline Pipeline;
+            VK_CHECK_WITH_MESSAGE(vkCreateGraphicsPipelines(m_device, m_cache, 1, &Info, nullptr, &Pipeline),
+                                  "Failed to create graphics pipeline");
+            return Pipeline;
+        });
+    }
+
+    auto PipelineCache::GetComputePipeline(const VkComputePipelineCreateInfo &Info, uint64_t CodeHash) -> VkPipeline {
+        PipelineKeyWriter Key;
+        Key.Add(Info.flags);
+        Key.AddStage(Info.stage, CodeHash);
+        Key.AddHandle(Info.layout);
+        return FindOrCreate(std::move(Key.Words), [&]() {
+            VkPipeline Pipeline;
+            VK_CHECK_WITH_MESSAGE(vkCreateComputePipelines(m_device, m_cache, 1, &Info, nullptr, &Pipeline),
+                                  "Failed to create compute pipeline");
+            return Pipeline;
+        });
+    }
+
+    auto PipelineCache::CompileAsync(std::function<VkPipeline()> Build) -> std::shared_future<VkPipeline> {
+        {
+            std::lock_guard<std::mutex> Lock(m_mutex);
+            m_stats.NumAsyncRequests++;
+        }
+        return ThreadPool::Get().Submit(std::move(Build)).share();
+    }
+
+    auto PipelineCache::GetStats() const -> PipelineCacheStats {
+        std::lock_guard<std::mutex> Lock(m_mutex);
+        return m_stats;
+    }
+}  // namespace HWPT
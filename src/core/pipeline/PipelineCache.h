@@ -0,0 +1,83 @@
+//
+// Created by HUSTLX on 2024/11/9.
+//
+
+#ifndef HARDWAREPATHTRACER_PIPELINECACHE_H
+#define HARDWAREPATHTRACER_PIPELINECACHE_H
+
+#include "core/Core.h"
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace HWPT {
+    struct PipelineCacheStats {
+        bool WarmStart = false;  // A valid cache file for this device was loaded
+        size_t LoadedBytes = 0;
+        double LoadMilliseconds = 0.;
+        uint NumPipelines = 0;
+        uint Hits = 0;
+        uint Misses = 0;
+        double CompileMilliseconds = 0.;  // Spent in vkCreate*Pipelines on misses, summed over all threads
+        uint NumAsyncRequests = 0;
+    };
+
+    // Owns the VkPipelineCache every pipeline is compiled through and the pipelines created from it.
+    // The driver cache is seeded from CachePath when the file's header matches this device (vendor, device and
+    // pipelineCacheUUID) and written back by Save, so a warm start skips most shader compilation. On top of it
+    // pipelines are deduplicated in process: the create info is flattened into a key, with the SPIR-V hash of
+    // each stage (ShaderBase::GetCodeHash) standing in for its module handle, and an identical request returns
+    // the pipeline created the first time. pNext chains are not part of the key.
+    // All methods may be called from any thread. A request for a pipeline another thread is still compiling
+    // waits for that compile instead of starting a second one, and CompileAsync queues whole pipeline builds,
+    // shader loading included, on the ThreadPool
+    class PipelineCache {
+    public:
+        PipelineCache(VkDevice Device, VkPhysicalDevice PhysicalDevice, std::filesystem::path CachePath);
+
+        ~PipelineCache();
+
+        // StageCodeHashes[i] identifies the code of Info.pStages[i]
+        auto GetGraphicsPipeline(const VkGraphicsPipelineCreateInfo& Info,
+                                 const std::vector<uint64_t>& StageCodeHashes) -> VkPipeline;
+
+        auto GetComputePipeline(const VkComputePipelineCreateInfo& Info, uint64_t CodeHash) -> VkPipeline;
+
+        // Runs Build on a worker, Build sets up its shaders and state and calls Get*Pipeline
+        auto CompileAsync(std::function<VkPipeline()> Build) -> std::shared_future<VkPipeline>;
+
+        // Writes the driver cache to CachePath, failures are reported and otherwise ignored
+        void Save() const;
+
+        auto GetHandle() -> VkPipelineCache {
+            return m_cache;
+        }
+
+        [[nodiscard]] auto GetStats() const -> PipelineCacheStats;
+
+    private:
+        auto LoadCacheFile() -> std::vector<char>;
+
+        // Returns the pipeline for Key, calling Create outside the lock when no thread has requested it yet
+        auto FindOrCreate(std::vector<uint64_t>&& Key, const std::function<VkPipeline()>& Create) -> VkPipeline;
+
+        struct PipelineEntry {
+            std::vector<uint64_t> Key;
+            std::shared_future<VkPipeline> Pipeline;  // Pending while the first requester compiles it
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_deviceProperties{};
+        std::filesystem::path m_cachePath;
+        VkPipelineCache m_cache = VK_NULL_HANDLE;
+        mutable std::mutex m_mutex;  // Guards m_pipelines and m_stats, VkPipelineCache is internally synchronized
+        std::unordered_multimap<uint64_t, PipelineEntry> m_pipelines;
+        PipelineCacheStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_PIPELINECACHE_H
@@ -0,0 +1,547 @@
+//
+// Created by HUSTLX on 2024/11/4.
+//
+
+#include "RenderGraph.h"
+#include "core/application/VulkanBackendApp.h"
+#include "core/RHI.h"
+#include <algorithm>
+
+
+namespace HWPT {
+    static constexpr VkAccessFlags2 WriteAccessMask =
+            VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+    static void HashCombine(uint64_t& Seed, uint64_t Value) {
+        Seed ^= Value + 0x9e3779b97f4a7c15ull + (Seed << 6u) + (Seed >> 2u);
+    }
+
+    auto RenderGraph::PassBuilder::Read(RGHandle Resource, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access,
+                                        VkImageLayout Layout) -> PassBuilder& {
+        m_graph.AddAccess(m_pass, Resource, {Stage, Access, Layout, VK_IMAGE_LAYOUT_UNDEFINED}, false);
+        return *this;
+    }
+
+    auto RenderGraph::PassBuilder::Write(RGHandle Resource, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access,
+                                         VkImageLayout Layout, VkImageLayout EndLayout) -> PassBuilder& {
+        m_graph.AddAccess(m_pass, Resource, {Stage, Access, Layout, EndLayout}, true);
+        return *this;
+    }
+
+    auto RenderGraph::PassBuilder::SetSideEffect() -> PassBuilder& {
+        m_graph.m_passes[m_pass].SideEffect = true;
+        return *this;
+    }
+
+    RenderGraph::RenderGraph(VkDevice Device) : m_device(Device) {}
+
+    RenderGraph::~RenderGraph() {
+        ReleaseTransients();
+    }
+
+    void RenderGraph::Reset() {
+        m_resources.clear();
+        m_passes.clear();
+        m_compiled = false;
+    }
+
+    auto RenderGraph::CreateTexture(const std::string &Name, const RGTextureDesc &Desc) -> RGHandle {
+        Resource Texture;
+        Texture.Name = Name;
+        Texture.Desc = Desc;
+        m_resources.push_back(Texture);
+        return {static_cast<uint>(m_resources.size() - 1)};
+    }
+
+    auto RenderGraph::ImportTexture(const std::string &Name, VkImage Image, VkImageView View,
+                                    VkImageAspectFlags Aspect, const RGAccess &Initial,
+                                    VkImageLayout FinalLayout) -> RGHandle {
+        Resource Texture;
+        Texture.Name = Name;
+        Texture.Imported = true;
+        Texture.Desc.Aspect = Aspect;
+        Texture.Image = Image;
+        Texture.View = View;
+        Texture.Initial = Initial;
+        Texture.FinalLayout = FinalLayout;
+        m_resources.push_back(Texture);
+        return {static_cast<uint>(m_resources.size() - 1)};
+    }
+
+    auto RenderGraph::ImportBuffer(const std::string &Name, VkBuffer Buffer, const RGAccess &Initial) -> RGHandle {
+        Resource ImportedBuffer;
+        ImportedBuffer.Name = Name;
+        ImportedBuffer.Imported = true;
+        ImportedBuffer.IsBuffer = true;
+        ImportedBuffer.Buffer = Buffer;
+        ImportedBuffer.Initial = Initial;
+        m_resources.push_back(ImportedBuffer);
+        return {static_cast<uint>(m_resources.size() - 1)};
+    }
+
+    void RenderGraph::MarkOutput(RGHandle Resource) {
+        m_resources[Resource.Index].IsOutput = true;
+    }
+
+    auto RenderGraph::AddPass(const std::string &Name, ExecuteFunction Execute) -> PassBuilder {
+        Pass NewPass;
+        NewPass.Name = Name;
+        NewPass.Execute = std::move(Execute);
+        m_passes.push_back(std::move(NewPass));
+        return {*this, static_cast<uint>(m_passes.size() - 1)};
+    }
+
+    void RenderGraph::AddAccess(uint PassIndex, RGHandle Resource, const RGAccess &Access, bool IsWrite) {
+        Check(Resource.IsValid() && Resource.Index < m_resources.size());
+        Check(m_resources[Resource.Index].IsBuffer || Access.Layout != VK_IMAGE_LAYOUT_UNDEFINED);
+        // A resource read and written by one pass, e.g. a depth buffer, becomes a single write access
+        for (auto& Existing: m_passes[PassIndex].Accesses) {
+            if (Existing.Resource == Resource.Index) {
+                if (Existing.Access.Layout != Access.Layout) {
+                    throw std::runtime_error("Pass " + m_passes[PassIndex].Name + " uses " +
+                                             m_resources[Resource.Index].Name + " in two layouts");
+                }
+                Existing.Access.Stage |= Access.Stage;
+                Existing.Access.Access |= Access.Access;
+                if (Access.EndLayout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                    Existing.Access.EndLayout = Access.EndLayout;
+                }
+                Existing.IsWrite |= IsWrite;
+                return;
+            }
+        }
+        m_passes[PassIndex].Accesses.push_back({Resource.Index, Access, IsWrite});
+    }
+
+    void RenderGraph::CullPasses() {
+        // Pass references are the resources it writes, resource references the passes reading it plus one
+        // for outputs. Whatever drops to zero starting from the unreferenced resources is culled
+        for (auto& Current: m_resources) {
+            Current.RefCount = Current.IsOutput ? 1 : 0;
+        }
+        for (auto& Current: m_passes) {
+            Current.RefCount = 0;
+            Current.Culled = false;
+            for (const auto& Access: Current.Accesses) {
+                if (Access.IsWrite) {
+                    Current.RefCount++;
+                } else {
+                    m_resources[Access.Resource].RefCount++;
+                }
+            }
+        }
+        std::vector<uint> Unreferenced;
+        for (uint i = 0; i < m_resources.size(); i++) {
+            if (m_resources[i].RefCount == 0) {
+                Unreferenced.push_back(i);
+            }
+        }
+        while (!Unreferenced.empty()) {
+            uint ResourceIndex = Unreferenced.back();
+            Unreferenced.pop_back();
+            for (auto& Writer: m_passes) {
+                bool WritesResource = std::any_of(Writer.Accesses.begin(), Writer.Accesses.end(),
+                                                  [&](const PassAccess& Access) {
+                                                      return Access.IsWrite && Access.Resource == ResourceIndex;
+                                                  });
+                if (!WritesResource || Writer.SideEffect || Writer.Culled || --Writer.RefCount > 0) {
+                    continue;
+                }
+                Writer.Culled = true;
+                for (const auto& Access: Writer.Accesses) {
+                    if (!Access.IsWrite && --m_resources[Access.Resource].RefCount == 0) {
+                        Unreferenced.push_back(Access.Resource);
+                    }
+                }
+            }
+        }
+    }
+
+    void RenderGraph::Compile() {
+        m_stats = RenderGraphStats();
+        m_stats.NumPasses = static_cast<uint>(m_passes.size());
+        CullPasses();
+
+        for (auto& Current: m_resources) {
+            Current.FirstPass = -1;
+            Current.LastPass = -1;
+            Current.Physical = ~0u;
+        }
+        for (uint PassIndex = 0; PassIndex < m_passes.size(); PassIndex++) {
+            if (m_passes[PassIndex].Culled) {
+                m_stats.NumCulledPasses++;
+                continue;
+            }
+            for (const auto& Access: m_passes[PassIndex].Accesses) {
+                Resource& Current = m_resources[Access.Resource];
+                if (Current.FirstPass < 0) {
+                    Current.FirstPass = static_cast<int>(PassIndex);
+                }
+                Current.LastPass = static_cast<int>(PassIndex);
+            }
+        }
+
+        // Transients only referenced by culled passes are never created
+        std::vector<uint> Transients;
+        uint64_t Signature = 0;
+        for (uint i = 0; i < m_resources.size(); i++) {
+            const Resource& Current = m_resources[i];
+            if (Current.Imported || Current.FirstPass < 0) {
+                continue;
+            }
+            Transients.push_back(i);
+            const RGTextureDesc& Desc = Current.Desc;
+            for (uint64_t Value: {uint64_t(Desc.Width), uint64_t(Desc.Height), uint64_t(Desc.Format),
+                                  uint64_t(Desc.Samples), uint64_t(Desc.Usage), uint64_t(Desc.Aspect),
+                                  uint64_t(Current.FirstPass), uint64_t(Current.LastPass)}) {
+                HashCombine(Signature, Value);
+            }
+        }
+        if (Transients.empty() || Signature != m_physicalSignature || m_physical.size() != Transients.size()) {
+            if (!m_physical.empty()) {
+                vkDeviceWaitIdle(m_device);
+            }
+            ReleaseTransients();
+            CreatePhysicalTextures(Transients);
+            m_physicalSignature = Signature;
+        }
+        for (uint i = 0; i < Transients.size(); i++) {
+            m_resources[Transients[i]].Physical = i;
+        }
+        UpdateAliasStages(Transients);
+
+        m_stats.NumTransients = static_cast<uint>(Transients.size());
+        for (const auto& Texture: m_physical) {
+            m_stats.TransientBytes += Texture.Size;
+        }
+        for (const auto* Memory: m_physicalMemory) {
+            m_stats.AllocatedBytes += Memory->Size;
+        }
+        m_compiled = true;
+    }
+
+    void RenderGraph::CreatePhysicalTextures(const std::vector<uint> &Transients) {
+        if (Transients.empty()) {
+            return;
+        }
+        m_generation++;
+        m_physical.resize(Transients.size());
+        std::vector<VkMemoryRequirements> Requirements(Transients.size());
+        for (uint i = 0; i < Transients.size(); i++) {
+            const RGTextureDesc& Desc = m_resources[Transients[i]].Desc;
+            VkImageCreateInfo CreateInfo{};
+            CreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            CreateInfo.imageType = VK_IMAGE_TYPE_2D;
+            CreateInfo.extent = {Desc.Width, Desc.Height, 1};
+            CreateInfo.mipLevels = 1;
+            CreateInfo.arrayLayers = 1;
+            CreateInfo.format = Desc.Format;
+            CreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            CreateInfo.samples = Desc.Samples;
+            CreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            CreateInfo.usage = Desc.Usage;
+            CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            VK_CHECK(vkCreateImage(m_device, &CreateInfo, nullptr, &m_physical[i].Image));
+            vkGetImageMemoryRequirements(m_device, m_physical[i].Image, &Requirements[i]);
+            m_physical[i].Size = Requirements[i].size;
+        }
+
+        // Largest first, each texture goes to the lowest offset that does not overlap a texture of the same
+        // memory type group whose lifetime overlaps its own
+        std::vector<uint> Order(Transients.size());
+        for (uint i = 0; i < Order.size(); i++) {
+            Order[i] = i;
+        }
+        std::stable_sort(Order.begin(), Order.end(), [&](uint A, uint B) {
+            return Requirements[A].size > Requirements[B].size;
+        });
+        struct Group {
+            uint MemoryTypeBits = 0;
+            VkDeviceSize Size = 0;
+            VkDeviceSize Alignment = 1;
+        };
+        std::vector<Group> Groups;
+        std::vector<uint> Placed;
+        auto LifetimesOverlap = [&](uint A, uint B) {
+            const Resource& First = m_resources[Transients[A]];
+            const Resource& Second = m_resources[Transients[B]];
+            return First.FirstPass <= Second.LastPass && Second.FirstPass <= First.LastPass;
+        };
+        auto RangesOverlap = [&](uint A, uint B) {
+            return m_physical[A].Group == m_physical[B].Group &&
+                   m_physical[A].Offset < m_physical[B].Offset + m_physical[B].Size &&
+                   m_physical[B].Offset < m_physical[A].Offset + m_physical[A].Size;
+        };
+        for (uint Current: Order) {
+            const VkMemoryRequirements& Requirement = Requirements[Current];
+            PhysicalTexture& Texture = m_physical[Current];
+            Texture.Group = ~0u;
+            for (uint i = 0; i < Groups.size(); i++) {
+                if (Groups[i].MemoryTypeBits == Requirement.memoryTypeBits) {
+                    Texture.Group = i;
+                }
+            }
+            if (Texture.Group == ~0u) {
+                Texture.Group = static_cast<uint>(Groups.size());
+                Groups.push_back({Requirement.memoryTypeBits, 0, 1});
+            }
+            auto AlignUp = [&](VkDeviceSize Value) {
+                return (Value + Requirement.alignment - 1) / Requirement.alignment * Requirement.alignment;
+            };
+            std::vector<VkDeviceSize> Candidates = {0};
+            for (uint Other: Placed) {
+                if (m_physical[Other].Group == Texture.Group && LifetimesOverlap(Current, Other)) {
+                    Candidates.push_back(AlignUp(m_physical[Other].Offset + m_physical[Other].Size));
+                }
+            }
+            std::sort(Candidates.begin(), Candidates.end());
+            for (VkDeviceSize Candidate: Candidates) {
+                Texture.Offset = Candidate;
+                bool Fits = std::none_of(Placed.begin(), Placed.end(), [&](uint Other) {
+                    return LifetimesOverlap(Current, Other) && RangesOverlap(Current, Other);
+                });
+                if (Fits) {
+                    break;
+                }
+            }
+            Placed.push_back(Current);
+            Group& Target = Groups[Texture.Group];
+            Target.Size = std::max(Target.Size, Texture.Offset + Texture.Size);
+            Target.Alignment = std::max(Target.Alignment, Requirement.alignment);
+        }
+
+        auto* Allocator = VulkanBackendApp::GetApplication()->GetMemoryAllocator();
+        for (const auto& Current: Groups) {
+            VkMemoryRequirements GroupRequirements{};
+            GroupRequirements.size = Current.Size;
+            GroupRequirements.alignment = Current.Alignment;
+            GroupRequirements.memoryTypeBits = Current.MemoryTypeBits;
+            m_physicalMemory.push_back(Allocator->Allocate(GroupRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                           MemoryResourceKind::Optimal, MemoryCategory::RenderTarget));
+        }
+
+        for (uint i = 0; i < m_physical.size(); i++) {
+            PhysicalTexture& Texture = m_physical[i];
+            const MemoryAllocation* Memory = m_physicalMemory[Texture.Group];
+            VK_CHECK(vkBindImageMemory(m_device, Texture.Image, Memory->Memory, Memory->Offset + Texture.Offset));
+
+            const RGTextureDesc& Desc = m_resources[Transients[i]].Desc;
+            VkImageViewCreateInfo ViewCreateInfo{};
+            ViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            ViewCreateInfo.image = Texture.Image;
+            ViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            ViewCreateInfo.format = Desc.Format;
+            ViewCreateInfo.subresourceRange.aspectMask = Desc.Aspect;
+            ViewCreateInfo.subresourceRange.baseMipLevel = 0;
+            ViewCreateInfo.subresourceRange.levelCount = 1;
+            ViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+            ViewCreateInfo.subresourceRange.layerCount = 1;
+            VK_CHECK(vkCreateImageView(m_device, &ViewCreateInfo, nullptr, &Texture.View));
+        }
+    }
+
+    void RenderGraph::UpdateAliasStages(const std::vector<uint> &Transients) {
+        // Stages and writes of every pass using each texture, spread over the textures sharing its memory
+        std::vector<VkPipelineStageFlags2> UsedStages(Transients.size(), VK_PIPELINE_STAGE_2_NONE);
+        std::vector<VkAccessFlags2> UsedWrites(Transients.size(), VK_ACCESS_2_NONE);
+        for (const auto& Current: m_passes) {
+            if (Current.Culled) {
+                continue;
+            }
+            for (const auto& Access: Current.Accesses) {
+                uint Physical = m_resources[Access.Resource].Physical;
+                if (Physical != ~0u) {
+                    UsedStages[Physical] |= Access.Access.Stage;
+                    UsedWrites[Physical] |= Access.Access.Access & WriteAccessMask;
+                }
+            }
+        }
+        for (auto& Texture: m_physical) {
+            Texture.AliasStages = VK_PIPELINE_STAGE_2_NONE;
+            Texture.AliasWrites = VK_ACCESS_2_NONE;
+            for (uint Other = 0; Other < m_physical.size(); Other++) {
+                const PhysicalTexture& OtherTexture = m_physical[Other];
+                if (OtherTexture.Group == Texture.Group && OtherTexture.Offset < Texture.Offset + Texture.Size &&
+                    Texture.Offset < OtherTexture.Offset + OtherTexture.Size) {
+                    Texture.AliasStages |= UsedStages[Other];
+                    Texture.AliasWrites |= UsedWrites[Other];
+                }
+            }
+        }
+    }
+
+    void RenderGraph::ReleaseTransients() {
+        for (auto& Texture: m_physical) {
+            vkDestroyImageView(m_device, Texture.View, nullptr);
+            vkDestroyImage(m_device, Texture.Image, nullptr);
+        }
+        m_physical.clear();
+        for (auto* Memory: m_physicalMemory) {
+            RHI::FreeMemory(Memory);
+        }
+        m_physicalMemory.clear();
+        m_physicalSignature = 0;
+    }
+
+    void RenderGraph::Transition(uint ResourceIndex, const RGAccess &Access, bool IsWrite, ResourceState &State,
+                                 std::vector<VkImageMemoryBarrier2> &ImageBarriers,
+                                 std::vector<VkBufferMemoryBarrier2> &BufferBarriers) const {
+        const Resource& Current = m_resources[ResourceIndex];
+        bool LayoutChange = !Current.IsBuffer && Access.Layout != State.Layout;
+        VkPipelineStageFlags2 SrcStages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 SrcAccess = VK_ACCESS_2_NONE;
+        bool NeedsBarrier = false;
+        if (LayoutChange || IsWrite) {
+            // Waits for the last write and every read since, only the write has to be made available
+            SrcStages = State.WriteStages | State.ReadStages;
+            SrcAccess = State.WriteAccess;
+            NeedsBarrier = LayoutChange || SrcStages != VK_PIPELINE_STAGE_2_NONE;
+        } else if (State.WriteStages != VK_PIPELINE_STAGE_2_NONE &&
+                   ((Access.Stage & ~State.VisibleStages) || (Access.Access & ~State.VisibleAccess))) {
+            // Read after write the earlier reads did not already make visible to this stage
+            SrcStages = State.WriteStages;
+            SrcAccess = State.WriteAccess;
+            NeedsBarrier = true;
+        }
+
+        if (NeedsBarrier) {
+            if (Current.IsBuffer) {
+                VkBufferMemoryBarrier2 Barrier{};
+                Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                Barrier.srcStageMask = SrcStages;
+                Barrier.srcAccessMask = SrcAccess;
+                Barrier.dstStageMask = Access.Stage;
+                Barrier.dstAccessMask = Access.Access;
+                Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.buffer = Current.Buffer;
+                Barrier.offset = 0;
+                Barrier.size = VK_WHOLE_SIZE;
+                BufferBarriers.push_back(Barrier);
+            } else {
+                VkImageMemoryBarrier2 Barrier{};
+                Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                Barrier.srcStageMask = SrcStages;
+                Barrier.srcAccessMask = SrcAccess;
+                Barrier.dstStageMask = Access.Stage;
+                Barrier.dstAccessMask = Access.Access;
+                Barrier.oldLayout = State.Layout;
+                Barrier.newLayout = Access.Layout;
+                Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                Barrier.image = GetImage({ResourceIndex});
+                Barrier.subresourceRange.aspectMask = Current.Desc.Aspect;
+                Barrier.subresourceRange.baseMipLevel = 0;
+                Barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                Barrier.subresourceRange.baseArrayLayer = 0;
+                Barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                ImageBarriers.push_back(Barrier);
+            }
+        }
+
+        if (IsWrite) {
+            State.WriteStages = Access.Stage;
+            State.WriteAccess = Access.Access & WriteAccessMask;
+            State.ReadStages = VK_PIPELINE_STAGE_2_NONE;
+            State.VisibleStages = Access.Stage;
+            State.VisibleAccess = Access.Access;
+        } else if (LayoutChange) {
+            // The transition counts as a write, visible to this access only
+            State.WriteStages = Access.Stage;
+            State.WriteAccess = VK_ACCESS_2_NONE;
+            State.ReadStages = Access.Stage;
+            State.VisibleStages = Access.Stage;
+            State.VisibleAccess = Access.Access;
+        } else {
+            State.ReadStages |= Access.Stage;
+            if (NeedsBarrier) {
+                State.VisibleStages |= Access.Stage;
+                State.VisibleAccess |= Access.Access;
+            }
+        }
+        if (!Current.IsBuffer) {
+            State.Layout = Access.EndLayout != VK_IMAGE_LAYOUT_UNDEFINED ? Access.EndLayout : Access.Layout;
+        }
+    }
+
+    void RenderGraph::FlushBarriers(VkCommandBuffer CommandBuffer, std::vector<VkImageMemoryBarrier2> &ImageBarriers,
+                                    std::vector<VkBufferMemoryBarrier2> &BufferBarriers) {
+        if (ImageBarriers.empty() && BufferBarriers.empty()) {
+            return;
+        }
+        VkDependencyInfo DependencyInfo{};
+        DependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        DependencyInfo.imageMemoryBarrierCount = static_cast<uint>(ImageBarriers.size());
+        DependencyInfo.pImageMemoryBarriers = ImageBarriers.data();
+        DependencyInfo.bufferMemoryBarrierCount = static_cast<uint>(BufferBarriers.size());
+        DependencyInfo.pBufferMemoryBarriers = BufferBarriers.data();
+        vkCmdPipelineBarrier2(CommandBuffer, &DependencyInfo);
+        m_stats.NumImageBarriers += static_cast<uint>(ImageBarriers.size());
+        m_stats.NumBufferBarriers += static_cast<uint>(BufferBarriers.size());
+        m_stats.NumBarrierBatches++;
+        ImageBarriers.clear();
+        BufferBarriers.clear();
+    }
+
+    void RenderGraph::Execute(VkCommandBuffer CommandBuffer) {
+        Check(m_compiled);
+        std::vector<ResourceState> States(m_resources.size());
+        for (uint i = 0; i < m_resources.size(); i++) {
+            const Resource& Current = m_resources[i];
+            if (Current.Imported) {
+                States[i].WriteStages = Current.Initial.Stage;
+                States[i].WriteAccess = Current.Initial.Access & WriteAccessMask;
+                States[i].Layout = Current.Initial.Layout;
+            } else if (Current.Physical != ~0u) {
+                States[i].WriteStages = m_physical[Current.Physical].AliasStages;
+                States[i].WriteAccess = m_physical[Current.Physical].AliasWrites;
+            }
+        }
+
+        std::vector<VkImageMemoryBarrier2> ImageBarriers;
+        std::vector<VkBufferMemoryBarrier2> BufferBarriers;
+        for (const auto& Current: m_passes) {
+            if (Current.Culled) {
+                continue;
+            }
+            for (const auto& Access: Current.Accesses) {
+                Transition(Access.Resource, Access.Access, Access.IsWrite, States[Access.Resource],
+                           ImageBarriers, BufferBarriers);
+            }
+            FlushBarriers(CommandBuffer, ImageBarriers, BufferBarriers);
+            Current.Execute(CommandBuffer);
+        }
+
+        // Imported textures leave the graph in their final layout, whatever comes next synchronizes itself
+        for (uint i = 0; i < m_resources.size(); i++) {
+            const Resource& Current = m_resources[i];
+            if (!Current.Imported || Current.IsBuffer || Current.FinalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+                Current.FinalLayout == States[i].Layout) {
+                continue;
+            }
+            Transition(i, {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, Current.FinalLayout,
+                           VK_IMAGE_LAYOUT_UNDEFINED}, false, States[i], ImageBarriers, BufferBarriers);
+        }
+        FlushBarriers(CommandBuffer, ImageBarriers, BufferBarriers);
+    }
+
+    auto RenderGraph::GetImage(RGHandle Resource) const -> VkImage {
+        const auto& Current = m_resources[Resource.Index];
+        if (Current.Imported) {
+            return Current.Image;
+        }
+        Check(Current.Physical != ~0u);
+        return m_physical[Current.Physical].Image;
+    }
+
+    auto RenderGraph::GetImageView(RGHandle Resource) const -> VkImageView {
+        const auto& Current = m_resources[Resource.Index];
+        if (Current.Imported) {
+            return Current.View;
+        }
+        Check(Current.Physical != ~0u);
+        return m_physical[Current.Physical].View;
+    }
+}  // namespace HWPT
@@ -0,0 +1,216 @@
+//
+// Created by HUSTLX on 2024/11/4.
+//
+
+#ifndef HARDWAREPATHTRACER_RENDERGRAPH_H
+#define HARDWAREPATHTRACER_RENDERGRAPH_H
+
+#include "core/Core.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace HWPT {
+    struct MemoryAllocation;
+
+    struct RGTextureDesc {
+        uint Width = 0, Height = 0;
+        VkFormat Format = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+        VkImageUsageFlags Usage = 0;
+        VkImageAspectFlags Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    struct RGHandle {
+        uint Index = ~0u;
+
+        [[nodiscard]] auto IsValid() const -> bool {
+            return Index != ~0u;
+        }
+    };
+
+    // How a pass touches a resource, synchronization2 stage and access flags. Layout is ignored for buffers.
+    // EndLayout is the layout the pass leaves the image in when it transitions it itself, e.g. through the
+    // finalLayout of a VkRenderPass, UNDEFINED means it stays in Layout
+    struct RGAccess {
+        VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 Access = VK_ACCESS_2_NONE;
+        VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout EndLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    struct RenderGraphStats {
+        uint NumPasses = 0;
+        uint NumCulledPasses = 0;
+        uint NumImageBarriers = 0;
+        uint NumBufferBarriers = 0;
+        uint NumBarrierBatches = 0;  // vkCmdPipelineBarrier2 calls
+        uint NumTransients = 0;
+        VkDeviceSize TransientBytes = 0;  // What the transient textures would take on their own
+        VkDeviceSize AllocatedBytes = 0;  // What they take after aliasing
+
+        [[nodiscard]] auto GetSavedBytes() const -> VkDeviceSize {
+            return TransientBytes - AllocatedBytes;
+        }
+    };
+
+    // Frame graph rebuilt every frame: passes declare which resources they read and write, Compile culls the
+    // passes nothing depends on and places transient textures with disjoint lifetimes at the same memory
+    // offsets, Execute records every remaining pass behind one batched barrier computed from the declared
+    // accesses. Physical transients are kept while the frame keeps the same transients, a frame with a
+    // different set waits for the device once and recreates them. Single queue, the caller submits
+    class RenderGraph {
+    public:
+        using ExecuteFunction = std::function<void(VkCommandBuffer CommandBuffer)>;
+
+        class PassBuilder {
+        public:
+            auto Read(RGHandle Resource, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access,
+                      VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED) -> PassBuilder&;
+
+            auto Write(RGHandle Resource, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access,
+                       VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                       VkImageLayout EndLayout = VK_IMAGE_LAYOUT_UNDEFINED) -> PassBuilder&;
+
+            // Never culled, for passes with effects outside the graph like readbacks
+            auto SetSideEffect() -> PassBuilder&;
+
+        private:
+            friend class RenderGraph;
+
+            PassBuilder(RenderGraph& Graph, uint Pass) : m_graph(Graph), m_pass(Pass) {}
+
+            RenderGraph& m_graph;
+            uint m_pass;
+        };
+
+        explicit RenderGraph(VkDevice Device);
+
+        ~RenderGraph();
+
+        // Clears the passes and resources of the last frame, the physical transients stay
+        void Reset();
+
+        auto CreateTexture(const std::string& Name, const RGTextureDesc& Desc) -> RGHandle;
+
+        // InitialStage / InitialAccess is the last use before the graph, e.g. the stage the acquire semaphore
+        // waits at for a swap chain image. The graph transitions the image to FinalLayout at the end of the frame
+        auto ImportTexture(const std::string& Name, VkImage Image, VkImageView View, VkImageAspectFlags Aspect,
+                           const RGAccess& Initial, VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED) -> RGHandle;
+
+        auto ImportBuffer(const std::string& Name, VkBuffer Buffer, const RGAccess& Initial) -> RGHandle;
+
+        // Keeps the passes writing Resource, and everything they depend on, from being culled
+        void MarkOutput(RGHandle Resource);
+
+        auto AddPass(const std::string& Name, ExecuteFunction Execute) -> PassBuilder;
+
+        void Compile();
+
+        void Execute(VkCommandBuffer CommandBuffer);
+
+        // Destroys the physical transients, the device has to be idle
+        void ReleaseTransients();
+
+        // Valid after Compile
+        [[nodiscard]] auto GetImage(RGHandle Resource) const -> VkImage;
+
+        [[nodiscard]] auto GetImageView(RGHandle Resource) const -> VkImageView;
+
+        // Increments whenever the physical transients are recreated, objects referencing their views such as
+        // framebuffers have to be recreated too. The device is idle at that point
+        [[nodiscard]] auto GetGeneration() const -> uint64_t {
+            return m_generation;
+        }
+
+        [[nodiscard]] auto GetStats() const -> const RenderGraphStats& {
+            return m_stats;
+        }
+
+    private:
+        struct Resource {
+            std::string Name;
+            bool Imported = false;
+            bool IsBuffer = false;
+            bool IsOutput = false;
+            RGTextureDesc Desc;
+            VkImage Image = VK_NULL_HANDLE;
+            VkImageView View = VK_NULL_HANDLE;
+            VkBuffer Buffer = VK_NULL_HANDLE;
+            RGAccess Initial;
+            VkImageLayout FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            // Filled by Compile
+            uint RefCount = 0;
+            int FirstPass = -1, LastPass = -1;
+            uint Physical = ~0u;
+        };
+
+        struct PassAccess {
+            uint Resource;
+            RGAccess Access;
+            bool IsWrite;
+        };
+
+        struct Pass {
+            std::string Name;
+            ExecuteFunction Execute;
+            std::vector<PassAccess> Accesses;
+            bool SideEffect = false;
+            uint RefCount = 0;
+            bool Culled = false;
+        };
+
+        struct PhysicalTexture {
+            VkImage Image = VK_NULL_HANDLE;
+            VkImageView View = VK_NULL_HANDLE;
+            uint Group = 0;
+            VkDeviceSize Offset = 0;
+            VkDeviceSize Size = 0;
+            // Everything the memory range was used for by any texture placed over it, the first use in a frame
+            // waits for these since the previous occupant, or the last frame, may still be using the memory
+            VkPipelineStageFlags2 AliasStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 AliasWrites = VK_ACCESS_2_NONE;
+        };
+
+        // Synchronization state of a resource while recording
+        struct ResourceState {
+            VkPipelineStageFlags2 WriteStages = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 WriteAccess = VK_ACCESS_2_NONE;
+            VkPipelineStageFlags2 ReadStages = VK_PIPELINE_STAGE_2_NONE;  // Reads since the last write
+            VkPipelineStageFlags2 VisibleStages = VK_PIPELINE_STAGE_2_NONE;  // The last write is visible to these
+            VkAccessFlags2 VisibleAccess = VK_ACCESS_2_NONE;
+            VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        };
+
+        void AddAccess(uint PassIndex, RGHandle Resource, const RGAccess& Access, bool IsWrite);
+
+        void CullPasses();
+
+        void CreatePhysicalTextures(const std::vector<uint>& Transients);
+
+        void UpdateAliasStages(const std::vector<uint>& Transients);
+
+        // Appends the barrier Access needs on top of State and advances State past it
+        void Transition(uint ResourceIndex, const RGAccess& Access, bool IsWrite, ResourceState& State,
+                        std::vector<VkImageMemoryBarrier2>& ImageBarriers,
+                        std::vector<VkBufferMemoryBarrier2>& BufferBarriers) const;
+
+        void FlushBarriers(VkCommandBuffer CommandBuffer, std::vector<VkImageMemoryBarrier2>& ImageBarriers,
+                           std::vector<VkBufferMemoryBarrier2>& BufferBarriers);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        std::vector<Resource> m_resources;
+        std::vector<Pass> m_passes;
+        bool m_compiled = false;
+
+        std::vector<PhysicalTexture> m_physical;
+        std::vector<MemoryAllocation*> m_physicalMemory;  // One per memory type group
+        uint64_t m_physicalSignature = 0;
+        uint64_t m_generation = 0;
+
+        RenderGraphStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_RENDERGRAPH_H
@@ -0,0 +1,94 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#include "AliasTable.h"
+#include <algorithm>
+
+
+namespace HWPT {
+
+    AliasTable::AliasTable(const float *Weights, uint Count) {
+        Build(Weights, Count);
+    }
+
+    void AliasTable::Build(const float *Weights, uint Count) {
+        Check(Count > 0);
+        m_weights.assign(Weights, Weights + Count);
+        m_entries.assign(Count, AliasEntry{});
+
+        double WeightSum = 0.;
+        for (uint i = 0; i < Count; i++) {
+            Check(m_weights[i] >= 0.f);
+            WeightSum += m_weights[i];
+        }
+        m_weightSum = static_cast<float>(WeightSum);
+
+        // All zero, fall back to uniform so that sampling is still well-defined
+        if (WeightSum <= 0.) {
+            for (uint i = 0; i < Count; i++) {
+                m_entries[i] = {1.f, i};
+            }
+            return;
+        }
+
+        // Scaled probabilities, average is exactly 1
+        std::vector<double> Scaled(Count);
+        std::vector<uint> Small, Large;
+        Small.reserve(Count);
+        Large.reserve(Count);
+        for (uint i = 0; i < Count; i++) {
+            Scaled[i] = m_weights[i] * Count / WeightSum;
+            if (Scaled[i] < 1.) {
+                Small.push_back(i);
+            } else {
+                Large.push_back(i);
+            }
+        }
+
+        while (!Small.empty() && !Large.empty()) {
+            uint Less = Small.back();
+            Small.pop_back();
+            uint More = Large.back();
+
+            m_entries[Less] = {static_cast<float>(Scaled[Less]), More};
+            Scaled[More] -= 1. - Scaled[Less];
+            if (Scaled[More] < 1.) {
+                Large.pop_back();
+                Small.push_back(More);
+            }
+        }
+        // Left overs are 1 up to rounding error
+        for (uint Index: Large) {
+            m_entries[Index] = {1.f, Index};
+        }
+        for (uint Index: Small) {
+            m_entries[Index] = {1.f, Index};
+        }
+    }
+
+    auto AliasTable::Sample(float U, float *Pdf, float *Remapped) const -> uint {
+        auto Count = static_cast<uint>(m_entries.size());
+        float Scaled = U * static_cast<float>(Count);
+        uint Index = std::min(static_cast<uint>(Scaled), Count - 1);
+        float Fraction = std::min(Scaled - static_cast<float>(Index), 0.99999994f);
+
+        const AliasEntry& Entry = m_entries[Index];
+        uint Result = Index;
+        float Rest = 0.f;
+        if (Fraction < Entry.Probability) {
+            Rest = Fraction / Entry.Probability;
+        } else {
+            Result = Entry.Alias;
+            Rest = (Fraction - Entry.Probability) / (1.f - Entry.Probability);
+        }
+
+        if (Pdf) {
+            *Pdf = m_weightSum > 0.f ? GetPdf(Result) : 1.f / static_cast<float>(Count);
+        }
+        if (Remapped) {
+            *Remapped = std::min(Rest, 0.99999994f);
+        }
+        return Result;
+    }
+}  // namespace HWPT
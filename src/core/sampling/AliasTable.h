@@ -0,0 +1,55 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#ifndef HARDWAREPATHTRACER_ALIASTABLE_H
+#define HARDWAREPATHTRACER_ALIASTABLE_H
+
+#include "core/Core.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Same layout as AliasEntry in shader/HLSL/EnvironmentSampling.hlsl
+    struct AliasEntry {
+        float Probability = 1.f;
+        uint Alias = 0;
+    };
+
+    // Walker/Vose alias method, O(N) build and O(1) sampling of a discrete distribution
+    class AliasTable {
+    public:
+        AliasTable() = default;
+
+        AliasTable(const float* Weights, uint Count);
+
+        void Build(const float* Weights, uint Count);
+
+        // Returns the sampled index, Remapped receives a fresh uniform number in [0, 1)
+        // recovered from the unused bits of U, so a single random number is enough
+        auto Sample(float U, float* Pdf = nullptr, float* Remapped = nullptr) const -> uint;
+
+        [[nodiscard]] auto GetPdf(uint Index) const -> float {
+            return m_weightSum > 0.f ? m_weights[Index] / m_weightSum : 0.f;
+        }
+
+        [[nodiscard]] auto GetWeightSum() const -> float {
+            return m_weightSum;
+        }
+
+        [[nodiscard]] auto GetSize() const -> uint {
+            return static_cast<uint>(m_entries.size());
+        }
+
+        [[nodiscard]] auto GetEntries() const -> const std::vector<AliasEntry>& {
+            return m_entries;
+        }
+
+    private:
+        std::vector<AliasEntry> m_entries;
+        std::vector<float> m_weights;
+        float m_weightSum = 0.f;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_ALIASTABLE_H
@@ -0,0 +1,228 @@
+//
+// Created by HUSTLX on 2024/10/30.
+//
+
+#include "BRDFLUT.h"
+#include "core/ThreadPool.h"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+namespace HWPT {
+    static constexpr float BRDFLUTPI = 3.14159265358979323846f;
+    // Bump whenever the integrands change so stale cache files are ignored
+    static constexpr uint BRDFLUTVersion = 1;
+    static constexpr char BRDFLUTMagic[8] = {'H', 'W', 'P', 'T', 'L', 'U', 'T', '1'};
+
+    struct BRDFLUTFileHeader {
+        char Magic[8];
+        uint64_t Hash;
+        uint Size;
+        uint NumSamples;
+    };
+
+    // FNV-1a over the settings and the version
+    static auto HashSettings(const BRDFLUTSettings& Settings) -> uint64_t {
+        const uint Words[3] = {BRDFLUTVersion, Settings.Size, Settings.NumSamples};
+        uint64_t Hash = 0xcbf29ce484222325ull;
+        const auto* Bytes = reinterpret_cast<const uint8_t*>(Words);
+        for (size_t i = 0; i < sizeof(Words); i++) {
+            Hash = (Hash ^ Bytes[i]) * 0x100000001b3ull;
+        }
+        return Hash;
+    }
+
+    static auto RadicalInverse(uint Bits) -> float {
+        Bits = (Bits << 16u) | (Bits >> 16u);
+        Bits = ((Bits & 0x55555555u) << 1u) | ((Bits & 0xaaaaaaaau) >> 1u);
+        Bits = ((Bits & 0x33333333u) << 2u) | ((Bits & 0xccccccccu) >> 2u);
+        Bits = ((Bits & 0x0f0f0f0fu) << 4u) | ((Bits & 0xf0f0f0f0u) >> 4u);
+        Bits = ((Bits & 0x00ff00ffu) << 8u) | ((Bits & 0xff00ff00u) >> 8u);
+        return static_cast<float>(Bits) * 2.3283064365386963e-10f;
+    }
+
+    // Height-correlated Smith G2 divided by 4 NdotL NdotV, i.e. the visibility term
+    static auto SmithGGXVisibility(float NdotV, float NdotL, float Alpha) -> float {
+        float Alpha2 = Alpha * Alpha;
+        float LambdaV = NdotL * std::sqrt(NdotV * NdotV * (1.f - Alpha2) + Alpha2);
+        float LambdaL = NdotV * std::sqrt(NdotL * NdotL * (1.f - Alpha2) + Alpha2);
+        return .5f / (LambdaV + LambdaL);
+    }
+
+    BRDFLUT::BRDFLUT(const BRDFLUTSettings &Settings, const std::filesystem::path &CacheDirectory)
+            : m_settings(Settings), m_hash(HashSettings(Settings)) {
+        if (m_settings.Size == 0 || m_settings.NumSamples == 0) {
+            throw std::runtime_error("BRDFLUT needs a non-zero size and sample count");
+        }
+        std::stringstream Name;
+        Name << "BRDFLUT_" << std::hex << std::setw(16) << std::setfill('0') << m_hash << ".bin";
+        m_cachePath = CacheDirectory / Name.str();
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+        m_loadedFromCache = LoadCache();
+        if (!m_loadedFromCache) {
+            Generate(ThreadPool::Get());
+            SaveCache();
+        }
+        m_setupMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+    }
+
+    BRDFLUT::~BRDFLUT() {
+        delete m_splitSumTexture;
+        delete m_energyTexture;
+        delete m_energyAverageTexture;
+        delete m_sampler;
+    }
+
+    void BRDFLUT::Generate(ThreadPool &Pool) {
+        const uint Size = m_settings.Size;
+        const uint NumSamples = m_settings.NumSamples;
+        m_splitSum.assign(static_cast<size_t>(Size) * Size, glm::vec2(0.f));
+        m_energy.assign(static_cast<size_t>(Size) * Size, 0.f);
+        m_energyAverage.assign(Size, 0.f);
+
+        Pool.ParallelFor(Size, [&](uint Begin, uint End) {
+            for (uint RoughnessIndex = Begin; RoughnessIndex < End; RoughnessIndex++) {
+                float Roughness = (static_cast<float>(RoughnessIndex) + .5f) / static_cast<float>(Size);
+                float Alpha = Roughness * Roughness;
+                float Average = 0.f;
+                for (uint CosThetaIndex = 0; CosThetaIndex < Size; CosThetaIndex++) {
+                    float NdotV = (static_cast<float>(CosThetaIndex) + .5f) / static_cast<float>(Size);
+                    glm::vec3 V(std::sqrt(1.f - NdotV * NdotV), 0.f, NdotV);
+
+                    // Hammersley points through the GGX NDF, pdf(L) = D NdotH / (4 VdotH)
+                    double A = 0., B = 0.;
+                    for (uint Sample = 0; Sample < NumSamples; Sample++) {
+                        float U1 = (static_cast<float>(Sample) + .5f) / static_cast<float>(NumSamples);
+                        float U2 = RadicalInverse(Sample);
+                        float Phi = 2.f * BRDFLUTPI * U1;
+                        float CosThetaH = std::sqrt((1.f - U2) / (1.f + (Alpha * Alpha - 1.f) * U2));
+                        float SinThetaH = std::sqrt(std::max(0.f, 1.f - CosThetaH * CosThetaH));
+                        glm::vec3 H(SinThetaH * std::cos(Phi), SinThetaH * std::sin(Phi), CosThetaH);
+                        float VdotH = glm::dot(V, H);
+                        glm::vec3 L = 2.f * VdotH * H - V;
+                        float NdotL = L.z;
+                        if (NdotL <= 0.f || VdotH <= 0.f) {
+                            continue;
+                        }
+                        // f * NdotL / pdf with F = 1
+                        float Weight = SmithGGXVisibility(NdotV, NdotL, Alpha) * 4.f * VdotH * NdotL / CosThetaH;
+                        float Fc = std::pow(1.f - VdotH, 5.f);
+                        A += (1.f - Fc) * Weight;
+                        B += Fc * Weight;
+                    }
+                    glm::vec2 ScaleBias(static_cast<float>(A / NumSamples), static_cast<float>(B / NumSamples));
+                    size_t Index = static_cast<size_t>(RoughnessIndex) * Size + CosThetaIndex;
+                    m_splitSum[Index] = ScaleBias;
+                    m_energy[Index] = std::min(ScaleBias.x + ScaleBias.y, 1.f);
+                    Average += m_energy[Index] * NdotV;
+                }
+                m_energyAverage[RoughnessIndex] = 2.f * Average / static_cast<float>(Size);
+            }
+        });
+    }
+
+    auto BRDFLUT::LoadCache() -> bool {
+        std::ifstream File(m_cachePath, std::ios::binary);
+        if (!File.is_open()) {
+            return false;
+        }
+        BRDFLUTFileHeader Header{};
+        File.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+        if (!File || std::memcmp(Header.Magic, BRDFLUTMagic, sizeof(BRDFLUTMagic)) != 0 || Header.Hash != m_hash ||
+            Header.Size != m_settings.Size || Header.NumSamples != m_settings.NumSamples) {
+            return false;
+        }
+        const size_t NumTexels = static_cast<size_t>(m_settings.Size) * m_settings.Size;
+        m_splitSum.resize(NumTexels);
+        m_energy.resize(NumTexels);
+        m_energyAverage.resize(m_settings.Size);
+        File.read(reinterpret_cast<char*>(m_splitSum.data()), static_cast<std::streamsize>(sizeof(glm::vec2) * NumTexels));
+        File.read(reinterpret_cast<char*>(m_energy.data()), static_cast<std::streamsize>(sizeof(float) * NumTexels));
+        File.read(reinterpret_cast<char*>(m_energyAverage.data()),
+                  static_cast<std::streamsize>(sizeof(float) * m_settings.Size));
+        return static_cast<bool>(File);
+    }
+
+    void BRDFLUT::SaveCache() const {
+        // A missing cache only costs the next startup, so failures are reported and ignored
+        std::error_code Error;
+        std::filesystem::create_directories(m_cachePath.parent_path(), Error);
+        std::ofstream File(m_cachePath, std::ios::binary);
+        if (!File.is_open()) {
+            std::cerr << "Failed to write BRDF LUT cache " << m_cachePath.string() << "\n";
+            return;
+        }
+        BRDFLUTFileHeader Header{};
+        std::memcpy(Header.Magic, BRDFLUTMagic, sizeof(BRDFLUTMagic));
+        Header.Hash = m_hash;
+        Header.Size = m_settings.Size;
+        Header.NumSamples = m_settings.NumSamples;
+        File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        File.write(reinterpret_cast<const char*>(m_splitSum.data()),
+                   static_cast<std::streamsize>(sizeof(glm::vec2) * m_splitSum.size()));
+        File.write(reinterpret_cast<const char*>(m_energy.data()),
+                   static_cast<std::streamsize>(sizeof(float) * m_energy.size()));
+        File.write(reinterpret_cast<const char*>(m_energyAverage.data()),
+                   static_cast<std::streamsize>(sizeof(float) * m_energyAverage.size()));
+    }
+
+    void BRDFLUT::CreateGPUResources() {
+        if (m_splitSumTexture) {
+            return;
+        }
+        // Half floats: every table is in [0, 1], and unlike the 32 bit float formats, linear filtering of
+        // R16G16 / R16 SFLOAT sampled images is mandatory in Vulkan
+        std::vector<uint> SplitSum(m_splitSum.size());
+        std::transform(m_splitSum.begin(), m_splitSum.end(), SplitSum.begin(),
+                       [](const glm::vec2& Value) { return glm::packHalf2x16(Value); });
+        auto PackHalves = [](const std::vector<float>& Values) {
+            std::vector<uint16_t> Halves(Values.size());
+            std::transform(Values.begin(), Values.end(), Halves.begin(),
+                           [](float Value) { return glm::packHalf1x16(Value); });
+            return Halves;
+        };
+        std::vector<uint16_t> Energy = PackHalves(m_energy), EnergyAverage = PackHalves(m_energyAverage);
+
+        m_splitSumTexture = new Texture2D(m_settings.Size, m_settings.Size, TextureFormat::RG16F, SplitSum.data());
+        m_energyTexture = new Texture2D(m_settings.Size, m_settings.Size, TextureFormat::R16F, Energy.data());
+        m_energyAverageTexture = new Texture2D(m_settings.Size, 1, TextureFormat::R16F, EnergyAverage.data());
+        m_sampler = new Sampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    }
+
+    void BRDFLUT::ReportStartup(const BRDFLUTSettings &Settings, const std::filesystem::path &CacheDirectory) {
+        BRDFLUT Cold(Settings, CacheDirectory);
+        std::error_code Error;
+        std::filesystem::remove(Cold.GetCachePath(), Error);
+
+        auto TimeGenerate = [&](ThreadPool& Pool) {
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            Cold.Generate(Pool);
+            return std::chrono::duration<double, std::milli>(
+                    std::chrono::high_resolution_clock::now() - StartTime).count();
+        };
+        ThreadPool SingleThread(1);
+        double SingleMs = TimeGenerate(SingleThread);
+        double ParallelMs = TimeGenerate(ThreadPool::Get());
+        Cold.SaveCache();
+        BRDFLUT Warm(Settings, CacheDirectory);
+
+        std::cout << "BRDF LUT " << Settings.Size << "x" << Settings.Size << ", " << Settings.NumSamples
+                  << " samples per texel, cache " << Warm.GetCachePath().string() << "\n";
+        std::cout << "Path | ms\n";
+        std::cout << "Integrate, 1 thread | " << SingleMs << "\n";
+        std::cout << "Integrate, " << ThreadPool::Get().GetNumThreads() << " threads | " << ParallelMs << "\n";
+        std::cout << "Load cache" << (Warm.IsLoadedFromCache() ? "" : " (missed)") << " | " << Warm.GetSetupMs() << "\n";
+        std::cout << "E_avg at roughness 0.1 / 0.5 / 1.0 | " << Warm.GetEnergyAverage(Settings.Size / 10) << " / "
+                  << Warm.GetEnergyAverage(Settings.Size / 2) << " / " << Warm.GetEnergyAverage(Settings.Size - 1)
+                  << "\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
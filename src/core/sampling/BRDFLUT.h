@@ -0,0 +1,113 @@
+//
+// Created by HUSTLX on 2024/10/30.
+//
+
+#ifndef HARDWAREPATHTRACER_BRDFLUT_H
+#define HARDWAREPATHTRACER_BRDFLUT_H
+
+#include "core/Core.h"
+#include "core/texture/Texture2D.h"
+#include "core/texture/Sampler.h"
+#include <filesystem>
+#include <vector>
+
+
+namespace HWPT {
+    class ThreadPool;
+
+    struct BRDFLUTSettings {
+        uint Size = 64;  // Texels along cos(theta_v) and roughness
+        uint NumSamples = 4096;  // GGX importance samples per texel
+    };
+
+    // Tables of the GGX specular lobe (alpha = roughness^2, height-correlated Smith), indexed by
+    // cos(theta_v) along x and perceptual roughness along y at texel centers:
+    //   SplitSum: (A, B) with the directional albedo for F0 being F0 * A + B (Karis 2013)
+    //   Energy: E(mu, roughness) of the lobe with F = 1, which is A + B
+    //   EnergyAverage: E_avg(roughness) = 2 * integral of E(mu) mu dmu, one row
+    // Energy and EnergyAverage drive the multiple-scattering compensation of Kulla and Conty 2017,
+    // see shader/HLSL/BRDFLUT.hlsl. The tables are cached in CacheDirectory under a hash of the
+    // settings and only integrated when no matching file exists
+    class BRDFLUT {
+    public:
+        explicit BRDFLUT(const BRDFLUTSettings& Settings = {}, const std::filesystem::path& CacheDirectory = "Cache");
+
+        ~BRDFLUT();
+
+        // Integrates every table with Pool, one row per task
+        void Generate(ThreadPool& Pool);
+
+        void CreateGPUResources();
+
+        // RG16F
+        auto GetSplitSumTexture() -> Texture2D* {
+            return m_splitSumTexture;
+        }
+
+        // R16F
+        auto GetEnergyTexture() -> Texture2D* {
+            return m_energyTexture;
+        }
+
+        // R16F, Size x 1
+        auto GetEnergyAverageTexture() -> Texture2D* {
+            return m_energyAverageTexture;
+        }
+
+        // Linear and clamping, the lookups in BRDFLUT.hlsl rely on both
+        auto GetSampler() -> Sampler* {
+            return m_sampler;
+        }
+
+        [[nodiscard]] auto GetSplitSum(uint CosThetaIndex, uint RoughnessIndex) const -> glm::vec2 {
+            return m_splitSum[RoughnessIndex * m_settings.Size + CosThetaIndex];
+        }
+
+        [[nodiscard]] auto GetEnergy(uint CosThetaIndex, uint RoughnessIndex) const -> float {
+            return m_energy[RoughnessIndex * m_settings.Size + CosThetaIndex];
+        }
+
+        [[nodiscard]] auto GetEnergyAverage(uint RoughnessIndex) const -> float {
+            return m_energyAverage[RoughnessIndex];
+        }
+
+        [[nodiscard]] auto GetCachePath() const -> const std::filesystem::path& {
+            return m_cachePath;
+        }
+
+        [[nodiscard]] auto IsLoadedFromCache() const -> bool {
+            return m_loadedFromCache;
+        }
+
+        // Time spent in the constructor, either integrating or reading the cache
+        [[nodiscard]] auto GetSetupMs() const -> double {
+            return m_setupMs;
+        }
+
+        // Startup cost of a cold cache with one thread and with all cores, then of a warm cache
+        static void ReportStartup(const BRDFLUTSettings& Settings = {},
+                                  const std::filesystem::path& CacheDirectory = "Cache");
+
+    private:
+        auto LoadCache() -> bool;
+
+        void SaveCache() const;
+
+        BRDFLUTSettings m_settings;
+        uint64_t m_hash = 0;
+        std::filesystem::path m_cachePath;
+        bool m_loadedFromCache = false;
+        double m_setupMs = 0.;
+
+        std::vector<glm::vec2> m_splitSum;
+        std::vector<float> m_energy;
+        std::vector<float> m_energyAverage;
+
+        Texture2D* m_splitSumTexture = nullptr;
+        Texture2D* m_energyTexture = nullptr;
+        Texture2D* m_energyAverageTexture = nullptr;
+        Sampler* m_sampler = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_BRDFLUT_H
@@ -0,0 +1,161 @@
+//
+// Created by HUSTLX on 2024/10/21.
+//
+
+#include "BlueNoise.h"
+#include "core/sampling/PCGRandom.h"
+#include "core/ThreadPool.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+
+namespace HWPT {
+    static constexpr uint NumTexels = BlueNoise::TileSize * BlueNoise::TileSize;
+    // Golden ratio conjugate in 1/2^24 fixed point. The rank values are multiples of 1/2^13, so the rotated
+    // value is exact in float for any frame index and the GPU gets the same bits
+    static constexpr uint GoldenRatioFixedPoint = 10368890u;
+    static constexpr float FixedPointScale = 16777216.f;
+
+    // Toroidal Gaussian energy of one texel as seen from every offset on the tile
+    static auto BuildKernel() -> std::vector<float> {
+        constexpr float Sigma = 1.5f;
+        constexpr int Size = static_cast<int>(BlueNoise::TileSize);
+        std::vector<float> Kernel(NumTexels);
+        for (int y = 0; y < Size; y++) {
+            for (int x = 0; x < Size; x++) {
+                int DX = std::min(x, Size - x), DY = std::min(y, Size - y);
+                Kernel[y * Size + x] = std::exp(-static_cast<float>(DX * DX + DY * DY) /
+                                                (2.f * Sigma * Sigma));
+            }
+        }
+        return Kernel;
+    }
+
+    static void SplatEnergy(std::vector<float>& Energy, const std::vector<float>& Kernel, uint Texel,
+                            float Sign) {
+        constexpr uint Mask = BlueNoise::TileSize - 1;
+        uint TX = Texel % BlueNoise::TileSize, TY = Texel / BlueNoise::TileSize;
+        for (uint y = 0; y < BlueNoise::TileSize; y++) {
+            uint KernelRow = ((y - TY) & Mask) * BlueNoise::TileSize;
+            for (uint x = 0; x < BlueNoise::TileSize; x++) {
+                Energy[y * BlueNoise::TileSize + x] += Sign * Kernel[KernelRow + ((x - TX) & Mask)];
+            }
+        }
+    }
+
+    // Tightest cluster is the set texel with the highest energy, largest void the empty one with the lowest
+    static auto FindTexel(const std::vector<float>& Energy, const std::vector<bool>& Pattern,
+                          bool Cluster) -> uint {
+        uint Best = 0;
+        float BestEnergy = Cluster ? -1e30f : 1e30f;
+        for (uint i = 0; i < NumTexels; i++) {
+            if (Pattern[i] != Cluster) {
+                continue;
+            }
+            if (Cluster ? Energy[i] > BestEnergy : Energy[i] < BestEnergy) {
+                BestEnergy = Energy[i];
+                Best = i;
+            }
+        }
+        return Best;
+    }
+
+    BlueNoise::BlueNoise(uint Seed) {
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        std::vector<float> Channels(static_cast<size_t>(NumChannels) * NumTexels);
+        ThreadPool::Get().ParallelFor(NumChannels, [&](uint Begin, uint End) {
+            for (uint Channel = Begin; Channel < End; Channel++) {
+                GenerateChannel(Seed * NumChannels + Channel,
+                                Channels.data() + static_cast<size_t>(Channel) * NumTexels);
+            }
+        });
+
+        m_values.resize(Channels.size());
+        for (uint Texel = 0; Texel < NumTexels; Texel++) {
+            for (uint Channel = 0; Channel < NumChannels; Channel++) {
+                m_values[Texel * NumChannels + Channel] = Channels[Channel * NumTexels + Texel];
+            }
+        }
+
+        m_buildTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+    }
+
+    BlueNoise::~BlueNoise() {
+        delete m_texture;
+    }
+
+    void BlueNoise::GenerateChannel(uint Seed, float *Output) {
+        static const std::vector<float> Kernel = BuildKernel();
+        PCGRandom Random(Seed, Seed * 2u + 1u);
+
+        // Initial binary pattern, about 10% white noise
+        const uint NumInitial = NumTexels / 10;
+        std::vector<bool> Pattern(NumTexels, false);
+        std::vector<float> Energy(NumTexels, 0.f);
+        for (uint Count = 0; Count < NumInitial;) {
+            uint Texel = Random.NextUInt() % NumTexels;
+            if (!Pattern[Texel]) {
+                Pattern[Texel] = true;
+                SplatEnergy(Energy, Kernel, Texel, 1.f);
+                Count++;
+            }
+        }
+
+        // Move the tightest cluster into the largest void until that stops changing anything
+        while (true) {
+            uint Cluster = FindTexel(Energy, Pattern, true);
+            Pattern[Cluster] = false;
+            SplatEnergy(Energy, Kernel, Cluster, -1.f);
+            uint Void = FindTexel(Energy, Pattern, false);
+            Pattern[Void] = true;
+            SplatEnergy(Energy, Kernel, Void, 1.f);
+            if (Void == Cluster) {
+                break;
+            }
+        }
+
+        std::vector<uint> Ranks(NumTexels, 0);
+
+        // Phase 1, rank the initial points by removing tightest clusters
+        {
+            std::vector<bool> Prototype = Pattern;
+            std::vector<float> PrototypeEnergy = Energy;
+            for (uint Rank = NumInitial; Rank-- > 0;) {
+                uint Cluster = FindTexel(PrototypeEnergy, Prototype, true);
+                Prototype[Cluster] = false;
+                SplatEnergy(PrototypeEnergy, Kernel, Cluster, -1.f);
+                Ranks[Cluster] = Rank;
+            }
+        }
+
+        // Phase 2 and 3, fill the largest voids until the tile is full
+        for (uint Rank = NumInitial; Rank < NumTexels; Rank++) {
+            uint Void = FindTexel(Energy, Pattern, false);
+            Pattern[Void] = true;
+            SplatEnergy(Energy, Kernel, Void, 1.f);
+            Ranks[Void] = Rank;
+        }
+
+        for (uint Texel = 0; Texel < NumTexels; Texel++) {
+            Output[Texel] = (static_cast<float>(Ranks[Texel]) + .5f) / static_cast<float>(NumTexels);
+        }
+    }
+
+    auto BlueNoise::Sample(uint PixelX, uint PixelY, uint Channel, uint FrameIndex) const -> float {
+        Check(Channel < NumChannels);
+        uint Texel = (PixelY % TileSize) * TileSize + PixelX % TileSize;
+        uint Value = static_cast<uint>(m_values[Texel * NumChannels + Channel] * FixedPointScale) +
+                     FrameIndex * GoldenRatioFixedPoint;
+        return static_cast<float>(Value & 0xffffffu) * (1.f / FixedPointScale);
+    }
+
+    void BlueNoise::CreateGPUResources() {
+        if (m_texture) {
+            return;
+        }
+        m_texture = new Texture2D(TileSize, TileSize, TextureFormat::RGBA32F, m_values.data());
+    }
+}  // namespace HWPT
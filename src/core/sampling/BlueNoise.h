@@ -0,0 +1,50 @@
+//
+// Created by HUSTLX on 2024/10/21.
+//
+
+#ifndef HARDWAREPATHTRACER_BLUENOISE_H
+#define HARDWAREPATHTRACER_BLUENOISE_H
+
+#include "core/Core.h"
+#include "core/texture/Texture2D.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Tileable blue-noise dither masks generated with void-and-cluster (Ulichney 1993), one independent
+    // mask per RGBA channel. Indexing matches SampleBlueNoise in shader/HLSL/Sampling.hlsl
+    class BlueNoise {
+    public:
+        static constexpr uint TileSize = 64;
+        static constexpr uint NumChannels = 4;
+
+        explicit BlueNoise(uint Seed = 0);
+
+        ~BlueNoise();
+
+        // Value in [0, 1) of the tile wrapped around the pixel, decorrelated over frames with a
+        // golden ratio Cranley-Patterson rotation
+        [[nodiscard]] auto Sample(uint PixelX, uint PixelY, uint Channel, uint FrameIndex) const -> float;
+
+        // TileSize x TileSize RGBA32F texture
+        void CreateGPUResources();
+
+        auto GetTexture() -> Texture2D* {
+            return m_texture;
+        }
+
+        [[nodiscard]] auto GetBuildTimeMs() const -> double {
+            return m_buildTimeMs;
+        }
+
+    private:
+        static void GenerateChannel(uint Seed, float* Output);
+
+        std::vector<float> m_values;  // TileSize * TileSize texels, NumChannels interleaved
+        double m_buildTimeMs = 0.;
+
+        Texture2D* m_texture = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_BLUENOISE_H
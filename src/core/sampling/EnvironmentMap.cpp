@@ -0,0 +1,294 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#include "EnvironmentMap.h"
+#include "core/ThreadPool.h"
+#include "core/application/VulkanBackendApp.h"
+#include "core/compute/ComputeKernel.h"
+#include "stb_image.h"
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+
+namespace HWPT {
+    static constexpr float Pi = 3.14159265358979323846f;
+    static constexpr uint EnvironmentTestGroupSize = 64;
+
+    static auto Luminance(const glm::vec4& Color) -> float {
+        return 0.2126f * Color.x + 0.7152f * Color.y + 0.0722f * Color.z;
+    }
+
+    static auto SphericalToDirection(float Theta, float Phi) -> glm::vec3 {
+        float SinTheta = std::sin(Theta);
+        return {SinTheta * std::cos(Phi), std::cos(Theta), SinTheta * std::sin(Phi)};
+    }
+
+    EnvironmentMap::EnvironmentMap(const std::filesystem::path &HDRPath) {
+        int Width, Height, Channels;
+        float *Pixels = stbi_loadf(HDRPath.string().c_str(), &Width, &Height, &Channels,
+                                   STBI_rgb_alpha);
+        if (!Pixels) {
+            throw std::runtime_error("Failed to load environment map " + HDRPath.string());
+        }
+
+        m_width = static_cast<uint>(Width);
+        m_height = static_cast<uint>(Height);
+        m_pixels.resize(static_cast<size_t>(m_width) * m_height);
+        memcpy(m_pixels.data(), Pixels, m_pixels.size() * sizeof(glm::vec4));
+        stbi_image_free(Pixels);
+
+        BuildDistribution();
+    }
+
+    EnvironmentMap::EnvironmentMap(uint Width, uint Height, std::vector<glm::vec4> Pixels)
+            : m_width(Width), m_height(Height), m_pixels(std::move(Pixels)) {
+        Check(m_pixels.size() == static_cast<size_t>(m_width) * m_height);
+        BuildDistribution();
+    }
+
+    EnvironmentMap::~EnvironmentMap() {
+        delete m_aliasTableBuffer;
+        delete m_radianceTexture;
+        delete m_infoBuffer;
+    }
+
+    void EnvironmentMap::BuildDistribution() {
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        m_conditionals.resize(m_height);
+        std::vector<float> RowWeights(m_height);
+
+        // Rows are independent, build their conditional tables in parallel
+        ThreadPool::Get().ParallelFor(m_height, [&](uint Begin, uint End) {
+            std::vector<float> Weights(m_width);
+            for (uint Row = Begin; Row < End; Row++) {
+                // Account for the stretching of the equirectangular mapping near the poles
+                float SinTheta = std::sin(Pi * (static_cast<float>(Row) + .5f) /
+                                          static_cast<float>(m_height));
+                const glm::vec4 *RowPixels = m_pixels.data() + static_cast<size_t>(Row) * m_width;
+                for (uint Column = 0; Column < m_width; Column++) {
+                    Weights[Column] = std::max(Luminance(RowPixels[Column]), 0.f) * SinTheta;
+                }
+                m_conditionals[Row].Build(Weights.data(), m_width);
+                RowWeights[Row] = m_conditionals[Row].GetWeightSum();
+            }
+        });
+        m_marginal.Build(RowWeights.data(), m_height);
+
+        m_buildTimeMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - StartTime).count();
+    }
+
+    auto EnvironmentMap::Sample(const glm::vec2 &U) const -> EnvironmentSample {
+        EnvironmentSample Result;
+        if (m_marginal.GetWeightSum() <= 0.f) {
+            return Result;
+        }
+
+        float RowPdf, ColumnPdf, V, UU;
+        uint Row = m_marginal.Sample(U.y, &RowPdf, &V);
+        uint Column = m_conditionals[Row].Sample(U.x, &ColumnPdf, &UU);
+
+        // Jitter inside the texel with the remapped random numbers
+        float Theta = Pi * (static_cast<float>(Row) + V) / static_cast<float>(m_height);
+        float Phi = 2.f * Pi * (static_cast<float>(Column) + UU) / static_cast<float>(m_width);
+        float SinTheta = std::sin(Theta);
+        if (SinTheta <= 0.f) {
+            return Result;
+        }
+
+        Result.Direction = SphericalToDirection(Theta, Phi);
+        Result.Radiance = glm::vec3(m_pixels[static_cast<size_t>(Row) * m_width + Column]);
+        Result.Pdf = RowPdf * ColumnPdf * static_cast<float>(m_width) * static_cast<float>(m_height) /
+                     (2.f * Pi * Pi * SinTheta);
+        return Result;
+    }
+
+    auto EnvironmentMap::DirectionToPixel(const glm::vec3 &Direction) const -> glm::uvec2 {
+        float Theta = std::acos(std::clamp(Direction.y, -1.f, 1.f));
+        float Phi = std::atan2(Direction.z, Direction.x);
+        if (Phi < 0.f) {
+            Phi += 2.f * Pi;
+        }
+        uint Column = std::min(static_cast<uint>(Phi / (2.f * Pi) * static_cast<float>(m_width)),
+                               m_width - 1);
+        uint Row = std::min(static_cast<uint>(Theta / Pi * static_cast<float>(m_height)),
+                            m_height - 1);
+        return {Column, Row};
+    }
+
+    auto EnvironmentMap::GetPdf(const glm::vec3 &Direction) const -> float {
+        float SinTheta = std::sqrt(std::max(0.f, 1.f - Direction.y * Direction.y));
+        if (SinTheta <= 0.f || m_marginal.GetWeightSum() <= 0.f) {
+            return 0.f;
+        }
+        glm::uvec2 Pixel = DirectionToPixel(Direction);
+        float PixelPdf = m_marginal.GetPdf(Pixel.y) * m_conditionals[Pixel.y].GetPdf(Pixel.x);
+        return PixelPdf * static_cast<float>(m_width) * static_cast<float>(m_height) /
+               (2.f * Pi * Pi * SinTheta);
+    }
+
+    auto EnvironmentMap::Lookup(const glm::vec3 &Direction) const -> glm::vec3 {
+        glm::uvec2 Pixel = DirectionToPixel(Direction);
+        return glm::vec3(m_pixels[static_cast<size_t>(Pixel.y) * m_width + Pixel.x]);
+    }
+
+    void EnvironmentMap::CreateGPUResources() {
+        if (m_aliasTableBuffer) {
+            return;
+        }
+
+        // [Height marginal entries][Height * Width conditional entries], see EnvironmentSampling.hlsl
+        std::vector<AliasEntry> PackedEntries;
+        PackedEntries.reserve(m_height + static_cast<size_t>(m_width) * m_height);
+        PackedEntries.insert(PackedEntries.end(), m_marginal.GetEntries().begin(),
+                             m_marginal.GetEntries().end());
+        for (const auto &Conditional: m_conditionals) {
+            PackedEntries.insert(PackedEntries.end(), Conditional.GetEntries().begin(),
+                                 Conditional.GetEntries().end());
+        }
+        m_aliasTableBuffer = new StorageBuffer(sizeof(AliasEntry) * PackedEntries.size(),
+                                               PackedEntries.data());
+
+        m_radianceTexture = new Texture2D(m_width, m_height, TextureFormat::RGBA32F,
+                                          m_pixels.data());
+
+        float WeightSum = m_marginal.GetWeightSum();
+        EnvironmentGPUInfo Info{};
+        Info.Width = m_width;
+        Info.Height = m_height;
+        Info.InvWeightSum = WeightSum > 0.f ? 1.f / WeightSum : 0.f;
+        m_infoBuffer = new UniformBuffer(sizeof(EnvironmentGPUInfo), &Info);
+    }
+
+    auto EnvironmentMap::MeasureVarianceReduction(uint NumSamples, uint Seed) const -> double {
+        std::mt19937 RndEngine(Seed);
+        std::uniform_real_distribution<float> RndDist(0.f, 1.f);
+
+        // Welford's online variance of the luminance estimator
+        auto Variance = [&](auto &&Estimate) {
+            double Mean = 0., M2 = 0.;
+            for (uint i = 1; i <= NumSamples; i++) {
+                double Value = Estimate();
+                double Delta = Value - Mean;
+                Mean += Delta / i;
+                M2 += Delta * (Value - Mean);
+            }
+            return NumSamples > 1 ? M2 / (NumSamples - 1) : 0.;
+        };
+
+        double UniformVariance = Variance([&]() {
+            float CosTheta = 1.f - 2.f * RndDist(RndEngine);
+            float Phi = 2.f * Pi * RndDist(RndEngine);
+            glm::vec3 Direction = SphericalToDirection(std::acos(CosTheta), Phi);
+            return Luminance(glm::vec4(Lookup(Direction), 0.f)) * 4.f * Pi;
+        });
+        double ImportanceVariance = Variance([&]() {
+            EnvironmentSample EnvSample = Sample({RndDist(RndEngine), RndDist(RndEngine)});
+            return EnvSample.Pdf > 0.f ?
+                   Luminance(glm::vec4(EnvSample.Radiance, 0.f)) / EnvSample.Pdf : 0.f;
+        });
+
+        std::cout << "EnvironmentMap " << m_width << "x" << m_height << " variance with "
+                  << NumSamples << " samples, uniform: " << UniformVariance
+                  << ", importance: " << ImportanceVariance << "\n";
+        std::cout.flush();
+        return ImportanceVariance > 0. ? UniformVariance / ImportanceVariance : 0.;
+    }
+
+    void EnvironmentMap::CompareGPUSampling(uint NumSamples, uint Seed) {
+        CreateGPUResources();
+
+        std::mt19937 RndEngine(Seed);
+        std::uniform_real_distribution<float> RndDist(0.f, 1.f);
+        std::vector<glm::vec2> Randoms(NumSamples);
+        for (auto &U: Randoms) {
+            U = {RndDist(RndEngine), RndDist(RndEngine)};
+        }
+
+        // Bindings 0-2 are the environment, see shader/HLSL/EnvironmentTest.hlsl
+        ComputeKernel Kernel("../../shader/HLSL/EnvironmentSampleTest.spv", "EnvironmentSampleTest",
+                             {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                              VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                              VK_DESCRIPTOR_TYPE_STORAGE_BUFFER}, sizeof(glm::uvec4), 1);
+        StorageBuffer RandomBuffer(sizeof(glm::vec2) * NumSamples, Randoms.data());
+        StorageBuffer ResultBuffer(sizeof(glm::vec4) * 2 * NumSamples, nullptr);
+        VkDescriptorSet DescriptorSet = Kernel.AllocateDescriptorSet();
+        Kernel.UpdateBuffer(DescriptorSet, 0, m_infoBuffer->GetHandle());
+        Kernel.UpdateBuffer(DescriptorSet, 1, m_aliasTableBuffer->GetHandle());
+        Kernel.UpdateImage(DescriptorSet, 2, m_radianceTexture->CreateSRV(), VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+        Kernel.UpdateBuffer(DescriptorSet, 3, RandomBuffer.GetHandle());
+        Kernel.UpdateBuffer(DescriptorSet, 4, ResultBuffer.GetHandle());
+
+        auto *App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        glm::uvec4 Constants(NumSamples, 0, 0, 0);
+        Kernel.Dispatch(CommandBuffer, DescriptorSet,
+                        (NumSamples + EnvironmentTestGroupSize - 1) / EnvironmentTestGroupSize, 1, 1, &Constants);
+        ComputeKernel::ReadbackBarrier(CommandBuffer, ResultBuffer.GetHandle());
+        App->EndIntermediateCommand(CommandBuffer);
+        std::vector<glm::vec4> Results(2 * static_cast<size_t>(NumSamples));
+        ResultBuffer.Download(Results.data());
+
+        // Texel selection only compares floats, so the radiance has to match exactly. Directions and pdfs go
+        // through the GPU's transcendentals and are compared with a tolerance
+        uint TexelMismatches = 0;
+        float MaxDirectionError = 0.f, MaxPdfError = 0.f;
+        for (uint i = 0; i < NumSamples; i++) {
+            EnvironmentSample CPUSample = Sample(Randoms[i]);
+            const glm::vec4 &DirectionPdf = Results[2 * i];
+            if (glm::vec3(Results[2 * i + 1]) != CPUSample.Radiance) {
+                TexelMismatches++;
+                continue;
+            }
+            MaxDirectionError = std::max(MaxDirectionError,
+                                         glm::length(glm::vec3(DirectionPdf) - CPUSample.Direction));
+            if (CPUSample.Pdf > 0.f) {
+                MaxPdfError = std::max(MaxPdfError, std::abs(DirectionPdf.w - CPUSample.Pdf) / CPUSample.Pdf);
+            }
+        }
+
+        std::cout << "EnvironmentMap GPU sampling, " << NumSamples << " samples, texel mismatches: "
+                  << TexelMismatches << ", max direction error: " << MaxDirectionError
+                  << ", max relative pdf error: " << MaxPdfError << "\n";
+        std::cout.flush();
+    }
+
+    void EnvironmentMap::BenchmarkBuild(uint Width, uint Height) {
+        // Dim sky gradient with a small and very bright sun, the typical hard case for uniform sampling
+        std::vector<glm::vec4> Pixels(static_cast<size_t>(Width) * Height);
+        glm::vec3 SunDirection = glm::normalize(glm::vec3(.3f, .6f, .2f));
+        ThreadPool::Get().ParallelFor(Height, [&](uint Begin, uint End) {
+            for (uint Row = Begin; Row < End; Row++) {
+                float Theta = Pi * (static_cast<float>(Row) + .5f) / static_cast<float>(Height);
+                for (uint Column = 0; Column < Width; Column++) {
+                    float Phi = 2.f * Pi * (static_cast<float>(Column) + .5f) /
+                                static_cast<float>(Width);
+                    glm::vec3 Direction = SphericalToDirection(Theta, Phi);
+                    float Sky = .2f + .8f * std::max(Direction.y, 0.f);
+                    float Sun = glm::dot(Direction, SunDirection) > .9995f ? 5e4f : 0.f;
+                    Pixels[static_cast<size_t>(Row) * Width + Column] =
+                            glm::vec4(Sky * .4f + Sun, Sky * .6f + Sun, Sky + Sun, 1.f);
+                }
+            }
+        });
+
+        EnvironmentMap Environment(Width, Height, std::move(Pixels));
+        std::cout << "EnvironmentMap " << Width << "x" << Height << " alias tables built in "
+                  << Environment.GetBuildTimeMs() << " ms on "
+                  << ThreadPool::Get().GetNumThreads() << " threads\n";
+        double Reduction = Environment.MeasureVarianceReduction(1u << 16);
+        std::cout << "EnvironmentMap variance reduction vs uniform sampling: " << Reduction << "x\n";
+
+        auto UploadStartTime = std::chrono::high_resolution_clock::now();
+        Environment.CreateGPUResources();
+        double UploadMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - UploadStartTime).count();
+        std::cout << "EnvironmentMap alias tables and radiance uploaded in " << UploadMs << " ms\n";
+        Environment.CompareGPUSampling(1u << 16);
+        std::cout.flush();
+    }
+}  // namespace HWPT
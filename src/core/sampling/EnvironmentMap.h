@@ -0,0 +1,95 @@
+//
+// Created by HUSTLX on 2024/10/20.
+//
+
+#ifndef HARDWAREPATHTRACER_ENVIRONMENTMAP_H
+#define HARDWAREPATHTRACER_ENVIRONMENTMAP_H
+
+#include "core/Core.h"
+#include "core/sampling/AliasTable.h"
+#include "core/buffer/StorageBuffer.h"
+#include "core/buffer/UniformBuffer.h"
+#include "core/texture/Texture2D.h"
+#include <filesystem>
+#include <vector>
+
+
+namespace HWPT {
+    struct EnvironmentSample {
+        glm::vec3 Direction = glm::vec3(0.f, 1.f, 0.f);
+        glm::vec3 Radiance = glm::vec3(0.f);
+        float Pdf = 0.f;  // Solid angle measure
+    };
+
+    // Same layout as EnvironmentInfo in shader/HLSL/EnvironmentSampling.hlsl
+    struct EnvironmentGPUInfo {
+        uint Width;
+        uint Height;
+        float InvWeightSum;
+        float Padding;
+    };
+
+    // Equirectangular HDR environment, +Y is up. Importance sampled with a 2D piecewise-constant
+    // distribution stored as alias tables: one marginal table over rows and one conditional table per row
+    class EnvironmentMap {
+    public:
+        explicit EnvironmentMap(const std::filesystem::path& HDRPath);
+
+        EnvironmentMap(uint Width, uint Height, std::vector<glm::vec4> Pixels);
+
+        ~EnvironmentMap();
+
+        [[nodiscard]] auto Sample(const glm::vec2& U) const -> EnvironmentSample;
+
+        [[nodiscard]] auto GetPdf(const glm::vec3& Direction) const -> float;
+
+        [[nodiscard]] auto Lookup(const glm::vec3& Direction) const -> glm::vec3;
+
+        // Alias tables, radiance texture and info uniform for the GPU tracer
+        void CreateGPUResources();
+
+        auto GetAliasTableBuffer() -> StorageBuffer* {
+            return m_aliasTableBuffer;
+        }
+
+        auto GetRadianceTexture() -> Texture2D* {
+            return m_radianceTexture;
+        }
+
+        auto GetInfoBuffer() -> UniformBuffer* {
+            return m_infoBuffer;
+        }
+
+        [[nodiscard]] auto GetBuildTimeMs() const -> double {
+            return m_buildTimeMs;
+        }
+
+        // Variance ratio of the radiance integral estimator, uniform sphere sampling over importance sampling
+        [[nodiscard]] auto MeasureVarianceReduction(uint NumSamples, uint Seed = 0) const -> double;
+
+        // Draws the same samples with SampleEnvironment in shader/HLSL/EnvironmentTest.hlsl and reports how far
+        // they are from the CPU ones, creates the GPU resources if needed
+        void CompareGPUSampling(uint NumSamples, uint Seed = 0);
+
+        // Builds the distribution of a synthetic sky at the given resolution and reports the timings
+        static void BenchmarkBuild(uint Width = 8192, uint Height = 4096);
+
+    private:
+        void BuildDistribution();
+
+        [[nodiscard]] auto DirectionToPixel(const glm::vec3& Direction) const -> glm::uvec2;
+
+        uint m_width = 0, m_height = 0;
+        std::vector<glm::vec4> m_pixels;
+
+        AliasTable m_marginal;
+        std::vector<AliasTable> m_conditionals;
+        double m_buildTimeMs = 0.;
+
+        StorageBuffer* m_aliasTableBuffer = nullptr;
+        Texture2D* m_radianceTexture = nullptr;
+        UniformBuffer* m_infoBuffer = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_ENVIRONMENTMAP_H
@@ -0,0 +1,41 @@
+//
+// Created by HUSTLX on 2024/10/21.
+//
+
+#ifndef HARDWAREPATHTRACER_PCGRANDOM_H
+#define HARDWAREPATHTRACER_PCGRANDOM_H
+
+#include "core/Core.h"
+#include <algorithm>
+
+
+namespace HWPT {
+    // PCG32 (XSH RR), the plain pseudo random reference for the low-discrepancy samplers
+    class PCGRandom {
+    public:
+        explicit PCGRandom(uint64_t Seed = 0x853c49e6748fea9bull, uint64_t Sequence = 0xda3e39cb94b95bdbull) {
+            m_increment = (Sequence << 1u) | 1u;
+            NextUInt();
+            m_state += Seed;
+            NextUInt();
+        }
+
+        auto NextUInt() -> uint {
+            uint64_t OldState = m_state;
+            m_state = OldState * 0x5851f42d4c957f2dull + m_increment;
+            auto XorShifted = static_cast<uint>(((OldState >> 18u) ^ OldState) >> 27u);
+            auto Rotation = static_cast<uint>(OldState >> 59u);
+            return (XorShifted >> Rotation) | (XorShifted << ((~Rotation + 1u) & 31u));
+        }
+
+        auto NextFloat() -> float {
+            return std::min(static_cast<float>(NextUInt()) * 2.3283064365386963e-10f, 0.99999994f);
+        }
+
+    private:
+        uint64_t m_state = 0;
+        uint64_t m_increment = 1;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_PCGRANDOM_H
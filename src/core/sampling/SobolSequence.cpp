@@ -0,0 +1,220 @@
+//
+// Created by HUSTLX on 2024/10/21.
+//
+
+#include "SobolSequence.h"
+#include "core/sampling/PCGRandom.h"
+#include "core/application/VulkanBackendApp.h"
+#include "core/compute/ComputeKernel.h"
+#include <vector>
+#include <cmath>
+#include <functional>
+
+
+namespace HWPT {
+    static constexpr uint SamplerTestGroupSize = 8;
+
+    // Primitive polynomials and initial direction numbers from Joe & Kuo (new-joe-kuo-6.21201),
+    // dimension 0 is the van der Corput sequence and has no entry
+    struct SobolInitialNumbers {
+        uint Degree;
+        uint Coefficients;
+        std::array<uint, 6> InitialM;
+    };
+
+    static constexpr std::array<SobolInitialNumbers, SobolSequence::NumDimensions - 1> s_sobolInit = {{
+            {1, 0, {1}},
+            {2, 1, {1, 3}},
+            {3, 1, {1, 3, 1}},
+            {3, 2, {1, 1, 1}},
+            {4, 1, {1, 1, 3, 3}},
+            {4, 4, {1, 3, 5, 13}},
+            {5, 2, {1, 1, 5, 5, 17}},
+            {5, 4, {1, 1, 5, 5, 5}},
+            {5, 7, {1, 1, 7, 11, 19}},
+            {5, 11, {1, 1, 5, 1, 1}},
+            {5, 13, {1, 1, 1, 3, 11}},
+            {5, 14, {1, 3, 5, 5, 31}},
+            {6, 1, {1, 3, 3, 9, 7, 49}},
+            {6, 13, {1, 1, 1, 15, 21, 21}},
+            {6, 16, {1, 3, 1, 13, 27, 49}},
+    }};
+
+    static auto ReverseBits(uint Value) -> uint {
+        Value = ((Value >> 1u) & 0x55555555u) | ((Value & 0x55555555u) << 1u);
+        Value = ((Value >> 2u) & 0x33333333u) | ((Value & 0x33333333u) << 2u);
+        Value = ((Value >> 4u) & 0x0F0F0F0Fu) | ((Value & 0x0F0F0F0Fu) << 4u);
+        Value = ((Value >> 8u) & 0x00FF00FFu) | ((Value & 0x00FF00FFu) << 8u);
+        return (Value >> 16u) | (Value << 16u);
+    }
+
+    SobolSequence::SobolSequence() {
+        for (uint Bit = 0; Bit < NumBits; Bit++) {
+            m_directions[0][Bit] = 1u << (31u - Bit);
+        }
+
+        for (uint Dimension = 1; Dimension < NumDimensions; Dimension++) {
+            const SobolInitialNumbers &Init = s_sobolInit[Dimension - 1];
+            auto &V = m_directions[Dimension];
+            for (uint Bit = 0; Bit < Init.Degree; Bit++) {
+                V[Bit] = Init.InitialM[Bit] << (31u - Bit);
+            }
+            for (uint Bit = Init.Degree; Bit < NumBits; Bit++) {
+                V[Bit] = V[Bit - Init.Degree] ^ (V[Bit - Init.Degree] >> Init.Degree);
+                for (uint k = 1; k < Init.Degree; k++) {
+                    V[Bit] ^= ((Init.Coefficients >> (Init.Degree - 1u - k)) & 1u) * V[Bit - k];
+                }
+            }
+        }
+    }
+
+    SobolSequence::~SobolSequence() {
+        delete m_directionBuffer;
+    }
+
+    auto SobolSequence::SampleRaw(uint Index, uint Dimension) const -> uint {
+        Check(Dimension < NumDimensions);
+        uint Result = 0;
+        for (uint Bit = 0; Index != 0; Index >>= 1u, Bit++) {
+            if (Index & 1u) {
+                Result ^= m_directions[Dimension][Bit];
+            }
+        }
+        return Result;
+    }
+
+    auto SobolSequence::Hash(uint Value) -> uint {
+        uint State = Value * 747796405u + 2891336453u;
+        uint Word = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+        return (Word >> 22u) ^ Word;
+    }
+
+    auto SobolSequence::HashCombine(uint Seed, uint Value) -> uint {
+        return Seed ^ (Hash(Value) + 0x9e3779b9u + (Seed << 6u) + (Seed >> 2u));
+    }
+
+    auto SobolSequence::NestedUniformScramble(uint Value, uint Seed) -> uint {
+        // Laine-Karras style permutation on reversed bits is an Owen scramble
+        Value = ReverseBits(Value);
+        Value += Seed;
+        Value ^= Value * 0x6c50b47cu;
+        Value ^= Value * 0xb82f1e52u;
+        Value ^= Value * 0xc7afe638u;
+        Value ^= Value * 0x8d22f6e6u;
+        return ReverseBits(Value);
+    }
+
+    auto SobolSequence::Sample(uint Index, uint Dimension, uint Seed) const -> float {
+        // Dimensions are padded in blocks of NumDimensions, each block decorrelated by its own seed
+        uint BlockSeed = HashCombine(Seed, Dimension / NumDimensions);
+        uint ShuffledIndex = NestedUniformScramble(Index, BlockSeed);
+        uint Value = SampleRaw(ShuffledIndex, Dimension % NumDimensions);
+        Value = NestedUniformScramble(Value, HashCombine(BlockSeed, Dimension));
+        return std::min(static_cast<float>(Value) * 2.3283064365386963e-10f, 0.99999994f);
+    }
+
+    auto SobolSequence::SamplePixel(uint PixelX, uint PixelY, uint SampleIndex,
+                                    uint Dimension) const -> float {
+        return Sample(SampleIndex, Dimension, Hash(PixelX ^ Hash(PixelY)));
+    }
+
+    void SobolSequence::CreateGPUResources() {
+        if (m_directionBuffer) {
+            return;
+        }
+        m_directionBuffer = new StorageBuffer(sizeof(m_directions), m_directions.data());
+    }
+
+    void SobolSequence::BenchmarkConvergence(uint MaxSamples, uint NumTrials) {
+        // Exact integrals over the unit square
+        const double GaussianReference = std::pow(std::sqrt(3.14159265358979323846) / 2. * std::erf(1.), 2.);
+        const double StepReference = .5;
+        auto Gaussian = [](float X, float Y) { return std::exp(-static_cast<double>(X * X + Y * Y)); };
+        auto Step = [](float X, float Y) { return X < Y ? 1. : 0.; };
+
+        SobolSequence Sobol;
+        BlueNoise Noise;
+        std::cout << "Samples | Gaussian RMSE Sobol / PCG / BlueNoise | Step RMSE Sobol / PCG / BlueNoise\n";
+        for (uint NumSamples = 4; NumSamples <= MaxSamples; NumSamples *= 4) {
+            // Blue noise samples are the pixels of a Side x Side window, rotated by the trial as frame index
+            const auto Side = static_cast<uint>(std::lround(std::sqrt(static_cast<double>(NumSamples))));
+            double SquaredErrors[6] = {0., 0., 0., 0., 0., 0.};
+            for (uint Trial = 0; Trial < NumTrials; Trial++) {
+                PCGRandom Random(Trial, Trial * 2u + 1u);
+                uint Seed = Hash(Trial);
+                uint WindowX = Seed % BlueNoise::TileSize, WindowY = (Seed >> 16u) % BlueNoise::TileSize;
+                double Sums[6] = {0., 0., 0., 0., 0., 0.};
+                for (uint i = 0; i < NumSamples; i++) {
+                    float SX = Sobol.Sample(i, 0, Seed), SY = Sobol.Sample(i, 1, Seed);
+                    float PX = Random.NextFloat(), PY = Random.NextFloat();
+                    uint PixelX = WindowX + i % Side, PixelY = WindowY + i / Side;
+                    float BX = Noise.Sample(PixelX, PixelY, 0, Trial), BY = Noise.Sample(PixelX, PixelY, 1, Trial);
+                    Sums[0] += Gaussian(SX, SY);
+                    Sums[1] += Gaussian(PX, PY);
+                    Sums[2] += Gaussian(BX, BY);
+                    Sums[3] += Step(SX, SY);
+                    Sums[4] += Step(PX, PY);
+                    Sums[5] += Step(BX, BY);
+                }
+                const double References[6] = {GaussianReference, GaussianReference, GaussianReference,
+                                              StepReference, StepReference, StepReference};
+                for (int k = 0; k < 6; k++) {
+                    double Error = Sums[k] / NumSamples - References[k];
+                    SquaredErrors[k] += Error * Error;
+                }
+            }
+            std::cout << NumSamples;
+            for (double SquaredError: SquaredErrors) {
+                std::cout << " | " << std::sqrt(SquaredError / NumTrials);
+            }
+            std::cout << "\n";
+        }
+        std::cout.flush();
+    }
+
+    void SobolSequence::CompareGPU(SobolSequence &Sobol, BlueNoise &Noise, uint Width, uint Height,
+                                   uint NumFrames) {
+        Sobol.CreateGPUResources();
+        Noise.CreateGPUResources();
+
+        // Frame indices up to 2^31, where a float golden ratio rotation used to lose its precision
+        const uint FrameStride = (1u << 31u) / std::max(NumFrames, 1u);
+        const size_t NumResults = static_cast<size_t>(Width) * Height * NumFrames;
+        ComputeKernel Kernel("../../shader/HLSL/SamplerTest.spv", "SamplerTest",
+                             {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                              VK_DESCRIPTOR_TYPE_STORAGE_BUFFER}, sizeof(glm::uvec4), 1);
+        StorageBuffer ResultBuffer(sizeof(glm::vec4) * 2 * NumResults, nullptr);
+        VkDescriptorSet DescriptorSet = Kernel.AllocateDescriptorSet();
+        Kernel.UpdateBuffer(DescriptorSet, 0, Sobol.GetDirectionBuffer()->GetHandle());
+        Kernel.UpdateImage(DescriptorSet, 1, Noise.GetTexture()->CreateSRV(), VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+        Kernel.UpdateBuffer(DescriptorSet, 2, ResultBuffer.GetHandle());
+
+        auto *App = VulkanBackendApp::GetApplication();
+        auto CommandBuffer = App->BeginIntermediateCommand();
+        glm::uvec4 Constants(Width, Height, 0, FrameStride);
+        Kernel.Dispatch(CommandBuffer, DescriptorSet, (Width + SamplerTestGroupSize - 1) / SamplerTestGroupSize,
+                        (Height + SamplerTestGroupSize - 1) / SamplerTestGroupSize, NumFrames, &Constants);
+        ComputeKernel::ReadbackBarrier(CommandBuffer, ResultBuffer.GetHandle());
+        App->EndIntermediateCommand(CommandBuffer);
+        std::vector<glm::vec4> Results(2 * NumResults);
+        ResultBuffer.Download(Results.data());
+
+        size_t SobolMismatches = 0, BlueNoiseMismatches = 0;
+        for (uint Frame = 0; Frame < NumFrames; Frame++) {
+            uint FrameIndex = Frame * FrameStride;
+            for (uint y = 0; y < Height; y++) {
+                for (uint x = 0; x < Width; x++) {
+                    size_t ResultIndex = (static_cast<size_t>(Frame) * Height + y) * Width + x;
+                    for (uint k = 0; k < 4; k++) {
+                        SobolMismatches += Results[2 * ResultIndex][k] != Sobol.SamplePixel(x, y, FrameIndex, k);
+                        BlueNoiseMismatches += Results[2 * ResultIndex + 1][k] != Noise.Sample(x, y, k, FrameIndex);
+                    }
+                }
+            }
+        }
+        std::cout << "Sampling.hlsl over " << Width << "x" << Height << " pixels and " << NumFrames
+                  << " frames, Sobol mismatches: " << SobolMismatches << " of " << 4 * NumResults
+                  << ", blue noise mismatches: " << BlueNoiseMismatches << " of " << 4 * NumResults << "\n";
+        std::cout.flush();
+    }
+}  // namespace HWPT
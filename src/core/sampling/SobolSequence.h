@@ -0,0 +1,65 @@
+//
+// Created by HUSTLX on 2024/10/21.
+//
+
+#ifndef HARDWAREPATHTRACER_SOBOLSEQUENCE_H
+#define HARDWAREPATHTRACER_SOBOLSEQUENCE_H
+
+#include "core/Core.h"
+#include "core/buffer/StorageBuffer.h"
+#include "core/sampling/BlueNoise.h"
+#include <array>
+
+
+namespace HWPT {
+    // Sobol sequence with hash based Owen scrambling (Burley 2020). Sample indexing is shared with
+    // shader/HLSL/Sampling.hlsl, so CPU and GPU tracers see the exact same numbers for a pixel
+    class SobolSequence {
+    public:
+        static constexpr uint NumDimensions = 16;
+        static constexpr uint NumBits = 32;
+
+        SobolSequence();
+
+        ~SobolSequence();
+
+        // Unscrambled Sobol point, Dimension < NumDimensions
+        [[nodiscard]] auto SampleRaw(uint Index, uint Dimension) const -> uint;
+
+        // Owen scrambled and index shuffled sample in [0, 1), higher dimensions are padded with
+        // differently seeded copies of the table
+        [[nodiscard]] auto Sample(uint Index, uint Dimension, uint Seed) const -> float;
+
+        // Pixel seeded variant used by the path tracers
+        [[nodiscard]] auto SamplePixel(uint PixelX, uint PixelY, uint SampleIndex,
+                                       uint Dimension) const -> float;
+
+        // Direction numbers as uint[NumDimensions][NumBits]
+        void CreateGPUResources();
+
+        auto GetDirectionBuffer() -> StorageBuffer* {
+            return m_directionBuffer;
+        }
+
+        // RMSE vs sample count of scrambled Sobol and PCG on a smooth and a discontinuous integrand. Blue noise
+        // takes one sample per pixel of a square window, the error of a 1 spp image after a box filter
+        static void BenchmarkConvergence(uint MaxSamples = 4096, uint NumTrials = 64);
+
+        // Runs SobolSamplePixel and SampleBlueNoise of shader/HLSL/SamplingTest.hlsl over a pixel grid and
+        // NumFrames frame indices up to 2^31 and counts the samples that differ from the CPU bits
+        static void CompareGPU(SobolSequence& Sobol, BlueNoise& Noise, uint Width = 256, uint Height = 256,
+                               uint NumFrames = 8);
+
+        static auto Hash(uint Value) -> uint;
+
+        static auto HashCombine(uint Seed, uint Value) -> uint;
+
+        static auto NestedUniformScramble(uint Value, uint Seed) -> uint;
+
+    private:
+        std::array<std::array<uint, NumBits>, NumDimensions> m_directions{};
+        StorageBuffer* m_directionBuffer = nullptr;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_SOBOLSEQUENCE_H
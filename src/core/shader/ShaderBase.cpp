@@ -29,6 +29,11 @@ namespace HWPT {
         CreateInfo.pCode = reinterpret_cast<const uint32_t *>(ShaderSource.data());
 
         VK_CHECK(vkCreateShaderModule(GetVKDevice(), &CreateInfo, nullptr, &m_shaderModule));
+
+        m_codeHash = 0xcbf29ce484222325ull;
+        for (char Byte: ShaderSource) {
+            m_codeHash = (m_codeHash ^ static_cast<uint8_t>(Byte)) * 0x100000001b3ull;
+        }
     }
 
 //    void ShaderBase::BindShaderStage(const std::string &Entry) {
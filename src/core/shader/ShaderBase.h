@@ -35,11 +35,17 @@ namespace HWPT {
             return m_shaderModule;
         }
 
+        // FNV-1a of the SPIR-V, identifies the code across module handles and runs
+        [[nodiscard]] auto GetCodeHash() const -> uint64_t {
+            return m_codeHash;
+        }
+
 //        void BindShaderStage(const std::string& Entry);
 
     private:
         VkShaderModule m_shaderModule = VK_NULL_HANDLE;
         ShaderType m_shaderType = ShaderType::None;
+        uint64_t m_codeHash = 0;
     };
 
 
@@ -110,6 +110,28 @@ auto main() -> int {
 //    HWPT::HLSLCompiler::CompileShader("Particle.hlsl", "GSMain", HWPT::ShaderType::Geometry, "ParticleGeometry");
     HWPT::HLSLCompiler::CompileShader("Particle.hlsl", "PSMain", HWPT::ShaderType::Fragment, "ParticleFrag");
     HWPT::HLSLCompiler::CompileShader("UpdateParticle.hlsl", "UpdateParticles", HWPT::ShaderType::Compute, "UpdateParticle");
+    HWPT::HLSLCompiler::CompileShader("EnvironmentTest.hlsl", "EnvironmentSampleTest", HWPT::ShaderType::Compute, "EnvironmentSampleTest");
+    HWPT::HLSLCompiler::CompileShader("SamplingTest.hlsl", "SamplerTest", HWPT::ShaderType::Compute, "SamplerTest");
+    HWPT::HLSLCompiler::CompileShader("RadixSort.hlsl", "RadixCount", HWPT::ShaderType::Compute, "RadixCount");
+    HWPT::HLSLCompiler::CompileShader("RadixSort.hlsl", "RadixScan", HWPT::ShaderType::Compute, "RadixScan");
+    HWPT::HLSLCompiler::CompileShader("RadixSort.hlsl", "RadixScatter", HWPT::ShaderType::Compute, "RadixScatter");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "LBVHMorton", HWPT::ShaderType::Compute, "LBVHMorton");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "LBVHLeaves", HWPT::ShaderType::Compute, "LBVHLeaves");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "LBVHHierarchy", HWPT::ShaderType::Compute, "LBVHHierarchy");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "LBVHRefit", HWPT::ShaderType::Compute, "LBVHRefit");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCNearest", HWPT::ShaderType::Compute, "PLOCNearest");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCMerge", HWPT::ShaderType::Compute, "PLOCMerge");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCCount", HWPT::ShaderType::Compute, "PLOCCount");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCScan", HWPT::ShaderType::Compute, "PLOCScan");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCScatter", HWPT::ShaderType::Compute, "PLOCScatter");
+    HWPT::HLSLCompiler::CompileShader("GPUBVHBuild.hlsl", "PLOCFinalize", HWPT::ShaderType::Compute, "PLOCFinalize");
+    HWPT::HLSLCompiler::CompileShader("TraceRays.hlsl", "TraceClosestHit", HWPT::ShaderType::Compute, "TraceClosestHit");
+    HWPT::HLSLCompiler::CompileShader("ReSTIRDI.hlsl", "ReSTIRInitial", HWPT::ShaderType::Compute, "ReSTIRInitial");
+    HWPT::HLSLCompiler::CompileShader("ReSTIRDI.hlsl", "ReSTIRTemporal", HWPT::ShaderType::Compute, "ReSTIRTemporal");
+    HWPT::HLSLCompiler::CompileShader("ReSTIRDI.hlsl", "ReSTIRSpatial", HWPT::ShaderType::Compute, "ReSTIRSpatial");
+    HWPT::HLSLCompiler::CompileShader("ReSTIRDI.hlsl", "ReSTIRShade", HWPT::ShaderType::Compute, "ReSTIRShade");
+    HWPT::HLSLCompiler::CompileShader("VolumeTracking.hlsl", "VolumeRatioTracking", HWPT::ShaderType::Compute, "VolumeRatioTracking");
+    HWPT::HLSLCompiler::CompileShader("VolumeTracking.hlsl", "VolumeDeltaTracking", HWPT::ShaderType::Compute, "VolumeDeltaTracking");
 
     return 0;
 }
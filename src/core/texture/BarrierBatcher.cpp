@@ -0,0 +1,162 @@
+//
+// Created by HUSTLX on 2024/11/5.
+//
+
+#include "BarrierBatcher.h"
+#include "core/RHI.h"
+#include <algorithm>
+#include <tuple>
+
+
+namespace HWPT {
+    static constexpr VkAccessFlags2 WriteAccessMask =
+            VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+            VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+    // Whether a barrier into Stage / Access also made the image visible to the reads in ReadStage / ReadAccess
+    static auto CoversReads(VkPipelineStageFlags2 Stage, VkAccessFlags2 Access, VkPipelineStageFlags2 ReadStage,
+                            VkAccessFlags2 ReadAccess) -> bool {
+        bool StagesCovered = (Stage & VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT) || !(ReadStage & ~Stage);
+        bool AccessCovered = (Access & VK_ACCESS_2_MEMORY_READ_BIT) || !(ReadAccess & ~Access);
+        return StagesCovered && AccessCovered;
+    }
+
+    ImageLayoutState::ImageLayoutState(VkImage Image, VkImageAspectFlags Aspect, uint NumMips, uint NumLayers,
+                                       VkImageLayout InitialLayout)
+            : m_image(Image), m_aspect(Aspect), m_numMips(NumMips), m_numLayers(NumLayers),
+              m_subresources(static_cast<size_t>(NumMips) * NumLayers) {
+        SetLayout(InitialLayout);
+    }
+
+    void ImageLayoutState::SetLayout(VkImageLayout Layout, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access) {
+        for (auto& Current: m_subresources) {
+            Current.Layout = Layout;
+            Current.Stage = Stage;
+            Current.Access = Access;
+            Current.Pending = false;
+        }
+    }
+
+    auto ImageLayoutState::GetLayout(uint Mip, uint Layer) const -> VkImageLayout {
+        return m_subresources[Layer * m_numMips + Mip].Layout;
+    }
+
+    void BarrierBatcher::Transition(ImageLayoutState &State, VkImageLayout NewLayout, VkPipelineStageFlags2 Stage,
+                                    VkAccessFlags2 Access, uint BaseMip, uint NumMips, uint BaseLayer,
+                                    uint NumLayers) {
+        if (Stage == VK_PIPELINE_STAGE_2_NONE) {
+            std::tie(Stage, Access) = RHI::GetLayoutSyncScope(NewLayout);
+        }
+        uint EndMip = NumMips == ~0u ? State.m_numMips : std::min(BaseMip + NumMips, State.m_numMips);
+        uint EndLayer = NumLayers == ~0u ? State.m_numLayers : std::min(BaseLayer + NumLayers, State.m_numLayers);
+
+        for (uint Layer = BaseLayer; Layer < EndLayer; Layer++) {
+            for (uint Mip = BaseMip; Mip < EndMip; Mip++) {
+                auto& Current = State.At(Mip, Layer);
+                // Several uses of the same layout before the flush all wait for it, a different layout
+                // replaces the earlier request since nothing used the image in between
+                if (Current.Pending && Current.PendingLayout == NewLayout) {
+                    Current.PendingStage |= Stage;
+                    Current.PendingAccess |= Access;
+                } else {
+                    Current.Pending = true;
+                    Current.PendingLayout = NewLayout;
+                    Current.PendingStage = Stage;
+                    Current.PendingAccess = Access;
+                }
+                m_stats.NumRequested++;
+            }
+        }
+        if (!State.m_queued) {
+            State.m_queued = true;
+            m_pending.push_back(&State);
+        }
+    }
+
+    void BarrierBatcher::Flush(VkCommandBuffer CommandBuffer) {
+        if (m_pending.empty()) {
+            return;
+        }
+
+        m_barriers.clear();
+        for (ImageLayoutState* State: m_pending) {
+            for (uint Layer = 0; Layer < State->m_numLayers; Layer++) {
+                VkImageMemoryBarrier2* Run = nullptr;  // Open barrier the next mip may extend
+                for (uint Mip = 0; Mip < State->m_numMips; Mip++) {
+                    auto& Current = State->At(Mip, Layer);
+                    if (!Current.Pending) {
+                        Run = nullptr;
+                        continue;
+                    }
+                    Current.Pending = false;
+
+                    // Read only use in the current layout by stages the last barrier already covered
+                    bool Redundant = Current.Layout == Current.PendingLayout &&
+                                     !((Current.Access | Current.PendingAccess) & WriteAccessMask) &&
+                                     CoversReads(Current.Stage, Current.Access, Current.PendingStage,
+                                                 Current.PendingAccess);
+                    if (Redundant) {
+                        m_stats.NumSkipped++;
+                        Run = nullptr;
+                        continue;
+                    }
+
+                    VkAccessFlags2 SrcAccess = Current.Access & WriteAccessMask;
+                    if (Run && Run->oldLayout == Current.Layout && Run->newLayout == Current.PendingLayout &&
+                        Run->srcStageMask == Current.Stage && Run->srcAccessMask == SrcAccess &&
+                        Run->dstStageMask == Current.PendingStage && Run->dstAccessMask == Current.PendingAccess) {
+                        Run->subresourceRange.levelCount++;
+                    } else {
+                        VkImageMemoryBarrier2 Barrier{};
+                        Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                        Barrier.srcStageMask = Current.Stage;
+                        Barrier.srcAccessMask = SrcAccess;
+                        Barrier.dstStageMask = Current.PendingStage;
+                        Barrier.dstAccessMask = Current.PendingAccess;
+                        Barrier.oldLayout = Current.Layout;
+                        Barrier.newLayout = Current.PendingLayout;
+                        Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        Barrier.image = State->m_image;
+                        Barrier.subresourceRange.aspectMask = State->m_aspect;
+                        Barrier.subresourceRange.baseMipLevel = Mip;
+                        Barrier.subresourceRange.levelCount = 1;
+                        Barrier.subresourceRange.baseArrayLayer = Layer;
+                        Barrier.subresourceRange.layerCount = 1;
+                        m_barriers.push_back(Barrier);
+                        Run = &m_barriers.back();
+                    }
+
+                    Current.Layout = Current.PendingLayout;
+                    Current.Stage = Current.PendingStage;
+                    Current.Access = Current.PendingAccess;
+                }
+            }
+            State->m_queued = false;
+        }
+        m_pending.clear();
+
+        if (m_barriers.empty()) {
+            return;
+        }
+        VkDependencyInfo DependencyInfo{};
+        DependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        DependencyInfo.imageMemoryBarrierCount = static_cast<uint>(m_barriers.size());
+        DependencyInfo.pImageMemoryBarriers = m_barriers.data();
+        vkCmdPipelineBarrier2(CommandBuffer, &DependencyInfo);
+        m_stats.NumBarriers += m_barriers.size();
+        m_stats.NumFlushes++;
+    }
+
+    void BarrierBatcher::Discard(ImageLayoutState &State) {
+        if (!State.m_queued) {
+            return;
+        }
+        m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), &State), m_pending.end());
+        for (auto& Current: State.m_subresources) {
+            Current.Pending = false;
+        }
+        State.m_queued = false;
+    }
+}  // namespace HWPT
@@ -0,0 +1,110 @@
+//
+// Created by HUSTLX on 2024/11/5.
+//
+
+#ifndef HARDWAREPATHTRACER_BARRIERBATCHER_H
+#define HARDWAREPATHTRACER_BARRIERBATCHER_H
+
+#include "core/Core.h"
+#include <vector>
+
+
+namespace HWPT {
+    // Layout and synchronization scope of every mip and layer of one image as of the last barrier recorded
+    // for it, owned next to the image. Layout changes go through BarrierBatcher, SetLayout is for work that
+    // changes the layout on its own, e.g. an upload or the finalLayout of a render pass
+    class ImageLayoutState {
+    public:
+        ImageLayoutState() = default;
+
+        ImageLayoutState(VkImage Image, VkImageAspectFlags Aspect, uint NumMips, uint NumLayers = 1,
+                         VkImageLayout InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+        // Stage and Access are the last use in Layout, a later transition waits for them
+        void SetLayout(VkImageLayout Layout, VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE,
+                       VkAccessFlags2 Access = VK_ACCESS_2_NONE);
+
+        [[nodiscard]] auto GetLayout(uint Mip, uint Layer = 0) const -> VkImageLayout;
+
+        [[nodiscard]] auto GetImage() const -> VkImage {
+            return m_image;
+        }
+
+        [[nodiscard]] auto GetAspect() const -> VkImageAspectFlags {
+            return m_aspect;
+        }
+
+        [[nodiscard]] auto GetNumMips() const -> uint {
+            return m_numMips;
+        }
+
+        [[nodiscard]] auto GetNumLayers() const -> uint {
+            return m_numLayers;
+        }
+
+    private:
+        friend class BarrierBatcher;
+
+        struct Subresource {
+            VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 Access = VK_ACCESS_2_NONE;
+            // Requested through BarrierBatcher::Transition and not flushed yet
+            bool Pending = false;
+            VkImageLayout PendingLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags2 PendingStage = VK_PIPELINE_STAGE_2_NONE;
+            VkAccessFlags2 PendingAccess = VK_ACCESS_2_NONE;
+        };
+
+        auto At(uint Mip, uint Layer) -> Subresource& {
+            return m_subresources[Layer * m_numMips + Mip];
+        }
+
+        VkImage m_image = VK_NULL_HANDLE;
+        VkImageAspectFlags m_aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        uint m_numMips = 0, m_numLayers = 0;
+        std::vector<Subresource> m_subresources;
+        bool m_queued = false;  // In the pending list of a BarrierBatcher
+    };
+
+    struct BarrierBatcherStats {
+        uint64_t NumRequested = 0;  // Subresource transitions asked for
+        uint64_t NumSkipped = 0;  // Of those, already in the layout and visible to the requested scope
+        uint64_t NumBarriers = 0;  // VkImageMemoryBarrier2 after merging contiguous mips
+        uint64_t NumFlushes = 0;  // vkCmdPipelineBarrier2 calls
+    };
+
+    // Collects image layout transitions and records them as one vkCmdPipelineBarrier2 on Flush. The old
+    // layout and the source scope come from the tracked ImageLayoutState, several requests for the same
+    // subresource before a flush collapse into one barrier, and read only uses in the layout the image is
+    // already in are dropped. Nothing may touch the requested subresources between Transition and Flush,
+    // the application flushes its batcher at the start of every graphics command buffer it records
+    class BarrierBatcher {
+    public:
+        // Stage and Access are the next use of the subresources, the typical use of NewLayout when left NONE
+        void Transition(ImageLayoutState& State, VkImageLayout NewLayout,
+                        VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE,
+                        VkAccessFlags2 Access = VK_ACCESS_2_NONE, uint BaseMip = 0, uint NumMips = ~0u,
+                        uint BaseLayer = 0, uint NumLayers = ~0u);
+
+        void Flush(VkCommandBuffer CommandBuffer);
+
+        // Drops the pending transitions of State, for images destroyed before the next flush
+        void Discard(ImageLayoutState& State);
+
+        [[nodiscard]] auto HasPending() const -> bool {
+            return !m_pending.empty();
+        }
+
+        [[nodiscard]] auto GetStats() const -> const BarrierBatcherStats& {
+            return m_stats;
+        }
+
+    private:
+        std::vector<ImageLayoutState*> m_pending;
+        std::vector<VkImageMemoryBarrier2> m_barriers;
+        BarrierBatcherStats m_stats;
+    };
+}  // namespace HWPT
+
+#endif //HARDWAREPATHTRACER_BARRIERBATCHER_H
@@ -3,14 +3,16 @@
 //
 
 #include "Sampler.h"
+#include "core/application/VulkanBackendApp.h"
 
 
 namespace HWPT {
-    Sampler::Sampler() {
+    Sampler::Sampler(VkSamplerAddressMode AddressMode) : m_addressMode(AddressMode) {
         CreateSampler();
     }
 
     Sampler::~Sampler() {
+        VulkanBackendApp::GetApplication()->GetDescriptorCache()->EvictSampler(m_sampler);
         vkDestroySampler(GetVKDevice(), m_sampler, nullptr);
     }
 
@@ -20,9 +22,9 @@ namespace HWPT {
         CreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         CreateInfo.magFilter = VK_FILTER_LINEAR;
         CreateInfo.minFilter = VK_FILTER_LINEAR;
-        CreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        CreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        CreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        CreateInfo.addressModeU = m_addressMode;
+        CreateInfo.addressModeV = m_addressMode;
+        CreateInfo.addressModeW = m_addressMode;
         CreateInfo.anisotropyEnable = VK_FALSE;
         CreateInfo.maxAnisotropy = 1.f;
         CreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
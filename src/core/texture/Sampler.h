@@ -11,7 +11,8 @@
 namespace HWPT {
     class Sampler {
     public:
-        Sampler();
+        // Linear filtering, AddressMode on every axis
+        explicit Sampler(VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
         ~Sampler();
 
@@ -23,6 +24,7 @@ namespace HWPT {
 
     private:
         VkSampler m_sampler = VK_NULL_HANDLE;
+        VkSamplerAddressMode m_addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     };
 }  // namespace HWPT
 
@@ -4,6 +4,7 @@
 
 #include "Texture2D.h"
 #include "core/RHI.h"
+#include "core/application/VulkanBackendApp.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 
@@ -60,6 +61,14 @@ namespace HWPT {
             default:
                 throw std::runtime_error("Unsupported TextureUsage");
         }
+        m_layoutState = ImageLayoutState(m_texture, GetVKImageAspect(m_format), m_numMips);
+    }
+
+    Texture2D::Texture2D(uint Width, uint Height, TextureFormat Format, const void *Pixels,
+                         bool GenerateMips)
+            : m_width(Width), m_height(Height), m_format(Format), m_generateMips(GenerateMips),
+              m_textureUsage(TextureUsage::SRV) {
+        UploadPixels(Pixels);
     }
 
     void Texture2D::CreateTexture(const std::filesystem::path &TexturePath) {
@@ -74,46 +83,39 @@ namespace HWPT {
         Check(Pixels);
         m_format = GetTextureFormat(Channels);
 
+        UploadPixels(Pixels);
+        stbi_image_free(Pixels);
+    }
+
+    void Texture2D::UploadPixels(const void *Pixels) {
         if (m_generateMips) {
             m_numMips = CalculateNumMips(m_width, m_height);
         }
 
-        VkDeviceSize MemorySize = m_width * m_height * 4;  // TODO
-        auto [StagingBuffer, StagingBufferMemory] = RHI::CreateStagingBuffer(MemorySize);
-
-        void *MappedData = nullptr;
-        vkMapMemory(GetVKDevice(), StagingBufferMemory, 0, MemorySize, 0, &MappedData);
-        memcpy(MappedData, Pixels, MemorySize);
-        vkUnmapMemory(GetVKDevice(), StagingBufferMemory);
-        stbi_image_free(Pixels);
-
+        VkDeviceSize MemorySize = static_cast<VkDeviceSize>(m_width) * m_height *
+                                  GetTextureFormatByteSize(m_format);
         RHI::CreateTexture2D(m_width, m_height, m_numMips, GetVKSampleCount(m_msaaSamples),
                              GetVKFormat(m_format),
                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                              VK_IMAGE_TILING_OPTIMAL, m_texture, m_textureMemory);
-        RHI::TransitionTextureLayout(m_texture, m_numMips,
-                                     VK_IMAGE_LAYOUT_UNDEFINED,
-                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        RHI::CopyBufferToTexture(m_texture, StagingBuffer, m_width, m_height);
-
-        if (m_generateMips) {
-            RHI::GenerateMips(m_texture, m_width, m_height, m_numMips);
-        } else {
-            RHI::TransitionTextureLayout(m_texture, m_numMips,
-                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                         VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
-        }
-
-        vkDestroyBuffer(GetVKDevice(), StagingBuffer, nullptr);
-        vkFreeMemory(GetVKDevice(), StagingBufferMemory, nullptr);
+        // The upload moves every mip of m_layoutState along with the transitions it records
+        m_layoutState = ImageLayoutState(m_texture, GetVKImageAspect(m_format), m_numMips);
+        VulkanBackendApp::GetApplication()->GetUploadManager()->UploadTexture(m_layoutState, m_width, m_height,
+                                                                             Pixels, MemorySize);
     }
 
     Texture2D::~Texture2D() {
+        VulkanBackendApp::GetApplication()->GetBarrierBatcher()->Discard(m_layoutState);
+        if (m_bindlessIndex != InvalidBindlessIndex) {
+            VulkanBackendApp::GetApplication()->GetBindlessHeap()->Release(BindlessType::SampledImage,
+                                                                          m_bindlessIndex);
+        }
         if (IsSRVCreated) {
+            VulkanBackendApp::GetApplication()->GetDescriptorCache()->EvictImageView(m_textureView);
             vkDestroyImageView(GetVKDevice(), m_textureView, nullptr);
         }
         vkDestroyImage(GetVKDevice(), m_texture, nullptr);
-        vkFreeMemory(GetVKDevice(), m_textureMemory, nullptr);
+        RHI::FreeMemory(m_textureMemory);
     }
 
     auto Texture2D::CreateSRV() -> VkImageView {
@@ -141,6 +143,19 @@ namespace HWPT {
         return m_textureView;
     }
 
+    auto Texture2D::GetBindlessIndex() -> uint {
+        if (m_bindlessIndex == InvalidBindlessIndex) {
+            m_bindlessIndex = VulkanBackendApp::GetApplication()->GetBindlessHeap()->RegisterSampledImage(CreateSRV());
+        }
+        return m_bindlessIndex;
+    }
+
+    void Texture2D::TransitionLayout(VkImageLayout NewLayout, VkPipelineStageFlags2 Stage, VkAccessFlags2 Access,
+                                     uint BaseMip, uint NumMips) {
+        VulkanBackendApp::GetApplication()->GetBarrierBatcher()->Transition(m_layoutState, NewLayout, Stage, Access,
+                                                                            BaseMip, NumMips);
+    }
+
     auto Texture2D::CalculateNumMips(uint Width, uint Height) -> uint {
         uint MaxResolution = std::max(Width, Height);
         return static_cast<uint>(std::floor(std::log2(MaxResolution))) + 1;
@@ -6,11 +6,15 @@
 #define HARDWAREPATHTRACER_TEXTURE2D_H
 
 #include "TextureShared.h"
+#include "BarrierBatcher.h"
+#include "core/descriptor/BindlessHeap.h"
 #include <filesystem>
 #include "core/texture/Sampler.h"
 
 
 namespace HWPT {
+    struct MemoryAllocation;
+
     // TODO
 //    class Texture2DDesc {
 //    public:
@@ -26,21 +30,51 @@ namespace HWPT {
         Texture2D(uint Width, uint Height, TextureFormat Format, TextureUsage Usage,
                   uint MSAASample = 1, bool GenerateMips = false);
 
+        // ShaderResourceView initialized from tightly packed Pixels, e.g. float HDR data
+        Texture2D(uint Width, uint Height, TextureFormat Format, const void* Pixels,
+                  bool GenerateMips = false);
+
         ~Texture2D();
 
         void CreateTexture(const std::filesystem::path& TexturePath);
 
         auto CreateSRV() -> VkImageView;
 
+        // Index of the SRV in the application's BindlessHeap, registered on first use and kept until destruction
+        auto GetBindlessIndex() -> uint;
+
         auto GetHandle() -> VkImage& {
             return m_texture;
         }
 
+        [[nodiscard]] auto GetWidth() const -> uint {
+            return m_width;
+        }
+
+        [[nodiscard]] auto GetHeight() const -> uint {
+            return m_height;
+        }
+
+        [[nodiscard]] auto GetNumMips() const -> uint {
+            return m_numMips;
+        }
+
+        // Current layout of every mip, uploaded textures start in READ_ONLY_OPTIMAL
+        auto GetLayoutState() -> ImageLayoutState& {
+            return m_layoutState;
+        }
+
+        // Queues the transition of the mips in [BaseMip, BaseMip + NumMips) on the application's BarrierBatcher
+        void TransitionLayout(VkImageLayout NewLayout, VkPipelineStageFlags2 Stage = VK_PIPELINE_STAGE_2_NONE,
+                              VkAccessFlags2 Access = VK_ACCESS_2_NONE, uint BaseMip = 0, uint NumMips = ~0u);
+
     private:
+        void UploadPixels(const void* Pixels);
+
         static auto CalculateNumMips(uint Width, uint Height) -> uint;
 
         VkImage m_texture = VK_NULL_HANDLE;
-        VkDeviceMemory m_textureMemory = VK_NULL_HANDLE;
+        MemoryAllocation* m_textureMemory = nullptr;
         uint m_width = 0, m_height = 0;
         TextureFormat m_format = TextureFormat::None;
         void* m_mappedData = nullptr;
@@ -50,6 +84,8 @@ namespace HWPT {
         bool m_generateMips = false;
         uint m_msaaSamples = 1;
         TextureUsage m_textureUsage = TextureUsage::None;
+        ImageLayoutState m_layoutState;
+        uint m_bindlessIndex = InvalidBindlessIndex;
     };
 }  // namespace HWPT
 
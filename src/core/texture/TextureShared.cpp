@@ -24,6 +24,12 @@ namespace HWPT {
                 [[fallthrough]];
             case TextureFormat::RGBA:
                 return VK_FORMAT_R8G8B8A8_SRGB;
+            case TextureFormat::RGBA32F:
+                return VK_FORMAT_R32G32B32A32_SFLOAT;
+            case TextureFormat::RG16F:
+                return VK_FORMAT_R16G16_SFLOAT;
+            case TextureFormat::R16F:
+                return VK_FORMAT_R16_SFLOAT;
             case TextureFormat::Depth32:
                 return VK_FORMAT_D32_SFLOAT;
             case TextureFormat::Depth32Stencil8:
@@ -43,6 +49,45 @@ namespace HWPT {
                Format == TextureFormat::Depth24Stencil8;
     }
 
+    auto GetVKImageAspect(TextureFormat Format) -> VkImageAspectFlags {
+        switch (Format) {
+            case TextureFormat::Depth32:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            case TextureFormat::Depth32Stencil8:
+                [[fallthrough]];
+            case TextureFormat::Depth24Stencil8:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    auto GetTextureFormatByteSize(TextureFormat Format) -> uint {
+        switch (Format) {
+            case TextureFormat::R16F:
+                return 2;
+            case TextureFormat::RGB:
+                [[fallthrough]];  // Expanded to RGBA on load
+            case TextureFormat::RGBA:
+                [[fallthrough]];
+            case TextureFormat::RG16F:
+                [[fallthrough]];
+            case TextureFormat::Depth32:
+                [[fallthrough]];
+            case TextureFormat::Depth24Stencil8:
+                return 4;
+            case TextureFormat::Depth32Stencil8:
+                return 8;
+            case TextureFormat::RGBA32F:
+                return 16;
+            case TextureFormat::None:
+                [[fallthrough]];
+            default:
+                Check(false);
+                return 0;
+        }
+    }
+
     auto GetVKSampleCount(uint SampleCount) -> VkSampleCountFlagBits {
         switch (SampleCount) {
             case 1:
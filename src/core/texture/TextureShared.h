@@ -14,6 +14,9 @@ namespace HWPT {
         None = 0x0,
         RGB,
         RGBA,
+        RGBA32F,
+        RG16F,
+        R16F,
         Depth32,
         Depth32Stencil8,
         Depth24Stencil8
@@ -25,6 +28,11 @@ namespace HWPT {
 
     auto IsDepthStencilTexture(TextureFormat Format) -> bool;
 
+    // Every aspect of the format, what barriers on the whole image need
+    auto GetVKImageAspect(TextureFormat Format) -> VkImageAspectFlags;
+
+    auto GetTextureFormatByteSize(TextureFormat Format) -> uint;
+
     auto GetVKSampleCount(uint SampleCount) -> VkSampleCountFlagBits;
   
     enum class TextureUsage : uint8_t {